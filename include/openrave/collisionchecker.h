@@ -68,10 +68,7 @@ public:
         dReal depth; ///< the penetration depth, positive means the surfaces are penetrating, negative means the surfaces are not colliding (used for distance queries)
     };
 
-    CollisionReport() {
-        nKeepPrevious = 0;
-        Reset();
-    }
+    CollisionReport();
 
     /// \brief resets the report structure for the next collision call
     ///
@@ -97,6 +94,13 @@ public:
 
 typedef CollisionReport COLLISIONREPORT RAVE_DEPRECATED;
 
+/** \brief Returns a reset collision report from a pool owned by the calling thread.
+
+    The report goes back to the pool once all references to it are released, so code that needs a temporary report for every collision call does not allocate in steady state. The contacts and link pairs keep their capacity between uses. If only the result of a collision call is needed, pass an empty CollisionReportPtr instead, checkers skip filling the report completely then.
+    The number of allocated reports is counted under "CollisionReport.Allocations" in \ref RaveGetProfilingStats, and the number of times the contacts or link pairs of a pooled report had to grow is counted under "CollisionReport.ContactReallocations" when the report is acquired again.
+ */
+OPENRAVE_API CollisionReportPtr RaveAcquireCollisionReport();
+
 /** \brief <b>[interface]</b> Responsible for all collision checking queries of the environment. <b>If not specified, method is not multi-thread safe.</b> See \ref arch_collisionchecker.
     \ingroup interfaces
  */
@@ -199,6 +203,18 @@ public:
     /// \param[out] report [optional] collision report to be filled with data about the collision. If a body was hit, CollisionReport::plink1 contains the hit link pointer.
     virtual bool CheckCollision(const RAY& ray, CollisionReportPtr report = CollisionReportPtr()) = 0;
 
+    /** \brief Checks many rays against the environment in one call and returns the closest hit of each ray.
+
+        Every ray is checked like \ref CheckCollision(const RAY&, CollisionReportPtr) with CO_Distance set. Checkers that override it do not have to call the registered collision callbacks.
+
+        The default implementation loops over the rays, checkers can override it to synchronize and traverse their broadphase structures once for the whole batch.
+        \param vrays the rays. The length of each ray is the length of its direction.
+        \param[out] vdistances one entry per ray, the distance from the ray origin to the closest hit, or -1 if the ray did not hit anything
+        \param[out] vbodyids one entry per ray, the environment id of the body that was hit (KinBody::GetEnvironmentId), or 0 if nothing was hit
+        \return the number of rays that hit something
+     */
+    virtual int CheckCollisionRays(const std::vector<RAY>& vrays, std::vector<dReal>& vdistances, std::vector<int>& vbodyids);
+
     /// \brief Checks self collision only with the links of the passed in body.
     ///
     /// Only checks KinBody::GetNonAdjacentLinks(), Links that are joined together are ignored.
@@ -212,6 +228,19 @@ public:
     /// \param[out] report [optional] collision report to be filled with data about the collision.
     virtual bool CheckStandaloneSelfCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report = CollisionReportPtr()) = 0;
 
+    /** \brief Checks many configurations of a body against the scene in one call.
+
+        The configurations are stored back to back in vconfigs. If CO_ActiveDOFs is set and pbody is a robot, each configuration has RobotBase::GetActiveDOF() values and is set with RobotBase::SetActiveDOFValues, otherwise each configuration has KinBody::GetDOF() values. Limits are not checked. The state of the body is restored before returning. No report is filled, checking stops at the first collision of every configuration. As with \ref CheckCollision, a body without links or that is disabled is never in collision, and self collision is only checked for bodies with more than one link.
+
+        The default implementation loops over the configurations and calls \ref CheckCollision and \ref CheckStandaloneSelfCollision, checkers can override it to keep their internal structures alive across the batch.
+        \param pbody the body to set the configurations on
+        \param vconfigs the configurations, its size has to be a multiple of the number of dofs
+        \param[out] vresults one entry per configuration, 1 if the configuration is in collision, 0 otherwise
+        \param bCheckSelfCollision if true, will also check self collision of pbody
+        \return the number of configurations in collision
+     */
+    virtual int CheckCollisionBatch(KinBodyPtr pbody, const std::vector<dReal>& vconfigs, std::vector<uint8_t>& vresults, bool bCheckSelfCollision=true);
+
     /// \deprecated (13/04/09)
     virtual bool CheckSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) RAVE_DEPRECATED
     {
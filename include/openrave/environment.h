@@ -465,37 +465,66 @@ public:
     
     /// \brief Retrieve published bodies, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Copies the states of the latest \ref GetPublishedBodiesSnapshot, no mutex is locked.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBodies returns.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, kept for compatibility
     virtual void GetPublishedBodies(std::vector<KinBody::BodyState>& vbodies, uint64_t timeout=0) = 0;
 
+    /// \brief published bodies of one \ref UpdatePublishedBodies call, never modified once published
+    class PublishedBodies
+    {
+public:
+        PublishedBodies() : version(0), removedhistoryversion(0) {
+        }
+        virtual ~PublishedBodies() {
+        }
+
+        uint64_t version; ///< increases by one every time the published bodies are updated
+        std::vector<KinBody::BodyStateConstPtr> vbodystates; ///< the published bodies. The states of the bodies that did not change are shared with the previous snapshots.
+        std::vector<uint64_t> vbodyversions; ///< for every element of vbodystates, the version its state last changed
+        std::vector< std::pair<int, uint64_t> > vremovedbodies; ///< (environment id, version) of the recently unpublished bodies, ordered by version
+        uint64_t removedhistoryversion; ///< vremovedbodies holds all the bodies unpublished after this version
+    };
+    typedef boost::shared_ptr<PublishedBodies const> PublishedBodiesConstPtr;
+
+    /// \brief Returns the latest published bodies without locking any mutex or copying any state. <b>[multi-thread safe]</b>
+    ///
+    /// The snapshot is immutable, so it can be kept and read while the environment publishes new ones.
+    /// Note that the pbody pointers might become invalid as soon as the body is removed from the environment.
+    virtual PublishedBodiesConstPtr GetPublishedBodiesSnapshot() const = 0;
+
+    /// \brief Retrieves the published bodies that changed since a previous snapshot. <b>[multi-thread safe]</b>
+    ///
+    /// Removals should be applied before changes since a removed environment id can be reused by a new body.
+    /// \param version the PublishedBodies::version that the caller last saw, 0 if none
+    /// \param vchangedbodies filled with the states of the bodies that were published or changed after version
+    /// \param vremovedbodyids filled with the environment ids of the bodies that were unpublished after version
+    /// \param newversion set to the version of the snapshot the changes lead to, the version to pass next time
+    /// \return true if the changes are incremental. If false, version is too old, vchangedbodies holds all the published bodies and vremovedbodyids is empty, so the caller should drop any body not in vchangedbodies.
+    virtual bool GetPublishedBodiesChangedSince(uint64_t version, std::vector<KinBody::BodyStateConstPtr>& vchangedbodies, std::vector<int>& vremovedbodyids, uint64_t& newversion) const = 0;
+
     /// \brief Retrieve published body of specified name, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Reads the latest \ref GetPublishedBodiesSnapshot, no mutex is locked.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBody returns.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, kept for compatibility
     /// \return true if name matches to a published body
     virtual bool GetPublishedBody(const std::string& name, KinBody::BodyState& bodystate, uint64_t timeout=0) = 0;
     
     /// \brief Retrieve joint values of published body of specified name, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Reads the latest \ref GetPublishedBodiesSnapshot, no mutex is locked.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBodyJointValues returns.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, kept for compatibility
     /// \return true if name matches to a published body
     virtual bool GetPublishedBodyJointValues(const std::string& name, std::vector<dReal> &jointValues, uint64_t timeout=0) = 0;
 
     /// \brief Retrieve body transform of all published bodies whose name matches prefix, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Reads the latest \ref GetPublishedBodiesSnapshot, no mutex is locked.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBody returns.
     /// \param prefix the prefix to match to the target names.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, kept for compatibility
     virtual void GetPublishedBodyTransformsMatchingPrefix(const std::string& prefix, std::vector<std::pair<std::string, Transform> >& nameTransfPairs, uint64_t timeout = 0) = 0;
 
     /// \brief Updates the published bodies that viewers and other programs listening in on the environment see.
@@ -39,6 +39,11 @@
 #define MATH_ASSERT assert
 #endif
 
+#if defined(OPENRAVE_SIMD_GEOMETRY) && OPENRAVE_SIMD_GEOMETRY && (defined(__SSE2__) || defined(_M_X64))
+#include <openrave/geometrysimd.h>
+#define OPENRAVE_GEOMETRY_HAS_SIMD_KERNELS
+#endif
+
 namespace OpenRAVE {
 
 /// Templated math and geometric functions
@@ -186,6 +191,146 @@ inline double MATH_ATAN2(double fy, double fx) {
 }
 #endif
 
+/// \brief Reference kernels for the quaternion and matrix products.
+///
+/// The arrays have the memory layout of RaveVector (x,y,z,w) and RaveTransformMatrix::m. When OPENRAVE_SIMD_GEOMETRY
+/// is set, the float and double versions are dispatched to the kernels in \ref geometrysimd.h that are faster than these ones (see geometrybenchmark), which compute the same results.
+namespace scalar {
+
+/// \brief q = q0*q1
+template <typename T>
+inline void QuatMultiply(const T* q0, const T* q1, T* q)
+{
+    T x = q0[0]*q1[0] - q0[1]*q1[1] - q0[2]*q1[2] - q0[3]*q1[3];
+    T y = q0[0]*q1[1] + q0[1]*q1[0] + q0[2]*q1[3] - q0[3]*q1[2];
+    T z = q0[0]*q1[2] + q0[2]*q1[0] + q0[3]*q1[1] - q0[1]*q1[3];
+    T w = q0[0]*q1[3] + q0[3]*q1[0] + q0[1]*q1[2] - q0[2]*q1[1];
+    q[0] = x; q[1] = y; q[2] = z; q[3] = w;
+}
+
+/// \brief out = rotation of the 3 values of v by quaternion q
+template <typename T>
+inline void QuatRotate(const T* q, const T* v, T* out)
+{
+    T xx = 2 * q[1] * q[1];
+    T xy = 2 * q[1] * q[2];
+    T xz = 2 * q[1] * q[3];
+    T xw = 2 * q[1] * q[0];
+    T yy = 2 * q[2] * q[2];
+    T yz = 2 * q[2] * q[3];
+    T yw = 2 * q[2] * q[0];
+    T zz = 2 * q[3] * q[3];
+    T zw = 2 * q[3] * q[0];
+    T x = (1-yy-zz) * v[0] + (xy-zw) * v[1] + (xz+yw)*v[2];
+    T y = (xy+zw) * v[0] + (1-xx-zz) * v[1] + (yz-xw)*v[2];
+    T z = (xz-yw) * v[0] + (yz+xw) * v[1] + (1-xx-yy)*v[2];
+    out[0] = x; out[1] = y; out[2] = z;
+}
+
+/// \brief [m,t] = [m0,t0]*[m1,t1] for 3x4 transformation matrices. t has 4 values, the last is set to 0
+///
+/// m and t cannot alias the inputs.
+template <typename T>
+inline void MatrixMultiply(const T* m0, const T* t0, const T* m1, const T* t1, T* m, T* t)
+{
+    for(int i = 0; i < 3; ++i) {
+        m[4*i+0] = m0[4*i+0]*m1[0*4+0]+m0[4*i+1]*m1[1*4+0]+m0[4*i+2]*m1[2*4+0];
+        m[4*i+1] = m0[4*i+0]*m1[0*4+1]+m0[4*i+1]*m1[1*4+1]+m0[4*i+2]*m1[2*4+1];
+        m[4*i+2] = m0[4*i+0]*m1[0*4+2]+m0[4*i+1]*m1[1*4+2]+m0[4*i+2]*m1[2*4+2];
+    }
+    t[0] = t1[0] * m0[0] + t1[1] * m0[1] + t1[2] * m0[2] + t0[0];
+    t[1] = t1[0] * m0[4] + t1[1] * m0[5] + t1[2] * m0[6] + t0[1];
+    t[2] = t1[0] * m0[8] + t1[1] * m0[9] + t1[2] * m0[10] + t0[2];
+    t[3] = 0;
+}
+
+/// \brief [minv,tinv] = inverse of [m,t] for 3x4 transformation matrices, the rotation part does not have to be orthonormal. tinv has 4 values, the last is set to -0. The padding elements of minv are not changed.
+///
+/// minv and tinv cannot alias the inputs.
+template <typename T>
+inline void MatrixInverse(const T* m, const T* t, T* minv, T* tinv)
+{
+    // inverse = C^t / det(pf) where C is the matrix of coefficients
+    minv[0*4+0] = m[1*4 + 1] * m[2*4 + 2] - m[1*4 + 2] * m[2*4 + 1];
+    minv[0*4+1] = m[0*4 + 2] * m[2*4 + 1] - m[0*4 + 1] * m[2*4 + 2];
+    minv[0*4+2] = m[0*4 + 1] * m[1*4 + 2] - m[0*4 + 2] * m[1*4 + 1];
+    minv[1*4+0] = m[1*4 + 2] * m[2*4 + 0] - m[1*4 + 0] * m[2*4 + 2];
+    minv[1*4+1] = m[0*4 + 0] * m[2*4 + 2] - m[0*4 + 2] * m[2*4 + 0];
+    minv[1*4+2] = m[0*4 + 2] * m[1*4 + 0] - m[0*4 + 0] * m[1*4 + 2];
+    minv[2*4+0] = m[1*4 + 0] * m[2*4 + 1] - m[1*4 + 1] * m[2*4 + 0];
+    minv[2*4+1] = m[0*4 + 1] * m[2*4 + 0] - m[0*4 + 0] * m[2*4 + 1];
+    minv[2*4+2] = m[0*4 + 0] * m[1*4 + 1] - m[0*4 + 1] * m[1*4 + 0];
+    T fdet = m[0*4 + 2] * minv[2*4+0] + m[1*4 + 2] * minv[2*4+1] + m[2*4 + 2] * minv[2*4+2];
+    MATH_ASSERT(fdet>=0);
+    fdet = 1 / fdet;
+    minv[0*4+0] *= fdet;           minv[0*4+1] *= fdet;           minv[0*4+2] *= fdet;
+    minv[1*4+0] *= fdet;           minv[1*4+1] *= fdet;           minv[1*4+2] *= fdet;
+    minv[2*4+0] *= fdet;           minv[2*4+1] *= fdet;           minv[2*4+2] *= fdet;
+    tinv[0] = -(t[0] * minv[0] + t[1] * minv[1] + t[2] * minv[2]);
+    tinv[1] = -(t[0] * minv[4] + t[1] * minv[5] + t[2] * minv[6]);
+    tinv[2] = -(t[0] * minv[8] + t[1] * minv[9] + t[2] * minv[10]);
+    tinv[3] = -T(0);
+}
+
+/// \brief returns true if the box is on the positive side of all planes
+///
+/// pos, right, up, dir, and extents are the members of an obb. vplanes holds numplanes x components of the plane normals, followed by numplanes y, z, and w components.
+template <typename T>
+inline bool IsOBBinPlanes(const T* pos, const T* right, const T* up, const T* dir, const T* extents, const T* vplanes, size_t numplanes)
+{
+    const T* px = vplanes, *py = vplanes+numplanes, *pz = vplanes+2*numplanes, *pw = vplanes+3*numplanes;
+    for(size_t i = 0; i < numplanes; ++i) {
+        if( pos[0]*px[i] + pos[1]*py[i] + pos[2]*pz[i] + pw[i] < extents[0] * MATH_FABS(px[i]*right[0] + py[i]*right[1] + pz[i]*right[2]) + extents[1] * MATH_FABS(px[i]*up[0] + py[i]*up[1] + pz[i]*up[2]) + extents[2] * MATH_FABS(px[i]*dir[0] + py[i]*dir[1] + pz[i]*dir[2]) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // end namespace scalar
+
+template <typename T> inline void _QuatMultiply(const T* q0, const T* q1, T* q) {
+    scalar::QuatMultiply(q0,q1,q);
+}
+template <typename T> inline void _QuatRotate(const T* q, const T* v, T* out) {
+    scalar::QuatRotate(q,v,out);
+}
+template <typename T> inline void _MatrixMultiply(const T* m0, const T* t0, const T* m1, const T* t1, T* m, T* t) {
+    scalar::MatrixMultiply(m0,t0,m1,t1,m,t);
+}
+template <typename T> inline void _MatrixInverse(const T* m, const T* t, T* minv, T* tinv) {
+    scalar::MatrixInverse(m,t,minv,tinv);
+}
+template <typename T> inline bool _IsOBBinPlanes(const T* pos, const T* right, const T* up, const T* dir, const T* extents, const T* vplanes, size_t numplanes) {
+    return scalar::IsOBBinPlanes(pos,right,up,dir,extents,vplanes,numplanes);
+}
+#ifdef OPENRAVE_GEOMETRY_HAS_SIMD_KERNELS
+// QuatRotate and the double QuatMultiply have no SIMD kernels, they are not faster than the scalar ones.
+inline void _QuatMultiply(const float* q0, const float* q1, float* q) {
+    simd::QuatMultiply(q0,q1,q);
+}
+inline void _MatrixMultiply(const float* m0, const float* t0, const float* m1, const float* t1, float* m, float* t) {
+    simd::MatrixMultiply(m0,t0,m1,t1,m,t);
+}
+inline void _MatrixMultiply(const double* m0, const double* t0, const double* m1, const double* t1, double* m, double* t) {
+    simd::MatrixMultiply(m0,t0,m1,t1,m,t);
+}
+inline void _MatrixInverse(const float* m, const float* t, float* minv, float* tinv) {
+    simd::MatrixInverse(m,t,minv,tinv);
+}
+#ifdef __AVX2__
+inline void _MatrixInverse(const double* m, const double* t, double* minv, double* tinv) {
+    simd::MatrixInverse(m,t,minv,tinv);
+}
+#endif
+inline bool _IsOBBinPlanes(const float* pos, const float* right, const float* up, const float* dir, const float* extents, const float* vplanes, size_t numplanes) {
+    return simd::IsOBBinPlanes(pos,right,up,dir,extents,vplanes,numplanes);
+}
+inline bool _IsOBBinPlanes(const double* pos, const double* right, const double* up, const double* dir, const double* extents, const double* vplanes, size_t numplanes) {
+    return simd::IsOBBinPlanes(pos,right,up,dir,extents,vplanes,numplanes);
+}
+#endif
+
 /** \brief Vector class containing 4 dimensions.
 
     \ingroup affine_math
@@ -402,20 +547,8 @@ public:
 
     /// transform a vector by the rotation component only
     inline RaveVector<T> rotate(const RaveVector<T>& r) const {
-        T xx = 2 * rot.y * rot.y;
-        T xy = 2 * rot.y * rot.z;
-        T xz = 2 * rot.y * rot.w;
-        T xw = 2 * rot.y * rot.x;
-        T yy = 2 * rot.z * rot.z;
-        T yz = 2 * rot.z * rot.w;
-        T yw = 2 * rot.z * rot.x;
-        T zz = 2 * rot.w * rot.w;
-        T zw = 2 * rot.w * rot.x;
-
         RaveVector<T> v;
-        v.x = (1-yy-zz) * r.x + (xy-zw) * r.y + (xz+yw)*r.z;
-        v.y = (xy+zw) * r.x + (1-xx-zz) * r.y + (yz-xw)*r.z;
-        v.z = (xz-yw) * r.x + (yz+xw) * r.y + (1-xx-yy)*r.z;
+        _QuatRotate(&rot.x, &r.x, &v.x);
         return v;
     }
 
@@ -423,10 +556,7 @@ public:
     inline RaveTransform<T> rotate(const RaveTransform<T>& r) const {
         RaveTransform<T> t;
         t.trans = rotate(r.trans);
-        t.rot.x = rot.x*r.rot.x - rot.y*r.rot.y - rot.z*r.rot.z - rot.w*r.rot.w;
-        t.rot.y = rot.x*r.rot.y + rot.y*r.rot.x + rot.z*r.rot.w - rot.w*r.rot.z;
-        t.rot.z = rot.x*r.rot.z + rot.z*r.rot.x + rot.w*r.rot.y - rot.y*r.rot.w;
-        t.rot.w = rot.x*r.rot.w + rot.w*r.rot.x + rot.y*r.rot.z - rot.z*r.rot.y;
+        _QuatMultiply(&rot.x, &r.rot.x, &t.rot.x);
         // normalize the transformation
         MATH_ASSERT( t.rot.lengthsqr4() > 0.99f && t.rot.lengthsqr4() < 1.01f );
         t.rot.normalize4();
@@ -437,10 +567,7 @@ public:
     inline RaveTransform<T> operator* (const RaveTransform<T>&r) const {
         RaveTransform<T> t;
         t.trans = operator*(r.trans);
-        t.rot.x = rot.x*r.rot.x - rot.y*r.rot.y - rot.z*r.rot.z - rot.w*r.rot.w;
-        t.rot.y = rot.x*r.rot.y + rot.y*r.rot.x + rot.z*r.rot.w - rot.w*r.rot.z;
-        t.rot.z = rot.x*r.rot.z + rot.z*r.rot.x + rot.w*r.rot.y - rot.y*r.rot.w;
-        t.rot.w = rot.x*r.rot.w + rot.w*r.rot.x + rot.y*r.rot.z - rot.z*r.rot.y;
+        _QuatMultiply(&rot.x, &r.rot.x, &t.rot.x);
         // normalize the transformation
         MATH_ASSERT( t.rot.lengthsqr4() > 0.99f && t.rot.lengthsqr4() < 1.01f );
         t.rot.normalize4();
@@ -530,18 +657,7 @@ public:
     /// t = this * r
     inline RaveTransformMatrix<T> operator* (const RaveTransformMatrix<T>&r) const {
         RaveTransformMatrix<T> t;
-        t.m[0*4+0] = m[0*4+0]*r.m[0*4+0]+m[0*4+1]*r.m[1*4+0]+m[0*4+2]*r.m[2*4+0];
-        t.m[0*4+1] = m[0*4+0]*r.m[0*4+1]+m[0*4+1]*r.m[1*4+1]+m[0*4+2]*r.m[2*4+1];
-        t.m[0*4+2] = m[0*4+0]*r.m[0*4+2]+m[0*4+1]*r.m[1*4+2]+m[0*4+2]*r.m[2*4+2];
-        t.m[1*4+0] = m[1*4+0]*r.m[0*4+0]+m[1*4+1]*r.m[1*4+0]+m[1*4+2]*r.m[2*4+0];
-        t.m[1*4+1] = m[1*4+0]*r.m[0*4+1]+m[1*4+1]*r.m[1*4+1]+m[1*4+2]*r.m[2*4+1];
-        t.m[1*4+2] = m[1*4+0]*r.m[0*4+2]+m[1*4+1]*r.m[1*4+2]+m[1*4+2]*r.m[2*4+2];
-        t.m[2*4+0] = m[2*4+0]*r.m[0*4+0]+m[2*4+1]*r.m[1*4+0]+m[2*4+2]*r.m[2*4+0];
-        t.m[2*4+1] = m[2*4+0]*r.m[0*4+1]+m[2*4+1]*r.m[1*4+1]+m[2*4+2]*r.m[2*4+1];
-        t.m[2*4+2] = m[2*4+0]*r.m[0*4+2]+m[2*4+1]*r.m[1*4+2]+m[2*4+2]*r.m[2*4+2];
-        t.trans[0] = r.trans[0] * m[0] + r.trans[1] * m[1] + r.trans[2] * m[2] + trans.x;
-        t.trans[1] = r.trans[0] * m[4] + r.trans[1] * m[5] + r.trans[2] * m[6] + trans.y;
-        t.trans[2] = r.trans[0] * m[8] + r.trans[1] * m[9] + r.trans[2] * m[10] + trans.z;
+        _MatrixMultiply(m, &trans.x, r.m, &r.trans.x, t.m, &t.trans.x);
         return t;
     }
 
@@ -578,25 +694,8 @@ public:
 
     /// being on the safe side, do the full inverse incase someone uses scaling.
     inline RaveTransformMatrix<T> inverse() const {
-        // inverse = C^t / det(pf) where C is the matrix of coefficients
-        // calc C^t
         RaveTransformMatrix<T> inv;
-        inv.m[0*4+0] = m[1*4 + 1] * m[2*4 + 2] - m[1*4 + 2] * m[2*4 + 1];
-        inv.m[0*4+1] = m[0*4 + 2] * m[2*4 + 1] - m[0*4 + 1] * m[2*4 + 2];
-        inv.m[0*4+2] = m[0*4 + 1] * m[1*4 + 2] - m[0*4 + 2] * m[1*4 + 1];
-        inv.m[1*4+0] = m[1*4 + 2] * m[2*4 + 0] - m[1*4 + 0] * m[2*4 + 2];
-        inv.m[1*4+1] = m[0*4 + 0] * m[2*4 + 2] - m[0*4 + 2] * m[2*4 + 0];
-        inv.m[1*4+2] = m[0*4 + 2] * m[1*4 + 0] - m[0*4 + 0] * m[1*4 + 2];
-        inv.m[2*4+0] = m[1*4 + 0] * m[2*4 + 1] - m[1*4 + 1] * m[2*4 + 0];
-        inv.m[2*4+1] = m[0*4 + 1] * m[2*4 + 0] - m[0*4 + 0] * m[2*4 + 1];
-        inv.m[2*4+2] = m[0*4 + 0] * m[1*4 + 1] - m[0*4 + 1] * m[1*4 + 0];
-        T fdet = m[0*4 + 2] * inv.m[2*4+0] + m[1*4 + 2] * inv.m[2*4+1] + m[2*4 + 2] * inv.m[2*4+2];
-        MATH_ASSERT(fdet>=0);
-        fdet = 1 / fdet;
-        inv.m[0*4+0] *= fdet;           inv.m[0*4+1] *= fdet;           inv.m[0*4+2] *= fdet;
-        inv.m[1*4+0] *= fdet;           inv.m[1*4+1] *= fdet;           inv.m[1*4+2] *= fdet;
-        inv.m[2*4+0] *= fdet;           inv.m[2*4+1] *= fdet;           inv.m[2*4+2] *= fdet;
-        inv.trans = -inv.rotate(trans);
+        _MatrixInverse(m, &trans.x, inv.m, &inv.trans.x);
         return inv;
     }
 
@@ -955,10 +1054,8 @@ template <typename T> inline RaveTransformMatrix<T> matrixFromAxisAngle(const Ra
 template <typename T>
 inline RaveVector<T> quatMultiply(const RaveVector<T>& quat0, const RaveVector<T>& quat1)
 {
-    RaveVector<T> q(quat0.x*quat1.x - quat0.y*quat1.y - quat0.z*quat1.z - quat0.w*quat1.w,
-                    quat0.x*quat1.y + quat0.y*quat1.x + quat0.z*quat1.w - quat0.w*quat1.z,
-                    quat0.x*quat1.z + quat0.z*quat1.x + quat0.w*quat1.y - quat0.y*quat1.w,
-                    quat0.x*quat1.w + quat0.w*quat1.x + quat0.y*quat1.z - quat0.z*quat1.y);
+    RaveVector<T> q;
+    _QuatMultiply(&quat0.x, &quat1.x, &q.x);
     // do not normalize since some quaternion math (like derivatives) do not correspond to unit quaternions
     return q;
 }
@@ -1069,19 +1166,8 @@ inline RaveVector<T> dQSlerp(const RaveVector<T>& quat0, const RaveVector<T>& qu
 template <typename T>
 RaveVector<T> quatRotate(const RaveVector<T>& q, const RaveVector<T>& t)
 {
-    T xx = 2 * q.y * q.y;
-    T xy = 2 * q.y * q.z;
-    T xz = 2 * q.y * q.w;
-    T xw = 2 * q.y * q.x;
-    T yy = 2 * q.z * q.z;
-    T yz = 2 * q.z * q.w;
-    T yw = 2 * q.z * q.x;
-    T zz = 2 * q.w * q.w;
-    T zw = 2 * q.w * q.x;
     RaveVector<T> v;
-    v.x = (1-yy-zz) * t.x + (xy-zw) * t.y + (xz+yw)*t.z;
-    v.y = (xy+zw) * t.x + (1-xx-zz) * t.y + (yz-xw)*t.z;
-    v.z = (xz-yw) * t.x + (yz+xw) * t.y + (1-xx-yy)*t.z;
+    _QuatRotate(&q.x, &t.x, &v.x);
     return v;
 }
 
@@ -1602,6 +1688,17 @@ inline bool IsOBBinConvexHull(const obb<T>& o, const U& vplanes)
     return true;
 }
 
+/// \brief Tests if an oriented bounding box is inside a 3D convex hull whose planes are stored as a structure of arrays.
+///
+/// Gives the same results as \ref IsOBBinConvexHull(const obb<T>&, const U&). When OPENRAVE_SIMD_GEOMETRY is set, several planes are tested at once, so this is meant for testing many boxes or poses against the same number of planes.
+/// \ingroup geometric_primitives
+/// \param vplanes numplanes x components of the plane normals, followed by numplanes y, z, and w components. Normals should be facing inside.
+template <typename T>
+inline bool IsOBBinConvexHull(const obb<T>& o, const T* vplanes, size_t numplanes)
+{
+    return _IsOBBinPlanes(&o.pos.x, &o.right.x, &o.up.x, &o.dir.x, &o.extents.x, vplanes, numplanes);
+}
+
 //bool SphereSphereTest(const SPHERE& s1, const SPHERE& s2)
 //{
 //	return ( (s1.fRadius + s2.fRadius) * (s1.fRadius + s2.fRadius) >
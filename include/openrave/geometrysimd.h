@@ -0,0 +1,239 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2011 Rosen Diankov (rosen.diankov@gmail.com)
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/** \file   geometrysimd.h
+    \brief  SSE2/AVX2 kernels for the quaternion, matrix, and plane math of \ref geometry.h
+
+    Included by geometry.h when OPENRAVE_SIMD_GEOMETRY is set (see the OPT_SIMD_GEOMETRY cmake option) and the
+    compiler targets SSE2. The kernels perform the same floating-point operations in the same order as the scalar
+    kernels in geometry.h, so the results are identical. Only kernels that are faster than the scalar ones are kept, the
+    double MatrixInverse needs AVX2.
+
+    The arrays have the memory layout of RaveVector (x,y,z,w) and RaveTransformMatrix::m (3 rows of 4 values).
+ */
+#ifndef OPENRAVE_GEOMETRY_SIMD_H
+#define OPENRAVE_GEOMETRY_SIMD_H
+
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace OpenRAVE {
+namespace geometry {
+namespace simd {
+
+/// \brief q = q0*q1
+inline void QuatMultiply(const float* q0, const float* q1, float* q)
+{
+    const __m128 signfirst = _mm_castsi128_ps(_mm_set_epi32(0,0,0,(int)0x80000000));
+    const __m128 signall = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    __m128 b = _mm_loadu_ps(q1);
+    __m128 r = _mm_mul_ps(_mm_set1_ps(q0[0]), b);
+    r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(_mm_set_ps(q0[3],q0[2],q0[1],q0[1]), _mm_shuffle_ps(b,b,_MM_SHUFFLE(0,0,0,1))), signfirst));
+    r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(_mm_set_ps(q0[1],q0[3],q0[2],q0[2]), _mm_shuffle_ps(b,b,_MM_SHUFFLE(2,1,3,2))), signfirst));
+    r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(_mm_set_ps(q0[2],q0[1],q0[3],q0[3]), _mm_shuffle_ps(b,b,_MM_SHUFFLE(1,3,2,3))), signall));
+    _mm_storeu_ps(q, r);
+}
+
+/// \brief [m,t] = [m0,t0]*[m1,t1] for 3x4 transformation matrices. t has 4 values, the last is set to 0
+inline void MatrixMultiply(const float* m0, const float* t0, const float* m1, const float* t1, float* m, float* t)
+{
+    const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0,-1,-1,-1));
+    __m128 r0 = _mm_loadu_ps(m1), r1 = _mm_loadu_ps(m1+4), r2 = _mm_loadu_ps(m1+8);
+    for(int i = 0; i < 3; ++i) {
+        __m128 row = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m0[4*i+0]), r0), _mm_mul_ps(_mm_set1_ps(m0[4*i+1]), r1)), _mm_mul_ps(_mm_set1_ps(m0[4*i+2]), r2));
+        __m128 prev = _mm_loadu_ps(m+4*i);
+        // keep the padding element of m as is
+        _mm_storeu_ps(m+4*i, _mm_or_ps(_mm_and_ps(mask, row), _mm_andnot_ps(mask, prev)));
+    }
+    __m128 c0 = _mm_set_ps(0, m0[8], m0[4], m0[0]), c1 = _mm_set_ps(0, m0[9], m0[5], m0[1]), c2 = _mm_set_ps(0, m0[10], m0[6], m0[2]);
+    __m128 r = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t1[0]), c0), _mm_mul_ps(_mm_set1_ps(t1[1]), c1)), _mm_mul_ps(_mm_set1_ps(t1[2]), c2)), _mm_set_ps(0, t0[2], t0[1], t0[0]));
+    _mm_storeu_ps(t, r);
+}
+
+/// \brief returns a x b in the first 3 values
+inline __m128 _Cross(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(3,0,2,1)), _mm_shuffle_ps(b,b,_MM_SHUFFLE(3,1,0,2))), _mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(3,1,0,2)), _mm_shuffle_ps(b,b,_MM_SHUFFLE(3,0,2,1))));
+}
+
+/// \brief [minv,tinv] = inverse of [m,t], see scalar::MatrixInverse
+inline void MatrixInverse(const float* m, const float* t, float* minv, float* tinv)
+{
+    const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0,-1,-1,-1));
+    const __m128 signall = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    __m128 r0 = _mm_loadu_ps(m), r1 = _mm_loadu_ps(m+4), r2 = _mm_loadu_ps(m+8);
+    // the columns of the inverse before the division by the determinant
+    __m128 c0 = _Cross(r1, r2), c1 = _Cross(r2, r0), c2 = _Cross(r0, r1);
+    float fdet = m[2] * _mm_cvtss_f32(_mm_shuffle_ps(c0,c0,_MM_SHUFFLE(2,2,2,2))) + m[6] * _mm_cvtss_f32(_mm_shuffle_ps(c1,c1,_MM_SHUFFLE(2,2,2,2))) + m[10] * _mm_cvtss_f32(_mm_shuffle_ps(c2,c2,_MM_SHUFFLE(2,2,2,2)));
+    __m128 vdet = _mm_set1_ps(1 / fdet);
+    c0 = _mm_mul_ps(c0, vdet); c1 = _mm_mul_ps(c1, vdet); c2 = _mm_mul_ps(c2, vdet);
+    _mm_storeu_ps(tinv, _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t[0]), c0), _mm_mul_ps(_mm_set1_ps(t[1]), c1)), _mm_mul_ps(_mm_set1_ps(t[2]), c2)), signall));
+    tinv[3] = -0.0f;
+    __m128 c3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    // keep the padding elements of minv as is
+    _mm_storeu_ps(minv, _mm_or_ps(_mm_and_ps(mask, c0), _mm_andnot_ps(mask, _mm_loadu_ps(minv))));
+    _mm_storeu_ps(minv+4, _mm_or_ps(_mm_and_ps(mask, c1), _mm_andnot_ps(mask, _mm_loadu_ps(minv+4))));
+    _mm_storeu_ps(minv+8, _mm_or_ps(_mm_and_ps(mask, c2), _mm_andnot_ps(mask, _mm_loadu_ps(minv+8))));
+}
+
+/// \brief returns true if the box is on the positive side of all planes, see scalar::IsOBBinPlanes. Tests 4 planes at once.
+inline bool IsOBBinPlanes(const float* pos, const float* right, const float* up, const float* dir, const float* extents, const float* vplanes, size_t numplanes)
+{
+    const float* px = vplanes, *py = vplanes+numplanes, *pz = vplanes+2*numplanes, *pw = vplanes+3*numplanes;
+    const __m128 signall = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    size_t i = 0;
+    for(; i+4 <= numplanes; i += 4) {
+        __m128 x = _mm_loadu_ps(px+i), y = _mm_loadu_ps(py+i), z = _mm_loadu_ps(pz+i);
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(pos[0]), x), _mm_mul_ps(_mm_set1_ps(pos[1]), y)), _mm_mul_ps(_mm_set1_ps(pos[2]), z)), _mm_loadu_ps(pw+i));
+        __m128 fright = _mm_andnot_ps(signall, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(right[0])), _mm_mul_ps(y, _mm_set1_ps(right[1]))), _mm_mul_ps(z, _mm_set1_ps(right[2]))));
+        __m128 fup = _mm_andnot_ps(signall, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(up[0])), _mm_mul_ps(y, _mm_set1_ps(up[1]))), _mm_mul_ps(z, _mm_set1_ps(up[2]))));
+        __m128 fdir = _mm_andnot_ps(signall, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(dir[0])), _mm_mul_ps(y, _mm_set1_ps(dir[1]))), _mm_mul_ps(z, _mm_set1_ps(dir[2]))));
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(extents[0]), fright), _mm_mul_ps(_mm_set1_ps(extents[1]), fup)), _mm_mul_ps(_mm_set1_ps(extents[2]), fdir));
+        if( _mm_movemask_ps(_mm_cmplt_ps(d, r)) ) {
+            return false;
+        }
+    }
+    for(; i < numplanes; ++i) {
+        if( pos[0]*px[i] + pos[1]*py[i] + pos[2]*pz[i] + pw[i] < extents[0] * fabsf(px[i]*right[0] + py[i]*right[1] + pz[i]*right[2]) + extents[1] * fabsf(px[i]*up[0] + py[i]*up[1] + pz[i]*up[2]) + extents[2] * fabsf(px[i]*dir[0] + py[i]*dir[1] + pz[i]*dir[2]) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// \brief tests the remaining planes of the double versions of IsOBBinPlanes
+inline bool _IsOBBinPlanesTail(const double* pos, const double* right, const double* up, const double* dir, const double* extents, const double* vplanes, size_t numplanes, size_t i)
+{
+    const double* px = vplanes, *py = vplanes+numplanes, *pz = vplanes+2*numplanes, *pw = vplanes+3*numplanes;
+    for(; i < numplanes; ++i) {
+        if( pos[0]*px[i] + pos[1]*py[i] + pos[2]*pz[i] + pw[i] < extents[0] * fabs(px[i]*right[0] + py[i]*right[1] + pz[i]*right[2]) + extents[1] * fabs(px[i]*up[0] + py[i]*up[1] + pz[i]*up[2]) + extents[2] * fabs(px[i]*dir[0] + py[i]*dir[1] + pz[i]*dir[2]) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef __AVX2__
+
+/// \brief [m,t] = [m0,t0]*[m1,t1] for 3x4 transformation matrices. t has 4 values, the last is set to 0
+inline void MatrixMultiply(const double* m0, const double* t0, const double* m1, const double* t1, double* m, double* t)
+{
+    __m256d r0 = _mm256_loadu_pd(m1), r1 = _mm256_loadu_pd(m1+4), r2 = _mm256_loadu_pd(m1+8);
+    for(int i = 0; i < 3; ++i) {
+        __m256d row = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(m0[4*i+0]), r0), _mm256_mul_pd(_mm256_set1_pd(m0[4*i+1]), r1)), _mm256_mul_pd(_mm256_set1_pd(m0[4*i+2]), r2));
+        // keep the padding element of m as is
+        _mm256_storeu_pd(m+4*i, _mm256_blend_pd(row, _mm256_broadcast_sd(m+4*i+3), 8));
+    }
+    __m256d c0 = _mm256_set_pd(0, m0[8], m0[4], m0[0]), c1 = _mm256_set_pd(0, m0[9], m0[5], m0[1]), c2 = _mm256_set_pd(0, m0[10], m0[6], m0[2]);
+    __m256d r = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(t1[0]), c0), _mm256_mul_pd(_mm256_set1_pd(t1[1]), c1)), _mm256_mul_pd(_mm256_set1_pd(t1[2]), c2)), _mm256_set_pd(0, t0[2], t0[1], t0[0]));
+    _mm256_storeu_pd(t, r);
+}
+
+/// \brief returns a x b in the first 3 values
+inline __m256d _Cross(__m256d a, __m256d b)
+{
+    return _mm256_sub_pd(_mm256_mul_pd(_mm256_permute4x64_pd(a,_MM_SHUFFLE(3,0,2,1)), _mm256_permute4x64_pd(b,_MM_SHUFFLE(3,1,0,2))), _mm256_mul_pd(_mm256_permute4x64_pd(a,_MM_SHUFFLE(3,1,0,2)), _mm256_permute4x64_pd(b,_MM_SHUFFLE(3,0,2,1))));
+}
+
+/// \brief [minv,tinv] = inverse of [m,t], see scalar::MatrixInverse
+inline void MatrixInverse(const double* m, const double* t, double* minv, double* tinv)
+{
+    __m256d r0 = _mm256_loadu_pd(m), r1 = _mm256_loadu_pd(m+4), r2 = _mm256_loadu_pd(m+8);
+    // the columns of the inverse before the division by the determinant
+    __m256d c0 = _Cross(r1, r2), c1 = _Cross(r2, r0), c2 = _Cross(r0, r1);
+    double fdet = m[2] * _mm_cvtsd_f64(_mm256_extractf128_pd(c0,1)) + m[6] * _mm_cvtsd_f64(_mm256_extractf128_pd(c1,1)) + m[10] * _mm_cvtsd_f64(_mm256_extractf128_pd(c2,1));
+    __m256d vdet = _mm256_set1_pd(1 / fdet);
+    c0 = _mm256_mul_pd(c0, vdet); c1 = _mm256_mul_pd(c1, vdet); c2 = _mm256_mul_pd(c2, vdet);
+    _mm256_storeu_pd(tinv, _mm256_xor_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(t[0]), c0), _mm256_mul_pd(_mm256_set1_pd(t[1]), c1)), _mm256_mul_pd(_mm256_set1_pd(t[2]), c2)), _mm256_set1_pd(-0.0)));
+    tinv[3] = -0.0;
+    // transpose, the fourth column is 0
+    __m256d zero = _mm256_setzero_pd();
+    __m256d t0 = _mm256_unpacklo_pd(c0, c1), t1 = _mm256_unpackhi_pd(c0, c1), t2 = _mm256_unpacklo_pd(c2, zero), t3 = _mm256_unpackhi_pd(c2, zero);
+    // keep the padding elements of minv as is
+    _mm256_storeu_pd(minv, _mm256_blend_pd(_mm256_permute2f128_pd(t0, t2, 0x20), _mm256_broadcast_sd(minv+3), 8));
+    _mm256_storeu_pd(minv+4, _mm256_blend_pd(_mm256_permute2f128_pd(t1, t3, 0x20), _mm256_broadcast_sd(minv+7), 8));
+    _mm256_storeu_pd(minv+8, _mm256_blend_pd(_mm256_permute2f128_pd(t0, t2, 0x31), _mm256_broadcast_sd(minv+11), 8));
+}
+
+/// \brief returns true if the box is on the positive side of all planes, see scalar::IsOBBinPlanes. Tests 4 planes at once.
+inline bool IsOBBinPlanes(const double* pos, const double* right, const double* up, const double* dir, const double* extents, const double* vplanes, size_t numplanes)
+{
+    const double* px = vplanes, *py = vplanes+numplanes, *pz = vplanes+2*numplanes, *pw = vplanes+3*numplanes;
+    const __m256d signall = _mm256_set1_pd(-0.0);
+    size_t i = 0;
+    for(; i+4 <= numplanes; i += 4) {
+        __m256d x = _mm256_loadu_pd(px+i), y = _mm256_loadu_pd(py+i), z = _mm256_loadu_pd(pz+i);
+        __m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(pos[0]), x), _mm256_mul_pd(_mm256_set1_pd(pos[1]), y)), _mm256_mul_pd(_mm256_set1_pd(pos[2]), z)), _mm256_loadu_pd(pw+i));
+        __m256d fright = _mm256_andnot_pd(signall, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(right[0])), _mm256_mul_pd(y, _mm256_set1_pd(right[1]))), _mm256_mul_pd(z, _mm256_set1_pd(right[2]))));
+        __m256d fup = _mm256_andnot_pd(signall, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(up[0])), _mm256_mul_pd(y, _mm256_set1_pd(up[1]))), _mm256_mul_pd(z, _mm256_set1_pd(up[2]))));
+        __m256d fdir = _mm256_andnot_pd(signall, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(dir[0])), _mm256_mul_pd(y, _mm256_set1_pd(dir[1]))), _mm256_mul_pd(z, _mm256_set1_pd(dir[2]))));
+        __m256d r = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(extents[0]), fright), _mm256_mul_pd(_mm256_set1_pd(extents[1]), fup)), _mm256_mul_pd(_mm256_set1_pd(extents[2]), fdir));
+        if( _mm256_movemask_pd(_mm256_cmp_pd(d, r, _CMP_LT_OQ)) ) {
+            return false;
+        }
+    }
+    return _IsOBBinPlanesTail(pos, right, up, dir, extents, vplanes, numplanes, i);
+}
+
+#else // SSE2, two doubles per register
+
+/// \brief [m,t] = [m0,t0]*[m1,t1] for 3x4 transformation matrices. t has 4 values, the last is set to 0
+inline void MatrixMultiply(const double* m0, const double* t0, const double* m1, const double* t1, double* m, double* t)
+{
+    __m128d r0 = _mm_loadu_pd(m1), r1 = _mm_loadu_pd(m1+4), r2 = _mm_loadu_pd(m1+8);
+    __m128d s0 = _mm_load_sd(m1+2), s1 = _mm_load_sd(m1+6), s2 = _mm_load_sd(m1+10);
+    for(int i = 0; i < 3; ++i) {
+        __m128d a0 = _mm_set1_pd(m0[4*i+0]), a1 = _mm_set1_pd(m0[4*i+1]), a2 = _mm_set1_pd(m0[4*i+2]);
+        _mm_storeu_pd(m+4*i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(a0, r0), _mm_mul_pd(a1, r1)), _mm_mul_pd(a2, r2)));
+        _mm_store_sd(m+4*i+2, _mm_add_sd(_mm_add_sd(_mm_mul_sd(a0, s0), _mm_mul_sd(a1, s1)), _mm_mul_sd(a2, s2)));
+    }
+    __m128d b0 = _mm_set1_pd(t1[0]), b1 = _mm_set1_pd(t1[1]), b2 = _mm_set1_pd(t1[2]);
+    __m128d r01 = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(b0, _mm_set_pd(m0[4], m0[0])), _mm_mul_pd(b1, _mm_set_pd(m0[5], m0[1]))), _mm_mul_pd(b2, _mm_set_pd(m0[6], m0[2]))), _mm_loadu_pd(t0));
+    __m128d rz = _mm_add_sd(_mm_add_sd(_mm_add_sd(_mm_mul_sd(b0, _mm_set_sd(m0[8])), _mm_mul_sd(b1, _mm_set_sd(m0[9]))), _mm_mul_sd(b2, _mm_set_sd(m0[10]))), _mm_set_sd(t0[2]));
+    _mm_storeu_pd(t, r01);
+    _mm_storeu_pd(t+2, _mm_unpacklo_pd(rz, _mm_setzero_pd()));
+}
+
+/// \brief returns true if the box is on the positive side of all planes, see scalar::IsOBBinPlanes. Tests 2 planes at once.
+inline bool IsOBBinPlanes(const double* pos, const double* right, const double* up, const double* dir, const double* extents, const double* vplanes, size_t numplanes)
+{
+    const double* px = vplanes, *py = vplanes+numplanes, *pz = vplanes+2*numplanes, *pw = vplanes+3*numplanes;
+    const __m128d signall = _mm_set1_pd(-0.0);
+    size_t i = 0;
+    for(; i+2 <= numplanes; i += 2) {
+        __m128d x = _mm_loadu_pd(px+i), y = _mm_loadu_pd(py+i), z = _mm_loadu_pd(pz+i);
+        __m128d d = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(pos[0]), x), _mm_mul_pd(_mm_set1_pd(pos[1]), y)), _mm_mul_pd(_mm_set1_pd(pos[2]), z)), _mm_loadu_pd(pw+i));
+        __m128d fright = _mm_andnot_pd(signall, _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(right[0])), _mm_mul_pd(y, _mm_set1_pd(right[1]))), _mm_mul_pd(z, _mm_set1_pd(right[2]))));
+        __m128d fup = _mm_andnot_pd(signall, _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(up[0])), _mm_mul_pd(y, _mm_set1_pd(up[1]))), _mm_mul_pd(z, _mm_set1_pd(up[2]))));
+        __m128d fdir = _mm_andnot_pd(signall, _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(dir[0])), _mm_mul_pd(y, _mm_set1_pd(dir[1]))), _mm_mul_pd(z, _mm_set1_pd(dir[2]))));
+        __m128d r = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(extents[0]), fright), _mm_mul_pd(_mm_set1_pd(extents[1]), fup)), _mm_mul_pd(_mm_set1_pd(extents[2]), fdir));
+        if( _mm_movemask_pd(_mm_cmplt_pd(d, r)) ) {
+            return false;
+        }
+    }
+    return _IsOBBinPlanesTail(pos, right, up, dir, extents, vplanes, numplanes, i);
+}
+
+#endif // __AVX2__
+
+} // end namespace simd
+} // end namespace geometry
+} // end namespace OpenRAVE
+
+#endif
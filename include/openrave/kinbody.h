@@ -1791,6 +1791,21 @@ private:
         SetDOFValues(values,transform,static_cast<uint32_t>(checklimits));
     }
 
+    /** \brief Computes the link transformations for many configurations at once without changing the state of the body.
+
+        The configurations are evaluated in blocks with a structure-of-arrays layout so that the common revolute and
+        prismatic joints are computed across configurations at the same time. The base link keeps its current
+        transformation, non-mimic passive joints keep their current values, and values are used as is (see \ref CLA_Nothing).
+        Because the body is not modified, this can be called without locking the environment as long as the kinematics
+        structure does not change, also from several threads at the same time. Mimic equations and trajectory
+        joints are evaluated with private copies made at the start of each call, so the trajectories of the joints must
+        not be modified while the copies are made.
+        \param pconfigs numconfigs*GetDOF() values, each configuration ordered by the dof indices
+        \param numconfigs number of configurations
+        \param[out] ptransforms numconfigs*GetLinks().size() transformations, the links of the first configuration come first
+     */
+    virtual void ComputeLinkTransformsBatch(const dReal* pconfigs, size_t numconfigs, Transform* ptransforms) const;
+
     /// \brief sets the transformations of all the links at once
     virtual void SetLinkTransformations(const std::vector<Transform>& transforms);
 
@@ -1008,9 +1008,44 @@ protected:
         \param numpoints the number of points to convert. The target and source strides are gtarget.dof and gsource.dof
         \param penv [optional] The environment which might be needed to fill in unknown data. Assumes environment is locked.
         \param filluninitialized If there exists target groups that cannot be initialized, then will set default values using the current environment. For example, the current joint values of the body will be used.
+
+        The conversion is done with a cached \ref ConversionPlan, see \ref GetConversionPlan.
      */
     static void ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification& targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification& sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized = true);
 
+    /** \brief A conversion from a source specification to a target specification that is compiled once and can be applied many times.
+
+        The group matching, parsing of the group names, and computation of the index maps are done in the constructor, so \ref Convert only copies the values. Default values for target data that cannot be initialized from the source still have to be read from the environment at every conversion since the bodies can move between calls.
+     */
+    class OPENRAVE_API ConversionPlan
+    {
+public:
+        ConversionPlan(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec);
+        virtual ~ConversionPlan();
+
+        /// \brief converts the data, see \ref ConfigurationSpecification::ConvertData for a description of the parameters
+        void Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized = true) const;
+
+        /// \brief returns true if the plan was compiled for these exact specifications (same groups in the same order)
+        bool IsCompiledFor(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec) const;
+
+protected:
+        class GroupConversion;
+        typedef boost::shared_ptr<GroupConversion> GroupConversionPtr;
+
+        std::vector<Group> _vtargetgroups, _vsourcegroups; ///< the specification groups the plan was compiled for
+        int _targetdof, _sourcedof; ///< the strides of the target and source data
+        std::vector<GroupConversionPtr> _vgroupconversions; ///< one for every target group
+    };
+    typedef boost::shared_ptr<ConversionPlan> ConversionPlanPtr;
+    typedef boost::shared_ptr<ConversionPlan const> ConversionPlanConstPtr;
+
+    /** \brief returns a compiled plan for converting data from sourcespec to targetspec
+
+        The most recently compiled plans are cached by a hash of the specifications, so calling this repeatedly for the same specifications does not recompile them. Thread-safe. Callers that convert between the same specifications many times should keep the returned plan instead of looking it up for every conversion.
+     */
+    static ConversionPlanConstPtr GetConversionPlan(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec);
+
     /// \brief gets the name of the interpolation that represents the derivative of the passed in interpolation.
     ///
     /// For example GetInterpolationDerivative("quadratic") -> "linear"
@@ -2254,6 +2289,7 @@ OPENRAVE_API ConfigurationSpecification RaveGetAffineConfigurationSpecification(
 #include <openrave/sensorsystem.h>
 #include <openrave/viewer.h>
 #include <openrave/environment.h>
+#include <openrave/profiling.h>
 
 namespace OpenRAVE {
 
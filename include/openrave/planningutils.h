@@ -402,6 +402,13 @@ OPENRAVE_API void GetDHParameters(std::vector<DHParameter>&vparameters, KinBodyC
 class OPENRAVE_API DynamicsCollisionConstraint
 {
 public:
+    /// \brief the order in which the intermediate configurations of a segment are checked
+    enum EdgeCheckOrder
+    {
+        ECO_Sequential = 0, ///< check the configurations from q0 towards q1 (default)
+        ECO_Bisection = 1, ///< before the sequential pass, check a coarse grid of the interpolated path in bisection (van der Corput) order so that collisions in the middle of a segment are found early
+    };
+
     /*
        \param listCheckBodies initialize with these bodies to check environment and self-collision with
        \param parameters stored inside the structure as a weak pointer
@@ -434,6 +441,32 @@ public:
     /// \param bCallAfterCheckCollision if set, function will be called after check collision functions.
     virtual void SetUserCheckFunction(const boost::function<bool() >& usercheckfn, bool bCallAfterCheckCollision=false);
 
+    /// \brief sets the order in which the intermediate configurations of a segment are checked.
+    ///
+    /// With \ref ECO_Bisection, every coarsestride-th step of the directly interpolated path is checked coarse-to-fine before the regular sequential pass. The sequential pass is still performed for segments that pass, so the returned code is the same. The bisection pass is skipped when a filterreturn is requested since it cannot give the earliest invalid time, and is disabled for the current parameters once _neighstatefn is found to project an invalid sample away from the interpolated path.
+    /// \param coarsestride number of resolution steps between two samples of the bisection pass, >= 1
+    virtual void SetEdgeCheckOrder(EdgeCheckOrder checkorder, int coarsestride=4);
+
+    /// \brief enables caching of the segments that have been validated so that checking them again returns immediately.
+    ///
+    /// A segment is identified by its exact q0, q1, dq0, dq1, timeelapsed and masked options. A validated interval also validates any of its sub-intervals, ie IT_Closed covers IT_Open, IT_OpenStart and IT_OpenEnd.
+    /// The cache is dropped when bodies are added or removed, when the update stamp, geometry or enable state of any of the bodies not being checked changes, when the checked robots grab or release bodies, and when the parameters, filter mask, perturbation, or user functions are set. Changes to the geometry of the checked bodies themselves are not tracked, call \ref ClearValidatedSegments in that case.
+    /// \param maxsegments the maximum number of segments to store, 0 disables the cache (default)
+    virtual void SetValidatedSegmentCacheSize(int maxsegments);
+
+    /// \brief clears the cache of validated segments
+    virtual void ClearValidatedSegments();
+
+    /// \brief returns the number of checks that were answered by the validated segment cache
+    int GetNumValidatedSegmentHits() const {
+        return _nValidatedSegmentHits;
+    }
+
+    /// \brief returns the number of segments that were rejected by the bisection pass of \ref ECO_Bisection
+    int GetNumBisectionRejections() const {
+        return _nBisectionRejections;
+    }
+
     /// \brief checks line collision. Uses the constructor's self-collisions
     virtual int Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options = 0xffff, ConstraintFilterReturnPtr filterreturn = ConstraintFilterReturnPtr());
 
@@ -442,6 +475,36 @@ public:
     }
 
 protected:
+    /// \brief a segment that passed all the checks, see \ref SetValidatedSegmentCacheSize
+    struct ValidatedSegment
+    {
+        size_t hash; ///< hash of all the values below, compared first
+        std::vector<dReal> vvalues; ///< q0, q1, dq0, dq1 concatenated
+        dReal timeelapsed;
+        int options; ///< masked options the segment was checked with
+        int validatedmask; ///< combination of 1 (start), 2 (interior), 4 (end) that have been validated
+    };
+
+    /// \brief performs the actual checking for \ref Check without looking at the validated segment cache
+    virtual int _Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn);
+
+    /// \brief checks every _coarsestride-th step of the directly interpolated segment in bisection order.
+    ///
+    /// Returns 0 if no violation was found, if a sample could not be set, or if _neighstatefn moves the invalid sample.
+    /// \param options should already be masked with _filtermask
+    virtual int _CheckBisectionSamples(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& q0, const std::vector<dReal>& dq0, dReal timeelapsed, int numSteps, int options);
+
+    /// \brief registers the callbacks that invalidate the validated segments, only done once
+    virtual void _InitEnvironmentCallbacks();
+    virtual void _UpdateAddRemoveBodies(KinBodyPtr pbody, int action);
+    virtual void _UpdateChangedBody(KinBodyWeakPtr pweakbody);
+
+    /// \brief returns true if any of the bodies not being checked moved since _vTrackedBodyStamps were recorded
+    virtual bool _HaveTrackedBodiesMoved() const;
+
+    /// \brief records the update stamps of the bodies not being checked and not grabbed by the checked robots
+    virtual void _RecordTrackedBodyStamps();
+
     /// \brief checks an already set state
     ///
     /// \param vdofvelocities the current velocities set on the robot
@@ -464,6 +527,24 @@ protected:
     dReal _perturbation;
     boost::array< boost::function<bool() >, 2> _usercheckfns;
 
+    // for the check order
+    EdgeCheckOrder _checkorder;
+    int _coarsestride;
+    std::vector<int> _vbisectionorder; ///< cached order of the coarse samples
+    std::vector<dReal> _vbisectionconfig, _vbisectionvelconfig, _vbisectionprojected, _vbisectionzerodelta;
+    bool _bNeighStateFnProjects; ///< true if _neighstatefn of the current parameters moved an interpolated sample
+    int _nBisectionRejections;
+
+    // for caching validated segments
+    std::vector<ValidatedSegment> _vValidatedSegments; ///< ring buffer
+    int _nMaxValidatedSegments;
+    size_t _nNextValidatedSegment; ///< index in _vValidatedSegments to overwrite once full
+    bool _bEnvironmentChanged; ///< set by the callbacks when _vValidatedSegments have to be cleared
+    std::vector< std::pair<KinBody*, int> > _vTrackedBodyStamps; ///< update stamps of the bodies not being checked when _vValidatedSegments were last cleared. The bodies are alive as long as no remove callback set _bEnvironmentChanged.
+    int _nValidatedSegmentHits;
+    UserDataPtr _handleBodyAddRemove;
+    std::map<KinBody*, UserDataPtr> _mapBodyChangeHandles; ///< change callback handles of the environment bodies
+
     // for dynamics
     ConfigurationSpecification _specvel;
     std::vector< std::pair<int, std::pair<dReal, dReal> > > _vtorquevalues; ///< cache for dof indices and the torque limits that the current torque should be in
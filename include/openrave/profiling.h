@@ -0,0 +1,140 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2016 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/** \file profiling.h
+    \brief Named scoped timers and counters for measuring the hot paths of OpenRAVE. This file is automatically included by openrave.h.
+
+    Profiling is disabled by default and can be turned on at runtime with \ref RaveSetProfilingEnabled or by setting the OPENRAVE_PROFILING environment variable before \ref RaveInitialize is called. When disabled, a scope costs one function call and a branch.
+
+    Every thread accumulates into its own statistics, so threads do not contend with each other when profiling. The accumulated statistics of all threads can be queried with \ref RaveGetProfilingStats. If tracing is enabled with \ref RaveSetProfilingTraceEnabled, every scope is also recorded as an event and can be exported in the Chrome trace event format with \ref RaveWriteProfilingTrace (load the file in chrome://tracing). Setting OPENRAVE_PROFILING_TRACE to a filename enables tracing and writes the trace when \ref RaveDestroy is called.
+
+    Use \ref OPENRAVE_PROFILING_SCOPE to time a block and \ref OPENRAVE_PROFILING_COUNT to count events:
+    \code
+    void MyPlanner::_Iterate()
+    {
+        OPENRAVE_PROFILING_SCOPE("MyPlanner.Iterate");
+        ...
+        OPENRAVE_PROFILING_COUNT("MyPlanner.RejectedSamples", nrejected);
+    }
+    \endcode
+ */
+#ifndef OPENRAVE_PROFILING_H
+#define OPENRAVE_PROFILING_H
+
+namespace OpenRAVE {
+
+/// \brief The statistics of a profiling scope or counter accumulated over all threads.
+class OPENRAVE_API ProfilingStats
+{
+public:
+    ProfilingStats() : count(0), totaltime(0), mintime(0), maxtime(0) {
+    }
+
+    std::string name; ///< the name the scope was registered with
+    uint64_t count; ///< number of times a scope was entered, or the accumulated value of a counter
+    uint64_t totaltime; ///< total time spent inside the scope in nanoseconds, 0 for counters
+    uint64_t mintime, maxtime; ///< shortest and longest time of a single call in nanoseconds, 0 for counters
+};
+
+/// \brief Enables or disables the accumulation of profiling statistics. Thread-safe.
+OPENRAVE_API void RaveSetProfilingEnabled(bool enabled);
+
+/// \brief Returns true if profiling statistics are accumulated.
+OPENRAVE_API bool RaveIsProfilingEnabled();
+
+/// \brief Enables or disables the recording of every profiled scope as a trace event.
+///
+/// Has no effect unless profiling is also enabled. Every thread keeps at most a fixed number of events, the rest are dropped.
+OPENRAVE_API void RaveSetProfilingTraceEnabled(bool enabled);
+
+/// \brief Returns true if trace events are recorded.
+OPENRAVE_API bool RaveIsProfilingTraceEnabled();
+
+/// \brief Returns a unique id for the profiling scope name. Registering the same name again returns the same id. Thread-safe.
+OPENRAVE_API int RaveRegisterProfilingScope(const std::string& name);
+
+/// \brief Returns the current time used by the profiler in nanoseconds.
+OPENRAVE_API uint64_t RaveGetProfilingTime();
+
+/// \brief Adds one call of a scope that started at starttime and ended at endtime to the statistics of the current thread.
+///
+/// \param scopeid an id returned by \ref RaveRegisterProfilingScope
+/// \param starttime, endtime times returned by \ref RaveGetProfilingTime
+OPENRAVE_API void RaveAddProfilingSample(int scopeid, uint64_t starttime, uint64_t endtime);
+
+/// \brief Adds count to a profiling counter of the current thread.
+///
+/// \param scopeid an id returned by \ref RaveRegisterProfilingScope
+OPENRAVE_API void RaveAddProfilingCount(int scopeid, uint64_t count=1);
+
+/// \brief Gets the statistics of all scopes and counters that were used since the last reset, accumulated over all threads.
+OPENRAVE_API void RaveGetProfilingStats(std::vector<ProfilingStats>& vstats);
+
+/// \brief Resets all statistics and recorded trace events. The registered scope ids stay valid.
+OPENRAVE_API void RaveResetProfilingStats();
+
+/// \brief Writes the recorded trace events in the Chrome trace event JSON format.
+OPENRAVE_API void RaveWriteProfilingTrace(std::ostream& O);
+
+/// \brief Times the enclosing scope when profiling is enabled, see \ref OPENRAVE_PROFILING_SCOPE
+class ProfilingScope
+{
+public:
+    ProfilingScope(int scopeid) : _scopeid(scopeid), _starttime(0), _bEnabled(RaveIsProfilingEnabled()) {
+        if( _bEnabled ) {
+            _starttime = RaveGetProfilingTime();
+        }
+    }
+    ~ProfilingScope() {
+        if( _bEnabled ) {
+            RaveAddProfilingSample(_scopeid, _starttime, RaveGetProfilingTime());
+        }
+    }
+
+private:
+    int _scopeid;
+    uint64_t _starttime;
+    bool _bEnabled;
+};
+
+} // end namespace OpenRAVE
+
+#define OPENRAVE_PROFILING_CAT2(a,b) a ## b
+#define OPENRAVE_PROFILING_CAT(a,b) OPENRAVE_PROFILING_CAT2(a,b)
+
+#ifdef OPENRAVE_DISABLE_PROFILING
+
+#define OPENRAVE_PROFILING_SCOPE(name)
+#define OPENRAVE_PROFILING_COUNT(name, count)
+
+#else
+
+/// \brief Times the rest of the enclosing block under name. The name is registered only once per call site.
+#define OPENRAVE_PROFILING_SCOPE(name) \
+    static const int OPENRAVE_PROFILING_CAT(_profilingscopeid, __LINE__) = OpenRAVE::RaveRegisterProfilingScope(name); \
+    OpenRAVE::ProfilingScope OPENRAVE_PROFILING_CAT(_profilingscope, __LINE__)(OPENRAVE_PROFILING_CAT(_profilingscopeid, __LINE__))
+
+/// \brief Adds count to the counter name when profiling is enabled. The name is registered only once per call site.
+#define OPENRAVE_PROFILING_COUNT(name, count) { \
+        if( OpenRAVE::RaveIsProfilingEnabled() ) { \
+            static const int _profilingcounterid = OpenRAVE::RaveRegisterProfilingScope(name); \
+            OpenRAVE::RaveAddProfilingCount(_profilingcounterid, count); \
+        } \
+}
+
+#endif
+
+#endif
@@ -94,6 +94,17 @@ public:
      */
     virtual void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times, const ConfigurationSpecification& spec) const;
 
+    /** \brief bulk samples the trajectory at regular intervals starting at starttime.
+
+        Samples at starttime + i*deltatime for i in [0, numsamples). The samples are the same as calling \ref Sample with the spec for every time, but implementations can walk the trajectory once instead of searching for every sample. The default implementation is slow, so interface developers should override it.
+        \param data[out] the sampled points, numsamples*spec.GetDOF() values
+        \param starttime[in] the time of the first sample
+        \param deltatime[in] the time between consecutive samples
+        \param numsamples[in] the number of samples
+        \param spec[in] the specification format to return the data in
+     */
+    virtual void SampleRange(std::vector<dReal>& data, dReal starttime, dReal deltatime, size_t numsamples, const ConfigurationSpecification& spec) const;
+
     virtual const ConfigurationSpecification& GetConfigurationSpecification() const = 0;
 
     /// \brief return the number of waypoints
@@ -156,10 +167,14 @@ public:
     /// \brief return the duration of the trajectory in seconds
     virtual dReal GetDuration() const = 0;
 
-    /// \brief output the trajectory in XML format
+    /// \brief output the trajectory in XML format, or in the binary format if options has \ref SO_TrajectoryBinary
+    ///
+    /// The binary format is a fixed header followed by the XML of the trajectory without the waypoints (configuration
+    /// specification, description, readable interfaces), and the waypoints as a block of raw little-endian dReal values
+    /// aligned to 8 bytes. See \ref TrajectoryBinaryView for reading it in place.
     virtual void serialize(std::ostream& O, int options=0) const;
 
-    /// \brief initialize the trajectory
+    /// \brief initialize the trajectory, the format (XML or binary) is detected automatically
     virtual InterfaceBasePtr deserialize(std::istream& I);
 
     virtual void Clone(InterfaceBaseConstPtr preference, int cloningoptions);
@@ -262,6 +277,11 @@ public:
     static const int NUM_METHODS RAVE_DEPRECATED = 5;
 
 protected:
+    /// \brief writes the trajectory in the binary format, see \ref serialize
+    ///
+    /// \param pdata numwaypoints*GetConfigurationSpecification().GetDOF() values
+    void _SerializeBinary(std::ostream& O, const dReal* pdata, size_t numwaypoints, int options) const;
+
     inline TrajectoryBasePtr shared_trajectory() {
         return boost::static_pointer_cast<TrajectoryBase>(shared_from_this());
     }
@@ -281,6 +301,59 @@ private:
 /// \deprecated (11/10/04)
 typedef TrajectoryBase Trajectory RAVE_DEPRECATED;
 
+/** \brief Reads a trajectory serialized with \ref SO_TrajectoryBinary in place, for example from a memory mapped file.
+
+    The buffer has to stay valid while the view is used. The waypoints are only copied if the buffer is not aligned for dReal,
+    or was written with a different dReal size or byte order.
+ */
+class OPENRAVE_API TrajectoryBinaryView
+{
+public:
+    /// \param pbuffer the buffer starting with the serialized trajectory
+    /// \param size size of the buffer, can be bigger than the trajectory
+    /// \throw openrave_exception if the buffer does not start with a complete binary trajectory
+    TrajectoryBinaryView(const char* pbuffer, size_t size);
+    virtual ~TrajectoryBinaryView() {
+    }
+
+    /// \brief returns true if the buffer starts with the magic of the binary trajectory format
+    static bool IsBinaryTrajectory(const char* pbuffer, size_t size);
+
+    inline const ConfigurationSpecification& GetConfigurationSpecification() const {
+        return _spec;
+    }
+
+    inline size_t GetNumWaypoints() const {
+        return _numwaypoints;
+    }
+
+    /// \brief returns GetNumWaypoints()*GetConfigurationSpecification().GetDOF() values
+    inline const dReal* GetWaypoints() const {
+        return _pdata;
+    }
+
+    /// \brief returns the XML of the trajectory without the waypoints, holds the description and readable interfaces
+    inline const std::string& GetMetadata() const {
+        return _metadata;
+    }
+
+    /// \brief returns the number of bytes of the buffer that the trajectory uses
+    inline size_t GetSerializedSize() const {
+        return _serializedsize;
+    }
+
+    /// \brief initializes traj with the specification, description, readable interfaces and waypoints of the view
+    void InitTrajectory(TrajectoryBasePtr traj) const;
+
+private:
+    ConfigurationSpecification _spec;
+    std::string _metadata;
+    size_t _numwaypoints;
+    size_t _serializedsize;
+    const dReal* _pdata;
+    std::vector<dReal> _vconverteddata; ///< holds the waypoints if they cannot be read in place
+};
+
 } // end namespace OpenRAVE
 
 #endif // TRAJECTORY_H
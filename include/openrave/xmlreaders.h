@@ -29,6 +29,14 @@ namespace OpenRAVE {
 
 namespace xmlreaders {
 
+/** \brief Parses whitespace-separated numbers from a buffer and appends them to values.
+
+    Gives the same values as extracting dReal values from a std::stringstream, but most numbers are converted directly from the characters without going through the stream. Use it for large numeric element data like trajectory points and mesh vertices.
+    Parsing stops at the end of the buffer or at the first text that is not a number.
+    \return the number of values appended
+ */
+OPENRAVE_API size_t ParseNumbers(const char* pbegin, const char* pend, std::vector<dReal>& values);
+
 class OPENRAVE_API StringXMLReadable : public XMLReadable
 {
 public:
@@ -143,7 +143,6 @@ public:
 
         _pgeom.reset(new BaseFlashLidar3DGeom());
         _pdata.reset(new LaserSensorData());
-        _report.reset(new CollisionReport());
 
         _bRenderData = false;
         _bRenderGeometry = true;
@@ -205,9 +204,6 @@ public:
         if(( _fTimeToScan <= 0) && _bPower ) {
             _fTimeToScan = _pgeom->time_scan;
 
-            RAY r;
-
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(CO_Distance);
             Transform t;
 
             {
@@ -216,10 +212,10 @@ public:
                 t = GetTransform();
                 _pdata->__trans = t;
                 _pdata->__stamp = GetEnv()->GetSimulationTime();
-
-                r.pos = t.trans;
                 _pdata->positions.at(0) = t.trans;
 
+                _vrays.resize(_pgeom->width*_pgeom->height);
+                _vraydirs.resize(_vrays.size());
                 for(int w = 0; w < _pgeom->width; ++w) {
                     for(int h = 0; h < _pgeom->height; ++h) {
                         Vector vdir;
@@ -227,32 +223,29 @@ public:
                         vdir.y = (float)h*_iKK[1] + _iKK[3];
                         vdir.z = 1.0f;
                         vdir = t.rotate(vdir.normalize3());
-                        r.dir = _pgeom->max_range*vdir;
-
                         int index = w*_pgeom->height+h;
-
-                        if( GetEnv()->CheckCollision(r, _report)) {
-                            _pdata->ranges[index] = vdir*_report->minDistance;
-                            _pdata->intensity[index] = 1;
-                            // store the colliding bodies
-                            KinBody::LinkConstPtr plink = !!_report->plink1 ? _report->plink1 : _report->plink2;
-                            if( !!plink ) {
-                                _databodyids[index] = plink->GetParent()->GetEnvironmentId();
-                            }
-                        }
-                        else {
-                            _databodyids[index] = 0;
-                            _pdata->ranges[index] = vdir*_pgeom->max_range;
-                            _pdata->intensity[index] = 0;
-                        }
+                        _vrays[index].pos = t.trans;
+                        _vrays[index].dir = _pgeom->max_range*vdir;
+                        _vraydirs[index] = vdir;
                     }
                 }
 
-                _report->Reset();
+                // check all the beams in one call so the checker can share the broadphase work
+                GetEnv()->GetCollisionChecker()->CheckCollisionRays(_vrays, _vraydistances, _vraybodyids);
+                for(size_t index = 0; index < _vrays.size(); ++index) {
+                    if( _vraydistances[index] >= 0 ) {
+                        _pdata->ranges[index] = _vraydirs[index]*_vraydistances[index];
+                        _pdata->intensity[index] = 1;
+                    }
+                    else {
+                        _pdata->ranges[index] = _vraydirs[index]*_pgeom->max_range;
+                        _pdata->intensity[index] = 0;
+                    }
+                    // store the colliding bodies
+                    _databodyids[index] = _vraybodyids[index];
+                }
             }
 
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
-
             if( _bRenderData ) {
                 // If can render, check if some time passed before last update
                 list<GraphHandlePtr> listhandles;
@@ -425,7 +418,10 @@ protected:
     boost::shared_ptr<BaseFlashLidar3DGeom> _pgeom;
     boost::shared_ptr<LaserSensorData> _pdata;
     vector<int> _databodyids;     ///< if non 0, for each point in _data, specifies the body that was hit
-    CollisionReportPtr _report;
+    std::vector<RAY> _vrays; ///< cache of the rays of one scan
+    std::vector<Vector> _vraydirs; ///< cache of the unit direction of every ray
+    std::vector<dReal> _vraydistances; ///< cache of the distances returned by CheckCollisionRays
+    std::vector<int> _vraybodyids; ///< cache of the body ids returned by CheckCollisionRays
     // more geom stuff
     RaveVector<float> _vColor;
     dReal _iKK[4];     // inverse of KK
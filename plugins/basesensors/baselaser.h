@@ -144,7 +144,6 @@ public:
         _pgeom->max_range = 100;
         _fTimeToScan = 0;
         _vColor = RaveVector<float>(0.5f,0.5f,1,1);
-        _report.reset(new CollisionReport());
         _bPower = false;
         _bRenderData = false;
         _bRenderGeometry = true;
@@ -198,9 +197,6 @@ public:
         if( _bPower &&( _fTimeToScan <= 0) ) {
             _fTimeToScan = _pgeom->time_scan;
             Vector rotaxis(0,0,1);
-            RAY r;
-
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(CO_Distance);
             Transform t;
 
             {
@@ -210,34 +206,37 @@ public:
                 _pdata->__stamp = GetEnv()->GetSimulationTime();
                 t = GetLaserPlaneTransform();
                 _pdata->positions.at(0) = t.trans;
-                size_t index = 0;
-                for(dReal frotangle = _pgeom->min_angle[0]; frotangle <= _pgeom->max_angle[0]; frotangle += _pgeom->resolution[0], ++index) {
-                    if( index >= _pdata->ranges.size() ) {
+                _vrays.resize(0);
+                _vraydirs.resize(0);
+                for(dReal frotangle = _pgeom->min_angle[0]; frotangle <= _pgeom->max_angle[0]; frotangle += _pgeom->resolution[0]) {
+                    if( _vrays.size() >= _pdata->ranges.size() ) {
                         break;
                     }
                     Vector vdir(t.rotate(quatRotate(quatFromAxisAngle(rotaxis, (dReal)frotangle),Vector(1,0,0))));
+                    RAY r;
                     r.pos = t.trans+_pgeom->min_range*vdir;
                     r.dir = (_pgeom->max_range-_pgeom->min_range)*vdir;
+                    _vrays.push_back(r);
+                    _vraydirs.push_back(vdir);
+                }
 
-                    if( GetEnv()->CheckCollision(r, _report)) {
-                        _pdata->ranges[index] = vdir*(_report->minDistance+_pgeom->min_range);
+                // check all the beams in one call so the checker can share the broadphase work
+                GetEnv()->GetCollisionChecker()->CheckCollisionRays(_vrays, _vraydistances, _vraybodyids);
+                for(size_t index = 0; index < _vrays.size(); ++index) {
+                    const Vector& vdir = _vraydirs[index];
+                    if( _vraydistances[index] >= 0 ) {
+                        _pdata->ranges[index] = vdir*(_vraydistances[index]+_pgeom->min_range);
                         _pdata->intensity[index] = 1;
-                        // store the colliding bodies
-                        KinBody::LinkConstPtr plink = !!_report->plink1 ? _report->plink1 : _report->plink2;
-                        if( !!plink ) {
-                            _databodyids[index] = plink->GetParent()->GetEnvironmentId();
-                        }
                     }
                     else {
-                        _databodyids[index] = 0;
                         _pdata->ranges[index] = vdir*_pgeom->max_range;
                         _pdata->intensity[index] = 0;
                     }
+                    // store the colliding bodies
+                    _databodyids[index] = _vraybodyids[index];
                 }
             }
 
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
-
             if( _bRenderData ) {
                 // If can render, check if some time passed before last update
                 list<GraphHandlePtr> listhandles;
@@ -279,8 +278,6 @@ public:
             else {
                 _listGraphicsHandles.clear();
             }
-
-            _report->Reset();
         }
 
         return true;
@@ -432,7 +429,10 @@ protected:
     boost::shared_ptr<LaserGeomData> _pgeom;
     boost::shared_ptr<LaserSensorData> _pdata;
     vector<int> _databodyids;     ///< if non 0, for each point in _data, specifies the body that was hit
-    CollisionReportPtr _report;
+    std::vector<RAY> _vrays; ///< cache of the rays of one scan
+    std::vector<Vector> _vraydirs; ///< cache of the unit direction of every ray
+    std::vector<dReal> _vraydistances; ///< cache of the distances returned by CheckCollisionRays
+    std::vector<int> _vraybodyids; ///< cache of the body ids returned by CheckCollisionRays
 
     // more geom stuff
     RaveVector<float> _vColor;
@@ -327,7 +327,7 @@ public:
             }
 
             if( bHasCallbacks && !report ) {
-                report.reset(new CollisionReport());
+                report = RaveAcquireCollisionReport();
                 report->Reset(_options);
             }
 
@@ -604,7 +604,7 @@ public:
         bool bCollision = rayCallback.hasHit();
         if( bCollision ) {
             if( GetEnv()->HasRegisteredCollisionCallbacks() && !report ) {
-                report.reset(new CollisionReport());
+                report = RaveAcquireCollisionReport();
                 report->Reset(_options);
             }
 
@@ -673,7 +673,7 @@ public:
         bool bCollision = rayCallback.hasHit();
         if( bCollision ) {
             if( GetEnv()->HasRegisteredCollisionCallbacks() && !report ) {
-                report.reset(new CollisionReport());
+                report = RaveAcquireCollisionReport();
                 report->Reset(_options);
             }
 
@@ -737,7 +737,7 @@ public:
         bool bCollision = rayCallback.hasHit();
         if( bCollision ) {
             if( GetEnv()->HasRegisteredCollisionCallbacks() && !report ) {
-                report.reset(new CollisionReport());
+                report = RaveAcquireCollisionReport();
                 report->Reset(_options);
             }
 
@@ -243,7 +243,7 @@ public:
         // cache miss
         if( !report ) {
             // create an empty collision report
-            report.reset(new CollisionReport());
+            report = RaveAcquireCollisionReport();
         }
 
         // raw collisioncheck
@@ -363,7 +363,7 @@ public:
 
         // cache miss
         if( !report ) {
-            report.reset(new CollisionReport());
+            report = RaveAcquireCollisionReport();
         }
 
         _stime = utils::GetMilliTime();
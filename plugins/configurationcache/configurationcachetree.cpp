@@ -17,7 +17,21 @@
 #include <boost/lexical_cast.hpp>
 
 #include <boost/multi_array.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/thread.hpp>
 #include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <limits>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using boost::multi_array;
 using boost::extents;
@@ -28,6 +42,34 @@ inline dReal Sqr(dReal x) {
     return x*x;
 }
 
+/// \brief locks the tree for reading after the writers that are already waiting had their turn.
+///
+/// boost::shared_mutex lets new readers in whenever the reader count drops to zero, so under a steady stream of queries an insert could wait for seconds.
+class TreeReadLock
+{
+public:
+    TreeReadLock(boost::shared_mutex& mutextree, boost::mutex& mutexturn) : _lock(mutextree, boost::defer_lock) {
+        boost::mutex::scoped_lock turnlock(mutexturn);
+        _lock.lock();
+    }
+
+private:
+    boost::shared_lock<boost::shared_mutex> _lock;
+};
+
+/// \brief locks the tree for writing. Holds the turn while waiting for the current readers, so new readers queue behind it.
+class TreeWriteLock
+{
+public:
+    TreeWriteLock(boost::shared_mutex& mutextree, boost::mutex& mutexturn) : _lock(mutextree, boost::defer_lock) {
+        boost::mutex::scoped_lock turnlock(mutexturn);
+        _lock.lock();
+    }
+
+private:
+    boost::unique_lock<boost::shared_mutex> _lock;
+};
+
 CacheTreeNode::CacheTreeNode(const std::vector<dReal>& cs, Vector* plinkspheres)
 {
     std::copy(cs.begin(), cs.end(), _pcstate);
@@ -107,11 +149,10 @@ void CacheTreeNode::SetCollisionInfo(int robotlinkindex, int type)
 CacheTree::CacheTree(int statedof)
 {
     _poolNodes.reset(new boost::pool<>(sizeof(CacheTreeNode)+sizeof(dReal)*statedof));
-    _vnodes.resize(0);
-    _dummycs.resize(0);
-    _fulldirname.resize(0);
-    _mapNodeIndices.clear();
-    _collidingbodyname.resize(0);
+    _vsearchbuffers.resize(std::max(2, 2*(int)boost::thread::hardware_concurrency()));
+    FOREACH(itbuffers, _vsearchbuffers) {
+        itbuffers->reset(new SearchBuffers());
+    }
 
     _statedof=statedof;
     _weights.resize(_statedof, 1.0);
@@ -120,13 +161,14 @@ CacheTree::CacheTree(int statedof)
 
 CacheTree::~CacheTree()
 {
-    Reset();
+    _Reset();
     _weights.clear();
 }
 
 void CacheTree::Init(const std::vector<dReal>& weights, dReal maxdistance)
 {
-    Reset();
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
+    _Reset();
     _weights = weights;
     _statedof = (int)_weights.size();
     _numnodes = 0;
@@ -146,13 +188,12 @@ void CacheTree::Init(const std::vector<dReal>& weights, dReal maxdistance)
 
 void CacheTree::Reset()
 {
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
+    _Reset();
+}
 
-    _vnodes.resize(0);
-    _dummycs.resize(0);
-    _fulldirname.resize(0);
-    _mapNodeIndices.clear();
-    _collidingbodyname.resize(0);
-
+void CacheTree::_Reset()
+{
     // make sure all children are deleted
     for(size_t ilevel = 0; ilevel < _vsetLevelNodes.size(); ++ilevel) {
         FOREACH(itnode, _vsetLevelNodes[ilevel]) {
@@ -162,9 +203,6 @@ void CacheTree::Reset()
     FOREACH(itchildren, _vsetLevelNodes) {
         itchildren->clear();
     }
-    FOREACH(itnode, _vnodes) {
-        (*itnode)->~CacheTreeNode();
-    }
     // purge_memory leaks!
     //_poolNodes.purge_memory();
     _poolNodes.reset(new boost::pool<>(sizeof(CacheTreeNode)+sizeof(dReal)*_statedof));
@@ -240,13 +278,15 @@ dReal CacheTree::_ComputeDistance2(const dReal* cstatei, const dReal* cstatef) c
 
 void CacheTree::SetWeights(const std::vector<dReal>& weights)
 {
-    Reset();
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
+    _Reset();
     _weights = weights;
 }
 
 void CacheTree::SetMaxDistance(dReal maxdistance)
 {
-    Reset();
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
+    _Reset();
     _maxdistance = maxdistance;
     _maxlevel = ceilf(RaveLog(_maxdistance)/RaveLog(_base));
     _minlevel = _maxlevel - 1;
@@ -259,7 +299,8 @@ void CacheTree::SetMaxDistance(dReal maxdistance)
 
 void CacheTree::SetBase(dReal base)
 {
-    Reset();
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
+    _Reset();
     _statedof = (int)_weights.size();
     _base = base;
     _fBaseInv = 1/_base;
@@ -274,8 +315,28 @@ void CacheTree::SetBase(dReal base)
     }
 }
 
+CacheTree::SearchBuffers& CacheTree::_LockSearchBuffers(boost::mutex::scoped_lock& lock) const
+{
+    // start at a different buffer for every thread so that concurrent queries rarely contend on the same buffer
+    size_t start = boost::hash<boost::thread::id>()(boost::this_thread::get_id());
+    for(size_t i = 0; i < _vsearchbuffers.size(); ++i) {
+        SearchBuffers& buffers = *_vsearchbuffers[(start+i)%_vsearchbuffers.size()];
+        boost::mutex::scoped_lock trylock(buffers._mutex, boost::try_to_lock);
+        if( trylock.owns_lock() ) {
+            lock.swap(trylock);
+            return buffers;
+        }
+    }
+    // all are being used, so wait on the first one
+    SearchBuffers& buffers = *_vsearchbuffers[start%_vsearchbuffers.size()];
+    boost::mutex::scoped_lock waitlock(buffers._mutex);
+    lock.swap(waitlock);
+    return buffers;
+}
+
 std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::vector<dReal>& vquerystate, dReal distancebound, ConfigurationNodeType conftype) const
 {
+    TreeReadLock lock(_mutexTree, _mutexTreeTurn);
     if( _numnodes == 0 ) {
         return make_pair(CacheTreeNodeConstPtr(), dReal(0));
     }
@@ -284,22 +345,26 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
     dReal bestdist2 = std::numeric_limits<dReal>::infinity();
     OPENRAVE_ASSERT_OP(vquerystate.size(),==,_weights.size());
     const dReal* pquerystate = &vquerystate[0];
+    boost::mutex::scoped_lock bufferslock;
+    SearchBuffers& buffers = _LockSearchBuffers(bufferslock);
+    std::vector< std::pair<CacheTreeNodePtr, dReal> >& vCurrentLevelNodes = buffers._vCurrentLevelNodes;
+    std::vector< std::pair<CacheTreeNodePtr, dReal> >& vNextLevelNodes = buffers._vNextLevelNodes;
 
     dReal distancebound2 = Sqr(distancebound);
     int currentlevel = _maxlevel; // where the root node is
     // traverse all levels gathering up the children at each level
     dReal fLevelBound2 = Sqr(_fMaxLevelBound);
-    _vCurrentLevelNodes.resize(1);
-    _vCurrentLevelNodes[0].first = *_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin();
-    _vCurrentLevelNodes[0].second = _ComputeDistance2(pquerystate, _vCurrentLevelNodes[0].first->GetConfigurationState());
-    if( (conftype == CNT_Any || _vCurrentLevelNodes[0].first->GetType() == conftype) && _vCurrentLevelNodes[0].first->_usenn ) {
-        pbestnode = _vCurrentLevelNodes[0].first;
-        bestdist2 = _vCurrentLevelNodes[0].second;
-    }
-    while(_vCurrentLevelNodes.size() > 0 ) {
-        _vNextLevelNodes.resize(0);
+    vCurrentLevelNodes.resize(1);
+    vCurrentLevelNodes[0].first = *_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin();
+    vCurrentLevelNodes[0].second = _ComputeDistance2(pquerystate, vCurrentLevelNodes[0].first->GetConfigurationState());
+    if( (conftype == CNT_Any || vCurrentLevelNodes[0].first->GetType() == conftype) && vCurrentLevelNodes[0].first->_usenn ) {
+        pbestnode = vCurrentLevelNodes[0].first;
+        bestdist2 = vCurrentLevelNodes[0].second;
+    }
+    while(vCurrentLevelNodes.size() > 0 ) {
+        vNextLevelNodes.resize(0);
         dReal minchilddist2 = std::numeric_limits<dReal>::infinity();
-        FOREACH(itcurrentnode, _vCurrentLevelNodes) {
+        FOREACH(itcurrentnode, vCurrentLevelNodes) {
             // only take the children whose distances are within the bound
             FOREACHC(itchild, itcurrentnode->first->_vchildren) {
                 dReal curdist2 = _ComputeDistance2(pquerystate, (*itchild)->GetConfigurationState());
@@ -313,22 +378,22 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
                         }
                     }
                 }
-                _vNextLevelNodes.push_back(make_pair(*itchild, curdist2));
+                vNextLevelNodes.push_back(make_pair(*itchild, curdist2));
                 if( minchilddist2 > curdist2 ) {
                     minchilddist2 = curdist2;
                 }
             }
         }
 
-        _vCurrentLevelNodes.resize(0);
+        vCurrentLevelNodes.resize(0);
         // have to compute dist < RaveSqrt(minchilddist2) + fLevelBound
         // dist2 < m2 + 2mL + L2
 
         dReal ftestbound2 = 4*minchilddist2*fLevelBound2;
-        FOREACH(itnode, _vNextLevelNodes) {
+        FOREACH(itnode, vNextLevelNodes) {
             dReal f = itnode->second - minchilddist2 - fLevelBound2;
             if( f <= 0 || Sqr(f) <= ftestbound2 ) {
-                _vCurrentLevelNodes.push_back(*itnode);
+                vCurrentLevelNodes.push_back(*itnode);
             }
         }
         currentlevel -= 1;
@@ -346,6 +411,7 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
     std::pair<CacheTreeNodeConstPtr, dReal> bestnode;
     bestnode.first = NULL;
     bestnode.second = std::numeric_limits<dReal>::infinity();
+    TreeReadLock lock(_mutexTree, _mutexTreeTurn);
     if( _numnodes == 0 ) {
         return bestnode;
     }
@@ -353,6 +419,10 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
     OPENRAVE_ASSERT_OP(vquerystate.size(),==,_weights.size());
     // first localmax is distance from this node to the root
     const dReal* pquerystate = &vquerystate[0];
+    boost::mutex::scoped_lock bufferslock;
+    SearchBuffers& buffers = _LockSearchBuffers(bufferslock);
+    std::vector< std::pair<CacheTreeNodePtr, dReal> >& vCurrentLevelNodes = buffers._vCurrentLevelNodes;
+    std::vector< std::pair<CacheTreeNodePtr, dReal> >& vNextLevelNodes = buffers._vNextLevelNodes;
 
     dReal collisionthresh2 = Sqr(collisionthresh), freespacethresh2 = Sqr(freespacethresh);
     // traverse all levels gathering up the children at each level
@@ -372,15 +442,15 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
                 bestnode = make_pair(proot,RaveSqrt(curdist2));
             }
         }
-        _vCurrentLevelNodes.resize(1);
-        _vCurrentLevelNodes[0].first = proot;
-        _vCurrentLevelNodes[0].second = curdist2;
+        vCurrentLevelNodes.resize(1);
+        vCurrentLevelNodes[0].first = proot;
+        vCurrentLevelNodes[0].second = curdist2;
     }
-    dReal pruneradius2 = Sqr(_maxdistance); // the radius to prune all _vCurrentLevelNodes when going through them. Equivalent to min(query,children) + levelbound from the previous iteration
-    while(_vCurrentLevelNodes.size() > 0 ) {
-        _vNextLevelNodes.resize(0);
+    dReal pruneradius2 = Sqr(_maxdistance); // the radius to prune all vCurrentLevelNodes when going through them. Equivalent to min(query,children) + levelbound from the previous iteration
+    while(vCurrentLevelNodes.size() > 0 ) {
+        vNextLevelNodes.resize(0);
         dReal minchilddist=_maxdistance;
-        FOREACH(itcurrentnode, _vCurrentLevelNodes) {
+        FOREACH(itcurrentnode, vCurrentLevelNodes) {
             if( itcurrentnode->second > pruneradius2 ) {
                 continue;
             }
@@ -402,7 +472,7 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
                     }
                 }
                 if( curdist2 < comparedist2 ) {
-                    _vNextLevelNodes.push_back(make_pair(*itchild, curdist2));
+                    vNextLevelNodes.push_back(make_pair(*itchild, curdist2));
                     if( Sqr(minchilddist) > curdist2 ) {
                         minchilddist = RaveSqrt(curdist2);
                         comparedist2 = Sqr(minchilddist + fLevelBound);
@@ -411,7 +481,7 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
             }
         }
 
-        _vCurrentLevelNodes.swap(_vNextLevelNodes);
+        vCurrentLevelNodes.swap(vNextLevelNodes);
         pruneradius2 = Sqr(minchilddist + fLevelBound);
         currentlevel -= 1;
         fLevelBound *= _fBaseInv;
@@ -426,8 +496,8 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
 
 int CacheTree::InsertNode(const std::vector<dReal>& cs, CollisionReportPtr report, dReal fMinSeparationDist)
 {
-
     OPENRAVE_ASSERT_OP(cs.size(),==,_weights.size());
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
     CacheTreeNodePtr nodein = _CreateCacheTreeNode(cs, report);
     // if there is no root, make this the root, otherwise call the lowlevel  insert
     if( _numnodes == 0 ) {
@@ -606,6 +676,7 @@ bool CacheTree::_InsertDirectly(CacheTreeNodePtr nodein, CacheTreeNodePtr parent
 
 bool CacheTree::RemoveNode(CacheTreeNodeConstPtr _removenode)
 {
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
     if( _numnodes == 0 ) {
         return false;
     }
@@ -614,7 +685,7 @@ bool CacheTree::RemoveNode(CacheTreeNodeConstPtr _removenode)
 
     CacheTreeNodePtr proot = *_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin();
     if( _numnodes == 1 && removenode == proot ) {
-        Reset();
+        _Reset();
         return true;
     }
 
@@ -753,6 +824,7 @@ bool CacheTree::_Remove(CacheTreeNodePtr removenode, std::vector< std::vector<Ca
 
 void CacheTree::GetNodeValues(std::vector<dReal>& vals) const
 {
+    TreeReadLock lock(_mutexTree, _mutexTreeTurn);
     vals.resize(0);
     if( (int)vals.capacity() < _numnodes*_statedof) {
         vals.reserve(_numnodes*_statedof);
@@ -766,6 +838,7 @@ void CacheTree::GetNodeValues(std::vector<dReal>& vals) const
 
 void CacheTree::GetNodeValuesList(std::vector<CacheTreeNodePtr>& lvals)
 {
+    TreeReadLock lock(_mutexTree, _mutexTreeTurn);
     lvals.resize(0);
     if (_numnodes > 0) {
         FOREACH(itlevelnodes, _vsetLevelNodes) {
@@ -775,7 +848,7 @@ void CacheTree::GetNodeValuesList(std::vector<CacheTreeNodePtr>& lvals)
 }
 int CacheTree::RemoveCollisionConfigurations()
 {
-
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
     int nremoved=0;
     if (_numnodes > 0) {
         FOREACH(itlevelnodes, _vsetLevelNodes) {
@@ -788,181 +861,424 @@ int CacheTree::RemoveCollisionConfigurations()
     return nremoved;
 }
 
-int CacheTree::SaveCache(std::string filename)
+/// \brief header of the files written by CacheTree::SaveCache
+///
+/// The header is followed by the weights, the node records, the child indices of all nodes, and the names of the colliding bodies. Every node record has the same size (CacheFileNode followed by the state values), so all offsets are computed from the header and the file can be read in place.
+struct CacheFileHeader
 {
-    //boost::mutex::scoped_lock lock(_mutexpool);
-    _mapNodeIndices.clear();
-    int index=0;
-    int knownnodes=0;
-    FOREACH(itlevelnodes, _vsetLevelNodes) {
-        FOREACH(itnode, *itlevelnodes) {
-            if( (*itnode)->_conftype != CNT_Unknown) {
-                knownnodes++;
-            }
-            _mapNodeIndices[*itnode] = index++;
+    char magic[8]; ///< "ORCCACHE"
+    uint32_t version;
+    uint32_t sizereal; ///< sizeof(dReal)
+    uint32_t sizenode; ///< sizeof(CacheFileNode)
+    int32_t statedof;
+    int32_t maxlevel, minlevel;
+    uint32_t numnodes;
+    uint32_t numbodynames;
+    uint64_t numchildindices;
+    uint64_t filesize; ///< total size of the file, used to detect truncated files
+    double base, maxdistance;
+};
+
+/// \brief fixed size part of a node record
+struct CacheFileNode
+{
+    int16_t level;
+    uint8_t hasselfchild;
+    uint8_t usenn;
+    int32_t conftype;
+    int32_t robotlinkindex;
+    int32_t collidinglinkindex;
+    int32_t collidingbodyindex; ///< index into the body names, -1 if none
+    uint32_t numchildren;
+    uint64_t childoffset; ///< offset of the first child into the child indices
+};
+
+static const uint32_t s_nCacheFileVersion = 1;
+
+/// \brief id of the current process, used to make temporary file names unique between processes sharing the database directory
+static int _GetProcessId()
+{
+#ifdef _WIN32
+    return _getpid();
+#else
+    return getpid();
+#endif
+}
+
+static void _InitCacheFileHeader(CacheFileHeader& header)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "ORCCACHE", sizeof(header.magic));
+    header.version = s_nCacheFileVersion;
+    header.sizereal = sizeof(dReal);
+    header.sizenode = sizeof(CacheFileNode);
+}
+
+/// \brief read-only view of a whole file. On POSIX the file is mapped, so processes reading the same file share its pages.
+class CacheFileView
+{
+public:
+    CacheFileView() : _pdata(NULL), _size(0), _pmapped(NULL) {
+    }
+    ~CacheFileView() {
+#ifndef _WIN32
+        if( !!_pmapped ) {
+            munmap(_pmapped, _size);
         }
+#endif
     }
 
-    _numnodes = knownnodes;
-    _fulldirname = RaveFindDatabaseFile(std::string("selfcache.")+filename,false);
+    bool Open(const std::string& filename)
+    {
+#ifndef _WIN32
+        int fd = open(filename.c_str(), O_RDONLY);
+        if( fd < 0 ) {
+            return false;
+        }
+        struct stat filestat;
+        if( fstat(fd, &filestat) != 0 || filestat.st_size <= 0 ) {
+            close(fd);
+            return false;
+        }
+        void* pmapped = mmap(NULL, filestat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if( pmapped == MAP_FAILED ) {
+            return false;
+        }
+        _pmapped = pmapped;
+        _size = filestat.st_size;
+        _pdata = static_cast<const uint8_t*>(pmapped);
+        return true;
+#else
+        std::ifstream f(filename.c_str(), std::ios::in|std::ios::binary);
+        if( !f ) {
+            return false;
+        }
+        f.seekg(0, std::ios::end);
+        std::streamoff size = f.tellg();
+        if( size <= 0 ) {
+            return false;
+        }
+        f.seekg(0, std::ios::beg);
+        _vbuffer.resize(size);
+        if( !f.read(reinterpret_cast<char*>(&_vbuffer[0]), size) ) {
+            return false;
+        }
+        _pdata = &_vbuffer[0];
+        _size = _vbuffer.size();
+        return true;
+#endif
+    }
 
-    RAVELOG_DEBUG_FORMAT("Writing cache to %s, size=%d", _fulldirname%_numnodes);
-    
-    FILE* pfile;
-    pfile = fopen(_fulldirname.c_str(),"wb");
+    inline const uint8_t* GetData() const {
+        return _pdata;
+    }
+    inline size_t GetSize() const {
+        return _size;
+    }
 
-    fwrite(&_statedof, sizeof(_statedof), 1, pfile);
-    fwrite(&_weights[0], sizeof(_weights[0])*_weights.size(), 1, pfile);
-    fwrite(&_base, sizeof(_base), 1, pfile);
-    fwrite(&_fBaseInv, sizeof(_fBaseInv), 1, pfile);
-    fwrite(&_fBaseInv2, sizeof(_fBaseInv2), 1, pfile);
-    fwrite(&_fBaseChildMult, sizeof(_fBaseChildMult), 1, pfile);
-    fwrite(&_maxdistance, sizeof(_maxdistance), 1, pfile);
-    fwrite(&_maxlevel, sizeof(_maxlevel), 1, pfile);
-    fwrite(&_minlevel, sizeof(_minlevel), 1, pfile);
-    fwrite(&_numnodes, sizeof(_numnodes), 1, pfile);
-    fwrite(&_fMaxLevelBound, sizeof(_fMaxLevelBound), 1, pfile);
+private:
+    const uint8_t* _pdata;
+    size_t _size;
+    void* _pmapped; ///< the mapped memory, if any
+    std::vector<uint8_t> _vbuffer; ///< file contents if not mapped
+};
 
-    FOREACH(itlevelnodes, _vsetLevelNodes) {
-        FOREACH(itnode, *itlevelnodes) {
-            _newnode = *itnode;
-            // TODO save only configuration != CNT_Unknown without losing the validity of the tree
-            if (true) { //_newnode->_conftype != CNT_Unknown) {
-                fwrite(&_newnode->_level, sizeof(_newnode->_level), 1, pfile);
-                fwrite(_newnode->GetConfigurationState(), sizeof(dReal)*_statedof, 1, pfile);
-                fwrite(&_newnode->_conftype, sizeof(_newnode->_conftype), 1, pfile);
-
-                if (_newnode->_conftype == CNT_Collision ) {
-                    // note, this assumes the colliding body name never changes across environments, which is a false assumption
-                    _collidingbodyname = _newnode->GetCollidingLink()->GetParent()->GetName();
-                    int namelength = _collidingbodyname.size();
-                    fwrite(&namelength, sizeof(namelength), 1, pfile);
-                    fwrite(_collidingbodyname.c_str(), _collidingbodyname.size(), 1, pfile);
-                    int linkindex = _newnode->GetCollidingLink()->GetIndex();
-                    fwrite(&linkindex, sizeof(linkindex), 1, pfile);
-                    fwrite(&_newnode->_robotlinkindex, sizeof(_newnode->_robotlinkindex), 1, pfile);
-                }
-
-                fwrite(&_newnode->_hasselfchild, sizeof(_newnode->_hasselfchild), 1, pfile);
-                fwrite(&_newnode->_usenn, sizeof(_newnode->_usenn), 1, pfile);
-                int numchildren = _newnode->_vchildren.size();
-                fwrite(&numchildren, sizeof(numchildren), 1, pfile);
+int CacheTree::SaveCache(std::string filename)
+{
+    TreeReadLock lock(_mutexTree, _mutexTreeTurn);
+    std::string fullfilename = RaveFindDatabaseFile(std::string("selfcache.")+filename,false);
 
-                FOREACHC(itchild, (*itnode)->_vchildren) {
-                    int cindex = _mapNodeIndices[*itchild];
-                    fwrite(&cindex, sizeof(cindex), 1, pfile);
-                }
+    // gather the nodes in a deterministic order and index them
+    std::vector<CacheTreeNodePtr> vnodes; vnodes.reserve(_numnodes);
+    FOREACH(itlevelnodes, _vsetLevelNodes) {
+        vnodes.insert(vnodes.end(), itlevelnodes->begin(), itlevelnodes->end());
+    }
+    std::vector< std::pair<CacheTreeNodePtr, uint32_t> > vsortednodes(vnodes.size());
+    for(size_t i = 0; i < vnodes.size(); ++i) {
+        vsortednodes[i] = std::make_pair(vnodes[i], (uint32_t)i);
+    }
+    std::sort(vsortednodes.begin(), vsortednodes.end());
+
+    CacheFileHeader header;
+    _InitCacheFileHeader(header);
+    header.statedof = _statedof;
+    header.maxlevel = _maxlevel;
+    header.minlevel = _minlevel;
+    header.numnodes = vnodes.size();
+    header.base = _base;
+    header.maxdistance = _maxdistance;
+
+    const size_t noderecordsize = sizeof(CacheFileNode) + sizeof(dReal)*_statedof;
+    std::vector<uint8_t> vnoderecords(noderecordsize*vnodes.size());
+    std::vector<uint32_t> vchildindices;
+    std::vector<std::string> vbodynames;
+    std::map<std::string, int32_t> mapbodynameindices;
+    int knownnodes = 0;
+    for(size_t inode = 0; inode < vnodes.size(); ++inode) {
+        CacheTreeNodePtr pnode = vnodes[inode];
+        CacheFileNode filenode;
+        memset(&filenode, 0, sizeof(filenode));
+        filenode.level = pnode->_level;
+        filenode.hasselfchild = pnode->_hasselfchild;
+        filenode.usenn = pnode->_usenn;
+        filenode.conftype = pnode->_conftype;
+        filenode.robotlinkindex = pnode->_robotlinkindex;
+        filenode.collidinglinkindex = -1;
+        filenode.collidingbodyindex = -1;
+        if( pnode->_conftype != CNT_Unknown ) {
+            knownnodes++;
+        }
+        if( pnode->_conftype == CNT_Collision && !!pnode->GetCollidingLink() ) {
+            // note, this assumes the colliding body name never changes across environments, which is a false assumption
+            const std::string& bodyname = pnode->GetCollidingLink()->GetParent()->GetName();
+            std::map<std::string, int32_t>::iterator itname = mapbodynameindices.find(bodyname);
+            if( itname == mapbodynameindices.end() ) {
+                itname = mapbodynameindices.insert(std::make_pair(bodyname, (int32_t)vbodynames.size())).first;
+                vbodynames.push_back(bodyname);
             }
+            filenode.collidingbodyindex = itname->second;
+            filenode.collidinglinkindex = pnode->GetCollidingLinkIndex();
+        }
+        filenode.numchildren = pnode->_vchildren.size();
+        filenode.childoffset = vchildindices.size();
+        FOREACHC(itchild, pnode->_vchildren) {
+            std::vector< std::pair<CacheTreeNodePtr, uint32_t> >::const_iterator itsorted = std::lower_bound(vsortednodes.begin(), vsortednodes.end(), std::make_pair(*itchild, uint32_t(0)));
+            BOOST_ASSERT(itsorted != vsortednodes.end() && itsorted->first == *itchild);
+            vchildindices.push_back(itsorted->second);
         }
+        uint8_t* precord = &vnoderecords[inode*noderecordsize];
+        memcpy(precord, &filenode, sizeof(filenode));
+        memcpy(precord+sizeof(filenode), pnode->GetConfigurationState(), sizeof(dReal)*_statedof);
+    }
+
+    header.numchildindices = vchildindices.size();
+    header.numbodynames = vbodynames.size();
+    header.filesize = sizeof(header) + sizeof(dReal)*_statedof + vnoderecords.size() + sizeof(uint32_t)*vchildindices.size();
+    FOREACHC(itname, vbodynames) {
+        header.filesize += sizeof(uint32_t) + itname->size();
     }
 
-    fclose(pfile);
+    RAVELOG_DEBUG_FORMAT("Writing cache to %s, size=%d, known=%d", fullfilename%vnodes.size()%knownnodes);
 
+    // write to a temporary file and rename it, so that other processes never load a partially written cache
+    std::string tempfilename = str(boost::format("%s.%d.%s.tmp")%fullfilename%_GetProcessId()%boost::lexical_cast<std::string>(this));
+    {
+        std::ofstream f(tempfilename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        if( !f ) {
+            RAVELOG_WARN_FORMAT("failed to write cache file %s", tempfilename);
+            return 0;
+        }
+        f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if( _statedof > 0 ) {
+            f.write(reinterpret_cast<const char*>(&_weights[0]), sizeof(dReal)*_statedof);
+        }
+        if( vnoderecords.size() > 0 ) {
+            f.write(reinterpret_cast<const char*>(&vnoderecords[0]), vnoderecords.size());
+        }
+        if( vchildindices.size() > 0 ) {
+            f.write(reinterpret_cast<const char*>(&vchildindices[0]), sizeof(uint32_t)*vchildindices.size());
+        }
+        FOREACHC(itname, vbodynames) {
+            uint32_t namelength = itname->size();
+            f.write(reinterpret_cast<const char*>(&namelength), sizeof(namelength));
+            f.write(itname->c_str(), namelength);
+        }
+        if( !f ) {
+            f.close();
+            std::remove(tempfilename.c_str());
+            RAVELOG_WARN_FORMAT("failed to write cache file %s", tempfilename);
+            return 0;
+        }
+    }
+    if( std::rename(tempfilename.c_str(), fullfilename.c_str()) != 0 ) {
+        std::remove(tempfilename.c_str());
+        RAVELOG_WARN_FORMAT("failed to rename cache file to %s", fullfilename);
+        return 0;
+    }
     return 1;
 }
 
 int CacheTree::LoadCache(std::string filename, EnvironmentBasePtr penv)
 {
-    //boost::mutex::scoped_lock lock(_mutexpool);
-    _fulldirname = RaveFindDatabaseFile(std::string("selfcache.")+filename,false);
-
-    FILE* pfile = fopen(_fulldirname.c_str(),"rb");
-    size_t outs;
-
-    if (!pfile) {
+    std::string fullfilename = RaveFindDatabaseFile(std::string("selfcache.")+filename,false);
+    CacheFileView fileview;
+    if( !fileview.Open(fullfilename) ) {
         return 0;
     }
 
-    Reset();
-    outs = fread(&_statedof, sizeof(_statedof), 1, pfile);
-
-    _weights.resize(_statedof,1.0);
-    _curconf.resize(_statedof,1.0);
-    outs = fread(&_weights[0], sizeof(_weights[0])*_weights.size(), 1, pfile);
-
-    outs = fread(&_base, sizeof(_base), 1, pfile);
-    outs = fread(&_fBaseInv, sizeof(_fBaseInv), 1, pfile);
-    outs = fread(&_fBaseInv2, sizeof(_fBaseInv2), 1, pfile);
-    outs = fread(&_fBaseChildMult, sizeof(_fBaseChildMult), 1, pfile);
-    outs = fread(&_maxdistance, sizeof(_maxdistance), 1, pfile);
-    outs = fread(&_maxlevel, sizeof(_maxlevel), 1, pfile);
-    outs = fread(&_minlevel, sizeof(_minlevel), 1, pfile);
-    outs = fread(&_numnodes, sizeof(_numnodes), 1, pfile);
-    outs = fread(&_fMaxLevelBound, sizeof(_fMaxLevelBound), 1, pfile);
+    CacheFileHeader header, expected;
+    _InitCacheFileHeader(expected);
+    if( fileview.GetSize() < sizeof(header) ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, unknown format", fullfilename);
+        return 0;
+    }
+    memcpy(&header, fileview.GetData(), sizeof(header));
+    if( memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version || header.sizereal != expected.sizereal || header.sizenode != expected.sizenode ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, unknown format or version", fullfilename);
+        return 0;
+    }
+    if( header.statedof != _statedof ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, it has %d DOF while the cache has %d", fullfilename%header.statedof%_statedof);
+        return 0;
+    }
+    if( header.filesize != fileview.GetSize() || header.numnodes == 0 ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, it is truncated or empty", fullfilename);
+        return 0;
+    }
 
-    int maxenclevel = max(_EncodeLevel(_maxlevel), _EncodeLevel(_minlevel));
-    _vsetLevelNodes.resize(maxenclevel+1);
+    if( header.minlevel > header.maxlevel || header.minlevel < std::numeric_limits<int16_t>::min() || header.maxlevel > std::numeric_limits<int16_t>::max() || !(header.base > 1 && header.base < std::numeric_limits<double>::infinity()) || !(header.maxdistance > 0 && header.maxdistance < std::numeric_limits<double>::infinity()) ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, it has invalid levels %d to %d or base %f", fullfilename%header.minlevel%header.maxlevel%header.base);
+        return 0;
+    }
 
-    _vnodes.resize(_numnodes);
-    _dummycs.resize(_statedof, 0);
+    // check every section against the remaining bytes before forming any pointer, so that corrupted counts cannot overflow the offsets
+    const size_t noderecordsize = sizeof(CacheFileNode) + sizeof(dReal)*_statedof;
+    uint64_t remaining = fileview.GetSize() - sizeof(header);
+    if( sizeof(dReal)*_statedof > remaining ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, it is truncated", fullfilename);
+        return 0;
+    }
+    remaining -= sizeof(dReal)*_statedof;
+    if( header.numnodes > remaining/noderecordsize ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, it is truncated", fullfilename);
+        return 0;
+    }
+    remaining -= noderecordsize*header.numnodes;
+    if( header.numchildindices > remaining/sizeof(uint32_t) ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, it is truncated", fullfilename);
+        return 0;
+    }
+    const uint8_t* pweights = fileview.GetData() + sizeof(header);
+    const uint8_t* pnoderecords = pweights + sizeof(dReal)*_statedof;
+    const uint8_t* pchildindices = pnoderecords + noderecordsize*header.numnodes;
+    const uint8_t* pbodynames = pchildindices + sizeof(uint32_t)*header.numchildindices;
+    const uint8_t* pend = fileview.GetData() + fileview.GetSize();
+
+    // resolve the colliding bodies once
+    std::vector<KinBodyPtr> vbodies(header.numbodynames);
+    for(uint32_t ibody = 0; ibody < header.numbodynames; ++ibody) {
+        uint32_t namelength = 0;
+        if( (size_t)(pend-pbodynames) < sizeof(namelength) ) {
+            RAVELOG_WARN_FORMAT("ignoring cache file %s, it is truncated", fullfilename);
+            return 0;
+        }
+        memcpy(&namelength, pbodynames, sizeof(namelength));
+        pbodynames += sizeof(namelength);
+        if( (size_t)(pend-pbodynames) < namelength ) {
+            RAVELOG_WARN_FORMAT("ignoring cache file %s, it is truncated", fullfilename);
+            return 0;
+        }
+        std::string bodyname(reinterpret_cast<const char*>(pbodynames), namelength);
+        pbodynames += namelength;
+        vbodies[ibody] = penv->GetKinBody(bodyname);
+        if( !vbodies[ibody] ) {
+            RAVELOG_WARN_FORMAT("loading cache expected colliding body %s, but none found", bodyname);
+        }
+    }
 
-    for(int i = 0; i < _numnodes; ++i) {
-        _vnodes[i] = _CreateCacheTreeNode(_dummycs, CollisionReportPtr());
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
+    _Reset();
+    _weights.resize(_statedof);
+    if( _statedof > 0 ) {
+        memcpy(&_weights[0], pweights, sizeof(dReal)*_statedof);
+    }
+    _base = header.base;
+    _fBaseInv = 1/_base;
+    _fBaseInv2 = 1/Sqr(_base);
+    _fBaseChildMult = 1/(_base-1);
+    _maxdistance = header.maxdistance;
+    _maxlevel = header.maxlevel;
+    _minlevel = header.minlevel;
+    _fMaxLevelBound = RavePow(_base, _maxlevel);
+    _vsetLevelNodes.resize(max(_EncodeLevel(_maxlevel), _EncodeLevel(_minlevel))+1);
+
+    std::vector<CacheTreeNodePtr> vnodes(header.numnodes);
+    for(uint32_t inode = 0; inode < header.numnodes; ++inode) {
+        const uint8_t* precord = pnoderecords + inode*noderecordsize;
+        vnodes[inode] = new (_poolNodes->malloc()) CacheTreeNode(static_cast<const dReal*>(NULL), 0, NULL);
+        // the records are not necessarily aligned
+        memcpy(vnodes[inode]->_pcstate, precord+sizeof(CacheFileNode), sizeof(dReal)*_statedof);
+        // the levels of all nodes are needed before the children are checked
+        CacheFileNode filenode;
+        memcpy(&filenode, precord, sizeof(filenode));
+        vnodes[inode]->_level = filenode.level;
+#ifdef _DEBUG
+        vnodes[inode]->id = s_CacheTreeId++;
+#endif
     }
 
-    for (int inode = 0; inode < _numnodes; ++inode)
-    {
-        _newnode = _vnodes.at(inode);
-        outs = fread(&_newnode->_level, sizeof(_newnode->_level), 1, pfile);
-        outs = fread(_newnode->_pcstate, sizeof(dReal)*_statedof, 1, pfile);
-        outs = fread(&_newnode->_conftype, sizeof(_newnode->_conftype), 1, pfile);
-
-        if( _newnode->_conftype == CNT_Collision ) {
-            int namelength;
-            outs = fread(&namelength, sizeof(namelength), 1, pfile);
-            _collidingbodyname.resize(namelength);
-            outs = fread(&_collidingbodyname[0], namelength, 1, pfile);
-            int collidinglinkindex;
-            outs = fread(&collidinglinkindex, sizeof(collidinglinkindex), 1, pfile);
-            _pcollidingbody = penv->GetKinBody(_collidingbodyname);
-            if( !_pcollidingbody ) {
-                RAVELOG_WARN_FORMAT("loading cache expected colliding body %s, but none found", _collidingbodyname);
+    bool bvalid = true;
+    uint32_t numinserted = 0; ///< vnodes[0:numinserted] are in _vsetLevelNodes and destroyed by _Reset
+    for(uint32_t inode = 0; inode < header.numnodes && bvalid; ++inode) {
+        CacheFileNode filenode;
+        memcpy(&filenode, pnoderecords + inode*noderecordsize, sizeof(filenode));
+        if( filenode.level < _minlevel || filenode.level > _maxlevel ) {
+            bvalid = false;
+            break;
+        }
+        CacheTreeNodePtr pnode = vnodes[inode];
+        pnode->_hasselfchild = filenode.hasselfchild;
+        pnode->_usenn = filenode.usenn;
+        pnode->_conftype = (ConfigurationNodeType)filenode.conftype;
+        pnode->_robotlinkindex = filenode.robotlinkindex;
+        if( filenode.collidingbodyindex >= 0 && filenode.collidingbodyindex < (int32_t)vbodies.size() && !!vbodies[filenode.collidingbodyindex] ) {
+            KinBodyPtr pcollidingbody = vbodies[filenode.collidingbodyindex];
+            if( filenode.collidinglinkindex >= 0 && filenode.collidinglinkindex < (int32_t)pcollidingbody->GetLinks().size() ) {
+                pnode->_collidinglink = pcollidingbody->GetLinks()[filenode.collidinglinkindex];
             }
-            else {
-                _newnode->_collidinglink = _pcollidingbody->GetLinks().at(collidinglinkindex);
+        }
+        if( filenode.childoffset > header.numchildindices || filenode.numchildren > header.numchildindices - filenode.childoffset ) {
+            bvalid = false;
+            break;
+        }
+        pnode->_vchildren.resize(filenode.numchildren);
+        for(uint32_t ichild = 0; ichild < filenode.numchildren; ++ichild) {
+            uint32_t childindex;
+            memcpy(&childindex, pchildindices + sizeof(uint32_t)*(filenode.childoffset+ichild), sizeof(childindex));
+            // children are strictly below their parent, otherwise the file could make cycles
+            if( childindex >= header.numnodes || vnodes[childindex]->_level >= pnode->_level ) {
+                bvalid = false;
+                break;
             }
-            outs = fread(&_newnode->_robotlinkindex, sizeof(_newnode->_robotlinkindex), 1, pfile);
+            pnode->_vchildren[ichild] = vnodes[childindex];
         }
-
-        outs = fread(&_newnode->_hasselfchild, sizeof(_newnode->_hasselfchild), 1, pfile);
-        outs = fread(&_newnode->_usenn, sizeof(_newnode->_usenn), 1, pfile);
-        int numchildren;
-        outs = fread(&numchildren, sizeof(numchildren), 1, pfile);
-        _newnode->_vchildren.resize(numchildren);
-
-        // create the copies of the children and insert them
-        for(int i = 0; i < numchildren; ++i) {
-            int childid;
-            outs = fread(&childid, sizeof(childid), 1, pfile);
-            _newnode->_vchildren[i] = _vnodes.at(childid);
+        if( !bvalid ) {
+            break;
         }
-
-        _vsetLevelNodes.at(_EncodeLevel(_newnode->_level)).insert(_newnode);
+        _vsetLevelNodes[_EncodeLevel(pnode->_level)].insert(pnode);
+        ++numinserted;
     }
 
-    fclose(pfile);
-
-    _vnodes.resize(0);
-
-    int numloaded = GetNumKnownNodes();
-    OPENRAVE_ASSERT_OP(numloaded,==,_numnodes);
+    if( !bvalid || _vsetLevelNodes.at(_EncodeLevel(_maxlevel)).size() != 1 ) {
+        RAVELOG_WARN_FORMAT("ignoring cache file %s, it has invalid nodes", fullfilename);
+        // nodes that did not make it into _vsetLevelNodes are not destroyed by _Reset
+        for(uint32_t inode = numinserted; inode < header.numnodes; ++inode) {
+            _DeleteCacheTreeNode(vnodes[inode]);
+        }
+        _Reset();
+        return 0;
+    }
+    _numnodes = header.numnodes;
+    RAVELOG_DEBUG_FORMAT("Loaded cache from %s, size=%d, known=%d", fullfilename%_numnodes%_GetNumKnownNodes());
     return 1;
 }
 
 int CacheTree::UpdateCollisionConfigurations(KinBodyPtr pbody)
 {
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
     int nremoved=0;
     if (_numnodes > 0) {
         FOREACH(itlevelnodes, _vsetLevelNodes) {
             FOREACH(itnode, *itlevelnodes) {
-                _newnode = *itnode;
-                if ((_newnode->GetType() == CNT_Collision) && (pbody == _newnode->GetCollidingLink()->GetParent())) {
-                    _newnode->SetType(CNT_Unknown);
+                CacheTreeNodePtr pnode = *itnode;
+                if ((pnode->GetType() == CNT_Collision) && !!pnode->GetCollidingLink() && (pbody == pnode->GetCollidingLink()->GetParent())) {
+                    pnode->SetType(CNT_Unknown);
                     nremoved += 1;
                 }
             }
         }
-        int knum = GetNumKnownNodes();
+        int knum = _GetNumKnownNodes();
         RAVELOG_VERBOSE_FORMAT("removed %d nodes, %d known nodes left",nremoved%knum);
     }
     return nremoved;
@@ -970,6 +1286,7 @@ int CacheTree::UpdateCollisionConfigurations(KinBodyPtr pbody)
 
 int CacheTree::UpdateFreeConfigurations(KinBodyPtr pbody) //todo only remove those with overlaping linkspheres
 {
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
     int nremoved=0;
     if (_numnodes > 0) {
 
@@ -982,7 +1299,7 @@ int CacheTree::UpdateFreeConfigurations(KinBodyPtr pbody) //todo only remove tho
             }
         }
 
-        int knum = GetNumKnownNodes();
+        int knum = _GetNumKnownNodes();
         RAVELOG_VERBOSE_FORMAT("removed %d nodes, %d known nodes left",nremoved%knum);
     }
 
@@ -991,6 +1308,7 @@ int CacheTree::UpdateFreeConfigurations(KinBodyPtr pbody) //todo only remove tho
 
 int CacheTree::RemoveFreeConfigurations()
 {
+    TreeWriteLock lock(_mutexTree, _mutexTreeTurn);
     int nremoved=0;
     if (_numnodes > 0) {
         FOREACH(itlevelnodes, _vsetLevelNodes) {
@@ -1004,7 +1322,7 @@ int CacheTree::RemoveFreeConfigurations()
             }
         }
 
-        int knum = GetNumKnownNodes();
+        int knum = _GetNumKnownNodes();
         RAVELOG_VERBOSE_FORMAT("removed %d nodes, %d known nodes left",nremoved%knum);
     }
 
@@ -1012,6 +1330,12 @@ int CacheTree::RemoveFreeConfigurations()
 }
 
 int CacheTree::GetNumKnownNodes()
+{
+    TreeReadLock lock(_mutexTree, _mutexTreeTurn);
+    return _GetNumKnownNodes();
+}
+
+int CacheTree::_GetNumKnownNodes() const
 {
     int nknown=0;
     if (_numnodes > 0) {
@@ -1028,6 +1352,7 @@ int CacheTree::GetNumKnownNodes()
 
 bool CacheTree::Validate()
 {
+    TreeReadLock lock(_mutexTree, _mutexTreeTurn);
     if( _numnodes == 0 ) {
         return _numnodes==0;
     }
@@ -18,6 +18,9 @@
 #include "openraveplugindefs.h"
 #include <deque>
 #include <boost/pool/pool.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 #define _(msgid) OpenRAVE::RaveGetLocalizedTextForDomain("openrave_plugins_configurationcache", msgid)
 
@@ -160,6 +163,8 @@ typedef const CacheTreeNode* CacheTreeNodeConstPtr;
 
     d(p,q) < (1 + e)d(p,S)
     2^(1+i) (1 + 1/e) <= d(p,Qi)
+
+    The tree is safe to use from multiple threads: the queries (FindNearestNode, GetNodeValues, SaveCache, etc) can run concurrently with each other, the functions modifying the tree are serialized with the queries. Node pointers returned by the queries stay valid until the node is removed or the tree is reset. The hit counts of the nodes are statistics only and are not synchronized.
  */
 class CacheTree
 {
@@ -259,12 +264,36 @@ public:
     int GetNumKnownNodes();
 
     /// \brief save cache to disk
+    ///
+    /// The file is a versioned binary format with fixed size node records, see LoadCache. It is written to a temporary file first and then renamed, so processes loading the cache never see a partially written file.
+    /// \return 1 if successful
     int SaveCache(std::string filename);
 
     /// \brief load cache from disk
+    ///
+    /// The file is mapped into memory when the platform supports it, so processes loading the same cache share its pages. Files of an older format or of a tree with a different number of DOF are ignored and the cache is rebuilt.
+    /// \return 1 if successful
     int LoadCache(std::string filename, EnvironmentBasePtr penv);
 
 private:
+    /// \brief scratch space of a nearest neighbor query.
+    class SearchBuffers
+    {
+public:
+        boost::mutex _mutex; ///< held by the query using the buffers
+        std::vector< std::pair<CacheTreeNodePtr, dReal> > _vCurrentLevelNodes, _vNextLevelNodes;
+    };
+    typedef boost::shared_ptr<SearchBuffers> SearchBuffersPtr;
+
+    /// \brief locks one of the search buffers, first trying the ones not used by other queries
+    SearchBuffers& _LockSearchBuffers(boost::mutex::scoped_lock& lock) const;
+
+    /// \brief resets the tree, assumes _mutexTree is locked for writing
+    void _Reset();
+
+    /// \brief assumes _mutexTree is locked
+    int _GetNumKnownNodes() const;
+
     /// \brief creates new node on the pool
     CacheTreeNodePtr _CreateCacheTreeNode(const std::vector<dReal>& cs, CollisionReportPtr report);
     CacheTreeNodePtr _CloneCacheTreeNode(CacheTreeNodeConstPtr refnode);
@@ -317,12 +346,6 @@ private:
     std::vector<dReal> _weights; ///< weights used by the distance function
     std::vector<dReal> _curconf;
 
-    std::string _fulldirname;
-    CacheTreeNodePtr _newnode; ///< for loading
-    std::string _collidingbodyname;
-    KinBodyPtr _pcollidingbody;
-
-    std::map<CacheTreeNodePtr, int> _mapNodeIndices;
     std::vector< std::set<CacheTreeNodePtr> > _vsetLevelNodes; ///< _vsetLevelNodes[enc(level)][node] holds the indices of the children of "node" of a given the level. enc(level) maps (-inf,inf) into [0,inf) so it can be indexed by the vector. Every node has an entry in a map here. If the node doesn't hold any children, then it is at the leaf of the tree. _vsetLevelNodes.at(_EncodeLevel(_maxlevel)) is the root.
 
     boost::shared_ptr<boost::pool<> > _poolNodes; ///< the dynamically growing memory pool of nodes. Since each node's size is determined during run-time, the pool constructor has to be called with the correct node size
@@ -336,12 +359,13 @@ private:
     int _numnodes; ///< the number of nodes in the current tree starting at the root at _vsetLevelNodes.at(_EncodeLevel(_maxlevel))
     dReal _fMaxLevelBound; ///< pow(_base, _maxlevel)
 
-    // cache cache
-    mutable std::vector< std::pair<CacheTreeNodePtr, dReal> > _vCurrentLevelNodes, _vNextLevelNodes;
-    mutable std::vector< std::vector<CacheTreeNodePtr> > _vvCacheNodes;
+    // cache cache, only used by the functions that modify the tree
+    std::vector< std::pair<CacheTreeNodePtr, dReal> > _vCurrentLevelNodes, _vNextLevelNodes;
+    std::vector< std::vector<CacheTreeNodePtr> > _vvCacheNodes;
 
-    std::vector<CacheTreeNodePtr> _vnodes; ///< for loading
-    std::vector<dReal> _dummycs; ///< for loading
+    std::vector<SearchBuffersPtr> _vsearchbuffers; ///< scratch space for the queries, one is locked per query so concurrent queries do not have to wait on each other
+    mutable boost::shared_mutex _mutexTree; ///< locked for reading by the queries, and for writing by the functions modifying the tree
+    mutable boost::mutex _mutexTreeTurn; ///< taken before _mutexTree, so a waiting writer is not starved by new readers
 };
 
 typedef boost::shared_ptr<CacheTree> CacheTreePtr;
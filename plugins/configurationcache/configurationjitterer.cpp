@@ -24,6 +24,7 @@
 #endif
 
 #include "configurationcachetree.h"
+#include "workerthreadpool.h"
 
 namespace configurationcache {
 
@@ -84,6 +85,29 @@ typedef boost::shared_ptr<ManipPositionConstraints> ManipPositionConstraintsPtr;
 
 class ConfigurationJitterer : public SpaceSamplerBase
 {
+    /// \brief a block of jitter candidates that the workers evaluate in parallel
+    class WorkerJob
+    {
+public:
+        WorkerJob() : _numcandidates(0), _nextcandidate(0), _firstvalid(0) {
+        }
+        std::vector<dReal> _vperturbations; ///< the perturbations every candidate is checked with
+        std::vector< std::vector<dReal> > _vcandidates; ///< candidates in the order they were sampled, only the first _numcandidates are used
+        size_t _numcandidates;
+        size_t _nextcandidate; ///< next candidate for a worker to take, candidates are taken in sample order
+        size_t _firstvalid; ///< index of the first valid candidate in sample order, _numcandidates if none was found yet
+    };
+
+    /// \brief a worker for parallel jittering. Has its own cloned environment so that collision checking does not interfere with the other workers.
+    class Worker
+    {
+public:
+        EnvironmentBasePtr _penv;
+        RobotBasePtr _probot; ///< clone of the jittered robot inside _penv
+        RobotBase::ManipulatorConstPtr _pmanip; ///< clone of the constrained manipulator, if any
+        std::vector<dReal> _vtempdof;
+    };
+
 public:
     /// \param parameters The planner parameters used to define the configuration space to jitter. The following fields are required: _getstatefn, _setstatefn, _vConfigUpperLimit, _vConfigLowerLimit, _checkpathvelocityconstraintsfn, _diffstatefn, _nRandomGeneratorSeed, _samplefn. The following are used and optional : _neighstatefn (used for constraining on manifolds)
     ConfigurationJitterer(EnvironmentBasePtr penv, std::istream& is) : SpaceSamplerBase(penv)
@@ -119,6 +143,11 @@ By default will sample the robot's active DOFs. Parameters part of the interface
     bias_dir is the workspace direction to bias the sampling in.\n\
     nullsampleprob, nullbiassampleprob, and deltasampleprob are in [0,1]\n\
  //");
+        RegisterCommand("SetNumThreads",boost::bind(&ConfigurationJitterer::SetNumThreadsCommand,this,_1,_2),
+                        "format: int [int]\n\n\
+number of worker threads and the number of candidates per block. When more than 1 thread is used, the candidates are sampled in blocks and evaluated by the workers, each checking collisions in its own clone of the environment. The first valid candidate in sample order is returned, so the result is the same as the serial jittering. Not used when a neighbor state function is set. 0 or 1 jitters serially (default).");
+        RegisterCommand("GetNumThreads",boost::bind(&ConfigurationJitterer::GetNumThreadsCommand,this,_1,_2),
+                        "returns the number of worker threads and the number of candidates per block");
 
         bool bUseCache = false;
         std::string robotname, samplername = "MT19937";
@@ -181,6 +210,9 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         _linkdistthresh2 = _linkdistthresh*_linkdistthresh;
         _neighdistthresh = 1;
 
+        _nNumThreads = 0;
+        _nBlockSize = 32;
+
         _UpdateLimits();
         _limitscallback = _probot->RegisterChangeCallback(RobotBase::Prop_JointLimits, boost::bind(&ConfigurationJitterer::_UpdateLimits,this));
         _UpdateGrabbed();
@@ -192,6 +224,7 @@ By default will sample the robot's active DOFs. Parameters part of the interface
     }
 
     virtual ~ConfigurationJitterer(){
+        _StopWorkers();
     }
 
     virtual void SetSeed(uint32_t seed) {
@@ -289,6 +322,31 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         return true;
     }
 
+    bool SetNumThreadsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int numthreads = 0, blocksize = _nBlockSize;
+        sinput >> numthreads;
+        if( !sinput || numthreads < 0 ) {
+            return false;
+        }
+        sinput >> blocksize;
+        if( blocksize <= 0 ) {
+            return false;
+        }
+        if( numthreads != _nNumThreads ) {
+            _StopWorkers();
+            _nNumThreads = numthreads;
+        }
+        _nBlockSize = blocksize;
+        return true;
+    }
+
+    bool GetNumThreadsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sout << _nNumThreads << " " << _nBlockSize;
+        return true;
+    }
+
     bool SetConstraintToolDirectionCommand(std::ostream& sout, std::istream& sinput)
     {
         std::string manipname;
@@ -428,8 +486,6 @@ By default will sample the robot's active DOFs. Parameters part of the interface
     {
         RobotBase::RobotStateSaver robotsaver(_probot, KinBody::Save_LinkTransformation|KinBody::Save_ActiveDOF);
         _InitRobotState();
-        const dReal linkdistthresh = _linkdistthresh;
-        const dReal linkdistthresh2 = _linkdistthresh2;
 
         vector<AABB> newLinkAABBs;
         bool bCollision = false;
@@ -513,15 +569,10 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         }
 
         BOOST_ASSERT(!_busebiasing || _vbiasdofdirection.size() > 0);
-        const boost::array<dReal, 3> rayincs = {{0.5, 0.9, 0.2}};
-
-        bool busebiasing = _busebiasing;
-        const int nMaxIterRadiusThresh=_maxiterations/2;
-        const dReal imaxiterations = 2.0/dReal(_maxiterations);
-        const dReal fJitterLowerThresh=0.2, fJitterHigherThresh=0.8;
-        dReal fBias = _vbiasdirection.lengthsqr3();
-        if( fBias > g_fEpsilon ) {
-            fBias = RaveSqrt(fBias);
+
+        if( _nNumThreads > 1 && !bConstraint ) {
+            // the neighbor state function is bound to this environment, so can only parallelize without it
+            return _SampleParallel(vnewdof, interval, perturbations, robotsaver);
         }
 
         uint64_t starttime = utils::GetNanoPerformanceTime();
@@ -529,172 +580,9 @@ By default will sample the robot's active DOFs. Parameters part of the interface
             if( (iter%10) == 0 ) { // not sure what a good rate is...
                 _CallStatusFunctions(iter);
             }
-            if( busebiasing && iter < (int)rayincs.size() ) {
-                // start by checking samples directly above the current configuration
-                for (size_t j = 0; j < vnewdof.size(); ++j) {
-                    vnewdof[j] = _curdof[j] + (rayincs[iter] * _vbiasdofdirection.at(j));
-                }
-            }
-            else {
-                // ramp of the jitter as iterations increase
-                dReal jitter = _maxjitter;
-                if( iter < nMaxIterRadiusThresh ) {
-                    jitter = _maxjitter*dReal(iter+1)*imaxiterations;
-                }
-
-                bool samplebiasdir = false;
-                bool samplenull = false;
-                bool sampledelta = false;
-                if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullsampleprob)
-                {
-                    samplenull = true;
-                }
-                if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullbiassampleprob) {
-                    samplebiasdir = true;
-                }
-                if( (!samplenull && !samplebiasdir) || _ssampler->SampleSequenceOneReal() < _deltasampleprob ) {
-                    sampledelta = true;
-                }
-
-                bool deltasuccess = false;
-                if( sampledelta ) {
-                    // check which third the sampled dof is in
-                    for(size_t j = 0; j < vnewdof.size(); ++j) {
-                        dReal f = 2*_ssampler->SampleSequenceOneReal(interval)-1; // f in [-1,1]
-                        if( RaveFabs(f) < fJitterLowerThresh ) {
-                            _deltadof[j] = 0;
-                        }
-                        else if( f < -fJitterHigherThresh ) {
-                            _deltadof[j] = -jitter;
-                        }
-                        else if( f > fJitterHigherThresh ) {
-                            _deltadof[j] = jitter;
-                        }
-                        else {
-                            _deltadof[j] = jitter*f;
-                        }
-                    }
-                    deltasuccess = true;
-                }
-
-                if (!samplebiasdir && !samplenull && !deltasuccess) {
-                    continue;
-                }
-                // (lambda * biasdir) + (Nx) + delta + _curdofs
-                dReal fNullspaceMultiplier = linkdistthresh*2;
-                if( fNullspaceMultiplier <= 0 ) {
-                    fNullspaceMultiplier = fBias;
-                }
-                for (size_t k = 0; k < vnewdof.size(); ++k) {
-                    vnewdof[k] = _curdof[k];
-                    if (samplebiasdir) {
-                        vnewdof[k] += _ssampler->SampleSequenceOneReal() * _vbiasdofdirection[k];
-                    }
-                    if (samplenull) {
-                        for (size_t j = 0; j < _vbiasnullspace.size(); ++j) {
-                            dReal nullx = (_ssampler->SampleSequenceOneReal()*2-1)*fNullspaceMultiplier;
-                            vnewdof[k] += nullx * _vbiasnullspace[j][k];
-                        }
-                    }
-                    if (sampledelta) {
-                        vnewdof[k] += _deltadof[k];
-                    }
-                }
-            }
-
-            // get new state
-            for(size_t j = 0; j < _deltadof.size(); ++j) {
-                if( vnewdof[j] > _upper.at(j) ) {
-                    vnewdof[j] = _upper.at(j);
-                }
-                else if( vnewdof[j] < _lower.at(j) ) {
-                    vnewdof[j] = _lower.at(j);
-                }
-            }
-
-            if( !!_cache ) {
-                if( !!_cache->FindNearestNode(vnewdof, _neighdistthresh).first ) {
-                    _cachehit++;
-                    continue;
-                }
-            }
-
-            //int ret = cache.InsertNode(vnewdof, CollisionReportPtr(), _neighdistthresh);
-            //BOOST_ASSERT(ret==1);
-
-            _probot->SetActiveDOFValues(vnewdof);
-#ifdef _DEBUG
             dReal fmaxtransdist = 0;
-#endif
-            bool bSuccess = true;
-            if( linkdistthresh > 0 ) {
-                for (size_t ilink = 0; ilink < _vLinkAABBs.size(); ++ilink) {
-                    // check for an elipse
-                    // L^2 (b*v)^2 + |v|^2|b|^4 - (b*v)^2 |b|^2 <= |b|^4 * L^2
-                    Transform tnewlink = _vLinks[ilink]->GetTransform();
-                    TransformMatrix projdelta = _vOriginalInvTransforms[ilink] * tnewlink;
-                    projdelta.m[0] -= 1;
-                    projdelta.m[5] -= 1;
-                    projdelta.m[10] -= 1;
-                    Vector projextents = _vLinkAABBs[ilink].extents;
-                    Vector projboxright(projdelta.m[0]*projextents.x, projdelta.m[4]*projextents.x, projdelta.m[8]*projextents.x);
-                    Vector projboxup(projdelta.m[1]*projextents.y, projdelta.m[5]*projextents.y, projdelta.m[9]*projextents.y);
-                    Vector projboxdir(projdelta.m[2]*projextents.z, projdelta.m[6]*projextents.z, projdelta.m[10]*projextents.z);
-                    Vector projboxpos = projdelta * _vLinkAABBs[ilink].pos;
-
-                    Vector b;
-                    if( busebiasing ) {
-                        b = _vOriginalInvTransforms[ilink].rotate(_vbiasdirection); // inside link coordinate system
-                    }
-                    else {
-                        // doesn't matter which vector we pick since it is just a sphere.
-                        b = Vector(0,0,linkdistthresh);
-                    }
-
-                    dReal blength2 = b.lengthsqr3();
-                    dReal blength4 = blength2*blength2;
-                    dReal rhs = blength4 * linkdistthresh2;
-                    //dReal rhs = (b.lengthsqr3()) * linkdistthresh;
-                    dReal ellipdist = 0;
-                    // now figure out what is the max distance
-                    for(int ix = 0; ix < 2; ++ix) {
-                        Vector projvx = ix > 0 ? projboxpos + projboxright : projboxpos - projboxright;
-                        for(int iy = 0; iy < 2; ++iy) {
-                            Vector projvy = iy > 0 ? projvx + projboxup : projvx - projboxup;
-                            for(int iz = 0; iz < 2; ++iz) {
-                                Vector projvz = iz > 0 ? projvy + projboxdir : projvy - projboxdir;
-                                Vector v = projvz; // inside link coordinate system
-                                dReal bv = (v.dot3(b));
-                                dReal bv2 = bv*bv;
-                                dReal flen2 = (linkdistthresh2 - blength2) * bv2 + v.lengthsqr3()*blength4;
-
-                                if( ellipdist < flen2 ) {
-                                    ellipdist = flen2;
-#ifdef _DEBUG
-                                    fmaxtransdist = flen2;
-#endif
-                                    if (ellipdist > rhs) {
-                                        bSuccess = false;
-                                        break;
-                                    }
-                                }
-                            }
-
-                            if (ellipdist > rhs) {
-                                bSuccess = false;
-                                break;
-                            }
-                        }
-                        if (ellipdist > rhs) {
-                            bSuccess = false;
-                            break;
-                        }
-                    }
-                }
-
-                if (!bSuccess) {
-                    continue;
-                }
+            if( !_SampleCandidate(iter, vnewdof, interval, fmaxtransdist) ) {
+                continue;
             }
 
             // check perturbation
@@ -828,6 +716,333 @@ By default will sample the robot's active DOFs. Parameters part of the interface
 
 protected:
 
+    /// \brief generates the jitter candidate of iteration iter around _curdof, sets it on the robot, and checks it against the cache and the link distance threshold
+    ///
+    /// Draws from _ssampler, so the candidates only depend on the seed and the order that the iterations are generated in.
+    /// \param[out] fmaxtransdist the max link distance measure, only computed in debug builds
+    /// \return false if the candidate should be skipped
+    bool _SampleCandidate(int iter, std::vector<dReal>& vnewdof, IntervalType interval, dReal& fmaxtransdist)
+    {
+        const dReal linkdistthresh = _linkdistthresh;
+        const dReal linkdistthresh2 = _linkdistthresh2;
+    const boost::array<dReal, 3> rayincs = {{0.5, 0.9, 0.2}};
+
+    bool busebiasing = _busebiasing;
+    const int nMaxIterRadiusThresh=_maxiterations/2;
+    const dReal imaxiterations = 2.0/dReal(_maxiterations);
+    const dReal fJitterLowerThresh=0.2, fJitterHigherThresh=0.8;
+    dReal fBias = _vbiasdirection.lengthsqr3();
+    if( fBias > g_fEpsilon ) {
+        fBias = RaveSqrt(fBias);
+    }
+        if( busebiasing && iter < (int)rayincs.size() ) {
+            // start by checking samples directly above the current configuration
+            for (size_t j = 0; j < vnewdof.size(); ++j) {
+                vnewdof[j] = _curdof[j] + (rayincs[iter] * _vbiasdofdirection.at(j));
+            }
+        }
+        else {
+            // ramp of the jitter as iterations increase
+            dReal jitter = _maxjitter;
+            if( iter < nMaxIterRadiusThresh ) {
+                jitter = _maxjitter*dReal(iter+1)*imaxiterations;
+            }
+
+            bool samplebiasdir = false;
+            bool samplenull = false;
+            bool sampledelta = false;
+            if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullsampleprob)
+            {
+                samplenull = true;
+            }
+            if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullbiassampleprob) {
+                samplebiasdir = true;
+            }
+            if( (!samplenull && !samplebiasdir) || _ssampler->SampleSequenceOneReal() < _deltasampleprob ) {
+                sampledelta = true;
+            }
+
+            bool deltasuccess = false;
+            if( sampledelta ) {
+                // check which third the sampled dof is in
+                for(size_t j = 0; j < vnewdof.size(); ++j) {
+                    dReal f = 2*_ssampler->SampleSequenceOneReal(interval)-1; // f in [-1,1]
+                    if( RaveFabs(f) < fJitterLowerThresh ) {
+                        _deltadof[j] = 0;
+                    }
+                    else if( f < -fJitterHigherThresh ) {
+                        _deltadof[j] = -jitter;
+                    }
+                    else if( f > fJitterHigherThresh ) {
+                        _deltadof[j] = jitter;
+                    }
+                    else {
+                        _deltadof[j] = jitter*f;
+                    }
+                }
+                deltasuccess = true;
+            }
+
+            if (!samplebiasdir && !samplenull && !deltasuccess) {
+                return false;
+            }
+            // (lambda * biasdir) + (Nx) + delta + _curdofs
+            dReal fNullspaceMultiplier = linkdistthresh*2;
+            if( fNullspaceMultiplier <= 0 ) {
+                fNullspaceMultiplier = fBias;
+            }
+            for (size_t k = 0; k < vnewdof.size(); ++k) {
+                vnewdof[k] = _curdof[k];
+                if (samplebiasdir) {
+                    vnewdof[k] += _ssampler->SampleSequenceOneReal() * _vbiasdofdirection[k];
+                }
+                if (samplenull) {
+                    for (size_t j = 0; j < _vbiasnullspace.size(); ++j) {
+                        dReal nullx = (_ssampler->SampleSequenceOneReal()*2-1)*fNullspaceMultiplier;
+                        vnewdof[k] += nullx * _vbiasnullspace[j][k];
+                    }
+                }
+                if (sampledelta) {
+                    vnewdof[k] += _deltadof[k];
+                }
+            }
+        }
+
+        // get new state
+        for(size_t j = 0; j < _deltadof.size(); ++j) {
+            if( vnewdof[j] > _upper.at(j) ) {
+                vnewdof[j] = _upper.at(j);
+            }
+            else if( vnewdof[j] < _lower.at(j) ) {
+                vnewdof[j] = _lower.at(j);
+            }
+        }
+
+        if( !!_cache ) {
+            if( !!_cache->FindNearestNode(vnewdof, _neighdistthresh).first ) {
+                _cachehit++;
+                return false;
+            }
+        }
+
+        //int ret = cache.InsertNode(vnewdof, CollisionReportPtr(), _neighdistthresh);
+        //BOOST_ASSERT(ret==1);
+
+        _probot->SetActiveDOFValues(vnewdof);
+        fmaxtransdist = 0;
+        bool bSuccess = true;
+        if( linkdistthresh > 0 ) {
+            for (size_t ilink = 0; ilink < _vLinkAABBs.size(); ++ilink) {
+                // check for an elipse
+                // L^2 (b*v)^2 + |v|^2|b|^4 - (b*v)^2 |b|^2 <= |b|^4 * L^2
+                Transform tnewlink = _vLinks[ilink]->GetTransform();
+                TransformMatrix projdelta = _vOriginalInvTransforms[ilink] * tnewlink;
+                projdelta.m[0] -= 1;
+                projdelta.m[5] -= 1;
+                projdelta.m[10] -= 1;
+                Vector projextents = _vLinkAABBs[ilink].extents;
+                Vector projboxright(projdelta.m[0]*projextents.x, projdelta.m[4]*projextents.x, projdelta.m[8]*projextents.x);
+                Vector projboxup(projdelta.m[1]*projextents.y, projdelta.m[5]*projextents.y, projdelta.m[9]*projextents.y);
+                Vector projboxdir(projdelta.m[2]*projextents.z, projdelta.m[6]*projextents.z, projdelta.m[10]*projextents.z);
+                Vector projboxpos = projdelta * _vLinkAABBs[ilink].pos;
+
+                Vector b;
+                if( busebiasing ) {
+                    b = _vOriginalInvTransforms[ilink].rotate(_vbiasdirection); // inside link coordinate system
+                }
+                else {
+                    // doesn't matter which vector we pick since it is just a sphere.
+                    b = Vector(0,0,linkdistthresh);
+                }
+
+                dReal blength2 = b.lengthsqr3();
+                dReal blength4 = blength2*blength2;
+                dReal rhs = blength4 * linkdistthresh2;
+                //dReal rhs = (b.lengthsqr3()) * linkdistthresh;
+                dReal ellipdist = 0;
+                // now figure out what is the max distance
+                for(int ix = 0; ix < 2; ++ix) {
+                    Vector projvx = ix > 0 ? projboxpos + projboxright : projboxpos - projboxright;
+                    for(int iy = 0; iy < 2; ++iy) {
+                        Vector projvy = iy > 0 ? projvx + projboxup : projvx - projboxup;
+                        for(int iz = 0; iz < 2; ++iz) {
+                            Vector projvz = iz > 0 ? projvy + projboxdir : projvy - projboxdir;
+                            Vector v = projvz; // inside link coordinate system
+                            dReal bv = (v.dot3(b));
+                            dReal bv2 = bv*bv;
+                            dReal flen2 = (linkdistthresh2 - blength2) * bv2 + v.lengthsqr3()*blength4;
+
+                            if( ellipdist < flen2 ) {
+                                ellipdist = flen2;
+#ifdef _DEBUG
+                                fmaxtransdist = flen2;
+#endif
+                                if (ellipdist > rhs) {
+                                    bSuccess = false;
+                                    break;
+                                }
+                            }
+                        }
+
+                        if (ellipdist > rhs) {
+                            bSuccess = false;
+                            break;
+                        }
+                    }
+                    if (ellipdist > rhs) {
+                        bSuccess = false;
+                        break;
+                    }
+                }
+            }
+
+            if (!bSuccess) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief samples the candidates in blocks of _nBlockSize and has the workers evaluate every block
+    ///
+    /// The candidates are generated and filtered with the cache and link distances on the calling thread in the same
+    /// order as the serial jittering, and the first valid candidate in that order is returned. Therefore the result is
+    /// the same as the serial jittering and does not depend on the number of threads, the block size or the scheduling.
+    int _SampleParallel(std::vector<dReal>& vnewdof, IntervalType interval, const std::vector<dReal>& perturbations, RobotBase::RobotStateSaver& robotsaver)
+    {
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        _SyncWorkers();
+
+        WorkerJob job;
+        job._vperturbations = perturbations;
+        job._vcandidates.resize(_nBlockSize);
+        int iter = 0;
+        while(iter < _maxiterations) {
+            job._numcandidates = 0;
+            while(iter < _maxiterations && job._numcandidates < job._vcandidates.size()) {
+                if( (iter%10) == 0 ) {
+                    _CallStatusFunctions(iter);
+                }
+                dReal fmaxtransdist = 0;
+                if( _SampleCandidate(iter, vnewdof, interval, fmaxtransdist) ) {
+                    job._vcandidates[job._numcandidates++] = vnewdof;
+                }
+                ++iter;
+            }
+            if( job._numcandidates == 0 ) {
+                continue;
+            }
+
+            job._nextcandidate = 0;
+            job._firstvalid = job._numcandidates;
+            _workerpool.Run(boost::bind(&ConfigurationJitterer::_RunWorkerJob, this, _1, boost::ref(job)));
+
+            if( job._firstvalid < job._numcandidates ) {
+                vnewdof = job._vcandidates[job._firstvalid];
+                _probot->SetActiveDOFValues(vnewdof);
+                if( _bSetResultOnRobot ) {
+                    // have to release the saver so it does not restore the old configuration
+                    robotsaver.Release();
+                }
+                RAVELOG_DEBUG_FORMAT("succeed iterations=%d, threads=%d, computation=%fs\n",iter%_nNumThreads%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+                return 1;
+            }
+        }
+
+        RAVELOG_INFO_FORMAT("failed iterations=%d, threads=%d, computation=%fs\n",_maxiterations%_nNumThreads%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+        return 0;
+    }
+
+    /// \brief checks a candidate with all perturbations on the robot of the worker, same checks as the serial jittering without a neighbor state function
+    bool _EvaluateCandidate(Worker& worker, const std::vector<dReal>& vcandidate, const std::vector<dReal>& perturbations)
+    {
+        worker._vtempdof.resize(vcandidate.size());
+        FOREACHC(itperturbation, perturbations) {
+            for(size_t j = 0; j < vcandidate.size(); ++j) {
+                worker._vtempdof[j] = vcandidate[j] + *itperturbation;
+                if( worker._vtempdof[j] > _upper.at(j) ) {
+                    worker._vtempdof[j] = _upper.at(j);
+                }
+                else if( worker._vtempdof[j] < _lower.at(j) ) {
+                    worker._vtempdof[j] = _lower.at(j);
+                }
+            }
+            worker._probot->SetActiveDOFValues(worker._vtempdof);
+            if( !!_pConstraintToolDirection && !!worker._pmanip ) {
+                if( !_pConstraintToolDirection->IsInConstraints(worker._pmanip->GetTransform()) ) {
+                    return false;
+                }
+            }
+            if( !!_pConstraintToolPosition && !!worker._pmanip ) {
+                if( !_pConstraintToolPosition->IsInConstraints(worker._pmanip->GetTransform()) ) {
+                    return false;
+                }
+            }
+            if( worker._penv->CheckCollision(worker._probot) || worker._probot->CheckSelfCollision() ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief creates the worker threads if necessary and updates the worker environments from the current environment
+    void _SyncWorkers()
+    {
+        if( _vworkers.size() != (size_t)_nNumThreads ) {
+            _StopWorkers();
+            _vworkers.resize(_nNumThreads);
+        }
+        FOREACH(itworker, _vworkers) {
+            SyncWorkerEnvironment(itworker->_penv, GetEnv(), Clone_Bodies);
+            EnvironmentMutex::scoped_lock lockenv(itworker->_penv->GetMutex());
+            itworker->_probot = itworker->_penv->GetRobot(_probot->GetName());
+            OPENRAVE_ASSERT_FORMAT(!!itworker->_probot, "env=%d, could not find robot %s in worker environment", GetEnv()->GetId()%_probot->GetName(), ORE_InvalidState);
+            itworker->_probot->SetActiveDOFs(_vActiveIndices, _nActiveAffineDOFs, _vActiveAffineAxis);
+            itworker->_pmanip.reset();
+            if( !!_pmanip ) {
+                itworker->_pmanip = itworker->_probot->GetManipulator(_pmanip->GetName());
+            }
+        }
+        _workerpool.Start(_vworkers.size());
+    }
+
+    void _StopWorkers()
+    {
+        _workerpool.Stop();
+        FOREACH(itworker, _vworkers) {
+            itworker->_pmanip.reset();
+            itworker->_probot.reset();
+            if( !!itworker->_penv ) {
+                itworker->_penv->Destroy();
+            }
+        }
+        _vworkers.clear();
+    }
+
+    /// \brief evaluates the candidates of job in sample order, candidates after the first valid one are skipped
+    void _RunWorkerJob(size_t iworker, WorkerJob& job)
+    {
+        Worker& worker = _vworkers.at(iworker);
+        EnvironmentMutex::scoped_lock lockenv(worker._penv->GetMutex());
+        while(1) {
+            size_t icandidate;
+            {
+                boost::mutex::scoped_lock lock(_mutexWorkers);
+                icandidate = job._nextcandidate++;
+                // all candidates before the first valid one have been taken already, so later ones cannot change the result
+                if( icandidate >= job._numcandidates || icandidate > job._firstvalid ) {
+                    break;
+                }
+            }
+            if( _EvaluateCandidate(worker, job._vcandidates[icandidate], job._vperturbations) ) {
+                boost::mutex::scoped_lock lock(_mutexWorkers);
+                if( icandidate < job._firstvalid ) {
+                    job._firstvalid = icandidate;
+                }
+            }
+        }
+    }
+
     /// \brief extracts all used bodies from the configurationspecification and computes AABBs, transforms, and limits for links
     void _InitRobotState()
     {
@@ -1018,6 +1233,15 @@ protected:
 
     bool _bSetResultOnRobot; ///< if true, will set the final result on the robot DOF values
     bool _busebiasing; ///< if true will bias the end effector along a certain direction using the jacobian and nullspace.
+
+    //@{
+    // parallel jittering, see _SampleParallel
+    int _nNumThreads; ///< number of worker threads, 0 or 1 for serial
+    int _nBlockSize; ///< number of candidates sampled before they are evaluated by the workers
+    std::vector<Worker> _vworkers; ///< one for every thread of _workerpool
+    WorkerThreadPool _workerpool;
+    boost::mutex _mutexWorkers; ///< protects _nextcandidate and _firstvalid of the current job
+    //@}
 };
 
 SpaceSamplerBasePtr CreateConfigurationJitterer(EnvironmentBasePtr penv, std::istream& sinput)
@@ -6,6 +6,9 @@
 #include <boost/lexical_cast.hpp>
 #include <openrave/utils.h>
 #include <boost/function_output_iterator.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "workerthreadpool.h"
 
 #include "fclspace.h"
 #include "fclmanagercache.h"
@@ -63,7 +66,7 @@ public:
         {
             _bHasCallbacks = _pchecker->GetEnv()->HasRegisteredCollisionCallbacks();
             if( _bHasCallbacks && !_report ) {
-                _report.reset(new CollisionReport());
+                _report = OpenRAVE::RaveAcquireCollisionReport();
             }
 
             // TODO : What happens if we have CO_AllGeometryContacts set and not CO_Contacts ?
@@ -117,6 +120,7 @@ public:
         // TODO : Should we put a more reasonable arbitrary value ?
         _numMaxContacts = std::numeric_limits<int>::max();
         _nGetEnvManagerCacheClearCount = 100000;
+        _ResetBroadphaseUpdateStatistics();
         __description = ":Interface Author: Kenji Maillard\n\nFlexible Collision Library collision checker";
 
         SETUP_STATISTICS(_statistics, _userdatakey, GetEnv()->GetId());
@@ -124,6 +128,8 @@ public:
         // TODO : Consider removing these which could be more harmful than anything else
         RegisterCommand("SetBroadphaseAlgorithm", boost::bind(&FCLCollisionChecker::SetBroadphaseAlgorithmCommand, this, _1, _2), "sets the broadphase algorithm (Naive, SaP, SSaP, IntervalTree, DynamicAABBTree, DynamicAABBTree_Array)");
         RegisterCommand("SetBVHRepresentation", boost::bind(&FCLCollisionChecker::_SetBVHRepresentation, this, _1, _2), "sets the Bouding Volume Hierarchy representation for meshes (AABB, OBB, OBBRSS, RSS, kIDS)");
+        RegisterCommand("SetNumWorkerContexts", boost::bind(&FCLCollisionChecker::SetNumWorkerContextsCommand, this, _1, _2), "sets the number of worker contexts (and threads) CheckCollisionBatch distributes the configurations over. The contexts share the geometry of the checker. 0 disables the threads.");
+        RegisterCommand("GetBroadphaseUpdateStatistics", boost::bind(&FCLCollisionChecker::GetBroadphaseUpdateStatisticsCommand, this, _1, _2), "returns \"numsyncs numfullsyncs numupdatedobjects lastnumupdatedobjects\" of the broadphase managers since the last reset: how many times the managers were synchronized for a check, how many of those had to look at all their bodies, and how many collision objects were pushed to the managers in total and by the last synchronization. If \"reset\" is given, resets the counters afterwards.");
 
         RAVELOG_VERBOSE_FORMAT("FCLCollisionChecker %s created in env %d", _userdatakey%penv->GetId());
 
@@ -173,6 +179,7 @@ public:
         // We don't want to clone _bIsSelfCollisionChecker since a self collision checker can be created by cloning a environment collision checker
         _options = r->_options;
         _numMaxContacts = r->_numMaxContacts;
+        _SetNumWorkerContexts(r->_vworkercontexts.size());
         RAVELOG_VERBOSE(str(boost::format("FCL User data cloning env %d into env %d") % r->GetEnv()->GetId() % GetEnv()->GetId()));
     }
 
@@ -251,6 +258,10 @@ public:
         // clear all the current cached managers
         _bodymanagers.clear();
         _envmanagers.clear();
+        FOREACH(itcontext, _vworkercontexts) {
+            (*itcontext)->pbodymanager.reset();
+            (*itcontext)->penvmanager.reset();
+        }
     }
 
     const std::string & GetBroadphaseAlgorithm() const {
@@ -334,6 +345,9 @@ public:
     virtual void DestroyEnvironment()
     {
         RAVELOG_VERBOSE(str(boost::format("FCL User data destroying %s in env %d") % _userdatakey % GetEnv()->GetId()));
+        FOREACH(itcontext, _vworkercontexts) {
+            itcontext->reset(new WorkerContext());
+        }
         _fclspace->DestroyEnvironment();
     }
 
@@ -681,12 +695,297 @@ public:
         }
     }
 
+    /// \brief checks all the configurations while keeping the same managers and callback data for the whole batch
+    ///
+    /// The environment does not move during the batch, so the environment manager is only synchronized once and only the managers of pbody are updated for every configuration.
+    /// If worker contexts are set with SetNumWorkerContexts, the configurations are distributed over the contexts and checked from several threads.
+    virtual int CheckCollisionBatch(KinBodyPtr pbody, const std::vector<OpenRAVE::dReal>& vconfigs, std::vector<uint8_t>& vresults, bool bCheckSelfCollision=true)
+    {
+        START_TIMING_OPT(_statistics, "BodyBatch",_options,pbody->IsRobot());
+        if( _options & OpenRAVE::CO_Distance ) {
+            RAVELOG_WARN("fcl doesn't support CO_Distance yet\n");
+            return CollisionCheckerBase::CheckCollisionBatch(pbody, vconfigs, vresults, bCheckSelfCollision);
+        }
+
+        bool bActiveDOFs = !!(_options & OpenRAVE::CO_ActiveDOFs) && pbody->IsRobot();
+        RobotBasePtr probot;
+        if( bActiveDOFs ) {
+            probot = OpenRAVE::RaveInterfaceCast<RobotBase>(pbody);
+        }
+        int dof = !!probot ? probot->GetActiveDOF() : pbody->GetDOF();
+        OPENRAVE_ASSERT_OP_FORMAT(dof, >, 0, "body %s does not have any dofs to set", pbody->GetName(), OpenRAVE::ORE_InvalidArguments);
+        OPENRAVE_ASSERT_OP_FORMAT((int)(vconfigs.size()%dof), ==, 0, "configurations are not a multiple of the dof %d", dof, OpenRAVE::ORE_InvalidArguments);
+        size_t numconfigs = vconfigs.size()/dof;
+        vresults.resize(numconfigs);
+        if( numconfigs == 0 ) {
+            return 0;
+        }
+        // same early-outs as CheckCollision and CheckStandaloneSelfCollision
+        if( pbody->GetLinks().size() == 0 || !pbody->IsEnabled() ) {
+            std::fill(vresults.begin(), vresults.end(), 0);
+            return 0;
+        }
+        bCheckSelfCollision &= pbody->GetLinks().size() > 1;
+
+        int adjacentOptions = KinBody::AO_Enabled;
+        if( bActiveDOFs ) {
+            adjacentOptions |= KinBody::AO_ActiveDOFs;
+        }
+        // GetNonAdjacentLinks can move pbody, so call it before synchronizing anything
+        const std::vector<int>& nonadjacent = pbody->GetNonAdjacentLinks(adjacentOptions);
+
+        if( _vworkercontexts.size() > 1 && numconfigs > 1 && _CanUseWorkerContexts() ) {
+            return _CheckCollisionBatchWorkers(pbody, probot, bActiveDOFs, vconfigs, vresults, nonadjacent, bCheckSelfCollision);
+        }
+
+        KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+        _fclspace->Synchronize();
+        std::set<KinBodyConstPtr> attachedBodies;
+        pbody->GetAttached(attachedBodies);
+        BroadPhaseCollisionManagerPtr envManager = _GetEnvManager(attachedBodies);
+        KinBodyInfoPtr pinfo = _fclspace->GetInfo(pbody);
+
+        std::vector<KinBodyConstPtr> vbodyexcluded;
+        std::vector<LinkConstPtr> vlinkexcluded;
+        CollisionCallbackData query(shared_checker(), CollisionReportPtr(), vbodyexcluded, vlinkexcluded);
+        ADD_TIMING(_statistics);
+
+        std::vector<OpenRAVE::dReal> vvalues(dof);
+        int ncollisions = 0;
+        for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig) {
+            std::copy(vconfigs.begin()+iconfig*dof, vconfigs.begin()+(iconfig+1)*dof, vvalues.begin());
+            if( !!probot ) {
+                probot->SetActiveDOFValues(vvalues, KinBody::CLA_Nothing);
+            }
+            else {
+                pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing);
+            }
+
+            _fclspace->SynchronizeWithAttached(pbody);
+            BroadPhaseCollisionManagerPtr bodyManager = _GetBodyManager(pbody, bActiveDOFs);
+            vresults[iconfig] = _CheckBatchConfiguration(envManager, bodyManager, pinfo, nonadjacent, bCheckSelfCollision, query);
+            if( vresults[iconfig] ) {
+                ++ncollisions;
+            }
+        }
+        return ncollisions;
+    }
+
+    /// Sets the number of worker contexts used by CheckCollisionBatch. Each context is checked in its own thread, 0 or 1 disables the threads.
+    /// e.g. "SetNumWorkerContexts 8"
+    bool SetNumWorkerContextsCommand(ostream& sout, istream& sinput)
+    {
+        int numcontexts = 0;
+        sinput >> numcontexts;
+        if( !sinput ) {
+            return false;
+        }
+        _SetNumWorkerContexts(numcontexts);
+        return true;
+    }
+
+    bool GetBroadphaseUpdateStatisticsCommand(ostream& sout, istream& sinput)
+    {
+        sout << _nNumManagerSyncs << " " << _nNumManagerFullSyncs << " " << _nNumManagerUpdatedObjects << " " << _nLastNumManagerUpdatedObjects;
+        std::string cmd;
+        sinput >> cmd;
+        if( cmd == "reset" ) {
+            _ResetBroadphaseUpdateStatistics();
+        }
+        return true;
+    }
+
+    void _SetNumWorkerContexts(int numcontexts)
+    {
+        numcontexts = max(0, numcontexts);
+        if( (size_t)numcontexts != _vworkercontexts.size() ) {
+            _workerpool.Stop(); // restarted with the new number of contexts by the next batch
+        }
+        _vworkercontexts.resize(numcontexts);
+        FOREACH(itcontext, _vworkercontexts) {
+            if( !*itcontext ) {
+                itcontext->reset(new WorkerContext());
+            }
+        }
+    }
 
 private:
     inline boost::shared_ptr<FCLCollisionChecker> shared_checker() {
         return boost::dynamic_pointer_cast<FCLCollisionChecker>(shared_from_this());
     }
 
+    /// \brief read-only context for checking collisions from a worker thread
+    ///
+    /// Holds a shadow of _fclspace (see FCLSpace::CreateShadow) so that the BVH of the geometries are shared, and its own managers.
+    struct WorkerContext
+    {
+        boost::shared_ptr<FCLSpace> pspace; ///< has to be destroyed after the managers since they reference it
+        FCLCollisionManagerInstancePtr pbodymanager, penvmanager;
+        KinBodyConstWeakPtr pwbody; ///< the body pbodymanager was initialized with
+        bool bActiveDOFs; ///< the active dof option pbodymanager was initialized with
+    };
+    typedef boost::shared_ptr<WorkerContext> WorkerContextPtr;
+
+    /// \brief data shared by all the workers of one CheckCollisionBatch call
+    struct WorkerBatchData
+    {
+        KinBodyConstPtr pbody;
+        std::vector<KinBodyConstPtr> vmovingbodies; ///< pbody and all its attached bodies
+        std::vector<size_t> vlinkoffsets; ///< offset of the first link of each of the vmovingbodies in the transforms of one configuration
+        size_t numlinks; ///< number of link transforms stored per configuration
+        std::vector<Transform> vlinktransforms; ///< link transforms of vmovingbodies for every configuration
+        std::vector<int> vnonadjacent;
+        bool bCheckSelfCollision;
+    };
+
+    /// \brief returns true if the narrow phase can be called from several threads at once
+    bool _CanUseWorkerContexts() const
+    {
+#ifdef NARROW_COLLISION_CACHING
+        return false; // the cache of gjk guesses is shared
+#else
+        // callbacks are user code and should not be called from the worker threads
+        return !GetEnv()->HasRegisteredCollisionCallbacks();
+#endif
+    }
+
+    /// \brief checks the current configuration of the batch with the managers already synchronized. Returns true if in collision
+    bool _CheckBatchConfiguration(BroadPhaseCollisionManagerPtr envManager, BroadPhaseCollisionManagerPtr bodyManager, KinBodyInfoPtr pinfo, const std::vector<int>& nonadjacent, bool bCheckSelfCollision, CollisionCallbackData& query)
+    {
+        if( !!query._report ) {
+            query._report->Reset(_options);
+        }
+        query._bCollision = false;
+        query._bStopChecking = false;
+        query.bselfCollision = false;
+        envManager->collide(bodyManager.get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        if( query._bCollision || !bCheckSelfCollision || pinfo->vlinks.size() <= 1 ) {
+            return query._bCollision;
+        }
+
+        query._bStopChecking = false;
+        query.bselfCollision = true;
+        FOREACHC(itset, nonadjacent) {
+            size_t index1 = *itset&0xffff, index2 = *itset>>16;
+            LinkInfoPtr pLINK1 = pinfo->vlinks[index1], pLINK2 = pinfo->vlinks[index2];
+            FOREACH(itgeom1, pLINK1->vgeoms) {
+                FOREACH(itgeom2, pLINK2->vgeoms) {
+                    CheckNarrowPhaseGeomCollision((*itgeom1).second.get(), (*itgeom2).second.get(), &query);
+                    if( query._bStopChecking ) {
+                        return query._bCollision;
+                    }
+                }
+            }
+        }
+        return query._bCollision;
+    }
+
+    /// \brief computes the link transforms of all configurations serially, then checks them on the worker contexts
+    ///
+    /// Setting dof values modifies the bodies, so it cannot be done from the workers. Once the transforms are computed, nothing modifies the bodies until all workers are done.
+    int _CheckCollisionBatchWorkers(KinBodyPtr pbody, RobotBasePtr probot, bool bActiveDOFs, const std::vector<OpenRAVE::dReal>& vconfigs, std::vector<uint8_t>& vresults, const std::vector<int>& nonadjacent, bool bCheckSelfCollision)
+    {
+        size_t numconfigs = vresults.size();
+        size_t dof = vconfigs.size()/numconfigs;
+        WorkerBatchData batch;
+        batch.pbody = pbody;
+        batch.vnonadjacent = nonadjacent;
+        batch.bCheckSelfCollision = bCheckSelfCollision;
+        batch.numlinks = 0;
+        std::set<KinBodyConstPtr> attachedBodies;
+        pbody->GetAttached(attachedBodies);
+        FOREACH(itbody, attachedBodies) {
+            if( (*itbody)->GetEnvironmentId() ) { // for now GetAttached can hold bodies that are not initialized
+                batch.vmovingbodies.push_back(*itbody);
+                batch.vlinkoffsets.push_back(batch.numlinks);
+                batch.numlinks += (*itbody)->GetLinks().size();
+            }
+        }
+
+        batch.vlinktransforms.resize(numconfigs*batch.numlinks);
+        {
+            KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+            std::vector<OpenRAVE::dReal> vvalues(dof);
+            std::vector<Transform> vtrans;
+            for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig) {
+                std::copy(vconfigs.begin()+iconfig*dof, vconfigs.begin()+(iconfig+1)*dof, vvalues.begin());
+                if( !!probot ) {
+                    probot->SetActiveDOFValues(vvalues, KinBody::CLA_Nothing);
+                }
+                else {
+                    pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing);
+                }
+                for(size_t ibody = 0; ibody < batch.vmovingbodies.size(); ++ibody) {
+                    batch.vmovingbodies[ibody]->GetLinkTransformations(vtrans);
+                    std::copy(vtrans.begin(), vtrans.end(), batch.vlinktransforms.begin() + iconfig*batch.numlinks + batch.vlinkoffsets[ibody]);
+                }
+            }
+        }
+
+        _fclspace->Synchronize();
+        FOREACH(itcontext, _vworkercontexts) {
+            _PrepareWorkerContext(**itcontext, pbody, bActiveDOFs, attachedBodies);
+        }
+
+        ADD_TIMING(_statistics);
+        _workerpool.Start(_vworkercontexts.size());
+        _workerpool.Run(boost::bind(&FCLCollisionChecker::_WorkerCheckCollisionBatch, this, _1, boost::cref(batch), boost::ref(vresults)));
+        return (int)std::count(vresults.begin(), vresults.end(), 1);
+    }
+
+    /// \brief makes sure the shadow space and the managers of the context reflect the current environment. Has to be called from the thread owning the environment
+    void _PrepareWorkerContext(WorkerContext& context, KinBodyConstPtr pbody, bool bActiveDOFs, const std::set<KinBodyConstPtr>& attachedBodies)
+    {
+        if( !context.pspace || context.pspace->IsShadowOutdated() ) {
+            context.pbodymanager.reset();
+            context.penvmanager.reset();
+            context.pspace = _fclspace->CreateShadow();
+        }
+        else {
+            context.pspace->Synchronize();
+        }
+
+        if( !context.pbodymanager || context.pwbody.lock() != pbody || context.bActiveDOFs != bActiveDOFs ) {
+            context.pbodymanager.reset(new FCLCollisionManagerInstance(*context.pspace, _CreateManager()));
+            context.pbodymanager->InitBodyManager(pbody, bActiveDOFs);
+            context.pwbody = pbody;
+            context.bActiveDOFs = bActiveDOFs;
+        }
+        context.pbodymanager->Synchronize();
+
+        std::set<int> setExcludeBodyIds;
+        FOREACHC(itbody, attachedBodies) {
+            setExcludeBodyIds.insert((*itbody)->GetEnvironmentId());
+        }
+        if( !context.penvmanager || context.penvmanager->GetExcludeBodyIds() != setExcludeBodyIds ) {
+            context.penvmanager.reset(new FCLCollisionManagerInstance(*context.pspace, _CreateManager()));
+            context.penvmanager->InitEnvironment(attachedBodies);
+        }
+        context.penvmanager->EnsureBodies(context.pspace->GetEnvBodies());
+        context.penvmanager->Synchronize();
+    }
+
+    /// \brief thread function checking the configurations iworker, iworker+N, iworker+2N... of the batch where N is the number of contexts
+    void _WorkerCheckCollisionBatch(size_t iworker, const WorkerBatchData& batch, std::vector<uint8_t>& vresults)
+    {
+        WorkerContext& context = *_vworkercontexts.at(iworker);
+        KinBodyInfoPtr pinfo = context.pspace->GetInfo(batch.pbody);
+        std::vector<KinBodyConstPtr> vbodyexcluded;
+        std::vector<LinkConstPtr> vlinkexcluded;
+        CollisionCallbackData query(shared_checker(), CollisionReportPtr(), vbodyexcluded, vlinkexcluded);
+        std::vector<Transform> vtrans;
+        for(size_t iconfig = iworker; iconfig < vresults.size(); iconfig += _vworkercontexts.size()) {
+            std::vector<Transform>::const_iterator itconfigtrans = batch.vlinktransforms.begin() + iconfig*batch.numlinks;
+            for(size_t ibody = 0; ibody < batch.vmovingbodies.size(); ++ibody) {
+                vtrans.resize(batch.vmovingbodies[ibody]->GetLinks().size());
+                std::copy(itconfigtrans + batch.vlinkoffsets[ibody], itconfigtrans + batch.vlinkoffsets[ibody] + vtrans.size(), vtrans.begin());
+                context.pspace->SetLinkTransformations(batch.vmovingbodies[ibody], vtrans);
+            }
+            context.pbodymanager->Synchronize();
+            vresults[iconfig] = _CheckBatchConfiguration(context.penvmanager->GetManager(), context.pbodymanager->GetManager(), pinfo, batch.vnonadjacent, batch.bCheckSelfCollision, query);
+        }
+    }
+
     static bool CheckNarrowPhaseCollision(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data) {
         CollisionCallbackData* pcb = static_cast<CollisionCallbackData *>(data);
         return pcb->_pchecker->CheckNarrowPhaseCollision(o1, o2, pcb);
@@ -722,7 +1021,8 @@ private:
             return false;
         }
 
-        LinkInfoPtr pLINK1 = _fclspace->GetLinkInfo(plink1), pLINK2 = _fclspace->GetLinkInfo(plink2);
+        // use the link info of the collision objects rather than looking them up in _fclspace since the objects can belong to a shadow space
+        FCLSpace::KinBodyInfo::LINK *pLINK1 = static_cast<FCLSpace::KinBodyInfo::LINK *>(o1->getUserData()), *pLINK2 = static_cast<FCLSpace::KinBodyInfo::LINK *>(o2->getUserData());
 
         //RAVELOG_VERBOSE_FORMAT("env=%d, link %s:%s with %s:%s", GetEnv()->GetId()%plink1->GetParent()->GetName()%plink1->GetName()%plink2->GetParent()->GetName()%plink2->GetName());
         FOREACH(itgeompair1, pLINK1->vgeoms) {
@@ -896,6 +1196,7 @@ private:
         }
 
         it->second->Synchronize();
+        _AddBroadphaseUpdateStatistics(*it->second);
         //it->second->PrintStatus(OpenRAVE::Level_Info);
         return it->second->GetManager();
     }
@@ -931,11 +1232,30 @@ private:
         }
         it->second->EnsureBodies(_fclspace->GetEnvBodies());
         it->second->Synchronize();
+        _AddBroadphaseUpdateStatistics(*it->second);
         //it->second->PrintStatus(OpenRAVE::Level_Info);
         //RAVELOG_VERBOSE_FORMAT("env=%d, returning manager cache %x", GetEnv()->GetId()%it->second.get());
         return it->second->GetManager();
     }
 
+    inline void _AddBroadphaseUpdateStatistics(const FCLCollisionManagerInstance& manager)
+    {
+        ++_nNumManagerSyncs;
+        if( manager.IsLastSyncFull() ) {
+            ++_nNumManagerFullSyncs;
+        }
+        _nLastNumManagerUpdatedObjects = manager.GetNumLastUpdatedObjects();
+        _nNumManagerUpdatedObjects += _nLastNumManagerUpdatedObjects;
+    }
+
+    void _ResetBroadphaseUpdateStatistics()
+    {
+        _nNumManagerSyncs = 0;
+        _nNumManagerFullSyncs = 0;
+        _nNumManagerUpdatedObjects = 0;
+        _nLastNumManagerUpdatedObjects = 0;
+    }
+
     int _options;
     boost::shared_ptr<FCLSpace> _fclspace;
     int _numMaxContacts;
@@ -947,6 +1267,13 @@ private:
     //std::map<KinBodyPtr, FCLCollisionManagerInstancePtr> _activedofbodymanagers; ///< managers for each of the individual bodies specifically when active DOF is used. each manager should be called with InitBodyManager
     std::map< std::set<int>, FCLCollisionManagerInstancePtr> _envmanagers;
     int _nGetEnvManagerCacheClearCount; ///< count down until cache can be cleared
+    std::vector<WorkerContextPtr> _vworkercontexts; ///< contexts used by CheckCollisionBatch, one thread per context
+    WorkerThreadPool _workerpool; ///< threads of the worker contexts, kept alive between CheckCollisionBatch calls
+
+    uint64_t _nNumManagerSyncs; ///< number of times _bodymanagers/_envmanagers were synchronized
+    uint64_t _nNumManagerFullSyncs; ///< number of those synchronizations that had to look at all the bodies of the manager
+    uint64_t _nNumManagerUpdatedObjects; ///< total number of collision objects updated in the managers
+    uint64_t _nLastNumManagerUpdatedObjects; ///< number of collision objects updated by the last synchronization
 
 //    FCLCollisionManagerInstancePtr _bodymanager, _envmanager;
 //    fcl::CollisionObject* _o1, *_o2;
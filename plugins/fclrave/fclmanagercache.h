@@ -62,6 +62,9 @@ class FCLCollisionManagerInstance : public boost::enable_shared_from_this<FCLCol
 public:
     FCLCollisionManagerInstance(FCLSpace& fclspace, BroadPhaseCollisionManagerPtr pmanager) : _fclspace(fclspace), pmanager(pmanager) {
         _lastSyncTimeStamp = OpenRAVE::utils::GetMilliTime();
+        _nChangedBodiesSequence = 0;
+        _nLastNumUpdatedObjects = 0;
+        _bLastSyncFull = false;
     }
     ~FCLCollisionManagerInstance() {
         if( _tmpbuffer.size() > 0 ) {
@@ -134,6 +137,7 @@ public:
             pmanager->registerObjects(_tmpbuffer); // bulk update
         }
         pmanager->setup();
+        _nChangedBodiesSequence = _fclspace.GetChangedBodiesSequence();
     }
 
     /// \brief sets up manager for environment checking
@@ -147,6 +151,7 @@ public:
             _setExcludeBodyIds.insert((*itbody)->GetEnvironmentId());
         }
         pmanager->setup();
+        _nChangedBodiesSequence = _fclspace.GetChangedBodiesSequence();
     }
 
     /// \brief makes sure that all the bodies are currently in the scene (if they are not explicitly excluded)
@@ -226,6 +231,7 @@ public:
     void Synchronize()
     {
         _tmpbuffer.resize(0);
+        _vupdateobjs.resize(0);
         _lastSyncTimeStamp = OpenRAVE::utils::GetMilliTime();
         bool bcallsetup = false;
         bool bAttachedBodiesChanged = false;
@@ -249,193 +255,27 @@ public:
             }
         }
 
-        while(itcache != mapCachedBodies.end()) {
-            KinBodyConstPtr pbody = itcache->second.pwbody.lock();
-            FCLSpace::KinBodyInfoPtr pinfo = itcache->second.pwinfo.lock();
-
-            if( !pbody || pbody->GetEnvironmentId() == 0 ) {
-                // should happen when parts are removed
-                RAVELOG_VERBOSE_FORMAT("%u manager contains invalid body %s, removing for now (env %d)", _lastSyncTimeStamp%(!pbody ? std::string() : pbody->GetName())%(!pbody ? -1 : pbody->GetEnv()->GetId()));
-                FOREACH(itcolobj, itcache->second.vcolobjs) {
-                    if( !!itcolobj->get() ) {
-                        pmanager->unregisterObject(itcolobj->get());
-                    }
-                }
-                itcache->second.vcolobjs.resize(0);
-                mapCachedBodies.erase(itcache++);
-                continue;
-            }
-
-            FCLSpace::KinBodyInfoPtr pnewinfo = _fclspace.GetInfo(pbody); // necessary in case pinfos were swapped!
-            if( pinfo != pnewinfo ) {
-                // everything changed!
-                RAVELOG_VERBOSE_FORMAT("%u body %s entire KinBodyInfo changed", _lastSyncTimeStamp%pbody->GetName());
-                FOREACH(itcolobj, itcache->second.vcolobjs) {
-                    if( !!itcolobj->get() ) {
-                        pmanager->unregisterObject(itcolobj->get());
-                    }
-                }
-                itcache->second.vcolobjs.resize(0);
-                _AddBody(pbody, pnewinfo, itcache->second.vcolobjs, itcache->second.linkmask, _bTrackActiveDOF&&pbody==ptrackingbody);
-                itcache->second.pwinfo = pnewinfo;
-                //itcache->second.ResetStamps();
-                // need to update the stamps here so that we do not try to unregisterObject below and get into an error
-                itcache->second.nLastStamp = pnewinfo->nLastStamp;
-                itcache->second.nLinkUpdateStamp = pnewinfo->nLinkUpdateStamp;
-                itcache->second.nGeometryUpdateStamp = pnewinfo->nGeometryUpdateStamp;
-                itcache->second.nAttachedBodiesUpdateStamp = -1;
-                itcache->second.nActiveDOFUpdateStamp = pnewinfo->nActiveDOFUpdateStamp;
-                itcache->second.geometrygroup = pnewinfo->_geometrygroup;
-                pinfo = pnewinfo;
-                if( _tmpbuffer.size() > 0 ) {
-#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
-                    SaveCollisionObjectDebugInfos();
-#endif
-                    pmanager->registerObjects(_tmpbuffer); // bulk update
-                    _tmpbuffer.resize(0);
-                }
-            }
-
-            if( pinfo->nLinkUpdateStamp != itcache->second.nLinkUpdateStamp ) {
-                //RAVELOG_VERBOSE_FORMAT("env=%d, %u body %s (%d) for cache changed link %d != %d", pbody->GetEnv()->GetId()%_lastSyncTimeStamp%pbody->GetName()%pbody->GetEnvironmentId()%pinfo->nLinkUpdateStamp%itcache->second.nLinkUpdateStamp);
-                // links changed
-                uint64_t newlinkmask = pbody->GetLinkEnableStatesMask();
-                if( _bTrackActiveDOF && ptrackingbody == pbody ) {
-                    for(size_t itestlink = 0; itestlink < _vTrackingActiveLinks.size(); ++itestlink) {
-                        if( !_vTrackingActiveLinks[itestlink] ) {
-                            newlinkmask &= ~((uint64_t)1 << (uint64_t)itestlink);
-                        }
-                    }
-                }
-
-                uint64_t changed = itcache->second.linkmask ^ newlinkmask;
-                if( changed ) {
-                    for(uint64_t ilink = 0; ilink < pinfo->vlinks.size(); ++ilink) {
-                        if( changed & ((uint64_t)1<<ilink) ) {
-                            if( newlinkmask & ((uint64_t)1<<ilink) ) {
-                                CollisionObjectPtr pcolobj = _fclspace.GetLinkBV(pinfo, ilink);
-                                if( !!pcolobj ) {
-#ifdef FCLRAVE_USE_REPLACEOBJECT
-#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
-                                    SaveCollisionObjectDebugInfos(pcolobj.get());
-#endif
-                                    if( !!itcache->second.vcolobjs.at(ilink) ) {
-                                        pmanager->replaceObject(itcache->second.vcolobjs.at(ilink).get(), pcolobj.get(), false);
-                                    }
-                                    else {
-                                        pmanager->registerObject(pcolobj.get());
-                                    }
-#else
-
-                                    // no replace
-                                    if( !!itcache->second.vcolobjs.at(ilink) ) {
-                                        pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
-                                    }
-#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
-                                    SaveCollisionObjectDebugInfos(pcolobj.get());
-#endif
-                                    pmanager->registerObject(pcolobj.get());
-#endif
-                                    bcallsetup = true;
-                                }
-                                else {
-                                    if( !!itcache->second.vcolobjs.at(ilink) ) {
-                                        pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
-                                    }
-                                }
-                                itcache->second.vcolobjs.at(ilink) = pcolobj;
-                            }
-                            else {
-                                if( !!itcache->second.vcolobjs.at(ilink) ) {
-                                    pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
-                                    itcache->second.vcolobjs.at(ilink).reset();
-                                }
-                            }
-                        }
-                    }
-                }
-
-                itcache->second.linkmask = newlinkmask;
-                itcache->second.nLinkUpdateStamp = pinfo->nLinkUpdateStamp;
-            }
-            if( pinfo->nGeometryUpdateStamp != itcache->second.nGeometryUpdateStamp ) {
-
-                if( itcache->second.geometrygroup.size() == 0 || itcache->second.geometrygroup != pinfo->_geometrygroup ) {
-                    RAVELOG_VERBOSE_FORMAT("%u body %s (%d) for cache changed geometry %d != %d", _lastSyncTimeStamp%pbody->GetName()%pbody->GetEnvironmentId()%pinfo->nGeometryUpdateStamp%itcache->second.nGeometryUpdateStamp);
-                    // vcolobjs most likely changed
-                    for(uint64_t ilink = 0; ilink < pinfo->vlinks.size(); ++ilink) {
-                        if( itcache->second.linkmask & ((uint64_t)1<<ilink) ) {
-                            CollisionObjectPtr pcolobj = _fclspace.GetLinkBV(pinfo, ilink);
-                            if( !!pcolobj ) {
-#ifdef FCLRAVE_USE_REPLACEOBJECT
-#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
-                                SaveCollisionObjectDebugInfos(pcolobj.get());
-#endif
-                                if( !!itcache->second.vcolobjs.at(ilink) ) {
-                                    pmanager->replaceObject(itcache->second.vcolobjs.at(ilink).get(), pcolobj.get(), false);
-                                }
-                                else {
-                                    pmanager->registerObject(pcolobj.get());
-                                }
-#else
-
-                                // no replace
-                                if( !!itcache->second.vcolobjs.at(ilink) ) {
-                                    pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
-                                }
-#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
-                                SaveCollisionObjectDebugInfos(pcolobj.get());
-#endif
-                                pmanager->registerObject(pcolobj.get());
-#endif
-                                bcallsetup = true;
-                                itcache->second.vcolobjs.at(ilink) = pcolobj;
-                            }
-                            else {
-                                if( !!itcache->second.vcolobjs.at(ilink) ) {
-                                    pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
-                                    itcache->second.vcolobjs.at(ilink).reset();
-                                }
-                            }
-                        }
-                    }
-                    itcache->second.geometrygroup = pinfo->_geometrygroup;
-                }
-                itcache->second.nGeometryUpdateStamp = pinfo->nGeometryUpdateStamp;
-            }
-            if( pinfo->nLastStamp != itcache->second.nLastStamp ) {
-                if( IS_DEBUGLEVEL(OpenRAVE::Level_Verbose) ) {
-                    //Transform tpose = pbody->GetTransform();
-                    //RAVELOG_VERBOSE_FORMAT("env=%d, %u body %s (%d) for cache changed transform %d != %d, mask=0x%x, trans=(%.3f, %.3f, %.3f)", pbody->GetEnv()->GetId()%_lastSyncTimeStamp%pbody->GetName()%pbody->GetEnvironmentId()%pinfo->nLastStamp%itcache->second.nLastStamp%itcache->second.linkmask%tpose.trans.x%tpose.trans.y%tpose.trans.z);
-                }
-                // transform changed
-                for(uint64_t ilink = 0; ilink < pinfo->vlinks.size(); ++ilink) {
-                    if( itcache->second.linkmask & ((uint64_t)1<<ilink) ) {
-                        if( !!itcache->second.vcolobjs.at(ilink) ) {
-                            //RAVELOG_VERBOSE_FORMAT("env=%d, body %s updating link %d", pbody->GetEnv()->GetId()%pbody->GetName()%ilink);
-#ifdef FCLRAVE_USE_BULK_UPDATE
-                            pmanager->update(itcache->second.vcolobjs.at(ilink).get(), false);
-#else
-                            // Performance issue !!
-                            pmanager->update(itcache->second.vcolobjs.at(ilink).get());
-#endif
-                            bcallsetup = true;
-                        }
-                    }
-                }
-
-                itcache->second.nLastStamp = pinfo->nLastStamp;
+        // only look at the bodies that changed since the last synchronization, unless the space does not remember that far back
+        _vchangedbodyids.resize(0);
+        _bLastSyncFull = !_fclspace.GetChangedBodyIds(_nChangedBodiesSequence, _vchangedbodyids);
+        _nChangedBodiesSequence = _fclspace.GetChangedBodiesSequence();
+        if( _bLastSyncFull ) {
+            while(itcache != mapCachedBodies.end()) {
+                std::map<int, KinBodyCache>::iterator itnext = itcache;
+                ++itnext;
+                _SynchronizeCachedBody(itcache, ptrackingbody, bcallsetup, bAttachedBodiesChanged);
+                itcache = itnext;
             }
-            if( pinfo->nAttachedBodiesUpdateStamp != itcache->second.nAttachedBodiesUpdateStamp ) {
-                // bodies changed!
-                if( !!ptrackingbody ) {
-                    bAttachedBodiesChanged = true;
+        }
+        else if( _vchangedbodyids.size() > 0 ) {
+            std::sort(_vchangedbodyids.begin(), _vchangedbodyids.end());
+            _vchangedbodyids.erase(std::unique(_vchangedbodyids.begin(), _vchangedbodyids.end()), _vchangedbodyids.end());
+            FOREACH(itbodyid, _vchangedbodyids) {
+                itcache = mapCachedBodies.find(*itbodyid);
+                if( itcache != mapCachedBodies.end() ) {
+                    _SynchronizeCachedBody(itcache, ptrackingbody, bcallsetup, bAttachedBodiesChanged);
                 }
-
-                itcache->second.nAttachedBodiesUpdateStamp = pinfo->nAttachedBodiesUpdateStamp;
             }
-
-            ++itcache;
         }
 
         if( bAttachedBodiesChanged && !!ptrackingbody ) {
@@ -486,6 +326,16 @@ public:
 #endif
             pmanager->registerObjects(_tmpbuffer); // bulk update
         }
+        _nLastNumUpdatedObjects = _vupdateobjs.size();
+        if( _vupdateobjs.size() > 0 ) {
+            // only the moved links, all at once
+#ifdef FCLRAVE_USE_BULK_UPDATE
+            pmanager->update(_vupdateobjs, false);
+#else
+            pmanager->update(_vupdateobjs);
+#endif
+            bcallsetup = true;
+        }
         if( bcallsetup ) {
             pmanager->setup();
         }
@@ -503,6 +353,16 @@ public:
         return _setExcludeBodyIds;
     }
 
+    /// \brief number of collision objects whose transform was updated in the broadphase by the last \ref Synchronize
+    inline size_t GetNumLastUpdatedObjects() const {
+        return _nLastNumUpdatedObjects;
+    }
+
+    /// \brief true if the last \ref Synchronize had to look at all the bodies instead of only the changed ones
+    inline bool IsLastSyncFull() const {
+        return _bLastSyncFull;
+    }
+
     void PrintStatus(uint32_t debuglevel)
     {
         if( IS_DEBUGLEVEL(debuglevel) ) {
@@ -520,6 +380,191 @@ public:
     }
 
 private:
+    /// \brief synchronizes one cached body, erases it from mapCachedBodies if it is not valid anymore
+    ///
+    /// collision objects whose transform changed are appended to _vupdateobjs, new collision objects can be appended to _tmpbuffer
+    void _SynchronizeCachedBody(std::map<int, KinBodyCache>::iterator itcache, KinBodyConstPtr ptrackingbody, bool& bcallsetup, bool& bAttachedBodiesChanged)
+    {
+        KinBodyConstPtr pbody = itcache->second.pwbody.lock();
+        FCLSpace::KinBodyInfoPtr pinfo = itcache->second.pwinfo.lock();
+
+        if( !pbody || pbody->GetEnvironmentId() == 0 ) {
+            // should happen when parts are removed
+            RAVELOG_VERBOSE_FORMAT("%u manager contains invalid body %s, removing for now (env %d)", _lastSyncTimeStamp%(!pbody ? std::string() : pbody->GetName())%(!pbody ? -1 : pbody->GetEnv()->GetId()));
+            FOREACH(itcolobj, itcache->second.vcolobjs) {
+                if( !!itcolobj->get() ) {
+                    pmanager->unregisterObject(itcolobj->get());
+                }
+            }
+            itcache->second.vcolobjs.resize(0);
+            mapCachedBodies.erase(itcache);
+            return;
+        }
+
+        FCLSpace::KinBodyInfoPtr pnewinfo = _fclspace.GetInfo(pbody); // necessary in case pinfos were swapped!
+        if( pinfo != pnewinfo ) {
+            // everything changed!
+            RAVELOG_VERBOSE_FORMAT("%u body %s entire KinBodyInfo changed", _lastSyncTimeStamp%pbody->GetName());
+            FOREACH(itcolobj, itcache->second.vcolobjs) {
+                if( !!itcolobj->get() ) {
+                    pmanager->unregisterObject(itcolobj->get());
+                }
+            }
+            itcache->second.vcolobjs.resize(0);
+            _AddBody(pbody, pnewinfo, itcache->second.vcolobjs, itcache->second.linkmask, _bTrackActiveDOF&&pbody==ptrackingbody);
+            itcache->second.pwinfo = pnewinfo;
+            //itcache->second.ResetStamps();
+            // need to update the stamps here so that we do not try to unregisterObject below and get into an error
+            itcache->second.nLastStamp = pnewinfo->nLastStamp;
+            itcache->second.nLinkUpdateStamp = pnewinfo->nLinkUpdateStamp;
+            itcache->second.nGeometryUpdateStamp = pnewinfo->nGeometryUpdateStamp;
+            itcache->second.nAttachedBodiesUpdateStamp = -1;
+            itcache->second.nActiveDOFUpdateStamp = pnewinfo->nActiveDOFUpdateStamp;
+            itcache->second.geometrygroup = pnewinfo->_geometrygroup;
+            pinfo = pnewinfo;
+            if( _tmpbuffer.size() > 0 ) {
+#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
+                SaveCollisionObjectDebugInfos();
+#endif
+                pmanager->registerObjects(_tmpbuffer); // bulk update
+                _tmpbuffer.resize(0);
+            }
+        }
+
+        if( pinfo->nLinkUpdateStamp != itcache->second.nLinkUpdateStamp ) {
+            //RAVELOG_VERBOSE_FORMAT("env=%d, %u body %s (%d) for cache changed link %d != %d", pbody->GetEnv()->GetId()%_lastSyncTimeStamp%pbody->GetName()%pbody->GetEnvironmentId()%pinfo->nLinkUpdateStamp%itcache->second.nLinkUpdateStamp);
+            // links changed
+            uint64_t newlinkmask = pbody->GetLinkEnableStatesMask();
+            if( _bTrackActiveDOF && ptrackingbody == pbody ) {
+                for(size_t itestlink = 0; itestlink < _vTrackingActiveLinks.size(); ++itestlink) {
+                    if( !_vTrackingActiveLinks[itestlink] ) {
+                        newlinkmask &= ~((uint64_t)1 << (uint64_t)itestlink);
+                    }
+                }
+            }
+
+            uint64_t changed = itcache->second.linkmask ^ newlinkmask;
+            if( changed ) {
+                for(uint64_t ilink = 0; ilink < pinfo->vlinks.size(); ++ilink) {
+                    if( changed & ((uint64_t)1<<ilink) ) {
+                        if( newlinkmask & ((uint64_t)1<<ilink) ) {
+                            CollisionObjectPtr pcolobj = _fclspace.GetLinkBV(pinfo, ilink);
+                            if( !!pcolobj ) {
+#ifdef FCLRAVE_USE_REPLACEOBJECT
+#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
+                                SaveCollisionObjectDebugInfos(pcolobj.get());
+#endif
+                                if( !!itcache->second.vcolobjs.at(ilink) ) {
+                                    pmanager->replaceObject(itcache->second.vcolobjs.at(ilink).get(), pcolobj.get(), false);
+                                }
+                                else {
+                                    pmanager->registerObject(pcolobj.get());
+                                }
+#else
+
+                                // no replace
+                                if( !!itcache->second.vcolobjs.at(ilink) ) {
+                                    pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
+                                }
+#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
+                                SaveCollisionObjectDebugInfos(pcolobj.get());
+#endif
+                                pmanager->registerObject(pcolobj.get());
+#endif
+                                bcallsetup = true;
+                            }
+                            else {
+                                if( !!itcache->second.vcolobjs.at(ilink) ) {
+                                    pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
+                                }
+                            }
+                            itcache->second.vcolobjs.at(ilink) = pcolobj;
+                        }
+                        else {
+                            if( !!itcache->second.vcolobjs.at(ilink) ) {
+                                pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
+                                itcache->second.vcolobjs.at(ilink).reset();
+                            }
+                        }
+                    }
+                }
+            }
+
+            itcache->second.linkmask = newlinkmask;
+            itcache->second.nLinkUpdateStamp = pinfo->nLinkUpdateStamp;
+        }
+        if( pinfo->nGeometryUpdateStamp != itcache->second.nGeometryUpdateStamp ) {
+
+            if( itcache->second.geometrygroup.size() == 0 || itcache->second.geometrygroup != pinfo->_geometrygroup ) {
+                RAVELOG_VERBOSE_FORMAT("%u body %s (%d) for cache changed geometry %d != %d", _lastSyncTimeStamp%pbody->GetName()%pbody->GetEnvironmentId()%pinfo->nGeometryUpdateStamp%itcache->second.nGeometryUpdateStamp);
+                // vcolobjs most likely changed
+                for(uint64_t ilink = 0; ilink < pinfo->vlinks.size(); ++ilink) {
+                    if( itcache->second.linkmask & ((uint64_t)1<<ilink) ) {
+                        CollisionObjectPtr pcolobj = _fclspace.GetLinkBV(pinfo, ilink);
+                        if( !!pcolobj ) {
+#ifdef FCLRAVE_USE_REPLACEOBJECT
+#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
+                            SaveCollisionObjectDebugInfos(pcolobj.get());
+#endif
+                            if( !!itcache->second.vcolobjs.at(ilink) ) {
+                                pmanager->replaceObject(itcache->second.vcolobjs.at(ilink).get(), pcolobj.get(), false);
+                            }
+                            else {
+                                pmanager->registerObject(pcolobj.get());
+                            }
+#else
+
+                            // no replace
+                            if( !!itcache->second.vcolobjs.at(ilink) ) {
+                                pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
+                            }
+#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
+                            SaveCollisionObjectDebugInfos(pcolobj.get());
+#endif
+                            pmanager->registerObject(pcolobj.get());
+#endif
+                            bcallsetup = true;
+                            itcache->second.vcolobjs.at(ilink) = pcolobj;
+                        }
+                        else {
+                            if( !!itcache->second.vcolobjs.at(ilink) ) {
+                                pmanager->unregisterObject(itcache->second.vcolobjs.at(ilink).get());
+                                itcache->second.vcolobjs.at(ilink).reset();
+                            }
+                        }
+                    }
+                }
+                itcache->second.geometrygroup = pinfo->_geometrygroup;
+            }
+            itcache->second.nGeometryUpdateStamp = pinfo->nGeometryUpdateStamp;
+        }
+        if( pinfo->nLastStamp != itcache->second.nLastStamp ) {
+            if( IS_DEBUGLEVEL(OpenRAVE::Level_Verbose) ) {
+                //Transform tpose = pbody->GetTransform();
+                //RAVELOG_VERBOSE_FORMAT("env=%d, %u body %s (%d) for cache changed transform %d != %d, mask=0x%x, trans=(%.3f, %.3f, %.3f)", pbody->GetEnv()->GetId()%_lastSyncTimeStamp%pbody->GetName()%pbody->GetEnvironmentId()%pinfo->nLastStamp%itcache->second.nLastStamp%itcache->second.linkmask%tpose.trans.x%tpose.trans.y%tpose.trans.z);
+            }
+            // transform changed
+            for(uint64_t ilink = 0; ilink < pinfo->vlinks.size(); ++ilink) {
+                if( itcache->second.linkmask & ((uint64_t)1<<ilink) ) {
+                    if( !!itcache->second.vcolobjs.at(ilink) ) {
+                        //RAVELOG_VERBOSE_FORMAT("env=%d, body %s updating link %d", pbody->GetEnv()->GetId()%pbody->GetName()%ilink);
+                        _vupdateobjs.push_back(itcache->second.vcolobjs.at(ilink).get());
+                    }
+                }
+            }
+
+            itcache->second.nLastStamp = pinfo->nLastStamp;
+        }
+        if( pinfo->nAttachedBodiesUpdateStamp != itcache->second.nAttachedBodiesUpdateStamp ) {
+            // bodies changed!
+            if( !!ptrackingbody ) {
+                bAttachedBodiesChanged = true;
+            }
+
+            itcache->second.nAttachedBodiesUpdateStamp = pinfo->nAttachedBodiesUpdateStamp;
+        }
+    }
+
     /// \brief adds a body to the manager, returns true if something was added
     ///
     /// should not add anything to mapCachedBodies! append to _tmpbuffer
@@ -566,6 +611,12 @@ private:
 
     std::set<int> _setExcludeBodyIds; ///< any bodies that should not be considered inside the manager, used with environment mode
     CollisionGroup _tmpbuffer; ///< cache
+    CollisionGroup _vupdateobjs; ///< cache of the collision objects that moved, passed to the manager at once
+    std::vector<int> _vchangedbodyids; ///< cache of the ids of the bodies that changed since the last synchronization
+
+    uint64_t _nChangedBodiesSequence; ///< FCLSpace::GetChangedBodiesSequence at the last synchronization
+    size_t _nLastNumUpdatedObjects; ///< number of collision objects updated by the last synchronization
+    bool _bLastSyncFull; ///< true if the last synchronization looked at all the bodies
 
     KinBodyConstWeakPtr _ptrackingbody; ///< if set, then only tracking the attached bodies if this body
     std::vector<int> _vTrackingActiveLinks; ///< indices of which links are active for tracking body
@@ -3,6 +3,7 @@
 #define OPENRAVE_FCL_SPACE
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <memory> // c++11
 #include <vector>
 
@@ -163,7 +164,7 @@ public:
     typedef boost::function<void (KinBodyInfoPtr)> SynchronizeCallbackFn;
 
     FCLSpace(EnvironmentBasePtr penv, const std::string& userdatakey)
-        : _penv(penv), _userdatakey(userdatakey)
+        : _penv(penv), _userdatakey(userdatakey), _nTransformOverrideStamp(-1), _nChangedBodyIdsOffset(0)
     {
         // After many test, OBB seems to be the only real option (followed by kIOS which is needed for distance checking)
         SetBVHRepresentation("OBB");
@@ -186,6 +187,7 @@ public:
         _currentpinfo.clear();
         _cachedpinfo.clear();
         _setInitializedBodies.clear();
+        _InvalidateChangedBodyIds();
     }
 
     KinBodyInfoPtr InitKinBody(KinBodyConstPtr pbody, KinBodyInfoPtr pinfo = KinBodyInfoPtr())
@@ -200,6 +202,7 @@ public:
         pinfo->_pbody = boost::const_pointer_cast<KinBody>(pbody);
         // make sure that synchronization do occur !
         pinfo->nLastStamp = pbody->GetUpdateStamp() - 1;
+        _RecordChangedBody(pbody->GetEnvironmentId());
 
         pinfo->vlinks.reserve(pbody->GetLinks().size());
         FOREACHC(itlink, pbody->GetLinks()) {
@@ -231,7 +234,7 @@ public:
             }
 
             for(GeometryInfoIterator itgeominfo = begingeom; itgeominfo != endgeom; ++itgeominfo) {
-                const CollisionGeometryPtr pfclgeom = _CreateFCLGeomFromGeometryInfo(_meshFactory, *itgeominfo);
+                const CollisionGeometryPtr pfclgeom = _CreateFCLGeomFromGeometryInfo(_meshFactory, _bvhRepresentation, *itgeominfo);
 
                 if( !pfclgeom ) {
                     continue;
@@ -341,6 +344,7 @@ public:
                 RAVELOG_VERBOSE_FORMAT("FCLSpace : switching to geometry %s for kinbody %s (id = %d) (env = %d)", groupname%pbody->GetName()%pbody->GetEnvironmentId()%_penv->GetId());
                 // Set the current info to use the KinBodyInfoPtr associated to groupname
                 _currentpinfo[pbody->GetEnvironmentId()] = pinfo;
+                _RecordChangedBody(pbody->GetEnvironmentId());
 
                 // Revoke the information inside the cache so that a potentially outdated object does not survive
                 _cachedpinfo[(pbody)->GetEnvironmentId()].erase(groupname);
@@ -464,6 +468,7 @@ public:
 
             _currentpinfo.erase(pbody->GetEnvironmentId());
             _cachedpinfo.erase(pbody->GetEnvironmentId());
+            _RecordChangedBody(pbody->GetEnvironmentId());
         }
     }
 
@@ -495,7 +500,124 @@ public:
         return GetInfo(plink->GetParent())->vlinks.at(plink->GetIndex());
     }
 
+    /// \brief creates a space holding its own collision objects, but sharing the collision geometries (and their BVH) with this space
+    ///
+    /// The shadow does not register any callbacks on the bodies, so it is read-only with respect to the geometry and has to be recreated once \ref IsShadowOutdated returns true.
+    /// Since the shadow has its own collision objects, several shadows can be used at the same time from different threads.
+    boost::shared_ptr<FCLSpace> CreateShadow()
+    {
+        boost::shared_ptr<FCLSpace> pshadow(new FCLSpace(_penv, _userdatakey + std::string("shadow")));
+        pshadow->_geometrygroup = _geometrygroup;
+        pshadow->_bvhRepresentation = _bvhRepresentation;
+        pshadow->_meshFactory = _meshFactory;
+        pshadow->_pparent = weak_space();
+        FOREACH(itbody, _setInitializedBodies) {
+            KinBodyInfoPtr pinfo = GetInfo(*itbody);
+            if( !pinfo ) {
+                continue;
+            }
+            KinBodyInfoPtr pnewinfo(new KinBodyInfo());
+            pnewinfo->_pbody = pinfo->_pbody;
+            pnewinfo->nLastStamp = pinfo->nLastStamp;
+            pnewinfo->nLinkUpdateStamp = pinfo->nLinkUpdateStamp;
+            pnewinfo->nGeometryUpdateStamp = pinfo->nGeometryUpdateStamp;
+            pnewinfo->nAttachedBodiesUpdateStamp = pinfo->nAttachedBodiesUpdateStamp;
+            pnewinfo->nActiveDOFUpdateStamp = pinfo->nActiveDOFUpdateStamp;
+            pnewinfo->_geometrygroup = pinfo->_geometrygroup;
+            pnewinfo->vlinks.reserve(pinfo->vlinks.size());
+            FOREACH(itlink, pinfo->vlinks) {
+                boost::shared_ptr<KinBodyInfo::LINK> link(new KinBodyInfo::LINK((*itlink)->GetLink()));
+                link->bodylinkname = (*itlink)->bodylinkname;
+                if( !!(*itlink)->linkBV.second ) {
+                    link->linkBV = std::make_pair((*itlink)->linkBV.first, _CreateSharedCollisionObject((*itlink)->linkBV.second, link.get()));
+                }
+                link->vgeoms.reserve((*itlink)->vgeoms.size());
+                FOREACH(itgeompair, (*itlink)->vgeoms) {
+                    link->vgeoms.push_back(TransformCollisionPair(itgeompair->first, _CreateSharedCollisionObject(itgeompair->second, link.get())));
+                }
+                pnewinfo->vlinks.push_back(link);
+            }
+            pshadow->_currentpinfo[(*itbody)->GetEnvironmentId()] = pnewinfo;
+            pshadow->_setInitializedBodies.insert(*itbody);
+            pshadow->_mapShadowedInfos[(*itbody)->GetEnvironmentId()] = std::make_pair(KinBodyInfoWeakPtr(pinfo), _GetInfoStamps(pinfo));
+        }
+        return pshadow;
+    }
+
+    /// \brief returns true if this space is a shadow and the bodies or their geometries changed in the parent since the shadow was created
+    bool IsShadowOutdated() const
+    {
+        boost::shared_ptr<FCLSpace> pparent = _pparent.lock();
+        if( !pparent || pparent->_currentpinfo.size() != _mapShadowedInfos.size() ) {
+            return true;
+        }
+        FOREACHC(itinfo, pparent->_currentpinfo) {
+            std::map<int, std::pair<KinBodyInfoWeakPtr, std::vector<int> > >::const_iterator itshadowed = _mapShadowedInfos.find(itinfo->first);
+            if( itshadowed == _mapShadowedInfos.end() || itshadowed->second.first.lock() != itinfo->second || itshadowed->second.second != _GetInfoStamps(itinfo->second) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief sets the transformations of the collision objects of a body from vtrans instead of reading them from the body
+    ///
+    /// Used by shadows in order to check configurations without modifying the body. The next \ref Synchronize will read the transformations from the body again.
+    void SetLinkTransformations(KinBodyConstPtr pbody, const std::vector<Transform>& vtrans)
+    {
+        KinBodyInfoPtr pinfo = GetInfo(pbody);
+        if( !pinfo ) {
+            return;
+        }
+        BOOST_ASSERT( vtrans.size() == pinfo->vlinks.size() );
+        _SetLinkTransformations(pinfo, vtrans);
+        // KinBody update stamps are never negative, so the next synchronization is guaranteed to happen
+        pinfo->nLastStamp = _nTransformOverrideStamp--;
+        _RecordChangedBody(pbody->GetEnvironmentId());
+    }
+
+    /// \brief returns the sequence number that the next recorded body change will get, see \ref GetChangedBodyIds
+    inline uint64_t GetChangedBodiesSequence() const {
+        return _nChangedBodyIdsOffset + _vChangedBodyIds.size();
+    }
+
+    /// \brief appends the environment ids of the bodies whose KinBodyInfo changed since nsequence
+    ///
+    /// A change is anything that a broadphase manager has to react to: the transform, link enable states, geometry,
+    /// attached bodies, active dofs, or the KinBodyInfo itself. Ids can be repeated.
+    /// \return false if the changes are not recorded that far back, in which case every body has to be considered changed
+    bool GetChangedBodyIds(uint64_t nsequence, std::vector<int>& vbodyids) const
+    {
+        if( nsequence < _nChangedBodyIdsOffset ) {
+            return false;
+        }
+        size_t ifirst = (size_t)(nsequence - _nChangedBodyIdsOffset);
+        if( ifirst < _vChangedBodyIds.size() ) {
+            vbodyids.insert(vbodyids.end(), _vChangedBodyIds.begin()+ifirst, _vChangedBodyIds.end());
+        }
+        return true;
+    }
+
 private:
+    static CollisionObjectPtr _CreateSharedCollisionObject(CollisionObjectPtr pcoll, KinBodyInfo::LINK* plink)
+    {
+        CollisionObjectPtr pnewcoll = boost::make_shared<fcl::CollisionObject>(pcoll->collisionGeometry());
+        pnewcoll->setTransform(pcoll->getTransform());
+        pnewcoll->computeAABB();
+        pnewcoll->setUserData(plink);
+        return pnewcoll;
+    }
+
+    static std::vector<int> _GetInfoStamps(KinBodyInfoPtr pinfo)
+    {
+        std::vector<int> vstamps(4);
+        vstamps[0] = pinfo->nLinkUpdateStamp;
+        vstamps[1] = pinfo->nGeometryUpdateStamp;
+        vstamps[2] = pinfo->nAttachedBodiesUpdateStamp;
+        vstamps[3] = pinfo->nActiveDOFUpdateStamp;
+        return vstamps;
+    }
+
     static void _AddGeomInfoToBVHSubmodel(fcl::BVHModel<fcl::OBB>& model, KinBody::GeometryInfo const &info)
     {
         const OpenRAVE::TriMesh& mesh = info._meshcollision;
@@ -533,7 +655,7 @@ private:
     }
 
     // what about the tests on non-zero size (eg. box extents) ?
-    static CollisionGeometryPtr _CreateFCLGeomFromGeometryInfo(const MeshFactory &mesh_factory, const KinBody::GeometryInfo &info)
+    static CollisionGeometryPtr _CreateFCLGeomFromGeometryInfo(const MeshFactory &mesh_factory, const std::string& bvhRepresentation, const KinBody::GeometryInfo &info)
     {
         switch(info._type) {
 
@@ -558,6 +680,22 @@ private:
             }
 
             OPENRAVE_ASSERT_OP(mesh.indices.size() % 3, ==, 0);
+
+            // building the BVH is the expensive part, so share it with all the spaces that use the same mesh
+            std::string meshkey = bvhRepresentation + _GetMeshHash(mesh);
+            std::map<std::string, std::weak_ptr<fcl::CollisionGeometry> >& mapMeshCache = _GetMeshCache();
+            {
+                boost::mutex::scoped_lock lock(_GetMeshCacheMutex());
+                std::map<std::string, std::weak_ptr<fcl::CollisionGeometry> >::iterator itcached = mapMeshCache.find(meshkey);
+                if( itcached != mapMeshCache.end() ) {
+                    CollisionGeometryPtr pcachedgeom = itcached->second.lock();
+                    if( !!pcachedgeom ) {
+                        return pcachedgeom;
+                    }
+                }
+            }
+
+            // build outside of the lock so that other meshes can be looked up and built in the meantime
             size_t const num_points = mesh.vertices.size();
             size_t const num_triangles = mesh.indices.size() / 3;
 
@@ -573,7 +711,27 @@ private:
                 fcl_triangles[itri] = fcl::Triangle(tri_indices[0], tri_indices[1], tri_indices[2]);
             }
 
-            return mesh_factory(fcl_points, fcl_triangles);
+            CollisionGeometryPtr pfclgeom = mesh_factory(fcl_points, fcl_triangles);
+            if( !!pfclgeom ) {
+                boost::mutex::scoped_lock lock(_GetMeshCacheMutex());
+                // another thread might have built the same mesh in the meantime, share its BVH and drop this one
+                std::weak_ptr<fcl::CollisionGeometry>& pcachedweak = mapMeshCache[meshkey];
+                CollisionGeometryPtr pcachedgeom = pcachedweak.lock();
+                if( !!pcachedgeom ) {
+                    return pcachedgeom;
+                }
+                pcachedweak = pfclgeom;
+                // remove the expired entries so the map does not grow with every mesh ever loaded
+                for(std::map<std::string, std::weak_ptr<fcl::CollisionGeometry> >::iterator it = mapMeshCache.begin(); it != mapMeshCache.end(); ) {
+                    if( it->second.expired() ) {
+                        mapMeshCache.erase(it++);
+                    }
+                    else {
+                        ++it;
+                    }
+                }
+            }
+            return pfclgeom;
         }
 
         default:
@@ -582,6 +740,40 @@ private:
         }
     }
 
+    /// \brief hash of the vertices and indices of the mesh, used as the key of the BVH cache
+    static std::string _GetMeshHash(const OpenRAVE::TriMesh& mesh)
+    {
+        std::vector<uint8_t> vdata(mesh.vertices.size()*3*sizeof(OpenRAVE::dReal) + mesh.indices.size()*sizeof(int32_t));
+        uint8_t* pdata = &vdata[0];
+        FOREACHC(itvertex, mesh.vertices) {
+            OpenRAVE::dReal f[3] = { itvertex->x, itvertex->y, itvertex->z };
+            memcpy(pdata, f, sizeof(f));
+            pdata += sizeof(f);
+        }
+        FOREACHC(itindex, mesh.indices) {
+            int32_t index = *itindex;
+            memcpy(pdata, &index, sizeof(index));
+            pdata += sizeof(index);
+        }
+        return OpenRAVE::utils::GetMD5HashString(vdata);
+    }
+
+    /// \brief process-wide cache of the mesh geometries indexed by BVH representation and mesh hash.
+    ///
+    /// Only weak pointers are kept, so a BVH is freed as soon as no space uses it anymore. Environments that load the
+    /// same models (clones, planning threads, ...) reuse the already built BVHs instead of rebuilding them.
+    static std::map<std::string, std::weak_ptr<fcl::CollisionGeometry> >& _GetMeshCache()
+    {
+        static std::map<std::string, std::weak_ptr<fcl::CollisionGeometry> > s_mapMeshCache;
+        return s_mapMeshCache;
+    }
+
+    static boost::mutex& _GetMeshCacheMutex()
+    {
+        static boost::mutex s_mutex;
+        return s_mutex;
+    }
+
     void _Synchronize(KinBodyInfoPtr pinfo)
     {
         KinBodyPtr pbody = pinfo->GetBody();
@@ -591,12 +783,36 @@ private:
             pinfo->nLastStamp = pbody->GetUpdateStamp();
             BOOST_ASSERT( pbody->GetLinks().size() == pinfo->vlinks.size() );
             BOOST_ASSERT( vtrans.size() == pinfo->vlinks.size() );
-            for(size_t i = 0; i < vtrans.size(); ++i) {
-                CollisionObjectPtr pcoll = pinfo->vlinks[i]->linkBV.second;
-                if( !pcoll ) {
-                    continue;
-                }
-                Transform pose = vtrans[i] * pinfo->vlinks[i]->linkBV.first;
+            _SetLinkTransformations(pinfo, vtrans);
+            _RecordChangedBody(pbody->GetEnvironmentId());
+
+            // Does this have any use ?
+            if( !!_synccallback ) {
+                _synccallback(pinfo);
+            }
+        }
+    }
+
+    void _SetLinkTransformations(KinBodyInfoPtr pinfo, const std::vector<Transform>& vtrans)
+    {
+        for(size_t i = 0; i < vtrans.size(); ++i) {
+            CollisionObjectPtr pcoll = pinfo->vlinks[i]->linkBV.second;
+            if( !pcoll ) {
+                continue;
+            }
+            Transform pose = vtrans[i] * pinfo->vlinks[i]->linkBV.first;
+            fcl::Vec3f newPosition = ConvertVectorToFCL(pose.trans);
+            fcl::Quaternion3f newOrientation = ConvertQuaternionToFCL(pose.rot);
+
+            pcoll->setTranslation(newPosition);
+            pcoll->setQuatRotation(newOrientation);
+            // Do not forget to recompute the AABB otherwise getAABB won't give an up to date AABB
+            pcoll->computeAABB();
+
+            //pinfo->vlinks[i]->nLastStamp = pinfo->nLastStamp;
+            FOREACHC(itgeomcoll, pinfo->vlinks[i]->vgeoms) {
+                CollisionObjectPtr pcoll = (*itgeomcoll).second;
+                Transform pose = vtrans[i] * (*itgeomcoll).first;
                 fcl::Vec3f newPosition = ConvertVectorToFCL(pose.trans);
                 fcl::Quaternion3f newOrientation = ConvertQuaternionToFCL(pose.rot);
 
@@ -604,24 +820,6 @@ private:
                 pcoll->setQuatRotation(newOrientation);
                 // Do not forget to recompute the AABB otherwise getAABB won't give an up to date AABB
                 pcoll->computeAABB();
-
-                //pinfo->vlinks[i]->nLastStamp = pinfo->nLastStamp;
-                FOREACHC(itgeomcoll, pinfo->vlinks[i]->vgeoms) {
-                    CollisionObjectPtr pcoll = (*itgeomcoll).second;
-                    Transform pose = vtrans[i] * (*itgeomcoll).first;
-                    fcl::Vec3f newPosition = ConvertVectorToFCL(pose.trans);
-                    fcl::Quaternion3f newOrientation = ConvertQuaternionToFCL(pose.rot);
-
-                    pcoll->setTranslation(newPosition);
-                    pcoll->setQuatRotation(newOrientation);
-                    // Do not forget to recompute the AABB otherwise getAABB won't give an up to date AABB
-                    pcoll->computeAABB();
-                }
-            }
-
-            // Does this have any use ?
-            if( !!_synccallback ) {
-                _synccallback(pinfo);
             }
         }
     }
@@ -683,6 +881,7 @@ private:
         KinBodyInfoPtr pinfo = _pinfo.lock();
         if( !!pinfo ) {
             pinfo->nLinkUpdateStamp++;
+            _RecordChangedBody(pinfo);
         }
     }
 
@@ -690,6 +889,7 @@ private:
         KinBodyInfoPtr pinfo = _pinfo.lock();
         if( !!pinfo ) {
             pinfo->nActiveDOFUpdateStamp++;
+            _RecordChangedBody(pinfo);
         }
     }
 
@@ -697,9 +897,39 @@ private:
         KinBodyInfoPtr pinfo = _pinfo.lock();
         if( !!pinfo ) {
             pinfo->nAttachedBodiesUpdateStamp++;
+            _RecordChangedBody(pinfo);
         }
     }
 
+    void _RecordChangedBody(KinBodyInfoPtr pinfo)
+    {
+        KinBodyPtr pbody = pinfo->GetBody();
+        if( !!pbody ) {
+            _RecordChangedBody(pbody->GetEnvironmentId());
+        }
+    }
+
+    /// \brief records that the body changed so that the managers only have to look at the changed bodies
+    void _RecordChangedBody(int bodyid)
+    {
+        if( bodyid == 0 ) {
+            return;
+        }
+        // the managers that are further behind than this will just check all their bodies
+        if( _vChangedBodyIds.size() >= 1024 + 4*_setInitializedBodies.size() ) {
+            _nChangedBodyIdsOffset += _vChangedBodyIds.size();
+            _vChangedBodyIds.resize(0);
+        }
+        _vChangedBodyIds.push_back(bodyid);
+    }
+
+    /// \brief forces all the managers to check all their bodies on their next synchronization
+    void _InvalidateChangedBodyIds()
+    {
+        _nChangedBodyIdsOffset += _vChangedBodyIds.size() + 1;
+        _vChangedBodyIds.resize(0);
+    }
+
 
     EnvironmentBasePtr _penv;
     std::string _userdatakey;
@@ -712,6 +942,13 @@ private:
     std::set<KinBodyConstPtr> _setInitializedBodies; ///< Set of the kinbody initialized in this space
     std::map< int, std::map< std::string, KinBodyInfoPtr > > _cachedpinfo; ///< Associates to each body id and geometry group name the corresponding kinbody info if already initialized and not currently set as user data
     std::map< int, KinBodyInfoPtr> _currentpinfo; ///< maps kinbody environment id to the kinbodyinfo struct constaining fcl objects. The key being environment id makes it easier to compare objects without getting a handle to their pointers.
+
+    boost::weak_ptr<FCLSpace> _pparent; ///< if this space is a shadow, the space it was created from
+    std::map< int, std::pair<KinBodyInfoWeakPtr, std::vector<int> > > _mapShadowedInfos; ///< if this space is a shadow, maps kinbody environment id to the parent info and its update stamps at the time the shadow was created
+    int _nTransformOverrideStamp; ///< decreasing stamp set by SetLinkTransformations
+
+    std::vector<int> _vChangedBodyIds; ///< environment ids of the bodies that changed, in order of change. The first one has sequence number _nChangedBodyIdsOffset
+    uint64_t _nChangedBodyIdsOffset; ///< sequence number of the first element of _vChangedBodyIds
 };
 
 #ifdef RAVE_REGISTER_BOOST
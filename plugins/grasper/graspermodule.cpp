@@ -38,6 +38,8 @@ extern "C"
 
 #include <boost/thread/once.hpp>
 
+#include "workerthreadpool.h"
+
 static boost::mutex s_QhullMutex;
 
 #define GTS_M_ICOSAHEDRON_X /* sqrt(sqrt(5)+1)/sqrt(2*sqrt(5)) */   \
@@ -70,7 +72,11 @@ public:
         RegisterCommand("Grasp",boost::bind(&GrasperModule::_GraspCommand,this,_1,_2),
                         "Performs a grasp and returns contact points");
         RegisterCommand("GraspThreaded",boost::bind(&GrasperModule::_GraspThreadedCommand,this,_1,_2),
-                        "Parllelizes the computation of the grasp planning and force closure. Number of threads can be specified with 'numthreads'.");
+                        "Parllelizes the computation of the grasp planning and force closure. Number of threads can be specified with 'numthreads'. The worker threads and their environments are kept between calls. The results do not depend on the number of threads: 'maxgrasps' returns the first successful grasps in id order. With 'async 1', returns the number of grasps immediately and the results are retrieved with GetGraspThreadedResults.");
+        RegisterCommand("GetGraspThreadedResults",boost::bind(&GrasperModule::_GetGraspThreadedResultsCommand,this,_1,_2),
+                        "Returns the grasps of the current GraspThreaded call that became final since the last call, in id order: done nextindex numresults [results]");
+        RegisterCommand("StopGraspThreaded",boost::bind(&GrasperModule::_StopGraspThreadedCommand,this,_1,_2),
+                        "Stops the current GraspThreaded call and waits for the grasps being evaluated to finish");
         RegisterCommand("ComputeDistanceMap",boost::bind(&GrasperModule::_ComputeDistanceMapCommand,this,_1,_2),
                         "Computes a distance map around a particular point in space");
         RegisterCommand("GetStableContacts",boost::bind(&GrasperModule::_GetStableContactsCommand,this,_1,_2),
@@ -79,6 +85,7 @@ public:
                         "Given a point cloud, returns information about its convex hull like normal planes, vertex indices, and triangle indices. Computed planes point outside the mesh, face indices are not ordered, triangles point outside the mesh (counter-clockwise)");
     }
     virtual ~GrasperModule() {
+        _StopGraspWorkers();
         if( !!outfile )
             fclose(outfile);
         if( !!errfile )
@@ -87,6 +94,7 @@ public:
 
     virtual void Destroy()
     {
+        _StopGraspWorkers();
         _planner.reset();
         _robot.reset();
     }
@@ -649,6 +657,7 @@ public:
             forceclosurethreshold = 0;
             ffinestep = 0.001f;
             bCheckGraspIK = false;
+            collisionoptions = 0;
         }
 
         string targetname;
@@ -664,12 +673,13 @@ public:
         dReal ftranslationstepmult;
         dReal ffinestep;
 
-        string manipname;
+        string manipname, robotname;
         vector<int> vactiveindices;
         int affinedofs;
         Vector affineaxis;
 
         bool bCheckGraspIK;
+        int collisionoptions; ///< collision options of the module environment
     };
 
     struct GraspParametersThread
@@ -692,21 +702,98 @@ public:
     typedef boost::shared_ptr<GraspParametersThread> GraspParametersThreadPtr;
     typedef boost::shared_ptr<WorkerParameters> WorkerParametersPtr;
 
+    /// \brief the grasps of one GraspThreaded call. Grasp ids enumerate all combinations of standoffs, preshapes, rolls, approach rays, and manipulator directions.
+    class GraspJob
+    {
+public:
+        GraspJob() : _numgrasps(0), _maxgrasps(0), _nextgrasp(0), _numresults(0), _numreturned(0), _nextindex(0), _bStop(false) {
+        }
+
+        /// \brief creates the parameters of grasp id
+        GraspParametersThreadPtr CreateGrasp(size_t id) const
+        {
+            size_t istandoff = id % _standoffs.size();
+            size_t ipreshape = (id / _standoffs.size()) % _preshapes.size();
+            size_t iroll = (id / (_preshapes.size() * _standoffs.size())) % _rolls.size();
+            size_t iapproachray = (id / (_rolls.size() * _preshapes.size() * _standoffs.size()))%_approachrays.size();
+            size_t imanipulatordirection = (id / (_rolls.size() * _preshapes.size() * _standoffs.size()*_approachrays.size()));
+
+            GraspParametersThreadPtr grasp_params(new GraspParametersThread());
+            grasp_params->id = id;
+            grasp_params->vtargetposition = _approachrays.at(iapproachray).first;
+            grasp_params->vtargetdirection = _approachrays.at(iapproachray).second;
+            grasp_params->vmanipulatordirection = _manipulatordirections.at(imanipulatordirection);
+            grasp_params->ftargetroll = _rolls.at(iroll);
+            grasp_params->fstandoff = _standoffs.at(istandoff);
+            grasp_params->preshape = _preshapes.at(ipreshape);
+            return grasp_params;
+        }
+
+        WorkerParametersPtr _worker_params;
+        vector< pair<Vector, Vector> > _approachrays;
+        vector<dReal> _rolls;
+        vector< vector<dReal> > _preshapes;
+        vector<Vector> _manipulatordirections;
+        vector<dReal> _standoffs;
+        size_t _numgrasps; ///< one past the last grasp id to test
+        size_t _maxgrasps; ///< return at most this many grasps, the first ones in id order
+
+        //@{
+        // protected by GrasperModule::_mutexGrasp
+        size_t _nextgrasp; ///< next grasp id for a worker to take
+        size_t _numresults; ///< number of successful grasps, including the ones already returned
+        list<GraspParametersThreadPtr> _listresults; ///< successful grasps that were not returned yet, in the order they finished
+        std::set<size_t> _setevaluating; ///< ids of the grasps the workers are evaluating
+        size_t _numreturned; ///< number of grasps already returned
+        size_t _nextindex; ///< grasp id to resume the search from, see _PopFinalGraspResults
+        bool _bStop; ///< if true, workers do not take any new grasps
+        std::string _errormessage;
+        //@}
+    };
+    typedef boost::shared_ptr<GraspJob> GraspJobPtr;
+
+    /// \brief removes a grasp from the grasps being evaluated by a worker when it goes out of scope
+    class GraspEvaluationGuard
+    {
+public:
+        GraspEvaluationGuard(boost::mutex& mutexgrasp, GraspJob& job, size_t id) : _mutexgrasp(mutexgrasp), _job(job), _id(id) {
+        }
+        ~GraspEvaluationGuard() {
+            boost::mutex::scoped_lock lockgrasp(_mutexgrasp);
+            _job._setevaluating.erase(_id);
+        }
+
+private:
+        boost::mutex& _mutexgrasp;
+        GraspJob& _job;
+        size_t _id;
+    };
+
+    /// \brief a persistent grasp worker. Keeps its environment and planner between GraspThreaded calls, the environment is resynchronized with the module environment at the start of every call.
+    class GraspWorker
+    {
+public:
+        EnvironmentBasePtr _penv;
+        PlannerBasePtr _planner;
+    };
+
     virtual bool _GraspThreadedCommand(std::ostream& sout, std::istream& sinput)
     {
         EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
 
+        GraspJobPtr job(new GraspJob());
         WorkerParametersPtr worker_params(new WorkerParameters());
+        job->_worker_params = worker_params;
         int numthreads = 2;
+        bool bAsync = false;
         string cmd;
-        vector< pair<Vector, Vector> > approachrays;
-        vector<dReal> rolls;
-        vector< vector<dReal> > preshapes;
-        vector<Vector> manipulatordirections;
-        vector<dReal> standoffs;
+        vector< pair<Vector, Vector> >& approachrays = job->_approachrays;
+        vector<dReal>& rolls = job->_rolls;
+        vector< vector<dReal> >& preshapes = job->_preshapes;
+        vector<Vector>& manipulatordirections = job->_manipulatordirections;
+        vector<dReal>& standoffs = job->_standoffs;
         size_t startindex = 0;
         size_t maxgrasps = 0;
-
         while(!sinput.eof()) {
             sinput >> cmd;
             if( !sinput ) {
@@ -755,6 +842,9 @@ public:
             else if( cmd == "numthreads" ) {
                 sinput >> numthreads;
             }
+            else if( cmd == "async" ) {
+                sinput >> bAsync;
+            }
             // grasp specific
             else if( cmd == "approachrays" ) {
                 int numapproachrays = 0;
@@ -815,94 +905,210 @@ public:
         }
 
         worker_params->manipname = _robot->GetActiveManipulator()->GetName();
+        worker_params->robotname = _robot->GetName();
         worker_params->vactiveindices = _robot->GetActiveDOFIndices();
         worker_params->affinedofs = _robot->GetAffineDOF();
         worker_params->affineaxis = _robot->GetAffineRotationAxis();
+        worker_params->collisionoptions = GetEnv()->GetCollisionChecker()->GetCollisionOptions();
+
+        job->_numgrasps = approachrays.size()*rolls.size()*preshapes.size()*standoffs.size()*manipulatordirections.size();
+        job->_maxgrasps = maxgrasps > 0 ? maxgrasps : job->_numgrasps;
+        job->_nextgrasp = min(startindex, job->_numgrasps);
+        job->_nextindex = job->_nextgrasp;
+        RAVELOG_INFO(str(boost::format("number of grasps to test: %d\n")%job->_numgrasps));
+
+        // only one job can run at a time
+        _StopGraspJob();
+        _SyncGraspWorkers(max(numthreads,1));
+        {
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            _pgraspjob = job;
+        }
+        _workerpool.RunAsync(boost::bind(&GrasperModule::_RunGraspWorker, this, _1, job));
 
-        EnvironmentBasePtr pcloneenv = GetEnv()->CloneSelf(Clone_Bodies|Clone_Simulation);
+        if( bAsync ) {
+            // results are retrieved with GetGraspThreadedResults
+            sout << job->_numgrasps;
+            return true;
+        }
+
+        list<GraspParametersThreadPtr> listresults;
+        _workerpool.Wait();
+        {
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            _PopFinalGraspResults(*job, listresults);
+            _pgraspjob.reset();
+        }
+        if( job->_errormessage.size() > 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("grasp worker failed: %s", job->_errormessage, ORE_Failed);
+        }
 
-        _bContinueWorker = true;
-        // start worker threads
-        vector<boost::shared_ptr<boost::thread> > listthreads(numthreads);
-        FOREACH(itthread,listthreads) {
-            itthread->reset(new boost::thread(boost::bind(&GrasperModule::_WorkerThread,this,worker_params,pcloneenv)));
+        // parse results to output
+        sout << job->_nextindex << " " << listresults.size() << " ";
+        FOREACH(itresult, listresults) {
+            _WriteGraspResult(sout, **itresult);
         }
+        return true;
+    }
 
-        _listGraspResults.clear();
-        size_t numgrasps = approachrays.size()*rolls.size()*preshapes.size()*standoffs.size()*manipulatordirections.size();
-        if( maxgrasps == 0 ) {
-            maxgrasps = numgrasps;
+    /// \brief returns the grasps of the current GraspThreaded call that became final since the last call, see _PopFinalGraspResults
+    ///
+    /// Output format: done nextindex numresults [results], where done is 1 if all workers finished and nextindex is the grasp id to pass as startindex to resume the search.
+    virtual bool _GetGraspThreadedResultsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        list<GraspParametersThreadPtr> listresults;
+        bool bDone = true;
+        size_t nextgrasp = 0;
+        GraspJobPtr job;
+        {
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            job = _pgraspjob;
+            if( !!job ) {
+                bDone = !_workerpool.IsRunning();
+                _PopFinalGraspResults(*job, listresults);
+                nextgrasp = job->_nextindex;
+            }
+        }
+        if( !!job && bDone && job->_errormessage.size() > 0 ) {
+            RAVELOG_WARN(str(boost::format("grasp worker failed: %s")%job->_errormessage));
+        }
+        sout << bDone << " " << nextgrasp << " " << listresults.size() << " ";
+        FOREACH(itresult, listresults) {
+            _WriteGraspResult(sout, **itresult);
         }
-        RAVELOG_INFO(str(boost::format("number of grasps to test: %d\n")%numgrasps));
-        size_t id = startindex;
-        for(id=startindex; id < numgrasps; ++id) {
-            size_t istandoff = id % standoffs.size();
-            size_t ipreshape = (id / standoffs.size()) % preshapes.size();
-            size_t iroll = (id / (preshapes.size() * standoffs.size())) % rolls.size();
-            size_t iapproachray = (id / (rolls.size() * preshapes.size() * standoffs.size()))%approachrays.size();
-            size_t imanipulatordirection = (id / (rolls.size() * preshapes.size() * standoffs.size()*approachrays.size()));
+        return true;
+    }
 
-            boost::mutex::scoped_lock lock(_mutexGrasp);
-            if( _listGraspResults.size() >= maxgrasps ) {
+    virtual bool _StopGraspThreadedCommand(std::ostream& sout, std::istream& sinput)
+    {
+        _StopGraspJob();
+        return true;
+    }
+
+    static bool _CompareGraspId(GraspParametersThreadPtr a, GraspParametersThreadPtr b)
+    {
+        return a->id < b->id;
+    }
+
+    /// \brief moves the results of job that cannot change anymore to listresults, in id order. Has to be called with _mutexGrasp locked.
+    ///
+    /// A result is final once all grasps with smaller ids are evaluated. So the returned grasps and job._nextindex are the same as evaluating the grasps one by one in id order, for any number of threads. Once job._maxgrasps grasps are returned, the job is stopped, the grasps with larger ids are dropped, and job._nextindex is the id after the last returned grasp.
+    void _PopFinalGraspResults(GraspJob& job, list<GraspParametersThreadPtr>& listresults)
+    {
+        if( job._numreturned >= job._maxgrasps ) {
+            job._listresults.clear();
+            return;
+        }
+        size_t finalid = job._setevaluating.size() > 0 ? *job._setevaluating.begin() : job._nextgrasp;
+        list<GraspParametersThreadPtr> listfinal;
+        for(list<GraspParametersThreadPtr>::iterator itresult = job._listresults.begin(); itresult != job._listresults.end(); ) {
+            if( (*itresult)->id < finalid ) {
+                listfinal.splice(listfinal.end(), job._listresults, itresult++);
+            }
+            else {
+                ++itresult;
+            }
+        }
+        listfinal.sort(boost::bind(&GrasperModule::_CompareGraspId, _1, _2));
+        job._nextindex = finalid;
+        FOREACH(itresult, listfinal) {
+            listresults.push_back(*itresult);
+            if( ++job._numreturned >= job._maxgrasps ) {
+                job._nextindex = (*itresult)->id+1;
+                job._bStop = true;
+                job._listresults.clear();
                 break;
             }
+        }
+    }
 
-            // initialize _graspParamsWork
-            BOOST_ASSERT(!_graspParamsWork);
-            _graspParamsWork.reset(new GraspParametersThread());
-            _graspParamsWork->id = id;
-            _graspParamsWork->vtargetposition = approachrays.at(iapproachray).first;
-            _graspParamsWork->vtargetdirection = approachrays.at(iapproachray).second;
-            _graspParamsWork->vmanipulatordirection = manipulatordirections.at(imanipulatordirection);
-            _graspParamsWork->ftargetroll = rolls.at(iroll);
-            _graspParamsWork->fstandoff = standoffs.at(istandoff);
-            _graspParamsWork->preshape = preshapes.at(ipreshape);
-            _condGraspHasWork.notify_one();     // notify there is work
-            _condGraspReceivedWork.wait(lock);     // wait for more work
+    void _WriteGraspResult(std::ostream& sout, const GraspParametersThread& result)
+    {
+        sout << result.vtargetposition.x << " " << result.vtargetposition.y << " " << result.vtargetposition.z << " ";
+        sout << result.vtargetdirection.x << " " << result.vtargetdirection.y << " " << result.vtargetdirection.z << " ";
+        sout << result.ftargetroll << " " << result.fstandoff << " ";
+        sout << result.vmanipulatordirection.x << " " << result.vmanipulatordirection.y << " " << result.vmanipulatordirection.z << " ";
+        sout << result.mindist << " " << result.volume << " ";
+        FOREACHC(itangle, result.preshape) {
+            sout << (*itangle) << " ";
+        }
+        sout << result.transfinal.rot.x << " " << result.transfinal.rot.y << " " << result.transfinal.rot.z << " " << result.transfinal.rot.w << " " << result.transfinal.trans.x << " " << result.transfinal.trans.y << " " << result.transfinal.trans.z << " ";
+        FOREACHC(itangle, result.finalshape) {
+            sout << *itangle << " ";
+        }
+        sout << result.contacts.size() << " ";
+        FOREACHC(itc, result.contacts) {
+            const CollisionReport::CONTACT& c = itc->first;
+            sout << c.pos.x << " " << c.pos.y << " " << c.pos.z << " " << c.norm.x << " " << c.norm.y << " " << c.norm.z << " ";
         }
+    }
 
-        // wait for workers
-        _bContinueWorker = false;
-        FOREACH(itthread,listthreads) {
-            _condGraspHasWork.notify_all();     // signal
-            (*itthread)->join();
+    /// \brief stops taking new grasps of the current job and waits for the workers to finish the grasps they are evaluating. The results can still be retrieved.
+    void _StopGraspJob()
+    {
+        {
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            if( !!_pgraspjob ) {
+                _pgraspjob->_bStop = true;
+            }
         }
-        listthreads.clear();
+        _workerpool.Wait(); // errors are recorded in the job by _RunGraspWorker
+    }
 
-        // parse results to output
-        sout << id << " " << _listGraspResults.size() << " ";
-        FOREACH(itresult, _listGraspResults) {
-            sout << (*itresult)->vtargetposition.x << " " << (*itresult)->vtargetposition.y << " " << (*itresult)->vtargetposition.z << " ";
-            sout << (*itresult)->vtargetdirection.x << " " << (*itresult)->vtargetdirection.y << " " << (*itresult)->vtargetdirection.z << " ";
-            sout << (*itresult)->ftargetroll << " " << (*itresult)->fstandoff << " ";
-            sout << (*itresult)->vmanipulatordirection.x << " " << (*itresult)->vmanipulatordirection.y << " " << (*itresult)->vmanipulatordirection.z << " ";
-            sout << (*itresult)->mindist << " " << (*itresult)->volume << " ";
-            FOREACH(itangle, (*itresult)->preshape) {
-                sout << (*itangle) << " ";
-            }
-            sout << (*itresult)->transfinal.rot.x << " " << (*itresult)->transfinal.rot.y << " " << (*itresult)->transfinal.rot.z << " " << (*itresult)->transfinal.rot.w << " " << (*itresult)->transfinal.trans.x << " " << (*itresult)->transfinal.trans.y << " " << (*itresult)->transfinal.trans.z << " ";
-            FOREACH(itangle, (*itresult)->finalshape) {
-                sout << *itangle << " ";
-            }
-            sout << (*itresult)->contacts.size() << " ";
-            FOREACH(itc, (*itresult)->contacts) {
-                const CollisionReport::CONTACT& c = itc->first;
-                sout << c.pos.x << " " << c.pos.y << " " << c.pos.z << " " << c.norm.x << " " << c.norm.y << " " << c.norm.z << " ";
+    /// \brief creates the worker threads if necessary and updates the worker environments from the module environment. Has to be called with the environment locked and no job running.
+    void _SyncGraspWorkers(int numthreads)
+    {
+        if( _vgraspworkers.size() != (size_t)numthreads ) {
+            _StopGraspWorkers();
+            _vgraspworkers.resize(numthreads);
+        }
+        FOREACH(itworker, _vgraspworkers) {
+            SyncWorkerEnvironment(itworker->_penv, GetEnv(), Clone_Bodies|Clone_Simulation);
+            if( !itworker->_planner ) {
+                EnvironmentMutex::scoped_lock lockenv(itworker->_penv->GetMutex());
+                itworker->_planner = RaveCreatePlanner(itworker->_penv,"Grasper");
             }
         }
-        return true;
+        _workerpool.Start(_vgraspworkers.size());
     }
 
-    void _WorkerThread(const WorkerParametersPtr worker_params, EnvironmentBasePtr penv)
+    void _StopGraspWorkers()
     {
-        // clone environment
+        _StopGraspJob();
+        _workerpool.Stop();
+        FOREACH(itworker, _vgraspworkers) {
+            itworker->_planner.reset();
+            if( !!itworker->_penv ) {
+                itworker->_penv->Destroy();
+            }
+        }
+        _vgraspworkers.clear();
+    }
 
-        EnvironmentBasePtr pcloneenv = penv->CloneSelf(Clone_Bodies|Clone_Simulation);
+    void _RunGraspWorker(size_t iworker, GraspJobPtr job)
+    {
+        try {
+            _RunGraspJob(_vgraspworkers.at(iworker), *job);
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN(str(boost::format("grasp worker %d failed: %s")%iworker%ex.what()));
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            if( job->_errormessage.size() == 0 ) {
+                job->_errormessage = ex.what();
+            }
+        }
+    }
+
+    /// \brief evaluates grasps of job in the environment of worker until there are no grasps left. Every worker takes the next grasp id as soon as it finishes one, so slow grasps do not hold up the others.
+    void _RunGraspJob(GraspWorker& worker, GraspJob& job)
+    {
+        const WorkerParametersPtr worker_params = job._worker_params;
+        EnvironmentBasePtr pcloneenv = worker._penv;
         {
             EnvironmentMutex::scoped_lock lock(pcloneenv->GetMutex());
             boost::shared_ptr<CollisionCheckerMngr> pcheckermngr(new CollisionCheckerMngr(pcloneenv, worker_params->collisionchecker));
-            PlannerBasePtr planner = RaveCreatePlanner(pcloneenv,"Grasper");
-            RobotBasePtr probot = pcloneenv->GetRobot(_robot->GetName());
+            PlannerBasePtr planner = worker._planner;
+            RobotBasePtr probot = pcloneenv->GetRobot(worker_params->robotname);
             string strsavetraj;
 
             probot->SetActiveManipulator(worker_params->manipname);
@@ -930,26 +1136,24 @@ public:
             vector<dReal> vtrajpoint;
 
             // use CO_ActiveDOFs since might be calling FindIKSolution
-            int coloptions = GetEnv()->GetCollisionChecker()->GetCollisionOptions()|(worker_params->bCheckGraspIK ? CO_ActiveDOFs : 0);
+            int coloptions = worker_params->collisionoptions|(worker_params->bCheckGraspIK ? CO_ActiveDOFs : 0);
             coloptions &= ~CO_Contacts;
             pcloneenv->GetCollisionChecker()->SetCollisionOptions(coloptions|CO_Contacts);
 
-            while(_bContinueWorker) {
+            while(1) {
                 {
-                    // wait for work
-                    boost::mutex::scoped_lock lock(_mutexGrasp);
-                    if( !_graspParamsWork ) {
-                        _condGraspHasWork.wait(lock);
-                        // after signal
-                        if( !_graspParamsWork ) {
-                            continue;
-                        }
+                    // take the next grasp
+                    boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+                    // once maxgrasps grasps succeeded, the first maxgrasps successful ids are among the ones already taken
+                    if( job._bStop || job._nextgrasp >= job._numgrasps || job._numresults >= job._maxgrasps ) {
+                        break;
                     }
-                    grasp_params = _graspParamsWork;
-                    _graspParamsWork.reset();
-                    _condGraspReceivedWork.notify_all();
+                    grasp_params = job.CreateGrasp(job._nextgrasp++);
+                    job._setevaluating.insert(grasp_params->id);
                 }
+                GraspEvaluationGuard evaluationguard(_mutexGrasp, job, grasp_params->id);
 
+                OPENRAVE_PROFILING_SCOPE("GrasperModule.EvaluateGrasp");
                 RAVELOG_DEBUG(str(boost::format("grasp %d: start")%grasp_params->id));
 
                 // fill params
@@ -1125,10 +1329,10 @@ public:
                         jointvaluesstd[i] = _vjointmaxlengths.at(i) * RaveSqrt(jointstd / dReal(vfinalvalues.size()));
                     }
                     dReal fmaxjointdisplacement = 0;
-                    FOREACHC(itlink, _robot->GetLinks()) {
+                    FOREACHC(itlink, probot->GetLinks()) {
                         dReal f = 0;
-                        for(size_t ijoint = 0; ijoint < _robot->GetJoints().size(); ++ijoint) {
-                            if( _robot->DoesAffect(ijoint, (*itlink)->GetIndex()) ) {
+                        for(size_t ijoint = 0; ijoint < probot->GetJoints().size(); ++ijoint) {
+                            if( probot->DoesAffect(ijoint, (*itlink)->GetIndex()) ) {
                                 f += jointvaluesstd.at(ijoint);
                             }
                         }
@@ -1147,18 +1351,20 @@ public:
 
                 RAVELOG_DEBUG(str(boost::format("grasp %d: success")%grasp_params->id));
 
-                boost::mutex::scoped_lock lock(_mutexGrasp);
-                _listGraspResults.push_back(grasp_params);
+                boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+                job._listresults.push_back(grasp_params);
+                ++job._numresults;
             }
         }
-        pcloneenv->Destroy();
     }
 
-    bool _bContinueWorker;
-    boost::mutex _mutexGrasp;
-    GraspParametersThreadPtr _graspParamsWork;
-    list<GraspParametersThreadPtr> _listGraspResults;
-    boost::condition _condGraspHasWork, _condGraspReceivedWork;
+    //@{
+    // GraspThreaded workers, see _RunGraspJob
+    std::vector<GraspWorker> _vgraspworkers;
+    WorkerThreadPool _workerpool;
+    boost::mutex _mutexGrasp; ///< protects _pgraspjob and the job state
+    GraspJobPtr _pgraspjob; ///< the current or last job
+    //@}
 
 protected:
     void _ComputeJointMaxLengths(vector<dReal>& vjointlengths)
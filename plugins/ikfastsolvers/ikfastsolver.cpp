@@ -18,6 +18,9 @@
 #include <boost/bind.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "workerthreadpool.h"
 
 #ifdef OPENRAVE_HAS_LAPACK
 #include "jacobianinverse.h"
@@ -35,6 +38,39 @@ public:
         IkReturnPtr ikreturn;
     };
 
+    /// \brief the results of one free parameter sample of a parallel SolveAll call
+    class FreeSampleResult
+    {
+public:
+        FreeSampleResult() : action(IKRA_Reject) {
+        }
+        IkReturnAction action;
+        std::vector<IkReturnPtr> vikreturns;
+    };
+
+    /// \brief the work shared by all worker threads for one parallel SolveAll call
+    class WorkerJob
+    {
+public:
+        WorkerJob(const IkParameterization& param, int filteroptions) : _param(param), _filteroptions(filteroptions), _nextsample(0), _quitsample(std::numeric_limits<size_t>::max()) {
+        }
+        const IkParameterization& _param;
+        int _filteroptions;
+        std::vector< std::vector<IkReal> > _vfreesamples; ///< free parameter values in the order that the serial search visits them
+        std::vector<FreeSampleResult> _vresults; ///< one for every _vfreesamples
+        size_t _nextsample; ///< next sample for a worker to take
+        size_t _quitsample; ///< the smallest sample index that returned IKRA_Quit, samples after it do not need to be computed
+        std::string _errormessage;
+    };
+
+    /// \brief a worker for parallel SolveAll. Has its own cloned environment so that collision checking does not interfere with the other workers.
+    class Worker
+    {
+public:
+        EnvironmentBasePtr _penv;
+        boost::shared_ptr< IkFastSolver<IkReal> > _psolver; ///< solver set to the manipulator of _penv
+    };
+
 public:
     IkFastSolver(EnvironmentBasePtr penv, std::istream& sinput, boost::shared_ptr<ikfast::IkFastFunctions<IkReal> > ikfunctions, const vector<dReal>& vfreeinc, dReal ikthreshold=1e-4) : IkSolverBase(penv), _ikfunctions(ikfunctions), _vFreeInc(vfreeinc), _ikthreshold(ikthreshold) {
         OPENRAVE_ASSERT_OP(ikfunctions->_GetIkRealSize(),==,sizeof(IkReal));
@@ -77,10 +113,17 @@ public:
         RegisterCommand("SetBackTraceSelfCollisionLinks",boost::bind(&IkFastSolver<IkReal>::_SetBackTraceSelfCollisionLinksCommand,this,_1,_2),
                         "format: int int\n\n\
 for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfCollisionWithFree, when pruning self collisions, the number of links to look at. If the tip of the manip self collides with the base, then can safely quit the IK.");
+        RegisterCommand("SetNumThreads",boost::bind(&IkFastSolver<IkReal>::_SetNumThreadsCommand,this,_1,_2),
+                        "format: int\n\n\
+number of worker threads that SolveAll uses to search the free parameters. Each worker checks collisions in its own clone of the environment and the solutions are returned in the same order as the serial search. Only used when no custom filters need to be called. 0 or 1 searches serially (default). Cloned solvers search serially.");
+        RegisterCommand("GetNumThreads",boost::bind(&IkFastSolver<IkReal>::_GetNumThreadsCommand,this,_1,_2),
+                        "returns the number of worker threads that SolveAll uses");
         _numBacktraceLinksForSelfCollisionWithNonMoving = 2;
         _numBacktraceLinksForSelfCollisionWithFree = 0;
+        _nNumThreads = 0;
     }
     virtual ~IkFastSolver() {
+        _StopWorkers();
     }
 
     inline boost::shared_ptr<IkFastSolver<IkReal> > shared_solver() {
@@ -186,6 +229,26 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
         return true;
     }
 
+    bool _SetNumThreadsCommand(ostream& sout, istream& sinput)
+    {
+        int numthreads = 0;
+        sinput >> numthreads;
+        if( !sinput || numthreads < 0 ) {
+            return false;
+        }
+        if( numthreads != _nNumThreads ) {
+            _StopWorkers();
+            _nNumThreads = numthreads;
+        }
+        return true;
+    }
+
+    bool _GetNumThreadsCommand(ostream& sout, istream& sinput)
+    {
+        sout << _nNumThreads;
+        return true;
+    }
+
     virtual IkReturnAction CallFilters(const IkParameterization& param, IkReturnPtr ikreturn, int minpriority, int maxpriority) {
         // have to convert to the manipulator's base coordinate system
         RobotBase::ManipulatorPtr pmanip(_pmanip);
@@ -663,6 +726,10 @@ protected:
         vikreturns.resize(0);
         IkParameterization ikparamdummy;
         const IkParameterization& param = _ConvertIkParameterization(rawparam, ikparamdummy);
+        if( _nNumThreads > 1 && _vfreeparams.size() > 0 && ((filteroptions & IKFO_IgnoreCustomFilters) || !_HasFilterInRange(IKSP_MinPriority, IKSP_MaxPriority)) ) {
+            // custom filters are user functions operating on this environment, so they can only be called from the serial search
+            return _SolveAllParallel(param, filteroptions, vikreturns);
+        }
         RobotBase::ManipulatorPtr pmanip(_pmanip);
         RobotBasePtr probot = pmanip->GetRobot();
         RobotBase::RobotStateSaver saver(probot);
@@ -806,6 +873,8 @@ protected:
         _SetJacobianRefine(r->_fRefineWithJacobianInverseAllowedError, r->_jacobinvsolver._nMaxIterations);
 
         _bEmptyTransform6D = r->_bEmptyTransform6D;
+        // the worker threads are not cloned, otherwise every cloned environment (for example the worker environments
+        // of parallel planners) would start its own workers. Clones search serially until SetNumThreads is called on them.
     }
 
 protected:
@@ -1748,6 +1817,132 @@ protected:
 //        return IKRA_Success;
     }
 
+    /// \brief SolveAll that distributes the free parameter samples to the worker threads.
+    ///
+    /// The samples are enumerated in the same order as ComposeSolution and the results are merged in that order, so
+    /// the returned solutions do not depend on the number of threads or the scheduling. Every sample uses its own
+    /// StateCheckEndEffector, so the end effector collision shortcuts do not carry over between samples.
+    bool _SolveAllParallel(const IkParameterization& param, int filteroptions, std::vector<IkReturnPtr>& vikreturns)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        RobotBase::RobotStateSaver saver(probot);
+        probot->SetActiveDOFs(pmanip->GetArmIndices());
+
+        boost::shared_ptr<WorkerJob> job(new WorkerJob(param, filteroptions));
+        std::vector<IkReal> vfree(_vfreeparams.size());
+        ComposeSolution(_vfreeparams, vfree, 0, vector<dReal>(), boost::bind(&IkFastSolver::_RecordFreeSample,this,boost::cref(vfree),boost::ref(job->_vfreesamples)), _vFreeInc);
+        job->_vresults.resize(job->_vfreesamples.size());
+
+        _SyncWorkers();
+        _workerpool.Run(boost::bind(&IkFastSolver::_RunWorkerJob, this, _1, boost::ref(*job)));
+
+        if( job->_errormessage.size() > 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("ik worker failed: %s"), job->_errormessage, ORE_Failed);
+        }
+        // like the serial search, a quit keeps the solutions found before it unsorted and returns false
+        bool bQuit = false;
+        FOREACH(itresult, job->_vresults) {
+            vikreturns.insert(vikreturns.end(), itresult->vikreturns.begin(), itresult->vikreturns.end());
+            if( itresult->action & IKRA_Quit ) {
+                bQuit = true;
+                break;
+            }
+        }
+
+        // the finish callbacks belong to this solver, so call them here with the solutions set on the original robot
+        FOREACH(itikreturn, vikreturns) {
+            probot->SetActiveDOFValues((*itikreturn)->_vsolution,false);
+            IkParameterization paramnew = pmanip->GetIkParameterization(param,false);
+            _CallFinishCallbacks(*itikreturn, pmanip, pmanip->GetBase()->GetTransform() * paramnew);
+        }
+        if( bQuit ) {
+            return false;
+        }
+        _SortSolutions(probot, vikreturns);
+        return vikreturns.size()>0;
+    }
+
+    IkReturnAction _RecordFreeSample(const std::vector<IkReal>& vfree, std::vector< std::vector<IkReal> >& vfreesamples)
+    {
+        vfreesamples.push_back(vfree);
+        return IKRA_Reject; // continue enumerating
+    }
+
+    /// \brief computes all the solutions of one free parameter sample, called on the solver of a worker
+    IkReturnAction _SolveAllFreeSample(const IkParameterization& param, const std::vector<IkReal>& vfree, int filteroptions, std::vector<IkReturnPtr>& vikreturns)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        RobotBase::RobotStateSaver saver(probot);
+        probot->SetActiveDOFs(pmanip->GetArmIndices());
+        StateCheckEndEffector stateCheck(probot,_vchildlinks,_vindependentlinks,filteroptions);
+        CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
+        return _SolveAll(param, vfree, filteroptions, vikreturns, stateCheck);
+    }
+
+    /// \brief creates the worker threads if necessary and updates the worker environments from the current environment
+    void _SyncWorkers()
+    {
+        if( _vworkers.size() != (size_t)_nNumThreads ) {
+            _StopWorkers();
+            _vworkers.resize(_nNumThreads);
+        }
+        FOREACH(itworker, _vworkers) {
+            SyncWorkerEnvironment(itworker->_penv, GetEnv(), Clone_Bodies);
+            EnvironmentMutex::scoped_lock lockenv(itworker->_penv->GetMutex());
+            if( !itworker->_psolver ) {
+                std::stringstream ssinput;
+                itworker->_psolver.reset(new IkFastSolver<IkReal>(itworker->_penv, ssinput, _ikfunctions, _vFreeInc, _ikthreshold));
+            }
+            itworker->_psolver->Clone(shared_solver(), 0);
+        }
+        _workerpool.Start(_vworkers.size());
+    }
+
+    void _StopWorkers()
+    {
+        _workerpool.Stop();
+        FOREACH(itworker, _vworkers) {
+            itworker->_psolver.reset();
+            if( !!itworker->_penv ) {
+                itworker->_penv->Destroy();
+            }
+        }
+        _vworkers.clear();
+    }
+
+    void _RunWorkerJob(size_t iworker, WorkerJob& job)
+    {
+        Worker& worker = _vworkers.at(iworker);
+        EnvironmentMutex::scoped_lock lockenv(worker._penv->GetMutex());
+        while(1) {
+            size_t isample;
+            {
+                boost::mutex::scoped_lock lock(_mutexWorkers);
+                isample = job._nextsample++;
+                if( isample >= job._vfreesamples.size() || isample > job._quitsample ) {
+                    break;
+                }
+            }
+            FreeSampleResult& result = job._vresults[isample];
+            try {
+                result.action = worker._psolver->_SolveAllFreeSample(job._param, job._vfreesamples[isample], job._filteroptions, result.vikreturns);
+            }
+            catch(const std::exception& ex) {
+                boost::mutex::scoped_lock lock(_mutexWorkers);
+                if( job._errormessage.size() == 0 ) {
+                    job._errormessage = ex.what();
+                }
+                result.action = IKRA_Quit;
+            }
+            if( result.action & IKRA_Quit ) {
+                boost::mutex::scoped_lock lock(_mutexWorkers);
+                job._quitsample = min(job._quitsample, isample);
+            }
+        }
+    }
+
     IkReturnAction _SolveAll(const IkParameterization& param, const vector<IkReal>& vfree, int filteroptions, std::vector<IkReturnPtr>& vikreturns, StateCheckEndEffector& stateCheck)
     {
         RobotBase::ManipulatorPtr pmanip(_pmanip);
@@ -2297,6 +2492,14 @@ protected:
 
     bool _bEmptyTransform6D; ///< if true, then the iksolver has been built with identity of the manipulator transform. Only valid for Transform6D IKs.
 
+    //@{
+    // parallel SolveAll, see _SolveAllParallel
+    int _nNumThreads; ///< number of worker threads for SolveAll, 0 or 1 for serial
+    std::vector<Worker> _vworkers;
+    WorkerThreadPool _workerpool; ///< runs _RunWorkerJob, one thread per worker
+    boost::mutex _mutexWorkers; ///< protects the sample counters and the error of the current WorkerJob
+    //@}
+
 };
 
 #ifdef OPENRAVE_IKFAST_FLOAT32
@@ -0,0 +1,182 @@
+// -*- coding: utf-8 --*
+// Copyright (C) 2006-2016 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_PLUGIN_WORKERTHREADPOOL_H
+#define OPENRAVE_PLUGIN_WORKERTHREADPOOL_H
+
+#include <openrave/openrave.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+
+/// \brief Clones penv into the environment of a worker thread. The environment is created the first time and resynchronized with EnvironmentBase::Clone afterwards.
+///
+/// The simulation of the worker environment is stopped, otherwise its simulation thread would spin on the environment lock while the worker holds it.
+inline void SyncWorkerEnvironment(OpenRAVE::EnvironmentBasePtr& penvworker, OpenRAVE::EnvironmentBasePtr penv, int cloningoptions)
+{
+    if( !penvworker ) {
+        penvworker = penv->CloneSelf(cloningoptions);
+    }
+    else {
+        penvworker->Clone(penv, cloningoptions);
+    }
+    penvworker->StopSimulation();
+}
+
+/// \brief Persistent threads that all run the same job and are kept alive between jobs.
+///
+/// \code
+/// pool.Start(numthreads);
+/// pool.Run(boost::bind(&MyPlanner::_RunWorkerJob, this, _1, boost::ref(job))); // called once per thread with the thread index
+/// \endcode
+/// The job function has to distribute the work between the threads itself, for example with a shared counter.
+class WorkerThreadPool : public boost::noncopyable
+{
+public:
+    WorkerThreadPool() : _nJobId(0), _nThreadsBusy(0), _bShutdown(false) {
+    }
+    virtual ~WorkerThreadPool() {
+        Stop();
+    }
+
+    /// \brief makes sure the pool has numthreads threads. Changing the number of threads restarts all of them.
+    void Start(size_t numthreads)
+    {
+        if( _vthreads.size() == numthreads ) {
+            return;
+        }
+        Stop();
+        for(size_t ithread = 0; ithread < numthreads; ++ithread) {
+            _vthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&WorkerThreadPool::_ThreadLoop, this, ithread, _nJobId))));
+        }
+    }
+
+    /// \brief stops and joins all threads. Cannot be called while a job is running.
+    void Stop()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bShutdown = true;
+            _condHasJob.notify_all();
+        }
+        for(size_t ithread = 0; ithread < _vthreads.size(); ++ithread) {
+            _vthreads[ithread]->join();
+        }
+        _vthreads.clear();
+        _bShutdown = false;
+    }
+
+    inline size_t GetNumThreads() const {
+        return _vthreads.size();
+    }
+
+    /// \brief calls fn(ithread) on every thread and returns once all calls have returned.
+    ///
+    /// \throw openrave_exception if any of the calls threw, with the message of the first exception.
+    void Run(const boost::function<void(size_t)>& fn)
+    {
+        RunAsync(fn);
+        Wait();
+    }
+
+    /// \brief starts calling fn(ithread) on every thread and returns immediately. \ref Wait has to be called before the next job.
+    void RunAsync(const boost::function<void(size_t)>& fn)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        BOOST_ASSERT(_nThreadsBusy == 0);
+        _fn = fn;
+        _errormessage.clear();
+        _nThreadsBusy = _vthreads.size();
+        ++_nJobId;
+        _condHasJob.notify_all();
+    }
+
+    /// \brief returns true if the threads are still running the job of the last \ref RunAsync call
+    bool IsRunning()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _nThreadsBusy > 0;
+    }
+
+    /// \brief waits for the current job to finish, returns immediately if there is none.
+    ///
+    /// \throw openrave_exception if any of the calls threw, with the message of the first exception.
+    void Wait()
+    {
+        std::string errormessage;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            while(_nThreadsBusy > 0) {
+                _condJobDone.wait(lock);
+            }
+            _fn.clear();
+            errormessage.swap(_errormessage);
+        }
+        if( errormessage.size() > 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("worker thread failed: %s", errormessage, OpenRAVE::ORE_Failed);
+        }
+    }
+
+private:
+    void _ThreadLoop(size_t ithread, uint64_t lastjobid)
+    {
+        while(1) {
+            boost::function<void(size_t)> fn;
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while(!_bShutdown && _nJobId == lastjobid) {
+                    _condHasJob.wait(lock);
+                }
+                if( _bShutdown ) {
+                    return;
+                }
+                lastjobid = _nJobId;
+                fn = _fn;
+            }
+
+            std::string errormessage;
+            try {
+                fn(ithread);
+            }
+            catch(const std::exception& ex) {
+                errormessage = ex.what();
+            }
+
+            boost::mutex::scoped_lock lock(_mutex);
+            if( errormessage.size() > 0 && _errormessage.size() == 0 ) {
+                _errormessage = errormessage;
+            }
+            if( --_nThreadsBusy == 0 ) {
+                _condJobDone.notify_all();
+            }
+        }
+    }
+
+    std::vector< boost::shared_ptr<boost::thread> > _vthreads;
+    boost::mutex _mutex; ///< protects the job state below
+    boost::condition _condHasJob, _condJobDone;
+    boost::function<void(size_t)> _fn; ///< job of the current Run call
+    std::string _errormessage; ///< first error of the current job
+    uint64_t _nJobId; ///< incremented for every job
+    size_t _nThreadsBusy; ///< number of threads still running the current job
+    bool _bShutdown;
+};
+
+#endif
@@ -35,7 +35,7 @@ class ODECollisionChecker : public OpenRAVE::CollisionCheckerBase
         {
             _bHasCallbacks = pchecker->GetEnv()->HasRegisteredCollisionCallbacks();
             if( _bHasCallbacks && !_report ) {
-                _report.reset(new CollisionReport());
+                _report = OpenRAVE::RaveAcquireCollisionReport();
             }
             if( !!_report ) {
                 _report->Reset(pchecker->GetCollisionOptions());
@@ -130,12 +130,19 @@ public:
 
         _odespace->Init();
         geomray = dCreateRay(0, 1000.0f);     // 1000m (is this used?)
+        _raybatchspace = NULL;
     }
     virtual ~ODECollisionChecker() {
         if( geomray != NULL ) {
             dGeomDestroy(geomray);
             geomray = NULL;
         }
+        if( _raybatchspace != NULL ) {
+            // also destroys the rays inside it
+            dSpaceDestroy(_raybatchspace);
+            _raybatchspace = NULL;
+            _vraybatchgeoms.clear();
+        }
         // save to call DestroyEnvironment since it does not rely on the Environment lock
         DestroyEnvironment();
         _odespace->Destroy();
@@ -355,7 +362,7 @@ public:
         bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
         std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
 
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vgeomcontacts;
         dGeomID geom1 = _odespace->GetLinkGeom(plink1);
         int igeom1 = 0;
         bool bCollision = false;
@@ -369,7 +376,7 @@ public:
                 int N = _GeomCollide(geom1, geom2, vcontacts, !!preport && !!(preport->options & OpenRAVE::CO_Contacts));
                 if (N) {
                     if( !preport && bHasCallbacks ) {
-                        preport.reset(new CollisionReport());
+                        preport = OpenRAVE::RaveAcquireCollisionReport();
                         preport->Reset(_options);
                     }
 
@@ -556,7 +563,7 @@ public:
         std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
 
         bool bCollision = false;
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vgeomcontacts;
         dGeomID geom1 = _odespace->GetLinkGeom(plink);
         while(geom1 != NULL) {
             BOOST_ASSERT(dGeomIsEnabled(geom1));
@@ -565,7 +572,7 @@ public:
             if (N > 0) {
 
                 if( !report && bHasCallbacks ) {
-                    report.reset(new CollisionReport());
+                    report = OpenRAVE::RaveAcquireCollisionReport();
                     report->Reset(_options);
                 }
 
@@ -706,6 +713,57 @@ public:
         return cb._bCollision;
     }
 
+    /// \brief puts all rays into one ode space and collides it with the environment space once
+    virtual int CheckCollisionRays(const std::vector<RAY>& vrays, std::vector<OpenRAVE::dReal>& vdistances, std::vector<int>& vbodyids)
+    {
+        vdistances.resize(vrays.size());
+        vbodyids.resize(vrays.size());
+        std::fill(vdistances.begin(), vdistances.end(), OpenRAVE::dReal(-1));
+        std::fill(vbodyids.begin(), vbodyids.end(), 0);
+        if( vrays.size() == 0 ) {
+            return 0;
+        }
+
+#ifndef ODE_USE_MULTITHREAD
+        boost::mutex::scoped_lock lock(_mutexode);
+#endif
+        if( _raybatchspace == NULL ) {
+            _raybatchspace = dHashSpaceCreate(0);
+        }
+        while(_vraybatchgeoms.size() < vrays.size()) {
+            dGeomID geom = dCreateRay(_raybatchspace, 1000.0f);
+            dGeomSetData(geom, (void*)_vraybatchgeoms.size()); // the index of the ray
+            _vraybatchgeoms.push_back(geom);
+        }
+        for(size_t iray = 0; iray < _vraybatchgeoms.size(); ++iray) {
+            dGeomID geom = _vraybatchgeoms[iray];
+            OpenRAVE::dReal fmaxdist = iray < vrays.size() ? OpenRAVE::RaveSqrt(vrays[iray].dir.lengthsqr3()) : OpenRAVE::dReal(0);
+            if( fmaxdist <= 0 ) {
+                dGeomDisable(geom);
+                continue;
+            }
+            const RAY& ray = vrays[iray];
+            Vector vnormdir = ray.dir*(1/fmaxdist);
+            dGeomRaySet(geom, ray.pos.x, ray.pos.y, ray.pos.z, vnormdir.x, vnormdir.y, vnormdir.z);
+            dGeomRaySetClosestHit(geom, !(_options&OpenRAVE::CO_RayAnyHit));
+            dGeomRaySetLength(geom, fmaxdist);
+            dGeomRaySetParams(geom,0,0);
+            dGeomEnable(geom);
+        }
+
+        _odespace->Synchronize();
+        RayBatchCallbackData cb(vdistances, vbodyids);
+        dSpaceCollide2((dGeomID)_odespace->GetSpace(), (dGeomID)_raybatchspace, &cb, RayBatchCollisionCallback);
+
+        int nhits = 0;
+        FOREACHC(itdist, vdistances) {
+            if( *itdist >= 0 ) {
+                ++nhits;
+            }
+        }
+        return nhits;
+    }
+
     virtual bool CheckStandaloneSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report)
     {
         if( _options & OpenRAVE::CO_Distance ) {
@@ -924,7 +982,7 @@ private:
             }
         }
 
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vgeomcontacts;
         int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
         if ( N > 0 ) {
             if( !!pcb->_report || pcb->GetCallbacks().size() > 0 ) {
@@ -1041,7 +1099,7 @@ private:
         }
 
         // only care if one of the bodies is the link
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vgeomcontacts;
         int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
         if ( N > 0 ) {
 
@@ -1176,7 +1234,7 @@ private:
 
         // only care if one of the bodies is the link
         if(( pkb1 == pcb->_plink) ||( pkb2 == pcb->_plink) ) {
-            vector<dContact> vcontacts;
+            vector<dContact>& vcontacts = _vgeomcontacts;
             int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
             if (N) {
                 if(!!pcb->_report || pcb->GetCallbacks().size() > 0 ) {
@@ -1369,14 +1427,72 @@ private:
         }
     }
 
+    /// \brief the results of CheckCollisionRays
+    class RayBatchCallbackData
+    {
+    public:
+        RayBatchCallbackData(std::vector<OpenRAVE::dReal>& vdistances, std::vector<int>& vbodyids) : _vdistances(vdistances), _vbodyids(vbodyids) {
+        }
+        std::vector<OpenRAVE::dReal>& _vdistances;
+        std::vector<int>& _vbodyids;
+    };
+
+    static void RayBatchCollisionCallback (void *data, dGeomID o1, dGeomID o2)
+    {
+        RayBatchCallbackData* pcb = (RayBatchCallbackData*)data;
+        if( !dGeomIsEnabled(o1) || !dGeomIsEnabled(o2) ) {
+            return;
+        }
+        if (dGeomIsSpace(o1) || dGeomIsSpace(o2)) {
+            dSpaceCollide2(o1,o2,pcb,RayBatchCollisionCallback);
+            return;
+        }
+
+        dGeomID geomray = o2, geomlink = o1;
+        if( dGeomGetClass(o1) == dRayClass ) {
+            geomray = o1;
+            geomlink = o2;
+        }
+        if( dGeomGetClass(geomray) != dRayClass || dGeomGetClass(geomlink) == dRayClass ) {
+            return;
+        }
+        dBodyID b = dGeomGetBody(geomlink);
+        if( b == NULL || !dBodyGetData(b) ) {
+            return;
+        }
+        KinBody::LinkPtr plink = ((ODESpace::KinBodyInfo::LINK*)dBodyGetData(b))->GetLink();
+        if( !plink || !plink->IsEnabled() ) {
+            return;
+        }
+
+        // the ray length is set, so ode only returns contacts on the ray
+        dContact contact[2];
+        int N = dCollide(geomray,geomlink,2,&contact[0].geom,sizeof(dContact));
+        if( N <= 0 ) {
+            return;
+        }
+        OpenRAVE::dReal fdist = contact[0].geom.depth;
+        for(int index = 1; index < N; ++index) {
+            if( fdist > contact[index].geom.depth ) {
+                fdist = contact[index].geom.depth;
+            }
+        }
+        size_t iray = (size_t)dGeomGetData(geomray);
+        if( pcb->_vdistances.at(iray) < 0 || pcb->_vdistances[iray] > fdist ) {
+            pcb->_vdistances[iray] = fdist;
+            pcb->_vbodyids[iray] = plink->GetParent()->GetEnvironmentId();
+        }
+    }
+
     int _options;
     dGeomID geomray;     // used for all ray tests
     boost::shared_ptr<ODESpace> _odespace;
     size_t _nMaxStartContacts, _nMaxContacts;
     std::string _userdatakey;
     CollisionReport _report;
-
-
+    std::vector<dContact> _vgeomcontacts; ///< contacts of the geometry pair being checked, kept so that checking pairs does not allocate
+    dSpaceID _raybatchspace; ///< holds the rays of CheckCollisionRays, created on the first call
+    std::vector<dGeomID> _vraybatchgeoms; ///< the rays inside _raybatchspace, ray i stores i as its data
 };
 
 #endif
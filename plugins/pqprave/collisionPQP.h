@@ -18,7 +18,13 @@
 #define  COLPQP_H
 
 #include "pqp/PQP.h"
+#include <openrave/utils.h>
 #include <boost/lexical_cast.hpp>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 //wrapper class for PQP, distance and tolerance checking is _off_ by default, collision checking is _on_ by default
 class CollisionCheckerPQP : public CollisionCheckerBase
@@ -53,11 +59,23 @@ public:
         _benablecol = true;
         _benabledis = false;
         _benabletol = false;
+        _options = 0;
+
+        RegisterCommand("SetBVHCacheDirectory",boost::bind(&CollisionCheckerPQP::_SetBVHCacheDirectoryCommand,this,_1,_2),
+                        "Sets the directory where the bounding volume hierarchies of the link meshes are stored and looked up, so that they do not have to be rebuilt by every environment and process. An empty directory disables the cache.");
     }
     virtual ~CollisionCheckerPQP() {
         DestroyEnvironment();
     }
 
+    virtual void Clone(InterfaceBaseConstPtr preference, int cloningoptions)
+    {
+        CollisionCheckerBase::Clone(preference, cloningoptions);
+        boost::shared_ptr<CollisionCheckerPQP const> r = boost::dynamic_pointer_cast<CollisionCheckerPQP const>(preference);
+        _bvhcachedir = r->_bvhcachedir;
+        SetCollisionOptions(r->_options);
+    }
+
     virtual bool InitEnvironment()
     {
         RAVELOG_DEBUG("creating pqp collision\n");
@@ -99,21 +117,12 @@ public:
         pinfo->_pbody = boost::const_pointer_cast<KinBody>(pbody);
         pbody->SetUserData(_userdatakey, pinfo);
 
-        PQP_REAL p1[3], p2[3], p3[3];
         pinfo->vlinks.reserve(pbody->GetLinks().size());
         FOREACHC(itlink, pbody->GetLinks()) {
             const TriMesh& trimesh = (*itlink)->GetCollisionData();
             boost::shared_ptr<PQP_Model> pm;
             if( trimesh.indices.size() > 0 ) {
-                pm.reset(new PQP_Model());
-                pm->BeginModel(trimesh.indices.size()/3);
-                for(int j = 0; j < (int)trimesh.indices.size(); j+=3) {
-                    p1[0] = trimesh.vertices[trimesh.indices[j]].x;     p1[1] = trimesh.vertices[trimesh.indices[j]].y;     p1[2] = trimesh.vertices[trimesh.indices[j]].z;
-                    p2[0] = trimesh.vertices[trimesh.indices[j+1]].x;   p2[1] = trimesh.vertices[trimesh.indices[j+1]].y;     p2[2] = trimesh.vertices[trimesh.indices[j+1]].z;
-                    p3[0] = trimesh.vertices[trimesh.indices[j+2]].x;   p3[1] = trimesh.vertices[trimesh.indices[j+2]].y;     p3[2] = trimesh.vertices[trimesh.indices[j+2]].z;
-                    pm->AddTri(p1, p2, p3, j/3);
-                }
-                pm->EndModel();
+                pm = _CreateModel(trimesh);
             }
             pinfo->vlinks.push_back(pm);
         }
@@ -561,7 +570,7 @@ private:
         // collision
         if(_benablecol) {
             if( GetEnv()->HasRegisteredCollisionCallbacks() && !report ) {
-                report.reset(new CollisionReport());
+                report = RaveAcquireCollisionReport();
                 report->Reset(_options);
             }
 
@@ -685,6 +694,158 @@ private:
     RobotBaseConstPtr _pactiverobot;     ///< set if ActiveDOFs option is enabled
     vector<uint8_t> _vactivelinks;
     std::string _userdatakey;
+    std::string _bvhcachedir; ///< if not empty, directory of the cached PQP models, see _LoadModel/_SaveModel
+
+    /// \brief header of the BVH cache files.
+    ///
+    /// The header is followed by the raw Tri array and the raw BV array of the processed model, so the arrays are at fixed
+    /// offsets and can be read (or mapped) without any parsing. All the sizes are checked on load so that a file written
+    /// by a build with a different PQP_REAL or BV layout is just ignored.
+    struct BVHCacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t sizereal, sizetri, sizebv;
+        uint32_t bvtype;
+        uint32_t numtris, numbvs;
+        uint32_t reserved;
+    };
+
+    static const uint32_t s_nBVHCacheVersion = 1;
+    static const int s_nPQPBuildStateProcessed = 2; ///< PQP_BUILD_STATE_PROCESSED from pqp/PQP.cpp
+
+    bool _SetBVHCacheDirectoryCommand(ostream& sout, istream& sinput)
+    {
+        std::string dir;
+        sinput >> dir;
+        if( dir.size() > 0 ) {
+#ifdef _WIN32
+            CreateDirectoryA(dir.c_str(), NULL);
+#else
+            mkdir(dir.c_str(), S_IRWXU);
+#endif
+        }
+        _bvhcachedir = dir;
+        return true;
+    }
+
+    /// \brief returns a processed model of the mesh, looks it up in the cache directory first if one is set.
+    boost::shared_ptr<PQP_Model> _CreateModel(const TriMesh& trimesh)
+    {
+        std::string filename;
+        if( _bvhcachedir.size() > 0 ) {
+            filename = str(boost::format("%s/%s.pqp")%_bvhcachedir%_GetMeshHash(trimesh));
+            boost::shared_ptr<PQP_Model> pm = _LoadModel(filename, trimesh.indices.size()/3);
+            if( !!pm ) {
+                return pm;
+            }
+        }
+
+        PQP_REAL p1[3], p2[3], p3[3];
+        boost::shared_ptr<PQP_Model> pm(new PQP_Model());
+        pm->BeginModel(trimesh.indices.size()/3);
+        for(int j = 0; j < (int)trimesh.indices.size(); j+=3) {
+            p1[0] = trimesh.vertices[trimesh.indices[j]].x;     p1[1] = trimesh.vertices[trimesh.indices[j]].y;     p1[2] = trimesh.vertices[trimesh.indices[j]].z;
+            p2[0] = trimesh.vertices[trimesh.indices[j+1]].x;   p2[1] = trimesh.vertices[trimesh.indices[j+1]].y;     p2[2] = trimesh.vertices[trimesh.indices[j+1]].z;
+            p3[0] = trimesh.vertices[trimesh.indices[j+2]].x;   p3[1] = trimesh.vertices[trimesh.indices[j+2]].y;     p3[2] = trimesh.vertices[trimesh.indices[j+2]].z;
+            pm->AddTri(p1, p2, p3, j/3);
+        }
+        pm->EndModel();
+
+        if( filename.size() > 0 ) {
+            _SaveModel(*pm, filename);
+        }
+        return pm;
+    }
+
+    /// \brief hash of the triangles of the mesh exactly as they are passed to PQP
+    static std::string _GetMeshHash(const TriMesh& trimesh)
+    {
+        std::vector<uint8_t> vdata(trimesh.indices.size()*3*sizeof(PQP_REAL));
+        PQP_REAL* pdata = reinterpret_cast<PQP_REAL*>(vdata.empty() ? NULL : &vdata[0]);
+        FOREACHC(itindex, trimesh.indices) {
+            const Vector& v = trimesh.vertices.at(*itindex);
+            *pdata++ = v.x;
+            *pdata++ = v.y;
+            *pdata++ = v.z;
+        }
+        return utils::GetMD5HashString(vdata);
+    }
+
+    static void _InitBVHCacheHeader(BVHCacheHeader& header, uint32_t numtris, uint32_t numbvs)
+    {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "ORPQPBVH", sizeof(header.magic));
+        header.version = s_nBVHCacheVersion;
+        header.sizereal = sizeof(PQP_REAL);
+        header.sizetri = sizeof(Tri);
+        header.sizebv = sizeof(BV);
+        header.bvtype = PQP_BV_TYPE;
+        header.numtris = numtris;
+        header.numbvs = numbvs;
+    }
+
+    /// \brief loads a processed model from a cache file, returns an empty pointer if the file does not exist or does not match
+    static boost::shared_ptr<PQP_Model> _LoadModel(const std::string& filename, size_t numtris)
+    {
+        boost::shared_ptr<PQP_Model> pm;
+        std::ifstream f(filename.c_str(), std::ios::in|std::ios::binary);
+        if( !f ) {
+            return pm;
+        }
+        BVHCacheHeader header, expected;
+        if( !f.read(reinterpret_cast<char*>(&header), sizeof(header)) ) {
+            return pm;
+        }
+        _InitBVHCacheHeader(expected, numtris, header.numbvs);
+        if( memcmp(&header, &expected, sizeof(header)) != 0 || header.numtris == 0 || header.numbvs == 0 || header.numbvs > 2*header.numtris ) {
+            RAVELOG_DEBUG_FORMAT("ignoring pqp cache file %s", filename);
+            return pm;
+        }
+
+        pm.reset(new PQP_Model());
+        pm->tris = new Tri[header.numtris];
+        pm->num_tris = pm->num_tris_alloced = header.numtris;
+        pm->b = new BV[header.numbvs];
+        pm->num_bvs = pm->num_bvs_alloced = header.numbvs;
+        if( !f.read(reinterpret_cast<char*>(pm->tris), sizeof(Tri)*header.numtris) || !f.read(reinterpret_cast<char*>(pm->b), sizeof(BV)*header.numbvs) ) {
+            RAVELOG_DEBUG_FORMAT("pqp cache file %s is truncated", filename);
+            pm.reset();
+            return pm;
+        }
+        pm->last_tri = pm->tris;
+        pm->build_state = s_nPQPBuildStateProcessed;
+        return pm;
+    }
+
+    /// \brief writes the processed model to a temporary file and renames it, so concurrent readers never see partial files
+    static void _SaveModel(const PQP_Model& model, const std::string& filename)
+    {
+        if( model.build_state != s_nPQPBuildStateProcessed || model.num_tris <= 0 || model.num_bvs <= 0 ) {
+            return;
+        }
+        BVHCacheHeader header;
+        _InitBVHCacheHeader(header, model.num_tris, model.num_bvs);
+        std::string tempfilename = str(boost::format("%s.%s.tmp")%filename%boost::lexical_cast<std::string>(&model));
+        {
+            std::ofstream f(tempfilename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+            if( !f ) {
+                RAVELOG_DEBUG_FORMAT("failed to write pqp cache file %s", tempfilename);
+                return;
+            }
+            f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            f.write(reinterpret_cast<const char*>(model.tris), sizeof(Tri)*model.num_tris);
+            f.write(reinterpret_cast<const char*>(model.b), sizeof(BV)*model.num_bvs);
+            if( !f ) {
+                f.close();
+                std::remove(tempfilename.c_str());
+                return;
+            }
+        }
+        if( std::rename(tempfilename.c_str(), filename.c_str()) != 0 ) {
+            std::remove(tempfilename.c_str());
+        }
+    }
 
     void _SetActiveBody(KinBodyConstPtr pbody) {
         if( _options & CO_ActiveDOFs ) {
@@ -252,6 +252,9 @@ public:
 
             _ikreturn.reset(new IkReturn(IKRA_Success));
             _bSamplingRays = false;
+            _nextray = 0;
+            _nraybatchstart = 0;
+            _nraybatchsize = 1;
             if( _vf->_bIgnoreSensorCollision && !!_vf->_sensorrobot ) {
                 _collisionfn = _vf->_targetlink->GetParent()->GetEnv()->RegisterCollisionCallback(boost::bind(&VisibilityConstraintFunction::_IgnoreCollisionCallback,this,_1,_2));
             }
@@ -336,13 +339,21 @@ public:
         /// \param mindist Minimum distance to keep from the plane (should be non-negative)
         bool InConvexHull(const TransformMatrix& tCameraInTarget, dReal mindist=0)
         {
-            _vconvexplanes3d.resize(_vf->_vconvexplanes.size());
-            for(size_t i = 0; i < _vf->_vconvexplanes.size(); ++i) {
-                _vconvexplanes3d[i] = tCameraInTarget.rotate(_vf->_vconvexplanes[i]);
-                _vconvexplanes3d[i].w = -tCameraInTarget.trans.dot3(_vconvexplanes3d[i]) - mindist;
+            // store the planes as x,y,z,w arrays so that several planes are tested at once
+            size_t numplanes = _vf->_vconvexplanes.size();
+            if( numplanes == 0 ) {
+                return true;
+            }
+            _vconvexplanes3d.resize(4*numplanes);
+            for(size_t i = 0; i < numplanes; ++i) {
+                Vector vplane = tCameraInTarget.rotate(_vf->_vconvexplanes[i]);
+                _vconvexplanes3d[i] = vplane.x;
+                _vconvexplanes3d[numplanes+i] = vplane.y;
+                _vconvexplanes3d[2*numplanes+i] = vplane.z;
+                _vconvexplanes3d[3*numplanes+i] = -tCameraInTarget.trans.dot3(vplane) - mindist;
             }
             FOREACH(itobb,_vTargetLocalOBBs) {
-                if( !geometry::IsOBBinConvexHull(*itobb,_vconvexplanes3d) ) {
+                if( !geometry::IsOBBinConvexHull(*itobb,&_vconvexplanes3d[0],numplanes) ) {
                     return false;
                 }
             }
@@ -364,8 +375,22 @@ public:
             std::string occludingbodyandlinkname = "";
             FOREACH(itobb,_vTargetLocalOBBs) {  // itobb is in targetlink coordinates
                 OBB cameraobb = geometry::TransformOBB(tCameraInTargetinv,*itobb);
+                boost::function<bool(const Vector&)> testfn;
+                if( !_collisionfn ) {
+                    // gather the sampled rays first so that they can be checked in batches with CheckCollisionRays. The batched checks do not call the collision callbacks, so only use them when none are registered.
+                    _vraysamples.resize(0);
+                    SampleProjectedOBBWithTest(cameraobb, _vf->_fSampleRayDensity, boost::bind(&VisibilityConstraintFunction::_CollectRaySample, this, _1));
+                    _nextray = 0;
+                    _nraybatchstart = 0;
+                    _nraybatchsize = 1;
+                    _vraybodyids.resize(0);
+                    testfn = boost::bind(&VisibilityConstraintFunction::_TestBatchedRay, this, _1, boost::ref(tworldcamera), boost::ref(occludingbodyandlinkname));
+                }
+                else {
+                    testfn = boost::bind(&VisibilityConstraintFunction::_TestRay, this, _1, boost::ref(tworldcamera), boost::ref(occludingbodyandlinkname));
+                }
                 // SampleProjectedOBBWithTest usually quits when first occlusion is found, so just passing occludingbodyandlinkname to _TestRay should return the initial occluding part.
-                if( !SampleProjectedOBBWithTest(cameraobb, _vf->_fSampleRayDensity, boost::bind(&VisibilityConstraintFunction::_TestRay, this, _1, boost::ref(tworldcamera), boost::ref(occludingbodyandlinkname)),_vf->_fAllowableOcclusion) ) {
+                if( !SampleProjectedOBBWithTest(cameraobb, _vf->_fSampleRayDensity, testfn, _vf->_fAllowableOcclusion) ) {
                     RAVELOG_VERBOSE("box is occluded\n");
                     errormsg = str(boost::format("{\"type\":\"pattern_occluded\", \"bodylinkname\":\"%s\"}")%occludingbodyandlinkname);
                     return true;
@@ -412,10 +437,7 @@ private:
         /// \brief tcamera is the camera in the world coordinate system
         bool _TestRay(const Vector& v, const TransformMatrix& tcamera, std::string& errormsg)
         {
-            RAY r;
-            dReal filen = 1/RaveSqrt(v.lengthsqr3());
-            r.dir = tcamera.rotate((2.0f*filen)*v);
-            r.pos = tcamera.trans + 0.5f*_vf->_fRayMinDist*r.dir;         // move the rays a little forward
+            RAY r = _GetCameraRay(v, tcamera);
             if( !_vf->_robot->GetEnv()->CheckCollision(r,_report) ) {
                 return true;         // not supposed to happen, but it is OK
             }
@@ -477,6 +499,52 @@ private:
             }
         }
 
+        /// \brief the ray that _TestRay shoots for the sample v
+        RAY _GetCameraRay(const Vector& v, const TransformMatrix& tcamera)
+        {
+            RAY r;
+            dReal filen = 1/RaveSqrt(v.lengthsqr3());
+            r.dir = tcamera.rotate((2.0f*filen)*v);
+            r.pos = tcamera.trans + 0.5f*_vf->_fRayMinDist*r.dir;         // move the rays a little forward
+            return r;
+        }
+
+        bool _CollectRaySample(const Vector& v)
+        {
+            _vraysamples.push_back(v);
+            return true;
+        }
+
+        /// \brief same as _TestRay, except the samples gathered in _vraysamples are checked in batches
+        ///
+        /// SampleProjectedOBBWithTest visits the samples in the same order every time, so v is _vraysamples[_nextray].
+        /// Rays whose closest hit is the target box are not occluded, all other rays are checked again by _TestRay to classify the occlusion.
+        /// The batch size starts at 1 and doubles with every batch, so an early occlusion does not pay for a full batch of rays,
+        /// and checkers that do not override CheckCollisionRays and test the rays one by one do not check many rays that are never used.
+        bool _TestBatchedRay(const Vector& v, const TransformMatrix& tcamera, std::string& errormsg)
+        {
+            if( _nextray >= _vraysamples.size() ) {
+                return _TestRay(v, tcamera, errormsg);
+            }
+            size_t index = _nextray++;
+            const Vector& vsample = _vraysamples[index];
+            BOOST_ASSERT(v.x == vsample.x && v.y == vsample.y && v.z == vsample.z);
+            if( index >= _nraybatchstart + _vraybodyids.size() ) {
+                _nraybatchstart = index;
+                size_t nrays = min(_vraysamples.size() - index, _nraybatchsize);
+                _nraybatchsize = min(2*_nraybatchsize, (size_t)128);
+                _vrays.resize(nrays);
+                for(size_t i = 0; i < nrays; ++i) {
+                    _vrays[i] = _GetCameraRay(_vraysamples[index+i], tcamera);
+                }
+                _vf->_robot->GetEnv()->GetCollisionChecker()->CheckCollisionRays(_vrays, _vraydistances, _vraybodyids);
+            }
+            if( _vraybodyids.at(index-_nraybatchstart) == _ptargetbox->GetEnvironmentId() ) {
+                return true;
+            }
+            return _TestRay(v, tcamera, errormsg);
+        }
+
         bool _TestRayRigid(const Vector& v, const TransformMatrix& tcamera, const vector<KinBody::LinkPtr>& vattachedlinks)
         {
             dReal filen = 1/RaveSqrt(v.lengthsqr3());
@@ -514,7 +582,13 @@ private:
         IkReturnPtr _ikreturn;
         CollisionReportPtr _report;
         AABB _abTarget;         // local aabb in the targetlink coordinate system
-        vector<Vector> _vconvexplanes3d; ///< the convex planes of the camera in the target link coordinate system
+        vector<dReal> _vconvexplanes3d; ///< the convex planes of the camera in the target link coordinate system, stored as x, y, z, and w arrays
+        vector<Vector> _vraysamples; ///< the samples of the current OBB for _TestBatchedRay, in camera coordinates
+        vector<RAY> _vrays; ///< the current batch of rays
+        vector<dReal> _vraydistances; ///< the distances returned by CheckCollisionRays for the current batch
+        vector<int> _vraybodyids; ///< the body ids returned by CheckCollisionRays for the current batch
+        size_t _nextray, _nraybatchstart; ///< the index of the next sample in _vraysamples, and the index of the first sample of the current batch
+        size_t _nraybatchsize; ///< number of rays of the next batch
     };
 
     class GoalSampleFunction
@@ -19,6 +19,7 @@
 #include <openrave/planningutils.h>
 
 #include "manipconstraints.h"
+#include "workerthreadpool.h"
 #include "ParabolicPathSmooth/DynamicPath.h"
 
 namespace rplanners {
@@ -172,10 +173,55 @@ private:
         std::vector<ParabolicRamp::ParabolicRampND> segmentoutramps;
     };
 
+    /// \brief a shortcut between times t1 and t2 of the current path and the result of checking it
+    class ShortcutCandidate
+    {
+public:
+        ShortcutCandidate() : t1(0), t2(0), u1(0), u2(0), i1(0), i2(0), fcurvelmult(1), fcuraccelmult(1), numslowdowns(0), iIterProgress(0), bsuccess(false) {
+        }
+        dReal t1, t2; ///< times on the path
+        dReal u1, u2; ///< times on ramps i1 and i2
+        int i1, i2; ///< ramp indices of t1 and t2
+        ParabolicRamp::Vector x0, x1, dx0, dx1;
+        std::vector<dReal> vellimits, accellimits; ///< limits the shortcut was computed with
+        std::vector<ParabolicRamp::ParabolicRampND> accumoutramps; ///< if bsuccess, the checked ramps replacing [t1, t2]
+        dReal fcurvelmult, fcuraccelmult;
+        int numslowdowns;
+        uint32_t iIterProgress;
+        bool bsuccess;
+    };
+
+    /// \brief the candidates shared by all worker threads for one speculative shortcut iteration
+    class ShortcutJob
+    {
+public:
+        ShortcutJob(const std::vector<ParabolicRamp::ParabolicRampND>& ramps, const std::vector<dReal>& rampStartTime, std::vector<ShortcutCandidate>& vcandidates) : _ramps(ramps), _rampStartTime(rampStartTime), _vcandidates(vcandidates), _mintimestep(0), _fstarttimevelmult(1), _fstarttimeaccelmult(1), _iters(0), _numIters(0), _nextcandidate(0) {
+        }
+        const std::vector<ParabolicRamp::ParabolicRampND>& _ramps;
+        const std::vector<dReal>& _rampStartTime;
+        std::vector<ShortcutCandidate>& _vcandidates;
+        dReal _mintimestep, _fstarttimevelmult, _fstarttimeaccelmult;
+        int _iters, _numIters; ///< iteration of the first candidate
+        size_t _nextcandidate; ///< next candidate for a worker to take
+    };
+
+    /// \brief a worker for the speculative shortcuts. Has its own cloned environment so that collision checking does not interfere with the other workers.
+    class Worker
+    {
+public:
+        EnvironmentBasePtr _penv;
+        boost::shared_ptr<ParabolicSmoother> _psmoother; ///< smoother with parameters set to the bodies of _penv
+    };
+
 public:
     ParabolicSmoother(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _feasibilitychecker(this)
     {
         __description = ":Interface Author: Rosen Diankov\n\nInterface to `Indiana University Intelligent Motion Laboratory <http://www.iu.edu/~motion/software.html>`_ parabolic smoothing library (Kris Hauser).\n\n**Note:** The original trajectory will not be preserved at all, don't use this if the robot has to hit all points of the trajectory.\n";
+        RegisterCommand("SetNumThreads",boost::bind(&ParabolicSmoother::_SetNumThreadsCommand,this,_1,_2),
+                        "format: int\n\n\
+number of worker threads that speculatively check shortcuts in parallel. Every iteration samples one candidate per thread from the same random stream, checks them in cloned environments, and commits the one that saves the most time, so the result only depends on the number of threads. The workers rebuild the default constraints from the configuration specification, so the winning shortcut is checked again with the real parameters before being committed. 0 or 1 shortcuts serially (default).");
+        RegisterCommand("GetNumThreads",boost::bind(&ParabolicSmoother::_GetNumThreadsCommand,this,_1,_2),
+                        "returns the number of worker threads used for shortcutting");
         _bmanipconstraints = false;
         _constraintreturn.reset(new ConstraintFilterReturn());
         _logginguniformsampler = RaveCreateSpaceSampler(GetEnv(),"mt19937");
@@ -183,6 +229,30 @@ public:
             _logginguniformsampler->SetSeed(utils::GetMicroTime());
         }
         _usingNewHeuristics = 1;
+        _nNumThreads = 0;
+    }
+    virtual ~ParabolicSmoother() {
+        _StopWorkers();
+    }
+
+    bool _SetNumThreadsCommand(ostream& sout, istream& sinput)
+    {
+        int numthreads = 0;
+        sinput >> numthreads;
+        if( !sinput || numthreads < 0 ) {
+            return false;
+        }
+        if( numthreads != _nNumThreads ) {
+            _StopWorkers();
+            _nNumThreads = numthreads;
+        }
+        return true;
+    }
+
+    bool _GetNumThreadsCommand(ostream& sout, istream& sinput)
+    {
+        sout << _nNumThreads;
+        return true;
     }
 
     virtual bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr params)
@@ -1165,8 +1235,6 @@ protected:
         interpolationtime = 0;
         nslowdownloops = 0;
         slowdownlooptime = 0;
-        nchecks = 0;
-        checktime = 0;
 #endif
         uint32_t fileindex;
         if( !!_logginguniformsampler ) {
@@ -1253,6 +1321,7 @@ protected:
 #endif
         int iters=0;
         for(iters=0; iters<numIters; iters++) {
+            OPENRAVE_PROFILING_SCOPE("ParabolicSmoother.ShortcutIteration");
             nItersFromPrevSuccessful += 1;
             if (nItersFromPrevSuccessful > nCutoffIters) {
                 // No progress for already nCutOffIters. Stop right away.
@@ -1395,15 +1464,10 @@ protected:
                         //                }
 
                         iIterProgress += 0x10;
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                        tcheckstart = utils::GetMicroTime();
-#endif
-                        retcheck = _feasibilitychecker.Check2(intermediate.ramps[iramp], 0xffff, outramps);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                        tcheckend = utils::GetMicroTime();
-                        checktime += 0.000001f*(float)(tcheckend - tcheckstart);
-                        nchecks += 1;
-#endif
+                        {
+                            OPENRAVE_PROFILING_SCOPE("ParabolicSmoother.CheckRamp");
+                            retcheck = _feasibilitychecker.Check2(intermediate.ramps[iramp], 0xffff, outramps);
+                        }
 
                         iIterProgress += 0x10;
                         if( retcheck.retcode != 0) {
@@ -1461,15 +1525,10 @@ protected:
 
                             // Check the newly interpolated segment. Note that intermediate2 should have ramps.size() == 1.
                             OPENRAVE_ASSERT_OP(intermediate2.ramps.size(), ==, 1);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                            tcheckstart = utils::GetMicroTime();
-#endif
-                            retcheck = _feasibilitychecker.Check2(intermediate2.ramps[0], 0xffff, outramps2);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                            tcheckend = utils::GetMicroTime();
-                            checktime += 0.000001f*(float)(tcheckend - tcheckstart);
-                            nchecks += 1;
-#endif
+                            {
+                                OPENRAVE_PROFILING_SCOPE("ParabolicSmoother.CheckRamp");
+                                retcheck = _feasibilitychecker.Check2(intermediate2.ramps[0], 0xffff, outramps2);
+                            }
 
                             if (retcheck.retcode != 0) {
                                 RAVELOG_WARN_FORMAT("env=%d, the final SolveMinTime generated infeasible segment retcode = 0x%x", GetEnv()->GetId()%retcheck.retcode);
@@ -1727,11 +1786,523 @@ protected:
 
         RAVELOG_DEBUG_FORMAT("measured %d slow-down loops, %.15e sec. = %.15e sec./loop", nslowdownloops%slowdownlooptime%(slowdownlooptime/nslowdownloops));
         RAVELOG_DEBUG_FORMAT("measured %d interpolations, %.15e sec. = %.15e sec./interpolation", ninterpolations%interpolationtime%(interpolationtime/ninterpolations));
-        RAVELOG_DEBUG_FORMAT("measured %d checkings, %.15e sec. = %.15e sec./check", nchecks%checktime%(checktime/nchecks));
 #endif
         return shortcuts;
     }
 
+    /// \brief samples the times of the next shortcut of _Shortcut2. Uses the same random stream as the serial search.
+    void _SampleShortcutTimes2(int iters, int numIters, dReal endTime, ParabolicRamp::RandomNumberGeneratorBase* rng, dReal& t1, dReal& t2)
+    {
+        // For special shortcut
+        dReal specialShortcutWeight = 0.1;
+        dReal specialShortcutCutoffTime = 0.75;
+
+        if (iters == 0) {
+            t1 = 0;
+            t2 = endTime;
+        }
+        else if ((_zerovelpoints.size() > 0 && rng->Rand() <= specialShortcutWeight) || (numIters - iters <= (int)_zerovelpoints.size())) {
+            // We consider shortcutting around a zerovelpoint (the time instant of an original waypoint which has not been shortcut) when either
+            // - there are some zerovelpoints left and the random number falls below the threshold, or
+            // - there are some zerovelpoints left but there are not so many shortcut iterations left.
+            size_t index = _uniformsampler->SampleSequenceOneUInt32()%_zerovelpoints.size();
+            dReal t = _zerovelpoints[index];
+            t1 = t - rng->Rand()*min(specialShortcutCutoffTime, t);
+            t2 = t + rng->Rand()*min(specialShortcutCutoffTime, endTime - t);
+        }
+        else {
+            t1 = rng->Rand()*endTime;
+            t2 = rng->Rand()*endTime;
+        }
+        if (t1 > t2) {
+            ParabolicRamp::Swap(t1, t2);
+        }
+    }
+
+    /// \brief checks the shortcut between candidate.t1 and candidate.t2 of ramps without modifying ramps.
+    ///
+    /// On success, candidate.accumoutramps holds the ramps to insert between t1 and t2. Only uses the environment of this
+    /// smoother, so can be called on the smoother of a worker.
+    /// \param bCallCallbacks if false, does not call the planner callbacks since they belong to the original smoother
+    /// \return -1 if interrupted by a callback, 0 otherwise. candidate.bsuccess is set if the shortcut is valid.
+    int _EvaluateShortcut2(const std::vector<ParabolicRamp::ParabolicRampND>& ramps, const std::vector<dReal>& rampStartTime, dReal mintimestep, dReal fstarttimevelmult, dReal fstarttimeaccelmult, int iters, int numIters, bool bCallCallbacks, ShortcutCandidate& candidate)
+    {
+        OPENRAVE_PROFILING_SCOPE("ParabolicSmoother.EvaluateShortcut");
+        candidate.bsuccess = false;
+        candidate.numslowdowns = 0;
+        candidate.iIterProgress = 0;
+        const dReal t1 = candidate.t1, t2 = candidate.t2;
+        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d, shortcutting from t1 = %.15e to t2 = %.15e", GetEnv()->GetId()%iters%numIters%t1%t2);
+        if (t2 - t1 < mintimestep) {
+            RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: the sampled t1 and t2 are too close (mintimestep = %.15e)", GetEnv()->GetId()%iters%numIters%mintimestep);
+            return 0;
+        }
+        int &i1 = candidate.i1, &i2 = candidate.i2;
+        i1 = std::upper_bound(rampStartTime.begin(), rampStartTime.end(), t1) - rampStartTime.begin() - 1;
+        i2 = std::upper_bound(rampStartTime.begin(), rampStartTime.end(), t2) - rampStartTime.begin() - 1;
+
+        uint32_t& iIterProgress = candidate.iIterProgress;
+        dReal &u1 = candidate.u1, &u2 = candidate.u2;
+        dReal &fcurvelmult = candidate.fcurvelmult, &fcuraccelmult = candidate.fcuraccelmult;
+        ParabolicRamp::Vector &x0 = candidate.x0, &x1 = candidate.x1, &dx0 = candidate.dx0, &dx1 = candidate.dx1;
+        ParabolicRamp::DynamicPath &intermediate = _cacheintermediate, &intermediate2 = _cacheintermediate2;
+        std::vector<dReal>& vellimits = candidate.vellimits, &accellimits = candidate.accellimits;
+        std::vector<ParabolicRamp::ParabolicRampND>& accumoutramps = candidate.accumoutramps, &outramps = _cacheoutramps, &outramps2 = _cacheoutramps2;
+        bool bExpectModifiedConfigurations = _parameters->fCosManipAngleThresh > -1 + g_fEpsilonLinear; // gripper constraints enabled
+
+        u1 = t1 - rampStartTime.at(i1);
+        u2 = t2 - rampStartTime.at(i2);
+        OPENRAVE_ASSERT_OP(u1, >=, 0);
+        OPENRAVE_ASSERT_OP(u1, <=, ramps[i1].endTime + ParabolicRamp::EpsilonT);
+        OPENRAVE_ASSERT_OP(u2, >=, 0);
+        OPENRAVE_ASSERT_OP(u2, <=, ramps[i2].endTime + ParabolicRamp::EpsilonT);
+
+        u1 = ParabolicRamp::Min(u1, ramps[i1].endTime);
+        u2 = ParabolicRamp::Min(u2, ramps[i2].endTime);
+        ramps[i1].Evaluate(u1, x0);
+        if (_parameters->SetStateValues(x0) != 0) {
+            RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: setting state at x0 failed", GetEnv()->GetId()%iters%numIters);
+            return 0;
+        }
+        iIterProgress += 0x10000000;
+        _parameters->_getstatefn(x0);
+        iIterProgress += 0x10000000;
+        ramps[i2].Evaluate(u2, x1);
+        iIterProgress += 0x10000000;
+        if (_parameters->SetStateValues(x1) != 0) {
+            RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: setting state at x1 failed", GetEnv()->GetId()%iters%numIters);
+            return 0;
+        }
+        iIterProgress += 0x10000000;
+        _parameters->_getstatefn(x1);
+        ramps[i1].Derivative(u1, dx0);
+        ramps[i2].Derivative(u2, dx1);
+        ++_progress._iteration;
+
+        vellimits = _parameters->_vConfigVelocityLimit;
+        accellimits = _parameters->_vConfigAccelerationLimit;
+
+        // Initial velocity and acceleration scaling.
+        fcurvelmult = fstarttimevelmult;
+        fcuraccelmult = fstarttimeaccelmult;
+        for (size_t j = 0; j < _parameters->_vConfigVelocityLimit.size(); ++j) {
+            // Scale initial velocity and acceleration down but also watch out such that the
+            // new velocity limits (magnitude) does not fall below dx0 and dx1.
+            dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
+            {
+                dReal f = max(fminvel, fstarttimevelmult * _parameters->_vConfigVelocityLimit[j]);
+                if (vellimits[j] > f) {
+                    vellimits[j] = f;
+                }
+            }
+            {
+                dReal f = fstarttimeaccelmult * _parameters->_vConfigAccelerationLimit[j];
+                if (accellimits[j] > f) {
+                    accellimits[j] = f;
+                }
+            }
+        }
+
+        bool bsuccess = false;
+        size_t maxSlowdowns = 4; // will adjust this constant later
+
+        if (0) {
+            if (_parameters->SetStateValues(x0) != 0) {
+                RAVELOG_VERBOSE("state setting error");
+                return 0;
+            }
+            _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx0, vellimits, accellimits);
+            if (_parameters->SetStateValues(x1) != 0) {
+                RAVELOG_VERBOSE("state setting error");
+                return 0;
+            }
+            _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx1, vellimits, accellimits);
+            for (size_t j = 0; j < _parameters->_vConfigVelocityLimit.size(); ++j) {
+                dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
+                if (vellimits[j] < fminvel) {
+                    vellimits[j] = fminvel;
+                }
+            }
+        }
+
+#ifdef OPENRAVE_TIMING_DEBUGGING
+        tloopstart = utils::GetMicroTime();
+#endif
+        size_t islowdowntry = 0;
+        for (islowdowntry = 0; islowdowntry < maxSlowdowns; ++islowdowntry) {
+#ifdef OPENRAVE_TIMING_DEBUGGING
+            tinterpstart = utils::GetMicroTime();
+#endif
+            bool res = ParabolicRamp::SolveMinTime(x0, dx0, x1, dx1, accellimits, vellimits, _parameters->_vConfigLowerLimit, _parameters->_vConfigUpperLimit, intermediate, _parameters->_multidofinterp);
+#ifdef OPENRAVE_TIMING_DEBUGGING
+            tinterpend = utils::GetMicroTime();
+            interpolationtime += 0.000001f*(float)(tinterpend - tinterpstart);
+            ninterpolations += 1;
+#endif
+
+            iIterProgress += 0x1000;
+            if (!res) {
+                // The initial interpolation failed. Continue to the next iteration.
+                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: initial interpolation failed at islowdowntry = %d", GetEnv()->GetId()%iters%numIters%islowdowntry);
+                break;
+            }
+
+            dReal newramptime = intermediate.GetTotalTime();
+            if (newramptime + mintimestep > t2 - t1) {
+                // Reject this shortcut since it did not (and will not) make any significant improvement.
+                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: shortcut did not (and will not) make significant improvement", GetEnv()->GetId()%iters%numIters);
+                break;
+            }
+
+            if (bCallCallbacks && _CallCallbacks(_progress) == PA_Interrupt) {
+                return -1;
+            }
+
+            // The initial interpolation is successful. Now check constraints.
+            iIterProgress += 0x1000;
+            accumoutramps.resize(0);
+            ParabolicRamp::CheckReturn retcheck(0);
+            for (size_t irampnd = 0; irampnd < intermediate.ramps.size(); ++irampnd) {
+                // Anyway, SolveMinTime returns a parabolicpath (intermediate) which consists of only one ParabolicRampsND.
+                iIterProgress += 0x10;
+
+                if (irampnd > 0) { // copied from _Shortcut although unnecessary
+                    intermediate.ramps[irampnd].x0 = intermediate.ramps[irampnd - 1].x1;
+                    intermediate.ramps[irampnd].dx0 = intermediate.ramps[irampnd - 1].dx1;
+                }
+                if (_parameters->SetStateValues(intermediate.ramps[irampnd].x1) != 0) {
+                    retcheck.retcode = CFO_StateSettingError;
+                    break;
+                }
+
+                _parameters->_getstatefn(intermediate.ramps[irampnd].x1); // not sure what this is for.
+                iIterProgress += 0x10;
+                {
+                    OPENRAVE_PROFILING_SCOPE("ParabolicSmoother.CheckRamp");
+                    retcheck = _feasibilitychecker.Check2(intermediate.ramps[irampnd], 0xffff, outramps);
+                }
+
+                iIterProgress += 0x10;
+
+                if (retcheck.retcode != 0) {
+                    break;
+                }
+
+                if (bExpectModifiedConfigurations) {
+                    for (size_t i = 0; i + 1 < outramps.size(); ++i) {
+                        for (size_t j = 0; j < outramps[i].x1.size(); ++j) {
+                            // have to watch out that velocities don't drop under dx0 & dx1!
+                            dReal fminvel = max(RaveFabs(outramps[i].dx0[j]), RaveFabs(outramps[i].dx1[j]));
+                            if( vellimits[j] < fminvel ) {
+                                vellimits[j] = fminvel;
+                            }
+                            // maybe do accel limits depending on (dx1-dx0)/elapsedtime?
+                        }
+                    }
+                }
+
+                // Another consistency checking
+                if (IS_DEBUGLEVEL(Level_Verbose)) {
+                    for(size_t i = 0; i + 1 < outramps.size(); ++i) {
+                        for(size_t j = 0; j < outramps[i].x1.size(); ++j) {
+                            OPENRAVE_ASSERT_OP(RaveFabs(outramps[i].x1[j] - outramps[i + 1].x0[j]), <=, ParabolicRamp::EpsilonX);
+                            OPENRAVE_ASSERT_OP(RaveFabs(outramps[i].dx1[j] - outramps[i + 1].dx0[j]), <=, ParabolicRamp::EpsilonV);
+                        }
+                    }
+                }
+
+                // The interpolated segment passes constraints checking. Now see if it is
+                // modified such that it ends with different velocity.
+                if (retcheck.bDifferentVelocity && outramps.size() > 0) {
+                    ParabolicRamp::ParabolicRampND &outramp = outramps.at(outramps.size() - 1); // the last ParabolicRampND
+                    dReal allowedstretchtime = (t2 - t1) - (newramptime + mintimestep); // the time that the segment is allowed to stretch out such that it is still a useful shortcut
+
+#ifdef OPENRAVE_TIMING_DEBUGGING
+                    tinterpstart = utils::GetMicroTime();
+#endif
+                    bool res = ParabolicRamp::SolveMinTime(outramp.x0, outramp.dx0, intermediate.ramps[irampnd].x1, intermediate.ramps[irampnd].dx1, accellimits, vellimits, _parameters->_vConfigLowerLimit, _parameters->_vConfigUpperLimit, intermediate2, _parameters->_multidofinterp);
+#ifdef OPENRAVE_TIMING_DEBUGGING
+                    tinterpend = utils::GetMicroTime();
+                    interpolationtime += 0.000001f*(float)(tinterpend - tinterpstart);
+                    ninterpolations += 1;
+#endif
+
+                    if (!res) {
+                        RAVELOG_WARN_FORMAT("env = %d: failed to correct velocity discrepancy at the end of the segment", GetEnv()->GetId());
+                        retcheck.retcode = CFO_FinalValuesNotReached;
+                        break;
+                    }
+                    if (RaveFabs(intermediate2.GetTotalTime() - outramp.endTime) > allowedstretchtime) {
+                        RAVELOG_WARN_FORMAT("env = %d: intermediate2 is too long to be useful", GetEnv()->GetId());
+                        retcheck.retcode = CFO_FinalValuesNotReached;
+                        break;
+                    }
+
+                    // Check the newly interpolated segment. Note that intermediate2 should have ramps.size() == 1.
+                    OPENRAVE_ASSERT_OP(intermediate2.ramps.size(), ==, 1);
+                    {
+                        OPENRAVE_PROFILING_SCOPE("ParabolicSmoother.CheckRamp");
+                        retcheck = _feasibilitychecker.Check2(intermediate2.ramps[0], 0xffff, outramps2);
+                    }
+
+                    if (retcheck.retcode == 0) {
+                        // The final segment is now good.
+                        RAVELOG_VERBOSE_FORMAT("env = %d: the final SolveMinTime generated feasible segment, inserting it to outramps", GetEnv()->GetId());
+                        outramps.pop_back();
+                        outramps.insert(outramps.end(), outramps2.begin(), outramps2.end());
+                        break;
+                    }
+                    else if (retcheck.retcode == CFO_CheckTimeBasedConstraints) {
+                        RAVELOG_WARN_FORMAT("env = %d: the final SolveMinTime generated infeasible segment, retcode = 0x%x", GetEnv()->GetId()%retcheck.retcode);
+                        // Stop trying for now since from experience slowing down the ramp further in this case will not result in a more optimal path. Change retcheck.retcode so that it goes to the next sample iteration instead of trying to slow down.
+                        retcheck.retcode = CFO_FinalValuesNotReached;
+                        break;
+                    }
+                    else if (retcheck.bDifferentVelocity) {
+                        // Give up and continue to the next iteration.
+                        RAVELOG_VERBOSE_FORMAT("env = %d: after Check2, intermediate2 does not end at the desired velocity", GetEnv()->GetId());
+                        retcheck.retcode = CFO_FinalValuesNotReached;
+                        break;
+                    }
+                    else {
+                        // The re-interpolated final segment failed from other constraints. Stop trying and just continue to the next iteration.
+                        break;
+                    }
+                }
+                else {
+                    RAVELOG_VERBOSE("env = %d: new shortcut is aligned with boundary values after running Check2");
+                }
+                accumoutramps.insert(accumoutramps.end(), outramps.begin(), outramps.end());
+            }
+            // Finished checking constraints. Now see what retcheck.retcode is.
+            iIterProgress += 0x1000;
+
+            if (retcheck.retcode == 0) {
+                bsuccess = true;
+                break;
+            }
+            else if (retcheck.retcode == CFO_CheckTimeBasedConstraints) {
+                // CFO_CheckTimeBasedConstraints can be returned becasue of two things: torque limit violation and manipulator constraint violation.
+
+                // Modifiy vellimits and accellimits
+                if (_bmanipconstraints && !!_manipconstraintchecker) {
+                    // Manipulator constraints is enabled. Time-based constraint violation is likely because manipulator constraints.
+                    if (islowdowntry == 0) {
+                        // Try computing estimates of velocity and acceleration first before scaling down
+                        {
+                            // Use the original GetMaxVelocitiesAccelerations
+                            if (_parameters->SetStateValues(x0) != 0) {
+                                RAVELOG_VERBOSE("state setting error");
+                                break;
+                            }
+                            _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx0, vellimits, accellimits);
+                            if (_parameters->SetStateValues(x1) != 0) {
+                                RAVELOG_VERBOSE("state setting error");
+                                break;
+                            }
+                            _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx1, vellimits, accellimits);
+
+                            for (size_t j = 0; j < _parameters->_vConfigVelocityLimit.size(); ++j) {
+                                dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
+                                if (vellimits[j] < fminvel) {
+                                    vellimits[j] = fminvel;
+                                }
+                            }
+                        }
+                    }
+                    else {
+                        // After computing the new velocity and acceleration limits and it doesn't work, we gradually scale dof velocities/accelerations down.
+                        dReal fvelmult, faccelmult;
+                        if (retcheck.fMaxManipSpeed > _parameters->maxmanipspeed) {
+                            // If the velocity limit is violated, we don't scale down dof accelerations
+                            fvelmult = retcheck.fTimeBasedSurpassMult;
+                            fcurvelmult *= fvelmult;
+                            if (fcurvelmult < 0.01) {
+                                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurvelmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcurvelmult);
+                                break;
+                            }
+                            for (size_t j = 0; j < accellimits.size(); ++j) {
+                                dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
+                                vellimits[j] = max(fminvel, fvelmult * vellimits[j]);
+                            }
+                        }
+
+                        if (retcheck.fMaxManipAccel > _parameters->maxmanipaccel) {
+                            faccelmult = retcheck.fTimeBasedSurpassMult;
+                            fcuraccelmult *= faccelmult;
+                            if (fcuraccelmult < 0.01) {
+                                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurACCELmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcuraccelmult);
+                                break;
+                            }
+                            {
+                                // If the acceleration limit is violated, we also scale down dof velocities
+                                fvelmult = RaveSqrt(faccelmult); // larger scaling factor, less reduction
+                                fcurvelmult *= fvelmult; // use square root since velocity multipler has to be more than acceleration
+                                if (fcurvelmult < 0.01) {
+                                    RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurvelmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcurvelmult);
+                                    break;
+                                }
+                                for (size_t j = 0; j < accellimits.size(); ++j) {
+                                    dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
+                                    vellimits[j] = max(fminvel, fvelmult * vellimits[j]);
+                                }
+                            }
+                            for (size_t j = 0; j < accellimits.size(); ++j) {
+                                accellimits[j] *= faccelmult;
+                            }
+                        }
+
+                        candidate.numslowdowns += 1;
+                        RAVELOG_VERBOSE_FORMAT("fTimeBasedSurpassMult = %.15e; fcurvelmult = %.15e; fcuraccelmult = %.15e", retcheck.fTimeBasedSurpassMult%fcurvelmult%fcuraccelmult);
+                    }
+                }
+                else {
+                    // Scale vellimits and accellimits down using the usual procedure as in _Shortcut
+                    fcurvelmult *= retcheck.fTimeBasedSurpassMult;
+                    fcuraccelmult *= retcheck.fTimeBasedSurpassMult;
+                    if (fcurvelmult < 0.01) {
+                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurvelmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcurvelmult);
+                        break;
+                    }
+                    if (fcuraccelmult < 0.01) {
+                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurACCELmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcuraccelmult);
+                        break;
+                    }
+
+                    candidate.numslowdowns += 1;
+                    for (size_t j = 0; j < vellimits.size(); ++j) {
+                        dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
+                        vellimits[j] = max(fminvel, retcheck.fTimeBasedSurpassMult * vellimits[j]);
+                        accellimits[j] *= retcheck.fTimeBasedSurpassMult;
+                    }
+                }
+            }
+            else {
+                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: shortcut rejected due to constraints 0x%x", GetEnv()->GetId()%iters%numIters%retcheck.retcode);
+                break;
+            }
+            iIterProgress += 0x1000;
+        }
+#ifdef OPENRAVE_TIMING_DEBUGGING
+        nslowdownloops += (islowdowntry + 1);
+        tloopend = utils::GetMicroTime();
+        slowdownlooptime += 0.000001f*(float)(tloopend - tloopstart);
+#endif
+
+        candidate.bsuccess = bsuccess;
+        return 0;
+    }
+
+    /// \brief checks _vshortcutcandidates of the current ramps with the worker threads
+    void _EvaluateShortcutsParallel(const std::vector<ParabolicRamp::ParabolicRampND>& ramps, const std::vector<dReal>& rampStartTime, dReal mintimestep, dReal fstarttimevelmult, dReal fstarttimeaccelmult, int iters, int numIters)
+    {
+        boost::shared_ptr<ShortcutJob> job(new ShortcutJob(ramps, rampStartTime, _vshortcutcandidates));
+        job->_mintimestep = mintimestep;
+        job->_fstarttimevelmult = fstarttimevelmult;
+        job->_fstarttimeaccelmult = fstarttimeaccelmult;
+        job->_iters = iters;
+        job->_numIters = numIters;
+        _workerpool.Run(boost::bind(&ParabolicSmoother::_RunWorkerJob, this, _1, boost::ref(*job)));
+    }
+
+    /// \brief checks the ramps of a candidate evaluated by a worker with the parameters of this smoother.
+    ///
+    /// The workers only have the default constraints, so this catches anything custom constraint functions would reject.
+    /// The workers already checked the collisions in environments cloned from this one, so they are not checked again; custom functions that change which configurations are collision checked (for example a projecting _neighstatefn) are only checked for their other constraints.
+    bool _RecheckShortcutCandidate(const ShortcutCandidate& candidate)
+    {
+        OPENRAVE_PROFILING_SCOPE("ParabolicSmoother.RecheckShortcut");
+        const int options = 0xffff & ~(CFO_CheckEnvCollisions|CFO_CheckSelfCollisions|CFO_CheckWithPerturbation);
+        FOREACHC(itrampnd, candidate.accumoutramps) {
+            if (_parameters->SetStateValues(itrampnd->x1) != 0) {
+                return false;
+            }
+            ParabolicRamp::CheckReturn retcheck = _feasibilitychecker.Check2(*itrampnd, options, _cacheoutramps);
+            if (retcheck.retcode != 0 || retcheck.bDifferentVelocity || _cacheoutramps.size() != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief sets up this smoother to check shortcuts for master inside of a cloned environment.
+    ///
+    /// The state and constraint functions of the master parameters are bound to the original environment, so they are
+    /// rebuilt from the configuration specification. The limits are kept since they can be set by the user.
+    void _InitShortcutWorker(const ParabolicSmoother& master)
+    {
+        ConstraintTrajectoryTimingParametersPtr parameters(new ConstraintTrajectoryTimingParameters());
+        parameters->copy(master._parameters);
+        parameters->SetConfigurationSpecification(GetEnv(), master._parameters->_configurationspecification);
+        parameters->_vConfigLowerLimit = master._parameters->_vConfigLowerLimit;
+        parameters->_vConfigUpperLimit = master._parameters->_vConfigUpperLimit;
+        parameters->_vConfigVelocityLimit = master._parameters->_vConfigVelocityLimit;
+        parameters->_vConfigAccelerationLimit = master._parameters->_vConfigAccelerationLimit;
+        parameters->_vConfigResolution = master._parameters->_vConfigResolution;
+        parameters->vinitialconfig = master._parameters->vinitialconfig;
+        _parameters = parameters;
+        _InitPlan();
+        _bUsePerturbation = master._bUsePerturbation;
+        _feasibilitychecker.tol = master._feasibilitychecker.tol;
+        _feasibilitychecker.constraintsmask = master._feasibilitychecker.constraintsmask;
+        _dumplevel = master._dumplevel;
+    }
+
+    /// \brief creates the worker threads if necessary and updates the worker environments from the current environment
+    void _SyncWorkers()
+    {
+        if( _vworkers.size() != (size_t)_nNumThreads ) {
+            _StopWorkers();
+            _vworkers.resize(_nNumThreads);
+        }
+        FOREACH(itworker, _vworkers) {
+            SyncWorkerEnvironment(itworker->_penv, GetEnv(), Clone_Bodies);
+            EnvironmentMutex::scoped_lock lockenv(itworker->_penv->GetMutex());
+            if( !itworker->_psmoother ) {
+                std::stringstream ssinput;
+                itworker->_psmoother.reset(new ParabolicSmoother(itworker->_penv, ssinput));
+            }
+            itworker->_psmoother->_InitShortcutWorker(*this);
+        }
+        _workerpool.Start(_vworkers.size());
+    }
+
+    void _StopWorkers()
+    {
+        _workerpool.Stop();
+        FOREACH(itworker, _vworkers) {
+            itworker->_psmoother.reset();
+            if( !!itworker->_penv ) {
+                itworker->_penv->Destroy();
+            }
+        }
+        _vworkers.clear();
+    }
+
+    void _RunWorkerJob(size_t iworker, ShortcutJob& job)
+    {
+        Worker& worker = _vworkers.at(iworker);
+        EnvironmentMutex::scoped_lock lockenv(worker._penv->GetMutex());
+        while(1) {
+            size_t icandidate;
+            {
+                boost::mutex::scoped_lock lock(_mutexWorkers);
+                icandidate = job._nextcandidate++;
+                if( icandidate >= job._vcandidates.size() ) {
+                    break;
+                }
+            }
+            ShortcutCandidate& candidate = job._vcandidates[icandidate];
+            try {
+                worker._psmoother->_EvaluateShortcut2(job._ramps, job._rampStartTime, job._mintimestep, job._fstarttimevelmult, job._fstarttimeaccelmult, job._iters + icandidate, job._numIters, false, candidate);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN_FORMAT("env = %d: exception happened during speculative shortcut iterprogress = 0x%x: %s", worker._penv->GetId()%candidate.iIterProgress%ex.what());
+                candidate.bsuccess = false;
+            }
+        }
+    }
+
     int _Shortcut2(ParabolicRamp::DynamicPath& dynamicpath, int numIters, ParabolicRamp::RandomNumberGeneratorBase *rng, dReal mintimestep) {
 #ifdef OPENRAVE_TIMING_DEBUGGING
         // For time measuring
@@ -1739,8 +2310,6 @@ protected:
         interpolationtime = 0;
         nslowdownloops = 0;
         slowdownlooptime = 0;
-        nchecks = 0;
-        checktime = 0;
 #endif
         uint32_t fileindex;
         if( !!_logginguniformsampler ) {
@@ -1804,13 +2373,6 @@ protected:
             shortcutprogress << originalEndTime << " " << numIters;
         }
 
-        ParabolicRamp::Vector x0, x1, dx0, dx1;
-        ParabolicRamp::DynamicPath &intermediate = _cacheintermediate, &intermediate2 = _cacheintermediate2;
-        std::vector<dReal>& vellimits = _cachevellimits, &accellimits = _cacheaccellimits;
-        vellimits.resize(_parameters->_vConfigVelocityLimit.size());
-        accellimits.resize(_parameters->_vConfigAccelerationLimit.size());
-        std::vector<ParabolicRamp::ParabolicRampND>& accumoutramps = _cacheaccumoutramps, &outramps = _cacheoutramps, &outramps2 = _cacheoutramps2;
-
         dReal fstarttimevelmult = 1.0; // this is the multiplier for scaling down `initial` velocity at each shortcut. If manip constraints or dynamic
                                        // constraints are used, then this will track the most recent successful multiplier. The idea is that if the recent
                                        // successful multiplier some lower value, say 0.1, it is very unlikely that using the full velocity/acceleration
@@ -1830,9 +2392,11 @@ protected:
         uint32_t tshortcutstart = utils::GetMicroTime();
 #endif
         int iters = 0;
-        // For special shortcut
-        dReal specialShortcutWeight = 0.1;
-        dReal specialShortcutCutoffTime = 0.75;
+        // the speculative search cannot follow configurations modified by the constraints since the workers only have the default constraints
+        bool bParallel = _nNumThreads > 1 && !bExpectModifiedConfigurations;
+        if (bParallel) {
+            _SyncWorkers();
+        }
         for (iters = 0; iters < numIters; iters++) {
             nItersFromPrevSuccessful += 1;
             if (nItersFromPrevSuccessful > nCutoffIters) {
@@ -1840,394 +2404,77 @@ protected:
                 break;
             }
 
-            dReal t1, t2;
-            if (iters == 0) {
-                t1 = 0;
-                t2 = endTime;
-            }
-            else if ((_zerovelpoints.size() > 0 && rng->Rand() <= specialShortcutWeight) || (numIters - iters <= (int)_zerovelpoints.size())) {
-                // We consider shortcutting around a zerovelpoint (the time instant of an original waypoint which has not been shortcut) when either
-                // - there are some zerovelpoints left and the random number falls below the threshold, or
-                // - there are some zerovelpoints left but there are not so many shortcut iterations left.
-                size_t index = _uniformsampler->SampleSequenceOneUInt32()%_zerovelpoints.size();
-                dReal t = _zerovelpoints[index];
-                t1 = t - rng->Rand()*min(specialShortcutCutoffTime, t);
-                t2 = t + rng->Rand()*min(specialShortcutCutoffTime, endTime - t);
-            }
-            else {
-                t1 = rng->Rand()*endTime;
-                t2 = rng->Rand()*endTime;
-            }
-            if (t1 > t2) {
-                ParabolicRamp::Swap(t1, t2);
-            }
-            RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d, shortcutting from t1 = %.15e to t2 = %.15e", GetEnv()->GetId()%iters%numIters%t1%t2);
-            if (t2 - t1 < mintimestep) {
-                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: the sampled t1 and t2 are too close (mintimestep = %.15e)", GetEnv()->GetId()%iters%numIters%mintimestep);
-                continue;
-            }
-            int i1 = std::upper_bound(rampStartTime.begin(), rampStartTime.end(), t1) - rampStartTime.begin() - 1;
-            int i2 = std::upper_bound(rampStartTime.begin(), rampStartTime.end(), t2) - rampStartTime.begin() - 1;
-
-            uint32_t iIterProgress = 0;
+            ShortcutCandidate* pcandidate = &_cacheshortcutcandidate;
             try {
-                dReal u1 = t1 - rampStartTime.at(i1);
-                dReal u2 = t2 - rampStartTime.at(i2);
-                OPENRAVE_ASSERT_OP(u1, >=, 0);
-                OPENRAVE_ASSERT_OP(u1, <=, ramps[i1].endTime + ParabolicRamp::EpsilonT);
-                OPENRAVE_ASSERT_OP(u2, >=, 0);
-                OPENRAVE_ASSERT_OP(u2, <=, ramps[i2].endTime + ParabolicRamp::EpsilonT);
-
-                u1 = ParabolicRamp::Min(u1, ramps[i1].endTime);
-                u2 = ParabolicRamp::Min(u2, ramps[i2].endTime);
-                ramps[i1].Evaluate(u1, x0);
-                if (_parameters->SetStateValues(x0) != 0) {
-                    RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: setting state at x0 failed", GetEnv()->GetId()%iters%numIters);
-                    continue;
-                }
-                iIterProgress += 0x10000000;
-                _parameters->_getstatefn(x0);
-                iIterProgress += 0x10000000;
-                ramps[i2].Evaluate(u2, x1);
-                iIterProgress += 0x10000000;
-                if (_parameters->SetStateValues(x1) != 0) {
-                    RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: setting state at x1 failed", GetEnv()->GetId()%iters%numIters);
-                    continue;
-                }
-                iIterProgress += 0x10000000;
-                _parameters->_getstatefn(x1);
-                ramps[i1].Derivative(u1, dx0);
-                ramps[i2].Derivative(u2, dx1);
-                ++_progress._iteration;
-
-                vellimits = _parameters->_vConfigVelocityLimit;
-                accellimits = _parameters->_vConfigAccelerationLimit;
-
-                // Initial velocity and acceleration scaling.
-                dReal fcurvelmult = fstarttimevelmult;
-                dReal fcuraccelmult = fstarttimeaccelmult;
-                for (size_t j = 0; j < _parameters->_vConfigVelocityLimit.size(); ++j) {
-                    // Scale initial velocity and acceleration down but also watch out such that the
-                    // new velocity limits (magnitude) does not fall below dx0 and dx1.
-                    dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
-                    {
-                        dReal f = max(fminvel, fstarttimevelmult * _parameters->_vConfigVelocityLimit[j]);
-                        if (vellimits[j] > f) {
-                            vellimits[j] = f;
-                        }
-                    }
-                    {
-                        dReal f = fstarttimeaccelmult * _parameters->_vConfigAccelerationLimit[j];
-                        if (accellimits[j] > f) {
-                            accellimits[j] = f;
-                        }
-                    }
-                }
-
-                bool bsuccess = false;
-                size_t maxSlowdowns = 4; // will adjust this constant later
-
-                if (0) {
-                    if (_parameters->SetStateValues(x0) != 0) {
-                        RAVELOG_VERBOSE("state setting error");
-                        break;
-                    }
-                    _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx0, vellimits, accellimits);
-                    if (_parameters->SetStateValues(x1) != 0) {
-                        RAVELOG_VERBOSE("state setting error");
-                        break;
+                if (bParallel) {
+                    // Speculatively check the next candidates in the workers. All of them are checked on the current path, so
+                    // only one of them can be committed.
+                    int numcandidates = min(_nNumThreads, numIters - iters);
+                    _vshortcutcandidates.resize(numcandidates);
+                    for (int icandidate = 0; icandidate < numcandidates; ++icandidate) {
+                        _SampleShortcutTimes2(iters + icandidate, numIters, endTime, rng, _vshortcutcandidates[icandidate].t1, _vshortcutcandidates[icandidate].t2);
                     }
-                    _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx1, vellimits, accellimits);
-                    for (size_t j = 0; j < _parameters->_vConfigVelocityLimit.size(); ++j) {
-                        dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
-                        if (vellimits[j] < fminvel) {
-                            vellimits[j] = fminvel;
-                        }
-                    }
-                }
-
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                tloopstart = utils::GetMicroTime();
-#endif
-                size_t islowdowntry = 0;
-                for (islowdowntry = 0; islowdowntry < maxSlowdowns; ++islowdowntry) {
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                    tinterpstart = utils::GetMicroTime();
-#endif
-                    bool res = ParabolicRamp::SolveMinTime(x0, dx0, x1, dx1, accellimits, vellimits, _parameters->_vConfigLowerLimit, _parameters->_vConfigUpperLimit, intermediate, _parameters->_multidofinterp);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                    tinterpend = utils::GetMicroTime();
-                    interpolationtime += 0.000001f*(float)(tinterpend - tinterpstart);
-                    ninterpolations += 1;
-#endif
-
-                    iIterProgress += 0x1000;
-                    if (!res) {
-                        // The initial interpolation failed. Continue to the next iteration.
-                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: initial interpolation failed at islowdowntry = %d", GetEnv()->GetId()%iters%numIters%islowdowntry);
-                        break;
-                    }
-
-                    dReal newramptime = intermediate.GetTotalTime();
-                    if (newramptime + mintimestep > t2 - t1) {
-                        // Reject this shortcut since it did not (and will not) make any significant improvement.
-                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: shortcut did not (and will not) make significant improvement", GetEnv()->GetId()%iters%numIters);
-                        break;
-                    }
-
                     if (_CallCallbacks(_progress) == PA_Interrupt) {
                         return -1;
                     }
-
-                    // The initial interpolation is successful. Now check constraints.
-                    iIterProgress += 0x1000;
-                    accumoutramps.resize(0);
-                    ParabolicRamp::CheckReturn retcheck(0);
-                    for (size_t irampnd = 0; irampnd < intermediate.ramps.size(); ++irampnd) {
-                        // Anyway, SolveMinTime returns a parabolicpath (intermediate) which consists of only one ParabolicRampsND.
-                        iIterProgress += 0x10;
-
-                        if (irampnd > 0) { // copied from _Shortcut although unnecessary
-                            intermediate.ramps[irampnd].x0 = intermediate.ramps[irampnd - 1].x1;
-                            intermediate.ramps[irampnd].dx0 = intermediate.ramps[irampnd - 1].dx1;
-                        }
-                        if (_parameters->SetStateValues(intermediate.ramps[irampnd].x1) != 0) {
-                            retcheck.retcode = CFO_StateSettingError;
-                            break;
-                        }
-
-                        _parameters->_getstatefn(intermediate.ramps[irampnd].x1); // not sure what this is for.
-                        iIterProgress += 0x10;
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                        tcheckstart = utils::GetMicroTime();
-#endif
-                        retcheck = _feasibilitychecker.Check2(intermediate.ramps[irampnd], 0xffff, outramps);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                        tcheckend = utils::GetMicroTime();
-                        checktime += 0.000001f*(float)(tcheckend - tcheckstart);
-                        nchecks += 1;
-#endif
-
-                        iIterProgress += 0x10;
-
-                        if (retcheck.retcode != 0) {
-                            break;
-                        }
-
-                        if (bExpectModifiedConfigurations) {
-                            for (size_t i = 0; i + 1 < outramps.size(); ++i) {
-                                for (size_t j = 0; j < outramps[i].x1.size(); ++j) {
-                                    // have to watch out that velocities don't drop under dx0 & dx1!
-                                    dReal fminvel = max(RaveFabs(outramps[i].dx0[j]), RaveFabs(outramps[i].dx1[j]));
-                                    if( vellimits[j] < fminvel ) {
-                                        vellimits[j] = fminvel;
-                                    }
-                                    // maybe do accel limits depending on (dx1-dx0)/elapsedtime?
+                    _EvaluateShortcutsParallel(ramps, rampStartTime, mintimestep, fstarttimevelmult, fstarttimeaccelmult, iters, numIters);
+                    _progress._iteration += numcandidates;
+
+                    FOREACHC(itcandidate, _vshortcutcandidates) {
+                        numslowdowns += itcandidate->numslowdowns;
+                    }
+                    // Commit the candidate saving the most time that also passes the constraints of the parameters. Ties go to the earliest sample, so the result does not depend on the scheduling.
+                    while (1) {
+                        pcandidate = NULL;
+                        dReal fbestdiff = 0;
+                        FOREACH(itcandidate, _vshortcutcandidates) {
+                            if (itcandidate->bsuccess && itcandidate->accumoutramps.size() > 0) {
+                                dReal diff = itcandidate->t2 - itcandidate->t1;
+                                FOREACHC(itrampnd, itcandidate->accumoutramps) {
+                                    diff -= itrampnd->endTime;
                                 }
-                            }
-                        }
-
-                        // Another consistency checking
-                        if (IS_DEBUGLEVEL(Level_Verbose)) {
-                            for(size_t i = 0; i + 1 < outramps.size(); ++i) {
-                                for(size_t j = 0; j < outramps[i].x1.size(); ++j) {
-                                    OPENRAVE_ASSERT_OP(RaveFabs(outramps[i].x1[j] - outramps[i + 1].x0[j]), <=, ParabolicRamp::EpsilonX);
-                                    OPENRAVE_ASSERT_OP(RaveFabs(outramps[i].dx1[j] - outramps[i + 1].dx0[j]), <=, ParabolicRamp::EpsilonV);
+                                if (!pcandidate || diff > fbestdiff) {
+                                    pcandidate = &*itcandidate;
+                                    fbestdiff = diff;
                                 }
                             }
                         }
-
-                        // The interpolated segment passes constraints checking. Now see if it is
-                        // modified such that it ends with different velocity.
-                        if (retcheck.bDifferentVelocity && outramps.size() > 0) {
-                            ParabolicRamp::ParabolicRampND &outramp = outramps.at(outramps.size() - 1); // the last ParabolicRampND
-                            dReal allowedstretchtime = (t2 - t1) - (newramptime + mintimestep); // the time that the segment is allowed to stretch out such that it is still a useful shortcut
-
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                            tinterpstart = utils::GetMicroTime();
-#endif
-                            bool res = ParabolicRamp::SolveMinTime(outramp.x0, outramp.dx0, intermediate.ramps[irampnd].x1, intermediate.ramps[irampnd].dx1, accellimits, vellimits, _parameters->_vConfigLowerLimit, _parameters->_vConfigUpperLimit, intermediate2, _parameters->_multidofinterp);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                            tinterpend = utils::GetMicroTime();
-                            interpolationtime += 0.000001f*(float)(tinterpend - tinterpstart);
-                            ninterpolations += 1;
-#endif
-
-                            if (!res) {
-                                RAVELOG_WARN_FORMAT("env = %d: failed to correct velocity discrepancy at the end of the segment", GetEnv()->GetId());
-                                retcheck.retcode = CFO_FinalValuesNotReached;
-                                break;
-                            }
-                            if (RaveFabs(intermediate2.GetTotalTime() - outramp.endTime) > allowedstretchtime) {
-                                RAVELOG_WARN_FORMAT("env = %d: intermediate2 is too long to be useful", GetEnv()->GetId());
-                                retcheck.retcode = CFO_FinalValuesNotReached;
-                                break;
-                            }
-
-                            // Check the newly interpolated segment. Note that intermediate2 should have ramps.size() == 1.
-                            OPENRAVE_ASSERT_OP(intermediate2.ramps.size(), ==, 1);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                            tcheckstart = utils::GetMicroTime();
-#endif
-                            retcheck = _feasibilitychecker.Check2(intermediate2.ramps[0], 0xffff, outramps2);
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                            tcheckend = utils::GetMicroTime();
-                            checktime += 0.000001f*(float)(tcheckend - tcheckstart);
-                            nchecks += 1;
-#endif
-
-                            if (retcheck.retcode == 0) {
-                                // The final segment is now good.
-                                RAVELOG_VERBOSE_FORMAT("env = %d: the final SolveMinTime generated feasible segment, inserting it to outramps", GetEnv()->GetId());
-                                outramps.pop_back();
-                                outramps.insert(outramps.end(), outramps2.begin(), outramps2.end());
-                                break;
-                            }
-                            else if (retcheck.retcode == CFO_CheckTimeBasedConstraints) {
-                                RAVELOG_WARN_FORMAT("env = %d: the final SolveMinTime generated infeasible segment, retcode = 0x%x", GetEnv()->GetId()%retcheck.retcode);
-                                // Stop trying for now since from experience slowing down the ramp further in this case will not result in a more optimal path. Change retcheck.retcode so that it goes to the next sample iteration instead of trying to slow down.
-                                retcheck.retcode = CFO_FinalValuesNotReached;
-                                break;
-                            }
-                            else if (retcheck.bDifferentVelocity) {
-                                // Give up and continue to the next iteration.
-                                RAVELOG_VERBOSE_FORMAT("env = %d: after Check2, intermediate2 does not end at the desired velocity", GetEnv()->GetId());
-                                retcheck.retcode = CFO_FinalValuesNotReached;
-                                break;
-                            }
-                            else {
-                                // The re-interpolated final segment failed from other constraints. Stop trying and just continue to the next iteration.
-                                break;
-                            }
-                        }
-                        else {
-                            RAVELOG_VERBOSE("env = %d: new shortcut is aligned with boundary values after running Check2");
+                        if (!pcandidate || _RecheckShortcutCandidate(*pcandidate)) {
+                            break;
                         }
-                        accumoutramps.insert(accumoutramps.end(), outramps.begin(), outramps.end());
+                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: speculative shortcut rejected by the constraints of the parameters", GetEnv()->GetId()%iters%numIters);
+                        pcandidate->bsuccess = false;
                     }
-                    // Finished checking constraints. Now see what retcheck.retcode is.
-                    iIterProgress += 0x1000;
-
-                    if (retcheck.retcode == 0) {
-                        bsuccess = true;
-                        break;
+                    iters += numcandidates - 1;
+                    nItersFromPrevSuccessful += numcandidates - 1;
+                    if (!pcandidate) {
+                        continue;
                     }
-                    else if (retcheck.retcode == CFO_CheckTimeBasedConstraints) {
-                        // CFO_CheckTimeBasedConstraints can be returned becasue of two things: torque limit violation and manipulator constraint violation.
-
-                        // Modifiy vellimits and accellimits
-                        if (_bmanipconstraints && !!_manipconstraintchecker) {
-                            // Manipulator constraints is enabled. Time-based constraint violation is likely because manipulator constraints.
-                            if (islowdowntry == 0) {
-                                // Try computing estimates of velocity and acceleration first before scaling down
-                                {
-                                    // Use the original GetMaxVelocitiesAccelerations
-                                    if (_parameters->SetStateValues(x0) != 0) {
-                                        RAVELOG_VERBOSE("state setting error");
-                                        break;
-                                    }
-                                    _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx0, vellimits, accellimits);
-                                    if (_parameters->SetStateValues(x1) != 0) {
-                                        RAVELOG_VERBOSE("state setting error");
-                                        break;
-                                    }
-                                    _manipconstraintchecker->GetMaxVelocitiesAccelerations(dx1, vellimits, accellimits);
-
-                                    for (size_t j = 0; j < _parameters->_vConfigVelocityLimit.size(); ++j) {
-                                        dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
-                                        if (vellimits[j] < fminvel) {
-                                            vellimits[j] = fminvel;
-                                        }
-                                    }
-                                }
-                            }
-                            else {
-                                // After computing the new velocity and acceleration limits and it doesn't work, we gradually scale dof velocities/accelerations down.
-                                dReal fvelmult, faccelmult;
-                                if (retcheck.fMaxManipSpeed > _parameters->maxmanipspeed) {
-                                    // If the velocity limit is violated, we don't scale down dof accelerations
-                                    fvelmult = retcheck.fTimeBasedSurpassMult;
-                                    fcurvelmult *= fvelmult;
-                                    if (fcurvelmult < 0.01) {
-                                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurvelmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcurvelmult);
-                                        break;
-                                    }
-                                    for (size_t j = 0; j < accellimits.size(); ++j) {
-                                        dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
-                                        vellimits[j] = max(fminvel, fvelmult * vellimits[j]);
-                                    }
-                                }
-
-                                if (retcheck.fMaxManipAccel > _parameters->maxmanipaccel) {
-                                    faccelmult = retcheck.fTimeBasedSurpassMult;
-                                    fcuraccelmult *= faccelmult;
-                                    if (fcuraccelmult < 0.01) {
-                                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurACCELmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcuraccelmult);
-                                        break;
-                                    }
-                                    {
-                                        // If the acceleration limit is violated, we also scale down dof velocities
-                                        fvelmult = RaveSqrt(faccelmult); // larger scaling factor, less reduction
-                                        fcurvelmult *= fvelmult; // use square root since velocity multipler has to be more than acceleration
-                                        if (fcurvelmult < 0.01) {
-                                            RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurvelmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcurvelmult);
-                                            break;
-                                        }
-                                        for (size_t j = 0; j < accellimits.size(); ++j) {
-                                            dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
-                                            vellimits[j] = max(fminvel, fvelmult * vellimits[j]);
-                                        }
-                                    }
-                                    for (size_t j = 0; j < accellimits.size(); ++j) {
-                                        accellimits[j] *= faccelmult;
-                                    }
-                                }
-
-                                numslowdowns += 1;
-                                RAVELOG_VERBOSE_FORMAT("fTimeBasedSurpassMult = %.15e; fcurvelmult = %.15e; fcuraccelmult = %.15e", retcheck.fTimeBasedSurpassMult%fcurvelmult%fcuraccelmult);
-                            }
-                        }
-                        else {
-                            // Scale vellimits and accellimits down using the usual procedure as in _Shortcut
-                            fcurvelmult *= retcheck.fTimeBasedSurpassMult;
-                            fcuraccelmult *= retcheck.fTimeBasedSurpassMult;
-                            if (fcurvelmult < 0.01) {
-                                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurvelmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcurvelmult);
-                                break;
-                            }
-                            if (fcuraccelmult < 0.01) {
-                                RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: fcurACCELmult (%.15e) is too small. continue to the next iteration", GetEnv()->GetId()%iters%numIters%fcuraccelmult);
-                                break;
-                            }
-
-                            numslowdowns += 1;
-                            for (size_t j = 0; j < vellimits.size(); ++j) {
-                                dReal fminvel = max(RaveFabs(dx0[j]), RaveFabs(dx1[j]));
-                                vellimits[j] = max(fminvel, retcheck.fTimeBasedSurpassMult * vellimits[j]);
-                                accellimits[j] *= retcheck.fTimeBasedSurpassMult;
-                            }
-                        }
+                }
+                else {
+                    _SampleShortcutTimes2(iters, numIters, endTime, rng, pcandidate->t1, pcandidate->t2);
+                    int evalret = _EvaluateShortcut2(ramps, rampStartTime, mintimestep, fstarttimevelmult, fstarttimeaccelmult, iters, numIters, true, *pcandidate);
+                    numslowdowns += pcandidate->numslowdowns;
+                    if (evalret < 0) {
+                        return -1;
                     }
-                    else {
-                        RAVELOG_VERBOSE_FORMAT("env = %d: shortcut iter = %d/%d: shortcut rejected due to constraints 0x%x", GetEnv()->GetId()%iters%numIters%retcheck.retcode);
-                        break;
+                    if (!pcandidate->bsuccess) {
+                        continue;
                     }
-                    iIterProgress += 0x1000;
-                }
-#ifdef OPENRAVE_TIMING_DEBUGGING
-                nslowdownloops += (islowdowntry + 1);
-                tloopend = utils::GetMicroTime();
-                slowdownlooptime += 0.000001f*(float)(tloopend - tloopstart);
-#endif
 
-                if (!bsuccess) {
-                    continue;
+                    if (pcandidate->accumoutramps.size() == 0) {
+                        RAVELOG_WARN("accumulated ramps are empty!");
+                        continue;
+                    }
                 }
 
-                if (accumoutramps.size() == 0) {
-                    RAVELOG_WARN("accumulated ramps are empty!");
-                    continue;
-                }
+                dReal t1 = pcandidate->t1, t2 = pcandidate->t2, u1 = pcandidate->u1, u2 = pcandidate->u2;
+                int i1 = pcandidate->i1, i2 = pcandidate->i2;
+                const ParabolicRamp::Vector &x0 = pcandidate->x0, &x1 = pcandidate->x1, &dx0 = pcandidate->dx0, &dx1 = pcandidate->dx1;
+                const std::vector<dReal>& vellimits = pcandidate->vellimits, &accellimits = pcandidate->accellimits;
+                const std::vector<ParabolicRamp::ParabolicRampND>& accumoutramps = pcandidate->accumoutramps;
+                dReal fcurvelmult = pcandidate->fcurvelmult, fcuraccelmult = pcandidate->fcuraccelmult;
+                uint32_t& iIterProgress = pcandidate->iIterProgress;
 
                 // Shortcut is successful. Start inserting the segment into the original dynamicpath.
                 shortcuts++;
@@ -2360,7 +2607,7 @@ protected:
 
             }
             catch(const std::exception &ex) {
-                RAVELOG_WARN_FORMAT("env = %d: exception happened during shortcut iterprogress = 0x%x: %s", GetEnv()->GetId()%iIterProgress%ex.what());
+                RAVELOG_WARN_FORMAT("env = %d: exception happened during shortcut iterprogress = 0x%x: %s", GetEnv()->GetId()%(!!pcandidate ? pcandidate->iIterProgress : 0)%ex.what());
             }
         }
 #ifdef OPENRAVE_TIMING_DEBUGGING
@@ -2390,7 +2637,6 @@ protected:
 
         RAVELOG_VERBOSE_FORMAT("measured %d slow-down loops, %.15e sec. = %.15e sec./loop", nslowdownloops%slowdownlooptime%(slowdownlooptime/nslowdownloops));
         RAVELOG_VERBOSE_FORMAT("measured %d interpolations, %.15e sec. = %.15e sec./interpolation", ninterpolations%interpolationtime%(interpolationtime/ninterpolations));
-        RAVELOG_VERBOSE_FORMAT("measured %d checkings, %.15e sec. = %.15e sec./check", nchecks%checktime%(checktime/nchecks));
 #endif
         _DumpDynamicPath(dynamicpath, _dumplevel, fileindex, 1);
         return shortcuts;
@@ -2532,12 +2778,18 @@ protected:
     int nslowdownloops;
     dReal slowdownlooptime;
     uint32_t tloopstart, tloopend;
-
-    int nchecks;
-    dReal checktime;
-    uint32_t tcheckstart, tcheckend;
+    // the feasibility checks are timed under "ParabolicSmoother.CheckRamp" in RaveGetProfilingStats
 #endif
 
+    //@{ speculative shortcuts
+    ShortcutCandidate _cacheshortcutcandidate; ///< candidate of the serial search
+    std::vector<ShortcutCandidate> _vshortcutcandidates; ///< candidates of one speculative iteration, in sampling order
+    int _nNumThreads; ///< number of worker threads, <= 1 shortcuts serially
+    std::vector<Worker> _vworkers;
+    WorkerThreadPool _workerpool;
+    boost::mutex _mutexWorkers; ///< protects ShortcutJob::_nextcandidate
+    //@}
+
     std::vector<dReal> _zerovelpoints; ///< keeps track of the time instance of the original unshortcutted points of the original trajectory. Whenever we perform a shortcut, have to update this structure.
     bool _usingNewHeuristics;
 };
@@ -1105,11 +1105,23 @@ protected:
             // Finished preparation of waypoints. Now continue to time-parameterize the path.
 
             OPENRAVE_ASSERT_OP(vNewWaypoints[0].size(), ==, ndof);
-            std::vector<RampOptimizer::RampND>& rampndVect = _cacheRampNDVect;
+            // Interpolate all the segments with the full limits at once. _ComputeRampWithZeroVelEndpoints
+            // only recomputes the segments that need scaled down limits.
+            std::vector<dReal>& x0s = _cacheX0s, &x1s = _cacheX1s;
+            x0s.resize((vNewWaypoints.size() - 1)*ndof);
+            x1s.resize((vNewWaypoints.size() - 1)*ndof);
             for (size_t iwaypoint = 1; iwaypoint < vNewWaypoints.size(); ++iwaypoint) {
                 OPENRAVE_ASSERT_OP(vNewWaypoints[iwaypoint].size(), ==, ndof);
+                std::copy(vNewWaypoints[iwaypoint - 1].begin(), vNewWaypoints[iwaypoint - 1].end(), x0s.begin() + (iwaypoint - 1)*ndof);
+                std::copy(vNewWaypoints[iwaypoint].begin(), vNewWaypoints[iwaypoint].end(), x1s.begin() + (iwaypoint - 1)*ndof);
+            }
+            _interpolator.ComputeZeroVelNDTrajectories(x0s, x1s, _parameters->_vConfigVelocityLimit, _parameters->_vConfigAccelerationLimit, _cacheRampNDBatch);
 
-                if( !_ComputeRampWithZeroVelEndpoints(vNewWaypoints[iwaypoint - 1], vNewWaypoints[iwaypoint], options, rampndVect) ) {
+            std::vector<RampOptimizer::RampND>& rampndVect = _cacheRampNDVect;
+            for (size_t iwaypoint = 1; iwaypoint < vNewWaypoints.size(); ++iwaypoint) {
+                rampndVect.resize(0);
+                _cacheRampNDBatch.GetRampNDs(iwaypoint - 1, rampndVect);
+                if( !_ComputeRampWithZeroVelEndpoints(vNewWaypoints[iwaypoint - 1], vNewWaypoints[iwaypoint], options, rampndVect, !rampndVect.empty()) ) {
                     RAVELOG_WARN_FORMAT("env=%d: Failed to time-parameterize path connecting waypoints %d and %d", GetEnv()->GetId()%(iwaypoint - 1)%iwaypoint);
                     return false;
                 }
@@ -1143,7 +1155,11 @@ protected:
     /// velocities. Manip constraints (if available) is also taken care of by gradually scaling
     /// vellimits and accellimits down until the constraints are no longer violated. Therefore, the
     /// output trajectory (rampnd) is guaranteed to feasible.
-    bool _ComputeRampWithZeroVelEndpoints(const std::vector<dReal>& x0VectIn, const std::vector<dReal>& x1VectIn, int options, std::vector<RampOptimizer::RampND>& rampndVectOut)
+    ///
+    /// \param bHasInitialRampNDs if true, rampndVectOut already holds the interpolation with the full
+    /// vellimits and accellimits, for example from ComputeZeroVelNDTrajectories, so the first try
+    /// does not recompute it.
+    bool _ComputeRampWithZeroVelEndpoints(const std::vector<dReal>& x0VectIn, const std::vector<dReal>& x1VectIn, int options, std::vector<RampOptimizer::RampND>& rampndVectOut, bool bHasInitialRampNDs=false)
     {
         // Cache
         std::vector<dReal> &x0Vect = _cacheX0Vect1, &x1Vect = _cacheX1Vect1, &v0Vect = _cacheV0Vect, &v1Vect = _cacheV1Vect;
@@ -1154,8 +1170,10 @@ protected:
         RampOptimizer::CheckReturn retseg(0);
         size_t numTries = 30; // number of times allowed to scale down vellimits and accellimits
         for (size_t itry = 0; itry < numTries; ++itry) {
-            bool res = _interpolator.ComputeZeroVelNDTrajectory(x0VectIn, x1VectIn, vellimits, accellimits, rampndVectOut);
-            BOOST_ASSERT(res);
+            if( itry > 0 || !bHasInitialRampNDs ) {
+                bool res = _interpolator.ComputeZeroVelNDTrajectory(x0VectIn, x1VectIn, vellimits, accellimits, rampndVectOut);
+                BOOST_ASSERT(res);
+            }
 
             size_t irampnd = 0;
             rampndVectOut[0].GetX0Vect(x0Vect);
@@ -1274,6 +1292,7 @@ protected:
         // Main shortcut loop
         int iters = 0;
         for (iters = 0; iters < numIters; ++iters) {
+            OPENRAVE_PROFILING_SCOPE("ParabolicSmoother2.ShortcutIteration");
             if( tTotal < minTimeStep ) {
                 RAVELOG_VERBOSE_FORMAT("env=%d; tTotal = %.15e is too short to continue shortcutting", GetEnv()->GetId()%tTotal);
                 break;
@@ -1827,6 +1846,8 @@ protected:
 
     // in _SetMileStones
     std::vector<std::vector<dReal> > _cacheNewWaypointsVect;
+    std::vector<dReal> _cacheX0s, _cacheX1s; ///< the initial and final positions of all segments, segment-major
+    RampOptimizer::RampNDBatch _cacheRampNDBatch; ///< the RampNDs of all segments with the full limits
 
     // in _ComputeRampWithZeroVelEndpoints
     std::vector<dReal> _cacheX0Vect1, _cacheX1Vect1; ///< need to have another copies of x0 and x1 vectors. For v0 and v1 vectors, we can reuse to ones above.
@@ -50,6 +50,27 @@ void ParabolicInterpolator::Initialize(size_t ndof)
     _cacheCurvesVect.resize(_ndof);
 }
 
+void RampNDBatch::Initialize(size_t numsegments, size_t ndof)
+{
+    _numsegments = numsegments;
+    // Never shrink the buffers so that the RampNDs keep their memory between calls.
+    if( rampnds.size() < 3*numsegments ) {
+        rampnds.resize(3*numsegments);
+    }
+    if( numrampnds.size() < numsegments ) {
+        numrampnds.resize(numsegments);
+        durations.resize(numsegments);
+    }
+    std::fill(numrampnds.begin(), numrampnds.begin() + numsegments, 0);
+    std::fill(durations.begin(), durations.begin() + numsegments, 0);
+}
+
+void RampNDBatch::GetRampNDs(size_t isegment, std::vector<RampND>& rampndVectOut) const
+{
+    OPENRAVE_ASSERT_OP(isegment, <, _numsegments);
+    rampndVectOut.insert(rampndVectOut.end(), rampnds.begin() + 3*isegment, rampnds.begin() + 3*isegment + numrampnds[isegment]);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // ND Trajectory
 bool ParabolicInterpolator::ComputeZeroVelNDTrajectory(const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, std::vector<RampND>& rampndVectOut)
@@ -178,6 +199,155 @@ bool ParabolicInterpolator::ComputeZeroVelNDTrajectory(const std::vector<dReal>&
     return true;
 }
 
+bool ParabolicInterpolator::ComputeZeroVelNDTrajectories(const std::vector<dReal>& x0s, const std::vector<dReal>& x1s, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, RampNDBatch& batchOut, bool bCheck)
+{
+    OPENRAVE_ASSERT_OP(x0s.size()%_ndof, ==, 0);
+    OPENRAVE_ASSERT_OP(x1s.size(), ==, x0s.size());
+    OPENRAVE_ASSERT_OP(vmVect.size(), ==, _ndof);
+    OPENRAVE_ASSERT_OP(amVect.size(), ==, _ndof);
+
+    const size_t ndof = _ndof;
+    const size_t numsegments = x0s.size()/ndof;
+    batchOut.Initialize(numsegments, ndof);
+    if( _cacheSdVel.size() < numsegments ) {
+        _cacheSdVel.resize(numsegments);
+        _cacheSdAccel.resize(numsegments);
+        _cacheSdPeakVel.resize(numsegments);
+        _cacheSdFirstDisplacement.resize(numsegments);
+        _cacheSdDurations.resize(3*numsegments);
+    }
+
+    const dReal* px0 = numsegments > 0 ? &x0s[0] : NULL;
+    const dReal* px1 = numsegments > 0 ? &x1s[0] : NULL;
+    const dReal* pvm = &vmVect[0];
+    const dReal* pam = &amVect[0];
+
+    // Find the limiting velocity and acceleration of every segment the same way as
+    // ComputeZeroVelNDTrajectory. The inner loop has no data-dependent branches so that it can be
+    // vectorized across the DOFs.
+    for (size_t isegment = 0; isegment < numsegments; ++isegment) {
+        const dReal* px0seg = px0 + isegment*ndof;
+        const dReal* px1seg = px1 + isegment*ndof;
+        dReal vMin = g_fRampInf;
+        dReal aMin = g_fRampInf;
+        for (size_t idof = 0; idof < ndof; ++idof) {
+            dReal dinv = Abs(1/(px1seg[idof] - px0seg[idof]));
+            bool bmoving = !FuzzyZero(px1seg[idof] - px0seg[idof], g_fRampEpsilon);
+            vMin = Min(vMin, bmoving ? pvm[idof]*dinv : g_fRampInf);
+            aMin = Min(aMin, bmoving ? pam[idof]*dinv : g_fRampInf);
+        }
+        _cacheSdVel[isegment] = vMin;
+        _cacheSdAccel[isegment] = aMin;
+    }
+
+    // Compute the sd-profiles (from (0, 0) to (1, 0)) of all segments. This is what
+    // Compute1DTrajectory(0, 1, 0, 0, vMin, aMin) computes, written out in closed form.
+    bool bsuccess = true;
+    for (size_t isegment = 0; isegment < numsegments; ++isegment) {
+        dReal vm = _cacheSdVel[isegment], am = _cacheSdAccel[isegment];
+        dReal* pdurations = &_cacheSdDurations[3*isegment];
+        if( !(vm < g_fRampInf && am < g_fRampInf) ) {
+            // Displacements are zero.
+            batchOut.numrampnds[isegment] = 1;
+            pdurations[0] = pdurations[1] = pdurations[2] = 0;
+            continue;
+        }
+        if( !(vm > 0 && am > 0) ) {
+            batchOut.numrampnds[isegment] = 0;
+            bsuccess = false;
+            continue;
+        }
+
+        dReal vp = Sqrt(am);
+        dReal aminv = 1/am;
+        if( vp > vm + g_fRampEpsilon ) {
+            // The peak velocity exceeds the bound so add a middle ramp
+            dReal h = vp - vm;
+            dReal t = h*aminv;
+            pdurations[0] = vp*aminv - t;
+            pdurations[1] = 2*t + ((h*h)/(am*vm));
+            pdurations[2] = vp*aminv - t;
+            _cacheSdPeakVel[isegment] = vm;
+            batchOut.numrampnds[isegment] = 3;
+        }
+        else {
+            pdurations[0] = vp*aminv;
+            pdurations[1] = vp*aminv;
+            pdurations[2] = 0;
+            _cacheSdPeakVel[isegment] = am*pdurations[0];
+            batchOut.numrampnds[isegment] = 2;
+        }
+        _cacheSdFirstDisplacement[isegment] = pdurations[0]*(0.5*am*pdurations[0]);
+    }
+
+    // Map the sd-profiles to joint velocity profiles
+    std::vector<dReal>& vzero = _cacheVect;
+    std::fill(vzero.begin(), vzero.end(), 0);
+    for (size_t isegment = 0; isegment < numsegments; ++isegment) {
+        const int numrampnds = batchOut.numrampnds[isegment];
+        if( numrampnds == 0 ) {
+            continue;
+        }
+        const dReal* px0seg = px0 + isegment*ndof;
+        const dReal* px1seg = px1 + isegment*ndof;
+        const dReal* pdurations = &_cacheSdDurations[3*isegment];
+        RampND* prampnds = &batchOut.rampnds[3*isegment];
+        for (int irampnd = 0; irampnd < numrampnds; ++irampnd) {
+            // Initialize and fill rampnd._data with zeros
+            prampnds[irampnd].Initialize(ndof);
+            prampnds[irampnd].SetDuration(pdurations[irampnd]);
+        }
+        batchOut.durations[isegment] = pdurations[0] + pdurations[1] + pdurations[2];
+
+        if( numrampnds == 1 ) {
+            for (size_t idof = 0; idof < ndof; ++idof) {
+                prampnds[0].GetX0At(idof) = px0seg[idof];
+                prampnds[0].GetX1At(idof) = px0seg[idof];
+            }
+        }
+        else {
+            RampND& firstrampnd = prampnds[0];
+            RampND& lastrampnd = prampnds[numrampnds - 1];
+            const dReal sdvel = _cacheSdPeakVel[isegment], sdaccel = _cacheSdAccel[isegment];
+            const dReal sdswitch = numrampnds == 2 ? 0.5 : _cacheSdFirstDisplacement[isegment];
+            for (size_t idof = 0; idof < ndof; ++idof) {
+                dReal d = px1seg[idof] - px0seg[idof];
+                dReal v = d*sdvel;
+                dReal a = d*sdaccel;
+                firstrampnd.GetX0At(idof) = px0seg[idof];
+                firstrampnd.GetX1At(idof) = d*sdswitch + px0seg[idof];
+                firstrampnd.GetV1At(idof) = v;
+                firstrampnd.GetAAt(idof) = a;
+                lastrampnd.GetX0At(idof) = numrampnds == 2 ? d*sdswitch + px0seg[idof] : -(d*sdswitch - px1seg[idof]);
+                lastrampnd.GetX1At(idof) = px1seg[idof];
+                lastrampnd.GetV0At(idof) = v;
+                lastrampnd.GetAAt(idof) = -a;
+            }
+            if( numrampnds == 3 ) {
+                RampND& middlerampnd = prampnds[1];
+                for (size_t idof = 0; idof < ndof; ++idof) {
+                    middlerampnd.GetX0At(idof) = firstrampnd.GetX1At(idof);
+                    middlerampnd.GetX1At(idof) = lastrampnd.GetX0At(idof);
+                    middlerampnd.GetV0At(idof) = firstrampnd.GetV1At(idof);
+                    middlerampnd.GetV1At(idof) = firstrampnd.GetV1At(idof);
+                }
+            }
+        }
+
+        if( bCheck && numrampnds > 1 ) {// Check RampNDs of this segment
+            std::vector<dReal>& x0Vect = _cacheX0Vect, &x1Vect = _cacheX1Vect;
+            std::copy(px0seg, px0seg + ndof, x0Vect.begin());
+            std::copy(px1seg, px1seg + ndof, x1Vect.begin());
+            ParabolicCheckReturn ret = CheckRampNDs(batchOut.rampnds.begin() + 3*isegment, numrampnds, std::vector<dReal>(), std::vector<dReal>(), vmVect, amVect, x0Vect, x1Vect, vzero, vzero);
+            if( ret != PCR_Normal ) {
+                batchOut.numrampnds[isegment] = 0;
+                bsuccess = false;
+            }
+        }
+    }
+    return bsuccess;
+}
+
 bool ParabolicInterpolator::ComputeArbitraryVelNDTrajectory(const std::vector<dReal>&x0Vect, const std::vector<dReal>&x1Vect, const std::vector<dReal>&v0Vect, const std::vector<dReal>&v1Vect, const std::vector<dReal>&xminVect, const std::vector<dReal>&xmaxVect, const std::vector<dReal>&vmVect, const std::vector<dReal>&amVect, std::vector<RampND>&rampndVectOut, bool tryHarder)
 {
     OPENRAVE_ASSERT_OP(x0Vect.size(), ==, _ndof);
@@ -20,6 +20,37 @@ namespace OpenRAVE {
 
 namespace RampOptimizerInternal {
 
+/**
+   \brief Caller-owned storage for the results of ParabolicInterpolator::ComputeZeroVelNDTrajectories.
+
+   The RampNDs of segment isegment are rampnds[3*isegment], ..., rampnds[3*isegment +
+   numrampnds[isegment] - 1]. The buffers only grow, so reusing the same batch for many calls with
+   the same number of DOFs does not allocate any memory once it has been sized for the largest call.
+ */
+class RampNDBatch {
+public:
+    RampNDBatch() : _numsegments(0) {
+    }
+
+    /// \brief Prepare the batch for numsegments segments with ndof DOFs each.
+    void Initialize(size_t numsegments, size_t ndof);
+
+    inline size_t GetNumSegments() const
+    {
+        return _numsegments;
+    }
+
+    /// \brief Append the RampNDs of segment isegment to rampndVectOut.
+    void GetRampNDs(size_t isegment, std::vector<RampND>& rampndVectOut) const;
+
+    std::vector<RampND> rampnds; ///< 3 RampNDs reserved for every segment
+    std::vector<int> numrampnds; ///< number of RampNDs of every segment, 0 if the segment could not be interpolated
+    std::vector<dReal> durations; ///< total duration of every segment
+
+private:
+    size_t _numsegments;
+};
+
 class ParabolicInterpolator {
 public:
     /*
@@ -51,6 +82,30 @@ public:
      */
     bool ComputeZeroVelNDTrajectory(const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, std::vector<RampND>& rampndVectOut);
 
+    /**
+       \brief Batched version of ComputeZeroVelNDTrajectory for many independent segments sharing
+       the same velocity and acceleration limits. The results are the same as calling
+       ComputeZeroVelNDTrajectory on every segment.
+
+       Instead of going through a ParabolicCurve for every segment, the sd-profiles of all segments
+       are computed in closed form in one pass over the segments, and the RampNDs are written
+       directly into the caller-owned batchOut.
+
+       Only the zero velocity interpolation is batched. ComputeArbitraryVelNDTrajectory and
+       ComputeNDTrajectoryFixedDuration are not, their callers interpolate and check one segment
+       at a time.
+
+       \param x0s initial positions of all segments, segment-major: the initial position of
+       segment isegment is x0s[isegment*ndof], ..., x0s[isegment*ndof + ndof - 1]
+       \param x1s final positions of all segments, same layout as x0s
+       \param vmVect velocity limits
+       \param amVect acceleration limits
+       \param batchOut the resulting RampNDs. The RampNDs of segments which cannot be interpolated are left empty.
+       \param bCheck if true, check the RampNDs of every segment as ComputeZeroVelNDTrajectory does
+       \return true if all the segments are successfully interpolated
+     */
+    bool ComputeZeroVelNDTrajectories(const std::vector<dReal>& x0s, const std::vector<dReal>& x1s, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, RampNDBatch& batchOut, bool bCheck=true);
+
     /**
        \brief Compute an ND trajectory which interpolates (x0Vect, v0Vect) and (x1Vect, v1Vect)
        while respecting velocity and acceleration limits, as well as joint limits.
@@ -201,6 +256,11 @@ private:
     std::vector<Ramp> _cacheRampsVect2; // for using in Compute1DTrajectoryFixedDuration
     ParabolicCurve _cacheCurve;
     std::vector<ParabolicCurve> _cacheCurvesVect;
+
+    // for ComputeZeroVelNDTrajectories. sd-profile of every segment
+    std::vector<dReal> _cacheSdVel, _cacheSdAccel; ///< velocity and acceleration limits of s
+    std::vector<dReal> _cacheSdDurations; ///< 3 durations for each segment, the last one is 0 if the profile has only 2 ramps
+    std::vector<dReal> _cacheSdPeakVel, _cacheSdFirstDisplacement; ///< velocity at the first switch point and s at the first switch point
 };
 
 } // end namespace RampOptimizerInternal
@@ -0,0 +1,118 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2016 Puttichai Lertkultanon & Rosen Diankov
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the
+// GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+// of the License, or at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+// even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along with this program.
+// If not, see <http://www.gnu.org/licenses/>.
+
+/// \brief compares ParabolicInterpolator::ComputeZeroVelNDTrajectories with calling ComputeZeroVelNDTrajectory for every segment, for speed and for bitwise equality of the RampNDs.
+///
+/// usage: interpolatorbenchmark [numsegments] [numiterations]
+#include "openraveplugindefs.h"
+#include "interpolator.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <cstdlib>
+#include <iostream>
+
+using namespace OpenRAVE;
+using namespace OpenRAVE::RampOptimizerInternal;
+using namespace std;
+
+static bool AreRampNDsEqual(const RampND& rampnd0, const RampND& rampnd1)
+{
+    if( rampnd0.GetDOF() != rampnd1.GetDOF() || rampnd0.GetDuration() != rampnd1.GetDuration() ) {
+        return false;
+    }
+    for(size_t idof = 0; idof < rampnd0.GetDOF(); ++idof) {
+        if( rampnd0.GetX0At(idof) != rampnd1.GetX0At(idof) || rampnd0.GetX1At(idof) != rampnd1.GetX1At(idof) || rampnd0.GetV0At(idof) != rampnd1.GetV0At(idof) || rampnd0.GetV1At(idof) != rampnd1.GetV1At(idof) || rampnd0.GetAAt(idof) != rampnd1.GetAAt(idof) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static dReal RandomReal(dReal fmin, dReal fmax)
+{
+    return fmin + (fmax-fmin)*(dReal)rand()/(dReal)RAND_MAX;
+}
+
+int main(int argc, char ** argv)
+{
+    const size_t ndof = 7;
+    size_t numsegments = argc > 1 ? atoi(argv[1]) : 2000;
+    int numiterations = argc > 2 ? atoi(argv[2]) : 50;
+    numsegments = max(numsegments, (size_t)8);
+    RaveInitialize(false, Level_Error);
+
+    srand(1);
+    std::vector<dReal> vmVect(ndof), amVect(ndof), x0s(numsegments*ndof), x1s(numsegments*ndof);
+    for(size_t idof = 0; idof < ndof; ++idof) {
+        vmVect[idof] = RandomReal(0.5, 1.5);
+        amVect[idof] = RandomReal(1, 6);
+    }
+    for(size_t i = 0; i < x0s.size(); ++i) {
+        x0s[i] = RandomReal(-2, 2);
+        // some DOFs do not move
+        x1s[i] = rand()%5 == 0 ? x0s[i] : RandomReal(-2, 2);
+    }
+    // a segment that does not move at all, a very short one, and a long one that reaches the velocity limits
+    for(size_t idof = 0; idof < ndof; ++idof) {
+        x1s[5*ndof+idof] = x0s[5*ndof+idof];
+        x1s[6*ndof+idof] = x0s[6*ndof+idof] + 0.01;
+        x1s[7*ndof+idof] = x0s[7*ndof+idof] + 50;
+    }
+
+    ParabolicInterpolator interpolator(ndof), batchinterpolator(ndof);
+    RampNDBatch batch;
+    std::vector<dReal> x0Vect(ndof), x1Vect(ndof);
+    std::vector<RampND> rampnds, batchrampnds;
+
+    bool bsuccess = batchinterpolator.ComputeZeroVelNDTrajectories(x0s, x1s, vmVect, amVect, batch);
+    size_t nummismatches = 0;
+    for(size_t isegment = 0; isegment < numsegments; ++isegment) {
+        std::copy(x0s.begin() + isegment*ndof, x0s.begin() + (isegment+1)*ndof, x0Vect.begin());
+        std::copy(x1s.begin() + isegment*ndof, x1s.begin() + (isegment+1)*ndof, x1Vect.begin());
+        bool bsegmentsuccess = interpolator.ComputeZeroVelNDTrajectory(x0Vect, x1Vect, vmVect, amVect, rampnds);
+        batchrampnds.clear();
+        batch.GetRampNDs(isegment, batchrampnds);
+        bool bequal = bsegmentsuccess && rampnds.size() == batchrampnds.size();
+        for(size_t irampnd = 0; bequal && irampnd < rampnds.size(); ++irampnd) {
+            bequal = AreRampNDsEqual(rampnds[irampnd], batchrampnds[irampnd]);
+        }
+        if( !bequal ) {
+            ++nummismatches;
+        }
+    }
+    if( !bsuccess || nummismatches > 0 ) {
+        cout << "ComputeZeroVelNDTrajectories differs from ComputeZeroVelNDTrajectory in " << nummismatches << "/" << numsegments << " segments" << endl;
+    }
+
+    for(int icheck = 1; icheck >= 0; --icheck) {
+        boost::posix_time::ptime starttime = boost::posix_time::microsec_clock::universal_time();
+        for(int iter = 0; iter < numiterations; ++iter) {
+            for(size_t isegment = 0; isegment < numsegments; ++isegment) {
+                std::copy(x0s.begin() + isegment*ndof, x0s.begin() + (isegment+1)*ndof, x0Vect.begin());
+                std::copy(x1s.begin() + isegment*ndof, x1s.begin() + (isegment+1)*ndof, x1Vect.begin());
+                interpolator.ComputeZeroVelNDTrajectory(x0Vect, x1Vect, vmVect, amVect, rampnds);
+            }
+        }
+        boost::posix_time::ptime midtime = boost::posix_time::microsec_clock::universal_time();
+        for(int iter = 0; iter < numiterations; ++iter) {
+            batchinterpolator.ComputeZeroVelNDTrajectories(x0s, x1s, vmVect, amVect, batch, !!icheck);
+        }
+        boost::posix_time::ptime endtime = boost::posix_time::microsec_clock::universal_time();
+        double fsegments = double(numiterations)*numsegments;
+        double fpersegment = (midtime-starttime).total_microseconds()/fsegments, fbatch = (endtime-midtime).total_microseconds()/fsegments;
+        cout << "check=" << icheck << ": per segment=" << fpersegment << "us, batch=" << fbatch << "us, speedup=" << (fbatch > 0 ? fpersegment/fbatch : 0) << endl;
+    }
+    RaveDestroy();
+    return bsuccess && nummismatches == 0 ? 0 : 1;
+}
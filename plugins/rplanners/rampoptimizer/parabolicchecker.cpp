@@ -189,9 +189,13 @@ ParabolicCheckReturn CheckRampND(const RampND& rampnd, const std::vector<dReal>&
 }
 
 ParabolicCheckReturn CheckRampNDs(const std::vector<RampND>& rampnds, const std::vector<dReal>& xminVect, const std::vector<dReal>& xmaxVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect)
+{
+    return CheckRampNDs(rampnds.begin(), rampnds.size(), xminVect, xmaxVect, vmVect, amVect, x0Vect, x1Vect, v0Vect, v1Vect);
+}
+
+ParabolicCheckReturn CheckRampNDs(std::vector<RampND>::const_iterator rampnds, size_t nrampnds, const std::vector<dReal>& xminVect, const std::vector<dReal>& xmaxVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect)
 {
     size_t ndof = rampnds[0].GetDOF();
-    size_t nrampnds = rampnds.size();
 
     // Check the first RampND
     for (size_t idof = 0; idof < ndof; ++idof) {
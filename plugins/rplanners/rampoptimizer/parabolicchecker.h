@@ -50,6 +50,9 @@ ParabolicCheckReturn CheckRampND(const RampND& rampnd, const std::vector<dReal>&
 /// \brief Check a vector of RampNDs
 ParabolicCheckReturn CheckRampNDs(const std::vector<RampND>& rampnds, const std::vector<dReal>& xminVect, const std::vector<dReal>& xmaxVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect);
 
+/// \brief Check the nrampnds consecutive RampNDs starting at rampnds
+ParabolicCheckReturn CheckRampNDs(std::vector<RampND>::const_iterator rampnds, size_t nrampnds, const std::vector<dReal>& xminVect, const std::vector<dReal>& xmaxVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect);
+
 } // end namespace RampOptimizerInternal
 
 } // end namespace OpenRAVE
@@ -119,6 +119,21 @@ public:
     /// returns the nearest neighbor
     virtual std::pair<NodeBasePtr, dReal> FindNearestNode(const vector<dReal>& q) const = 0;
 
+    /// \brief finds the k nearest neighbors of a batch of configurations
+    ///
+    /// \param vqueries numqueries*GetDOF() values, the configurations to query
+    /// \param k the number of neighbors to return for each query
+    /// \param vnearest filled with numqueries*k entries, the neighbors of query i are at [i*k, (i+1)*k) sorted by increasing distance. If there are less than k nodes, the remaining entries have a NULL node and infinite distance.
+    /// \param fApproxEpsilon if > 0, the j-th returned neighbor is at most (1+fApproxEpsilon) times farther than the true j-th neighbor. This prunes more of the tree.
+    virtual void FindKNearestNodes(const std::vector<dReal>& vqueries, int k, std::vector< std::pair<NodeBasePtr, dReal> >& vnearest, dReal fApproxEpsilon=0) const = 0;
+
+    /// \brief finds all the nodes within a radius of a batch of configurations
+    ///
+    /// \param vqueries numqueries*GetDOF() values, the configurations to query
+    /// \param radius the maximum distance of the returned nodes (inclusive)
+    /// \param vvnodes vvnodes[i] is filled with the nodes within radius of query i sorted by increasing distance
+    virtual void FindNodesInRadius(const std::vector<dReal>& vqueries, dReal radius, std::vector< std::vector< std::pair<NodeBasePtr, dReal> > >& vvnodes) const = 0;
+
     /// \brief returns a temporary config stored on the local class. Next time this function is called, it will overwrite the config
     virtual const vector<dReal>& GetVectorConfig(NodeBasePtr node) const = 0;
 
@@ -214,7 +229,7 @@ public:
 
     inline dReal _ComputeDistance(const dReal* config0, const dReal* config1) const
     {
-        return _distmetricfn(VectorWrapper<const dReal>(config0, config0+_dof), VectorWrapper<dReal>(config1, config1+_dof));
+        return _distmetricfn(VectorWrapper<dReal>(config0, config0+_dof), VectorWrapper<dReal>(config1, config1+_dof));
     }
 
     inline dReal _ComputeDistance(const dReal* config0, const std::vector<dReal>& config1) const
@@ -232,6 +247,43 @@ public:
         return _FindNearestNode(vquerystate);
     }
 
+    virtual void FindKNearestNodes(const std::vector<dReal>& vqueries, int k, std::vector< std::pair<NodeBasePtr, dReal> >& vnearest, dReal fApproxEpsilon=0) const
+    {
+        OPENRAVE_ASSERT_OP(k,>,0);
+        OPENRAVE_ASSERT_OP(fApproxEpsilon,>=,0);
+        OPENRAVE_ASSERT_OP((int)(vqueries.size()%_dof),==,0);
+        size_t numqueries = vqueries.size()/_dof;
+        vnearest.resize(numqueries*k);
+        std::vector< std::pair<NodePtr, dReal> > vquerynearest, vcurrentlevelnodes, vnextlevelnodes;
+        vquerynearest.reserve(k+1);
+        for(size_t iquery = 0; iquery < numqueries; ++iquery) {
+            _FindNearestNodes(&vqueries[iquery*_dof], k, std::numeric_limits<dReal>::infinity(), fApproxEpsilon, vquerynearest, vcurrentlevelnodes, vnextlevelnodes);
+            for(int j = 0; j < k; ++j) {
+                if( j < (int)vquerynearest.size() ) {
+                    vnearest[iquery*k+j] = std::make_pair(NodeBasePtr(vquerynearest[j].first), vquerynearest[j].second);
+                }
+                else {
+                    vnearest[iquery*k+j] = std::make_pair(NodeBasePtr(NULL), std::numeric_limits<dReal>::infinity());
+                }
+            }
+        }
+    }
+
+    virtual void FindNodesInRadius(const std::vector<dReal>& vqueries, dReal radius, std::vector< std::vector< std::pair<NodeBasePtr, dReal> > >& vvnodes) const
+    {
+        OPENRAVE_ASSERT_OP((int)(vqueries.size()%_dof),==,0);
+        size_t numqueries = vqueries.size()/_dof;
+        vvnodes.resize(numqueries);
+        std::vector< std::pair<NodePtr, dReal> > vquerynearest, vcurrentlevelnodes, vnextlevelnodes;
+        for(size_t iquery = 0; iquery < numqueries; ++iquery) {
+            _FindNearestNodes(&vqueries[iquery*_dof], 0, radius, 0, vquerynearest, vcurrentlevelnodes, vnextlevelnodes);
+            vvnodes[iquery].resize(vquerynearest.size());
+            for(size_t j = 0; j < vquerynearest.size(); ++j) {
+                vvnodes[iquery][j] = std::make_pair(NodeBasePtr(vquerynearest[j].first), vquerynearest[j].second);
+            }
+        }
+    }
+
     virtual NodeBasePtr InsertNode(NodeBasePtr parent, const vector<dReal>& config, uint32_t userdata)
     {
         return _InsertNode((NodePtr)parent, config, userdata);
@@ -661,6 +713,89 @@ private:
         return bestnode;
     }
 
+    /// \brief gathers the nearest nodes of one query by traversing the cover tree
+    ///
+    /// Only uses the passed in buffers, so it does not modify any state of the tree.
+    /// \param k if > 0, vnearest holds the k nearest nodes. Otherwise vnearest holds all nodes within fRadius.
+    /// \param vnearest filled with the nodes sorted by increasing distance. A clone of a node at the level below it is not returned, so every RRT node is returned at most once.
+    void _FindNearestNodes(const dReal* pquery, int k, dReal fRadius, dReal fApproxEpsilon, std::vector< std::pair<NodePtr, dReal> >& vnearest, std::vector< std::pair<NodePtr, dReal> >& vcurrentlevelnodes, std::vector< std::pair<NodePtr, dReal> >& vnextlevelnodes) const
+    {
+        vnearest.resize(0);
+        if( _numnodes == 0 ) {
+            return;
+        }
+        const dReal fPruneMult = 1/(1+fApproxEpsilon);
+        // use the same level bound as _FindNearestNode so that k=1 returns the same node
+        dReal fLevelBound = _fMaxLevelBound;
+        NodePtr rootnode = *_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin();
+        vcurrentlevelnodes.resize(1);
+        vcurrentlevelnodes[0] = std::make_pair(rootnode, _ComputeDistance(rootnode->q, pquery));
+        _AddNearestCandidate(vcurrentlevelnodes[0], k, fRadius, vnearest);
+        while(vcurrentlevelnodes.size() > 0 ) {
+            vnextlevelnodes.resize(0);
+            FOREACH(itcurrentnode, vcurrentlevelnodes) {
+                FOREACHC(itchild, itcurrentnode->first->_vchildren) {
+                    std::pair<NodePtr, dReal> child(*itchild, _ComputeDistance((*itchild)->q, pquery));
+                    if( !_IsSelfChild(*itcurrentnode, child) ) {
+                        _AddNearestCandidate(child, k, fRadius, vnearest);
+                    }
+                    if( child.first->_vchildren.size() > 0 ) {
+                        vnextlevelnodes.push_back(child);
+                    }
+                }
+            }
+
+            dReal fSearchDist = fRadius;
+            if( k > 0 ) {
+                fSearchDist = (int)vnearest.size() >= k ? vnearest.back().second : std::numeric_limits<dReal>::infinity();
+            }
+            dReal ftestbound = fSearchDist*fPruneMult + fLevelBound;
+            vcurrentlevelnodes.resize(0);
+            FOREACH(itnode, vnextlevelnodes) {
+                if( itnode->second <= ftestbound ) {
+                    vcurrentlevelnodes.push_back(*itnode);
+                }
+            }
+            fLevelBound *= _fBaseInv;
+        }
+
+        if( k <= 0 ) {
+            std::sort(vnearest.begin(), vnearest.end(), _CompareNodeDistance);
+        }
+    }
+
+    /// \brief returns true if child is the clone of parent in the level below it, with the same test as _Remove. The distances are to the same query, so they can only differ by the distance between the nodes.
+    inline bool _IsSelfChild(const std::pair<NodePtr, dReal>& parent, const std::pair<NodePtr, dReal>& child) const
+    {
+        return parent.first->_hasselfchild && RaveFabs(parent.second - child.second) <= _mindistance && _ComputeDistance(parent.first, child.first) <= _mindistance;
+    }
+
+    /// \brief adds a node to the sorted k nearest nodes, or to the nodes within fRadius if k <= 0
+    inline void _AddNearestCandidate(const std::pair<NodePtr, dReal>& candidate, int k, dReal fRadius, std::vector< std::pair<NodePtr, dReal> >& vnearest) const
+    {
+        if( !candidate.first->_usenn ) {
+            return;
+        }
+        if( k <= 0 ) {
+            if( candidate.second <= fRadius ) {
+                vnearest.push_back(candidate);
+            }
+            return;
+        }
+        if( (int)vnearest.size() >= k && candidate.second >= vnearest.back().second ) {
+            return;
+        }
+        vnearest.insert(std::upper_bound(vnearest.begin(), vnearest.end(), candidate, _CompareNodeDistance), candidate);
+        if( (int)vnearest.size() > k ) {
+            vnearest.pop_back();
+        }
+    }
+
+    static bool _CompareNodeDistance(const std::pair<NodePtr, dReal>& p0, const std::pair<NodePtr, dReal>& p1)
+    {
+        return p0.second < p1.second;
+    }
+
     NodePtr _InsertNode(NodePtr parent, const vector<dReal>& config, uint32_t userdata)
     {
         NodePtr newnode = _CreateNode(parent, config, userdata);
@@ -381,6 +381,7 @@ Some python code to display data::\n\
         while(_vgoalpaths.size() < _parameters->_minimumgoalpaths && iter < 3*_parameters->_nMaxIterations) {
             RAVELOG_VERBOSE_FORMAT("env=%d, iter=%d, forward=%d, backward=%d", GetEnv()->GetId()%(iter/3)%_treeForward.GetNumNodes()%_treeBackward.GetNumNodes());
             ++iter;
+            OPENRAVE_PROFILING_SCOPE("BirrtPlanner.Iteration");
 
             // have to check callbacks at the beginning since code can continue
             callbackaction = _CallCallbacks(progress);
@@ -743,6 +744,7 @@ public:
         
         while(iter < _parameters->_nMaxIterations) {
             iter++;
+            OPENRAVE_PROFILING_SCOPE("BasicRrtPlanner.Iteration");
             if( !!bestGoalNode && iter >= _parameters->_nMinIterations ) {
                 break;
             }
@@ -918,7 +920,7 @@ class ExplorationPlanner : public RrtPlanner<SimpleNode>
 {
 public:
     ExplorationPlanner(EnvironmentBasePtr penv) : RrtPlanner<SimpleNode>(penv) {
-        __description = ":Interface Author: Rosen Diankov\n\nRRT-based exploration planner";
+        __description = ":Interface Author: Rosen Diankov\n\nRRT-based exploration planner. The explore step samples several neighbors of a random node and keeps the one farthest from the tree.";
     }
     virtual ~ExplorationPlanner() {
     }
@@ -944,7 +946,9 @@ public:
             return PS_Failed;
         }
         EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
-        vector<dReal> vSampleConfig;
+        vector<dReal> vSampleConfig, vNodeConfig, vCandidateConfigs;
+        std::vector< std::pair<NodeBasePtr, dReal> > vCandidateNearest;
+        const int dof = _parameters->GetDOF();
 
         PlannerParameters::StateSaver savestate(_parameters);
         CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
@@ -952,16 +956,33 @@ public:
         int iter = 0;
         while(iter < _parameters->_nMaxIterations && _treeForward.GetNumNodes() < _parameters->_nExpectedDataSize ) {
             ++iter;
+            OPENRAVE_PROFILING_SCOPE("ExplorationPlanner.Iteration");
 
             if( RaveRandomFloat() < _parameters->_fExploreProb ) {
                 // explore
                 int inode = RaveRandomInt()%_treeForward.GetNumNodes();
                 NodeBase* pnode = _treeForward.GetNodeFromIndex(inode);
+                _treeForward.GetVectorConfig(pnode, vNodeConfig);
 
-                if( !_parameters->_sampleneighfn(vSampleConfig, _treeForward.GetVectorConfig(pnode), _parameters->_fStepLength) ) {
+                // sampling next to a random node favors the dense regions of the tree, so keep the neighbor that is farthest from all nodes
+                vCandidateConfigs.resize(0);
+                for(int isample = 0; isample < s_nExploreCandidates; ++isample) {
+                    if( _parameters->_sampleneighfn(vSampleConfig, vNodeConfig, _parameters->_fStepLength) ) {
+                        vCandidateConfigs.insert(vCandidateConfigs.end(), vSampleConfig.begin(), vSampleConfig.end());
+                    }
+                }
+                if( vCandidateConfigs.size() == 0 ) {
                     continue;
                 }
-                if( GetParameters()->CheckPathAllConstraints(_treeForward.GetVectorConfig(pnode), vSampleConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) == 0 ) {
+                _treeForward.FindKNearestNodes(vCandidateConfigs, 1, vCandidateNearest);
+                size_t ibest = 0;
+                for(size_t icandidate = 1; icandidate < vCandidateNearest.size(); ++icandidate) {
+                    if( vCandidateNearest[icandidate].second > vCandidateNearest[ibest].second ) {
+                        ibest = icandidate;
+                    }
+                }
+                vSampleConfig.assign(vCandidateConfigs.begin()+ibest*dof, vCandidateConfigs.begin()+(ibest+1)*dof);
+                if( GetParameters()->CheckPathAllConstraints(vNodeConfig, vSampleConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) == 0 ) {
                     _treeForward.InsertNode(pnode, vSampleConfig, 0);
                     GetEnv()->UpdatePublishedBodies();
                     RAVELOG_DEBUG_FORMAT("size %d", _treeForward.GetNumNodes());
@@ -995,6 +1016,8 @@ public:
     }
 
 private:
+    static const int s_nExploreCandidates = 4; ///< number of neighbors sampled by the explore step
+
     boost::shared_ptr<ExplorationParameters> _parameters;
 
 };
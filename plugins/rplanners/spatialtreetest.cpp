@@ -0,0 +1,148 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2014 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/// \brief checks SpatialTree::FindKNearestNodes and SpatialTree::FindNodesInRadius against a brute force search over the inserted nodes.
+///
+/// usage: spatialtreetest [numnodes] [numqueries]
+#include "rplanners.h"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace OpenRAVE;
+using namespace std;
+
+static dReal RandomReal(dReal fmin, dReal fmax)
+{
+    return fmin + (fmax-fmin)*(dReal)rand()/(dReal)RAND_MAX;
+}
+
+static dReal ComputeDistance(const std::vector<dReal>& q0, const std::vector<dReal>& q1)
+{
+    dReal dist = 0;
+    for(size_t i = 0; i < q0.size(); ++i) {
+        dist += (q0[i]-q1[i])*(q0[i]-q1[i]);
+    }
+    return RaveSqrt(dist);
+}
+
+/// \brief returns the distances from vquery to all nodes, sorted
+static void ComputeBruteForceDistances(const std::vector< std::vector<dReal> >& vconfigs, const std::vector<dReal>& vquery, std::vector<dReal>& vdists)
+{
+    vdists.resize(vconfigs.size());
+    for(size_t i = 0; i < vconfigs.size(); ++i) {
+        vdists[i] = ComputeDistance(vconfigs[i], vquery);
+    }
+    std::sort(vdists.begin(), vdists.end());
+}
+
+int main(int argc, char ** argv)
+{
+    const int dof = 6;
+    const int k = 5;
+    const dReal fStepLength = 0.04;
+    int numnodes = argc > 1 ? atoi(argv[1]) : 5000;
+    int numqueries = argc > 2 ? atoi(argv[2]) : 200;
+    RaveInitialize(false, Level_Error);
+    srand(0);
+
+    SpatialTree<SimpleNode> tree(0);
+    boost::function<dReal(const std::vector<dReal>&, const std::vector<dReal>&)> distmetricfn = ComputeDistance;
+    tree.Init(boost::weak_ptr<PlannerBase>(), dof, distmetricfn, fStepLength, 2*RaveSqrt(dReal(dof)));
+
+    // grow the tree like an rrt so that nodes are clustered and clones are created at many levels
+    std::vector< std::vector<dReal> > vconfigs;
+    std::vector<NodeBasePtr> vnodes;
+    std::vector<dReal> q(dof);
+    for(int i = 0; i < dof; ++i) {
+        q[i] = RandomReal(-1, 1);
+    }
+    vnodes.push_back(tree.InsertNode(NULL, q, 0));
+    vconfigs.push_back(q);
+    while((int)vnodes.size() < numnodes) {
+        size_t iparent = rand()%vnodes.size();
+        for(int i = 0; i < dof; ++i) {
+            q[i] = min(dReal(1), max(dReal(-1), vconfigs[iparent][i] + RandomReal(-5*fStepLength, 5*fStepLength)));
+        }
+        NodeBasePtr node = tree.InsertNode(vnodes[iparent], q, 0);
+        if( !!node ) {
+            vnodes.push_back(node);
+            vconfigs.push_back(q);
+        }
+    }
+
+    bool bsuccess = true;
+    std::vector<dReal> vqueries(numqueries*dof), vquery(dof), vdists, vnodeconfig;
+    for(size_t i = 0; i < vqueries.size(); ++i) {
+        vqueries[i] = RandomReal(-1.2, 1.2);
+    }
+    // query the nodes themselves too
+    for(int iquery = 0; iquery < numqueries; iquery += 10) {
+        std::copy(vconfigs[iquery].begin(), vconfigs[iquery].end(), vqueries.begin()+iquery*dof);
+    }
+
+    std::vector< std::pair<NodeBasePtr, dReal> > vnearest, vapproxnearest;
+    std::vector< std::vector< std::pair<NodeBasePtr, dReal> > > vvradiusnodes;
+    const dReal fApproxEpsilon = 0.5;
+    tree.FindKNearestNodes(vqueries, k, vnearest);
+    tree.FindKNearestNodes(vqueries, k, vapproxnearest, fApproxEpsilon);
+    tree.FindNodesInRadius(vqueries, 0.15, vvradiusnodes);
+    for(int iquery = 0; iquery < numqueries; ++iquery) {
+        vquery.assign(vqueries.begin()+iquery*dof, vqueries.begin()+(iquery+1)*dof);
+        ComputeBruteForceDistances(vconfigs, vquery, vdists);
+        std::set<NodeBasePtr> setnearestnodes;
+        for(int j = 0; j < k; ++j) {
+            const std::pair<NodeBasePtr, dReal>& nearest = vnearest.at(iquery*k+j);
+            tree.GetVectorConfig(nearest.first, vnodeconfig);
+            if( RaveFabs(nearest.second - vdists[j]) > 1e-10 || RaveFabs(ComputeDistance(vnodeconfig, vquery) - nearest.second) > 1e-10 ) {
+                cerr << "query " << iquery << ": neighbor " << j << " is at " << nearest.second << ", brute force " << vdists[j] << endl;
+                bsuccess = false;
+            }
+            setnearestnodes.insert(nearest.first);
+            if( vapproxnearest.at(iquery*k+j).second > (1+fApproxEpsilon)*vdists[j] + 1e-10 ) {
+                cerr << "query " << iquery << ": approximate neighbor " << j << " is at " << vapproxnearest.at(iquery*k+j).second << ", bound " << (1+fApproxEpsilon)*vdists[j] << endl;
+                bsuccess = false;
+            }
+        }
+        if( (int)setnearestnodes.size() != k ) {
+            cerr << "query " << iquery << ": a node was returned more than once" << endl;
+            bsuccess = false;
+        }
+        if( tree.FindNearestNode(vquery).second != vnearest.at(iquery*k).second ) {
+            cerr << "query " << iquery << ": FindNearestNode differs from the first of FindKNearestNodes" << endl;
+            bsuccess = false;
+        }
+
+        size_t numinradius = std::upper_bound(vdists.begin(), vdists.end(), dReal(0.15)) - vdists.begin();
+        std::set<NodeBasePtr> setradiusnodes;
+        for(size_t j = 0; j < vvradiusnodes[iquery].size(); ++j) {
+            setradiusnodes.insert(vvradiusnodes[iquery][j].first);
+            if( RaveFabs(vvradiusnodes[iquery][j].second - vdists.at(j)) > 1e-10 ) {
+                cerr << "query " << iquery << ": node " << j << " in radius is at " << vvradiusnodes[iquery][j].second << ", brute force " << vdists.at(j) << endl;
+                bsuccess = false;
+            }
+        }
+        if( vvradiusnodes[iquery].size() != numinradius || setradiusnodes.size() != numinradius ) {
+            cerr << "query " << iquery << ": " << vvradiusnodes[iquery].size() << " nodes (" << setradiusnodes.size() << " unique) in radius, brute force " << numinradius << endl;
+            bsuccess = false;
+        }
+    }
+
+    cout << (bsuccess ? "SpatialTree queries match the brute force search" : "SpatialTree queries differ from the brute force search") << " for " << vnodes.size() << " nodes, " << tree.GetNumNodes()-(int)vnodes.size() << " clones" << endl;
+    RaveDestroy();
+    return bsuccess ? 0 : 1;
+}
@@ -57,6 +57,7 @@ public:
         // reset the cache
         _cachedoldspec = ConfigurationSpecification();
         _cachednewspec = ConfigurationSpecification();
+        _cachedvelocityplan.reset();
         return _InitPlan();
     }
 
@@ -155,7 +156,10 @@ public:
 
         _vdata.resize(numpoints*newspec.GetDOF());
         std::fill(_vdata.begin(), _vdata.end(), 0);
-        ConfigurationSpecification::ConvertData(_vdata.begin(), newspec, _vdiffdata.begin(), _parameters->_configurationspecification, numpoints, GetEnv());
+        if( !_cacheddataplan || !_cacheddataplan->IsCompiledFor(newspec, _parameters->_configurationspecification) ) {
+            _cacheddataplan = ConfigurationSpecification::GetConversionPlan(newspec, _parameters->_configurationspecification);
+        }
+        _cacheddataplan->Convert(_vdata.begin(), _vdiffdata.begin(), numpoints, GetEnv());
         int degree = 1;
 
         // {
@@ -274,6 +278,7 @@ public:
                         _cachednewspec._vgroups.at(itaccelgroupc-_cachednewspec._vgroups.begin()).interpolation = accelinterpolation;
                     }
                 }
+                _cachedvelocityplan = ConfigurationSpecification::GetConversionPlan(_cachednewspec, velspec);
                 // compute the timestamps and velocities
                 _timeoffset = -1;
                 FOREACH(itgroup,_cachednewspec._vgroups) {
@@ -318,7 +323,7 @@ public:
             }
             if( _parameters->_hasvelocities ) {
                 ptraj->GetWaypoints(0,numpoints,_vtempdata0,velspec);
-                ConfigurationSpecification::ConvertData(_vdata.begin(),_cachednewspec,_vtempdata0.begin(),velspec,numpoints,GetEnv(),false);
+                _cachedvelocityplan->Convert(_vdata.begin(),_vtempdata0.begin(),numpoints,GetEnv(),false);
             }
             try {
                 std::vector<dReal>::iterator itorgdiff = _vdiffdata.begin()+_cachedoldspec.GetDOF();
@@ -472,6 +477,8 @@ protected:
 
     // caching
     ConfigurationSpecification _cachedoldspec, _cachednewspec; ///< the configuration specification that the cached structures have been set for
+    ConfigurationSpecification::ConversionPlanConstPtr _cacheddataplan; ///< converts the planner configurations into the retimed trajectory data
+    ConfigurationSpecification::ConversionPlanConstPtr _cachedvelocityplan; ///< converts the velocities of the input trajectory into _cachednewspec, valid as long as _cachedoldspec is
     std::string _cachedposinterpolation;
     std::list< boost::function<dReal(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,bool) > > _listmintimefns;
     std::list< boost::function<void(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::iterator) > > _listvelocityfns;
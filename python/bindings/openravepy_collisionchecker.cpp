@@ -553,6 +553,37 @@ public:
         return boost::python::make_tuple(static_cast<numeric::array>(handle<>(pycollision)),static_cast<numeric::array>(handle<>(pypos)));
     }
 
+    object CheckCollisionRaysDistances(object rays)
+    {
+        std::vector<dReal> vrayvalues = ExtractArray<dReal>(numeric::array(rays).attr("flatten")());
+        if( vrayvalues.size() % 6 ) {
+            throw openrave_exception(_("rays object needs to be a Nx6 vector\n"));
+        }
+        std::vector<RAY> vrays(vrayvalues.size()/6);
+        for(size_t i = 0; i < vrays.size(); ++i) {
+            vrays[i].pos = Vector(vrayvalues[6*i+0], vrayvalues[6*i+1], vrayvalues[6*i+2]);
+            vrays[i].dir = Vector(vrayvalues[6*i+3], vrayvalues[6*i+4], vrayvalues[6*i+5]);
+        }
+        std::vector<dReal> vdistances;
+        std::vector<int> vbodyids;
+        _pCollisionChecker->CheckCollisionRays(vrays, vdistances, vbodyids);
+        return boost::python::make_tuple(toPyArray(vdistances), toPyArray(vbodyids));
+    }
+
+    object CheckCollisionBatch(PyKinBodyPtr pbody, object oconfigs, bool bCheckSelfCollision=true)
+    {
+        std::vector<dReal> vconfigs = ExtractArray<dReal>(numeric::array(oconfigs).attr("flatten")());
+        std::vector<uint8_t> vresults;
+        _pCollisionChecker->CheckCollisionBatch(openravepy::GetKinBody(pbody), vconfigs, vresults, bCheckSelfCollision);
+        npy_intp dims[] = { (npy_intp)vresults.size() };
+        PyObject* pycollision = PyArray_SimpleNew(1, dims, PyArray_BOOL);
+        bool* pcollision = (bool*)PyArray_DATA(pycollision);
+        for(size_t i = 0; i < vresults.size(); ++i) {
+            pcollision[i] = !!vresults[i];
+        }
+        return static_cast<numeric::array>(handle<>(pycollision));
+    }
+
     bool CheckCollision(boost::shared_ptr<PyRay> pyray)
     {
         return _pCollisionChecker->CheckCollision(pyray->r);
@@ -646,6 +677,7 @@ PyCollisionCheckerBasePtr RaveCreateCollisionChecker(PyEnvironmentBasePtr pyenv,
 }
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckCollisionRays_overloads, CheckCollisionRays, 2, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckCollisionBatch_overloads, CheckCollisionBatch, 2, 3)
 
 void init_openravepy_collisionchecker()
 {
@@ -733,6 +765,9 @@ void init_openravepy_collisionchecker()
     .def("CheckCollisionRays",&PyCollisionCheckerBase::CheckCollisionRays,
          CheckCollisionRays_overloads(args("rays","body","front_facing_only"),
                                       "Check if any rays hit the body and returns their contact points along with a vector specifying if a collision occured or not. Rays is a Nx6 array, first 3 columns are position, last 3 are direction*range. The return value is: (N array of hit points, Nx6 array of hit position and surface normals."))
+    .def("CheckCollisionRaysDistances",&PyCollisionCheckerBase::CheckCollisionRaysDistances,args("rays"), DOXY_FN(CollisionCheckerBase,CheckCollisionRays))
+    .def("CheckCollisionBatch",&PyCollisionCheckerBase::CheckCollisionBatch,
+         CheckCollisionBatch_overloads(args("body","configs","checkselfcollision"), DOXY_FN(CollisionCheckerBase,CheckCollisionBatch)))
     ;
 
     def("RaveCreateCollisionChecker",openravepy::RaveCreateCollisionChecker,args("env","name"),DOXY_FN1(RaveCreateCollisionChecker));
@@ -842,6 +842,27 @@ object RaveGetLoadedInterfaces()
     return ointerfacenames;
 }
 
+/// \brief returns a dictionary of scope name to (count, totaltime, mintime, maxtime), times are in nanoseconds
+object pyRaveGetProfilingStats()
+{
+    std::vector<ProfilingStats> vstats;
+    OpenRAVE::RaveGetProfilingStats(vstats);
+    boost::python::dict ostats;
+    FOREACHC(itstats, vstats) {
+        ostats[itstats->name] = boost::python::make_tuple(itstats->count, itstats->totaltime, itstats->mintime, itstats->maxtime);
+    }
+    return ostats;
+}
+
+void pyRaveWriteProfilingTrace(const std::string& filename)
+{
+    std::ofstream f(filename.c_str());
+    if( !f ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("failed to open file %s for writing the profiling trace"), filename, ORE_InvalidArguments);
+    }
+    OpenRAVE::RaveWriteProfilingTrace(f);
+}
+
 PyInterfaceBasePtr pyRaveClone(PyInterfaceBasePtr pyreference, int cloningoptions, PyEnvironmentBasePtr pyenv=PyEnvironmentBasePtr())
 {
     if( !pyenv ) {
@@ -1148,6 +1169,8 @@ void init_openravepy_global()
     .value("RobotManipulators",SO_RobotManipulators)
     .value("RobotSensors",SO_RobotSensors)
     .value("Geometry",SO_Geometry)
+    .value("InverseKinematics",SO_InverseKinematics)
+    .value("TrajectoryBinary",SO_TrajectoryBinary)
     ;
     enum_<InterfaceType>("InterfaceType" DOXY_ENUM(InterfaceType))
     .value(RaveGetInterfaceName(PT_Planner).c_str(),PT_Planner)
@@ -1334,6 +1357,13 @@ void init_openravepy_global()
     def("RaveInitialize",openravepy::pyRaveInitialize,RaveInitialize_overloads(args("load_all_plugins","level"),DOXY_FN1(RaveInitialize)));
     def("RaveDestroy",RaveDestroy,DOXY_FN1(RaveDestroy));
     def("RaveGetPluginInfo",openravepy::RaveGetPluginInfo,DOXY_FN1(RaveGetPluginInfo));
+    def("RaveSetProfilingEnabled",OpenRAVE::RaveSetProfilingEnabled,args("enabled"),DOXY_FN1(RaveSetProfilingEnabled));
+    def("RaveIsProfilingEnabled",OpenRAVE::RaveIsProfilingEnabled,DOXY_FN1(RaveIsProfilingEnabled));
+    def("RaveSetProfilingTraceEnabled",OpenRAVE::RaveSetProfilingTraceEnabled,args("enabled"),DOXY_FN1(RaveSetProfilingTraceEnabled));
+    def("RaveIsProfilingTraceEnabled",OpenRAVE::RaveIsProfilingTraceEnabled,DOXY_FN1(RaveIsProfilingTraceEnabled));
+    def("RaveGetProfilingStats",openravepy::pyRaveGetProfilingStats,"Returns a dictionary of profiling scope name to (count, totaltime, mintime, maxtime). Times are in nanoseconds.");
+    def("RaveResetProfilingStats",OpenRAVE::RaveResetProfilingStats,DOXY_FN1(RaveResetProfilingStats));
+    def("RaveWriteProfilingTrace",openravepy::pyRaveWriteProfilingTrace,args("filename"),"Writes the recorded profiling trace events to filename in the Chrome trace event JSON format.");
     def("RaveGetLoadedInterfaces",openravepy::RaveGetLoadedInterfaces,DOXY_FN1(RaveGetLoadedInterfaces));
     def("RaveReloadPlugins",OpenRAVE::RaveReloadPlugins,DOXY_FN1(RaveReloadPlugins));
     def("RaveLoadPlugin",OpenRAVE::RaveLoadPlugin,args("filename"),DOXY_FN1(RaveLoadPlugins));
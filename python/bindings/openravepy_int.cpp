@@ -1641,53 +1641,60 @@ public:
         _penv->UpdatePublishedBodies();
     }
 
+    object _GetPyBodyState(const KinBody::BodyState& bodystate)
+    {
+        boost::python::dict ostate;
+        ostate["body"] = toPyKinBody(bodystate.pbody, shared_from_this());
+        boost::python::list olinktransforms;
+        FOREACHC(ittransform, bodystate.vectrans) {
+            olinktransforms.append(ReturnTransform(*ittransform));
+        }
+        ostate["linktransforms"] = olinktransforms;
+        ostate["jointvalues"] = toPyArray(bodystate.jointvalues);
+        ostate["name"] = ConvertStringToUnicode(bodystate.strname);
+        ostate["uri"] = ConvertStringToUnicode(bodystate.uri);
+        ostate["updatestamp"] = bodystate.updatestamp;
+        ostate["environmentid"] = bodystate.environmentid;
+        ostate["activeManipulatorName"] = bodystate.activeManipulatorName;
+        ostate["activeManipulatorTransform"] = ReturnTransform(bodystate.activeManipulatorTransform);
+        return ostate;
+    }
+
     object GetPublishedBodies(uint64_t timeout=0)
     {
         std::vector<KinBody::BodyState> vbodystates;
         _penv->GetPublishedBodies(vbodystates, timeout);
         boost::python::list ostates;
         FOREACH(itstate, vbodystates) {
-            boost::python::dict ostate;
-            ostate["body"] = toPyKinBody(itstate->pbody, shared_from_this());
-            boost::python::list olinktransforms;
-            FOREACH(ittransform, itstate->vectrans) {
-                olinktransforms.append(ReturnTransform(*ittransform));
-            }
-            ostate["linktransforms"] = olinktransforms;
-            ostate["jointvalues"] = toPyArray(itstate->jointvalues);
-            ostate["name"] = ConvertStringToUnicode(itstate->strname);
-            ostate["uri"] = ConvertStringToUnicode(itstate->uri);
-            ostate["updatestamp"] = itstate->updatestamp;
-            ostate["environmentid"] = itstate->environmentid;
-            ostate["activeManipulatorName"] = itstate->activeManipulatorName;
-            ostate["activeManipulatorTransform"] = ReturnTransform(itstate->activeManipulatorTransform);
-            ostates.append(ostate);
+            ostates.append(_GetPyBodyState(*itstate));
         }
         return ostates;
     }
 
+    /// \brief returns (incremental, changed body states, removed environment ids, new version)
+    object GetPublishedBodiesChangedSince(uint64_t version)
+    {
+        std::vector<KinBody::BodyStateConstPtr> vchangedbodies;
+        std::vector<int> vremovedbodyids;
+        uint64_t newversion = 0;
+        bool bincremental = _penv->GetPublishedBodiesChangedSince(version, vchangedbodies, vremovedbodyids, newversion);
+        boost::python::list ostates, oremovedbodyids;
+        FOREACH(itstate, vchangedbodies) {
+            ostates.append(_GetPyBodyState(**itstate));
+        }
+        FOREACH(itid, vremovedbodyids) {
+            oremovedbodyids.append(*itid);
+        }
+        return boost::python::make_tuple(bincremental, ostates, oremovedbodyids, newversion);
+    }
+
     object GetPublishedBody(const string &name, uint64_t timeout = 0)
     {
         KinBody::BodyState bodystate;
         if( !_penv->GetPublishedBody(name, bodystate, timeout) ) {
             return object();
         }
-
-        boost::python::dict ostate;
-        ostate["body"] = toPyKinBody(bodystate.pbody, shared_from_this());
-        boost::python::list olinktransforms;
-        FOREACH(ittransform, bodystate.vectrans) {
-            olinktransforms.append(ReturnTransform(*ittransform));
-        }
-        ostate["linktransforms"] = olinktransforms;
-        ostate["jointvalues"] = toPyArray(bodystate.jointvalues);
-        ostate["name"] = ConvertStringToUnicode(bodystate.strname);
-        ostate["uri"] = ConvertStringToUnicode(bodystate.uri);
-        ostate["updatestamp"] = bodystate.updatestamp;
-        ostate["environmentid"] = bodystate.environmentid;
-        ostate["activeManipulatorName"] = bodystate.activeManipulatorName;
-        ostate["activeManipulatorTransform"] = ReturnTransform(bodystate.activeManipulatorTransform);
-        return ostate;
+        return _GetPyBodyState(bodystate);
     }
 
     object GetPublishedBodyJointValues(const string &name, uint64_t timeout=0)
@@ -2187,6 +2194,7 @@ Because race conditions can pop up when trying to lock the openrave environment
                     .def("UpdatePublishedBodies",&PyEnvironmentBase::UpdatePublishedBodies, DOXY_FN(EnvironmentBase,UpdatePublishedBodies))
                     .def("GetPublishedBody",&PyEnvironmentBase::GetPublishedBody, GetPublishedBody_overloads(args("name", "timeout"), DOXY_FN(EnvironmentBase,GetPublishedBody)))
                     .def("GetPublishedBodies",&PyEnvironmentBase::GetPublishedBodies, GetPublishedBodies_overloads(args("timeout"), DOXY_FN(EnvironmentBase,GetPublishedBodies)))
+                    .def("GetPublishedBodiesChangedSince",&PyEnvironmentBase::GetPublishedBodiesChangedSince, args("version"), DOXY_FN(EnvironmentBase,GetPublishedBodiesChangedSince))
                     .def("GetPublishedBodyJointValues",&PyEnvironmentBase::GetPublishedBodyJointValues, GetPublishedBodyJointValues_overloads(args("name", "timeout"), DOXY_FN(EnvironmentBase,GetPublishedBodyJointValues)))
                     .def("GetPublishedBodyTransformsMatchingPrefix",&PyEnvironmentBase::GetPublishedBodyTransformsMatchingPrefix, GetPublishedBodyTransformsMatchingPrefix_overloads(args("prefix", "timeout"), DOXY_FN(EnvironmentBase,GetPublishedBodyTransformsMatchingPrefix)))
                     .def("Triangulate",&PyEnvironmentBase::Triangulate,args("body"), DOXY_FN(EnvironmentBase,Triangulate))
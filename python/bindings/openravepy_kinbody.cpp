@@ -1907,6 +1907,29 @@ object PyKinBody::GetLinkTransformations(bool returndoflastvlaues) const
     return otransforms;
 }
 
+object PyKinBody::ComputeLinkTransformsBatch(object oconfigs) const
+{
+    std::vector<dReal> vconfigs = ExtractArray<dReal>(numeric::array(oconfigs).attr("flatten")());
+    size_t numconfigs = len(oconfigs);
+    if( numconfigs*_pbody->GetDOF() != vconfigs.size() ) {
+        throw openrave_exception(_("configurations need to have the dof of the body"));
+    }
+    size_t numlinks = _pbody->GetLinks().size();
+    std::vector<Transform> vtransforms(numconfigs*numlinks);
+    if( numconfigs > 0 ) {
+        _pbody->ComputeLinkTransformsBatch(vconfigs.size() > 0 ? &vconfigs[0] : NULL, numconfigs, &vtransforms[0]);
+    }
+    boost::python::list oconfigtransforms;
+    for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig) {
+        boost::python::list otransforms;
+        for(size_t ilink = 0; ilink < numlinks; ++ilink) {
+            otransforms.append(ReturnTransform(vtransforms[iconfig*numlinks+ilink]));
+        }
+        oconfigtransforms.append(otransforms);
+    }
+    return oconfigtransforms;
+}
+
 void PyKinBody::SetLinkTransformations(object transforms, object odoflastvalues)
 {
     size_t numtransforms = len(transforms);
@@ -3073,6 +3096,7 @@ void init_openravepy_kinbody()
                         .def("GetTransformPose",&PyKinBody::GetTransformPose, DOXY_FN(KinBody,GetTransform))
                         .def("GetLinkTransformations",&PyKinBody::GetLinkTransformations, GetLinkTransformations_overloads(args("returndoflastvlaues"), DOXY_FN(KinBody,GetLinkTransformations)))
                         .def("GetBodyTransformations",&PyKinBody::GetLinkTransformations, DOXY_FN(KinBody,GetLinkTransformations))
+                        .def("ComputeLinkTransformsBatch",&PyKinBody::ComputeLinkTransformsBatch, args("configs"), DOXY_FN(KinBody,ComputeLinkTransformsBatch))
                         .def("SetLinkTransformations",&PyKinBody::SetLinkTransformations,SetLinkTransformations_overloads(args("transforms","doflastsetvalues"), DOXY_FN(KinBody,SetLinkTransformations)))
                         .def("SetBodyTransformations",&PyKinBody::SetLinkTransformations,args("transforms"), DOXY_FN(KinBody,SetLinkTransformations))
                         .def("SetLinkVelocities",&PyKinBody::SetLinkVelocities,args("velocities"), DOXY_FN(KinBody,SetLinkVelocities))
@@ -143,6 +143,7 @@ public:
     object GetTransformPose() const;
     object GetLinkTransformations(bool returndoflastvlaues=false) const;
     void SetLinkTransformations(object transforms, object odoflastvalues=object());
+    object ComputeLinkTransformsBatch(object oconfigs) const;
     void SetLinkVelocities(object ovelocities);
     object GetLinkEnableStates() const;
     void SetLinkEnableStates(object oenablestates);
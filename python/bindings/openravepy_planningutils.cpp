@@ -222,6 +222,25 @@ public:
         _pconstraints->SetTorqueLimitMode(torquelimitmode);
     }
 
+    void SetEdgeCheckOrder(int checkorder, int coarsestride=4) {
+        _pconstraints->SetEdgeCheckOrder((OpenRAVE::planningutils::DynamicsCollisionConstraint::EdgeCheckOrder)checkorder, coarsestride);
+    }
+
+    void SetValidatedSegmentCacheSize(int maxsegments) {
+        _pconstraints->SetValidatedSegmentCacheSize(maxsegments);
+    }
+
+    void ClearValidatedSegments() {
+        _pconstraints->ClearValidatedSegments();
+    }
+
+    int GetNumValidatedSegmentHits() const {
+        return _pconstraints->GetNumValidatedSegmentHits();
+    }
+
+    int GetNumBisectionRejections() const {
+        return _pconstraints->GetNumBisectionRejections();
+    }
 
     PyEnvironmentBasePtr _pyenv;
     OpenRAVE::planningutils::DynamicsCollisionConstraintPtr _pconstraints;
@@ -426,6 +445,7 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(InsertActiveDOFWaypointWithRetiming_overloads, p
 BOOST_PYTHON_FUNCTION_OVERLOADS(InsertWaypointWithSmoothing_overloads, planningutils::pyInsertWaypointWithSmoothing, 4, 7)
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Check_overloads, Check, 5, 8)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetEdgeCheckOrder_overloads, SetEdgeCheckOrder, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads, PlanPath, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads2, PlanPath, 3, 5)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads3, PlanPath, 1, 3)
@@ -523,6 +543,11 @@ void InitPlanningUtils()
         .def("SetFilterMask", &planningutils::PyDynamicsCollisionConstraint::SetFilterMask, args("filtermask"), DOXY_FN(planningutils::DynamicsCollisionConstraint,SetFilterMask))
         .def("SetPerturbation", &planningutils::PyDynamicsCollisionConstraint::SetPerturbation, args("parameters"), DOXY_FN(planningutils::DynamicsCollisionConstraint,SetPerturbation))
         .def("SetTorqueLimitMode", &planningutils::PyDynamicsCollisionConstraint::SetTorqueLimitMode, args("torquelimitmode"), DOXY_FN(planningutils::DynamicsCollisionConstraint,SetTorqueLimitMode))
+        .def("SetEdgeCheckOrder", &planningutils::PyDynamicsCollisionConstraint::SetEdgeCheckOrder, SetEdgeCheckOrder_overloads(args("checkorder","coarsestride"), DOXY_FN(planningutils::DynamicsCollisionConstraint,SetEdgeCheckOrder)))
+        .def("SetValidatedSegmentCacheSize", &planningutils::PyDynamicsCollisionConstraint::SetValidatedSegmentCacheSize, args("maxsegments"), DOXY_FN(planningutils::DynamicsCollisionConstraint,SetValidatedSegmentCacheSize))
+        .def("ClearValidatedSegments", &planningutils::PyDynamicsCollisionConstraint::ClearValidatedSegments, DOXY_FN(planningutils::DynamicsCollisionConstraint,ClearValidatedSegments))
+        .def("GetNumValidatedSegmentHits", &planningutils::PyDynamicsCollisionConstraint::GetNumValidatedSegmentHits, DOXY_FN(planningutils::DynamicsCollisionConstraint,GetNumValidatedSegmentHits))
+        .def("GetNumBisectionRejections", &planningutils::PyDynamicsCollisionConstraint::GetNumBisectionRejections, DOXY_FN(planningutils::DynamicsCollisionConstraint,GetNumBisectionRejections))
         ;
     }
 }
@@ -113,6 +113,20 @@ public:
         return static_cast<numeric::array>(handle<>(pypos));
     }
 
+    object SampleRange2D(dReal starttime, dReal deltatime, size_t numsamples, PyConfigurationSpecificationPtr pyspec) const
+    {
+        vector<dReal> values;
+        ConfigurationSpecification spec = openravepy::GetConfigurationSpecification(pyspec);
+        _ptrajectory->SampleRange(values, starttime, deltatime, numsamples, spec);
+
+        npy_intp dims[] = { npy_intp(numsamples), npy_intp(spec.GetDOF()) };
+        PyObject *pypos = PyArray_SimpleNew(2,dims, sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT);
+        if( values.size() > 0 ) {
+            memcpy(PyArray_DATA(pypos), &values[0], values.size()*sizeof(values[0]));
+        }
+        return static_cast<numeric::array>(handle<>(pypos));
+    }
+
     object GetConfigurationSpecification() const {
         return object(openravepy::toPyConfigurationSpecification(_ptrajectory->GetConfigurationSpecification()));
     }
@@ -300,6 +314,7 @@ void init_openravepy_trajectory()
     .def("SampleFromPrevious",&PyTrajectoryBase::SampleFromPrevious,args("data","time","spec"),DOXY_FN(TrajectoryBase,Sample "std::vector; dReal; const ConfigurationSpecification"))
     .def("SamplePoints2D",SamplePoints2D1,args("times"),DOXY_FN(TrajectoryBase,SamplePoints2D "std::vector; std::vector"))
     .def("SamplePoints2D",SamplePoints2D2,args("times","spec"),DOXY_FN(TrajectoryBase,SamplePoints2D "std::vector; std::vector; const ConfigurationSpecification"))
+    .def("SampleRange2D",&PyTrajectoryBase::SampleRange2D,args("starttime","deltatime","numsamples","spec"),DOXY_FN(TrajectoryBase,SampleRange))
     .def("GetConfigurationSpecification",&PyTrajectoryBase::GetConfigurationSpecification,DOXY_FN(TrajectoryBase,GetConfigurationSpecification))
     .def("GetNumWaypoints",&PyTrajectoryBase::GetNumWaypoints,DOXY_FN(TrajectoryBase,GetNumWaypoints))
     .def("GetWaypoints",GetWaypoints1,args("startindex","endindex"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector"))
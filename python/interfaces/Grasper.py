@@ -113,7 +113,47 @@ class Grasper:
 
     def GraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,finestep=None):
         """See :ref:`module-grasper-graspthreaded`
+
+        :return: nextid, grasps. nextid is the startindex that resumes the search after the returned grasps. With maxgrasps, the first maxgrasps successful grasps in id order are returned for any numthreads.
+        """
+        cmd = self._GetGraspThreadedCommand(approachrays,standoffs,preshapes,rolls,manipulatordirections,target,onlycontacttarget,tightgrasp,graspingnoise,forceclosurethreshold,translationstepmult,numthreads,startindex,maxgrasps,finestep)
+        res = self.prob.SendCommand(cmd)
+        if res is None:
+            raise PlanningError('Grasp failed')
+        return self._ParseGraspThreadedResults(res.split())
+
+    def StartGraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,finestep=None):
+        """Starts GraspThreaded without waiting for it, the grasps are retrieved with :meth:`GetGraspThreadedResults`. Takes the same parameters as :meth:`GraspThreaded`.
+
+        :return: the total number of grasp ids
+        """
+        cmd = self._GetGraspThreadedCommand(approachrays,standoffs,preshapes,rolls,manipulatordirections,target,onlycontacttarget,tightgrasp,graspingnoise,forceclosurethreshold,translationstepmult,numthreads,startindex,maxgrasps,finestep)
+        res = self.prob.SendCommand(cmd + 'async 1 ')
+        if res is None:
+            raise PlanningError('Grasp failed')
+        return int(res)
+
+    def GetGraspThreadedResults(self):
+        """Returns the grasps of the call started with :meth:`StartGraspThreaded` that became final since the last call, in id order.
+
+        :return: done, nextid, grasps. done is True once all workers finished and nextid is the startindex that resumes the search after the returned grasps.
         """
+        res = self.prob.SendCommand('GetGraspThreadedResults')
+        if res is None:
+            raise PlanningError('GetGraspThreadedResults failed')
+        resultgrasps = res.split()
+        done = int(resultgrasps.pop(0)) != 0
+        nextid, resvalues = self._ParseGraspThreadedResults(resultgrasps)
+        return done, nextid, resvalues
+
+    def StopGraspThreaded(self):
+        """Stops the call started with :meth:`StartGraspThreaded` and waits for the grasps being evaluated. Their results can still be retrieved with :meth:`GetGraspThreadedResults`.
+        """
+        res = self.prob.SendCommand('StopGraspThreaded')
+        if res is None:
+            raise PlanningError('StopGraspThreaded failed')
+
+    def _GetGraspThreadedCommand(self,approachrays,standoffs,preshapes,rolls,manipulatordirections,target,onlycontacttarget,tightgrasp,graspingnoise,forceclosurethreshold,translationstepmult,numthreads,startindex,maxgrasps,finestep):
         cmd = 'GraspThreaded '
         if target is not None:
             cmd += 'target %s '%target.GetName()
@@ -149,10 +189,9 @@ class Grasper:
         cmd += 'manipulatordirections %d '%len(manipulatordirections)
         for f in manipulatordirections.flat:
             cmd += str(f) + ' '
-        res = self.prob.SendCommand(cmd)
-        if res is None:
-            raise PlanningError('Grasp failed')
-        resultgrasps = res.split()
+        return cmd
+
+    def _ParseGraspThreadedResults(self,resultgrasps):
         resvalues=[]
         nextid = int(resultgrasps.pop(0))
         preshapelen = len(self.robot.GetActiveManipulator().GetGripperIndices())
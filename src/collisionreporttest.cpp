@@ -0,0 +1,114 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2011 Rosen Diankov (rosen.diankov@gmail.com)
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/// \brief checks that RaveAcquireCollisionReport reuses released reports, never hands out a report that is still held, and does not allocate in steady state.
+///
+/// usage: collisionreporttest [numiterations]
+#include <openrave/openrave.h>
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace OpenRAVE;
+using namespace std;
+
+static uint64_t GetProfilingCount(const std::string& name)
+{
+    std::vector<ProfilingStats> vstats;
+    RaveGetProfilingStats(vstats);
+    for(size_t i = 0; i < vstats.size(); ++i) {
+        if( vstats[i].name == name ) {
+            return vstats[i].count;
+        }
+    }
+    return 0;
+}
+
+static void AddContacts(CollisionReportPtr report, int numcontacts)
+{
+    for(int i = 0; i < numcontacts; ++i) {
+        report->contacts.push_back(CollisionReport::CONTACT(Vector(i,0,0), Vector(0,0,1), 0));
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    int numiterations = argc > 1 ? atoi(argv[1]) : 1000;
+    RaveInitialize(false, Level_Error);
+    RaveSetProfilingEnabled(true);
+    RaveResetProfilingStats();
+    bool bsuccess = true;
+
+    // held reports are never handed out again and keep their contents
+    CollisionReportPtr report0 = RaveAcquireCollisionReport(), report1 = RaveAcquireCollisionReport();
+    AddContacts(report0, 5);
+    report0->minDistance = 0.5;
+    CollisionReportPtr report2 = RaveAcquireCollisionReport();
+    if( report0 == report1 || report0 == report2 || report1 == report2 ) {
+        cerr << "a report that is still held was handed out again" << endl;
+        bsuccess = false;
+    }
+    if( report0->contacts.size() != 5 || report0->minDistance != 0.5 ) {
+        cerr << "a held report was reset by acquiring another report" << endl;
+        bsuccess = false;
+    }
+
+    // released reports are reused and reset
+    CollisionReport* preleased = report2.get();
+    AddContacts(report2, 3);
+    report2.reset();
+    CollisionReportPtr report3 = RaveAcquireCollisionReport();
+    if( report3.get() != preleased ) {
+        cerr << "a released report was not reused" << endl;
+        bsuccess = false;
+    }
+    if( report3->contacts.size() != 0 || report3->contacts.capacity() < 3 || report3->minDistance != 1e20f ) {
+        cerr << "a reused report was not reset or lost the capacity of its contacts" << endl;
+        bsuccess = false;
+    }
+    report3.reset();
+
+    // steady state does not allocate reports or grow the contacts
+    for(int i = 0; i < 2; ++i) {
+        CollisionReportPtr report = RaveAcquireCollisionReport();
+        AddContacts(report, 10);
+    }
+    uint64_t nallocations = GetProfilingCount("CollisionReport.Allocations"), nreallocations = GetProfilingCount("CollisionReport.ContactReallocations");
+    if( nallocations != 3 ) {
+        cerr << nallocations << " reports were allocated instead of 3" << endl;
+        bsuccess = false;
+    }
+    for(int i = 0; i < numiterations; ++i) {
+        CollisionReportPtr report = RaveAcquireCollisionReport();
+        AddContacts(report, 10);
+    }
+    uint64_t nsteadyallocations = GetProfilingCount("CollisionReport.Allocations")-nallocations, nsteadyreallocations = GetProfilingCount("CollisionReport.ContactReallocations")-nreallocations;
+    if( nsteadyallocations != 0 || nsteadyreallocations != 0 ) {
+        cerr << "steady state allocated " << nsteadyallocations << " reports and grew the contacts " << nsteadyreallocations << " times" << endl;
+        bsuccess = false;
+    }
+    if( report0->contacts.size() != 5 ) {
+        cerr << "a held report was modified in steady state" << endl;
+        bsuccess = false;
+    }
+
+    cout << (bsuccess ? "RaveAcquireCollisionReport reuses the released reports only" : "RaveAcquireCollisionReport does not reuse the reports correctly") << ", " << nallocations << " allocations, " << nreallocations << " contact reallocations" << endl;
+    report0.reset();
+    report1.reset();
+    RaveDestroy();
+    return bsuccess ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2011 Rosen Diankov (rosen.diankov@gmail.com)
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/// \brief compares the scalar and SIMD kernels of geometry.h for speed and for bitwise equality of the results.
+///
+/// usage: geometrybenchmark [numiterations]
+#include <openrave/config.h>
+#include <openrave/geometry.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace OpenRAVE::geometry;
+using namespace std;
+
+#ifndef OPENRAVE_GEOMETRY_HAS_SIMD_KERNELS
+int main(int argc, char ** argv)
+{
+    cerr << "geometry.h was compiled without the SIMD kernels, configure with OPT_SIMD_GEOMETRY=ON" << endl;
+    return 1;
+}
+#else
+
+static const int s_nNumSamples = 1024;
+
+template <typename T>
+struct Samples
+{
+    Samples() : quats(4*s_nNumSamples), vecs(4*s_nNumSamples), mats(12*s_nNumSamples), trans(4*s_nNumSamples), outscalar(12*s_nNumSamples), outsimd(12*s_nNumSamples), outtransscalar(4*s_nNumSamples), outtranssimd(4*s_nNumSamples), extents(4*s_nNumSamples), planes(4*s_nNumPlanes) {
+        for(int i = 0; i < s_nNumSamples; ++i) {
+            RaveVector<T> axisangle(T(rand())/RAND_MAX-T(0.5), T(rand())/RAND_MAX-T(0.5), T(rand())/RAND_MAX-T(0.5));
+            axisangle *= T(6);
+            RaveTransform<T> t(quatFromAxisAngle(axisangle), RaveVector<T>(T(rand())/RAND_MAX, T(rand())/RAND_MAX, T(rand())/RAND_MAX));
+            RaveTransformMatrix<T> tm(t);
+            std::copy(&t.rot.x, &t.rot.x+4, &quats[4*i]);
+            std::copy(tm.m, tm.m+12, &mats[12*i]);
+            std::copy(&tm.trans.x, &tm.trans.x+4, &trans[4*i]);
+            vecs[4*i+0] = T(rand())/RAND_MAX; vecs[4*i+1] = T(rand())/RAND_MAX; vecs[4*i+2] = T(rand())/RAND_MAX; vecs[4*i+3] = 0;
+            extents[4*i+0] = T(0.6)*T(rand())/RAND_MAX; extents[4*i+1] = T(0.6)*T(rand())/RAND_MAX; extents[4*i+2] = T(0.6)*T(rand())/RAND_MAX; extents[4*i+3] = 0;
+        }
+        // the faces of the cube [-0.5,1.5]^3 as a structure of arrays, the boxes are at vecs with the rotations of mats
+        static const T s_planes[4][s_nNumPlanes] = { { 1, -1, 0, 0, 0, 0 }, { 0, 0, 1, -1, 0, 0 }, { 0, 0, 0, 0, 1, -1 }, { T(0.5), T(1.5), T(0.5), T(1.5), T(0.5), T(1.5) } };
+        for(int j = 0; j < 4; ++j) {
+            std::copy(s_planes[j], s_planes[j]+s_nNumPlanes, &planes[j*s_nNumPlanes]);
+        }
+    }
+
+    static const int s_nNumPlanes = 6;
+    std::vector<T> quats, vecs, mats, trans, extents, planes;
+    std::vector<T> outscalar, outsimd, outtransscalar, outtranssimd;
+};
+
+/// \brief times numiterations passes of fn over all samples, returns the nanoseconds per call
+template <typename Fn>
+static double _Time(Fn fn, int numiterations)
+{
+    boost::posix_time::ptime starttime = boost::posix_time::microsec_clock::universal_time();
+    for(int iter = 0; iter < numiterations; ++iter) {
+        for(int i = 0; i < s_nNumSamples; ++i) {
+            fn(i);
+        }
+    }
+    boost::posix_time::time_duration duration = boost::posix_time::microsec_clock::universal_time() - starttime;
+    return 1000.0*double(duration.total_microseconds())/(double(numiterations)*s_nNumSamples);
+}
+
+template <typename T>
+struct QuatMultiplyScalarFn
+{
+    QuatMultiplyScalarFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        scalar::QuatMultiply(&s.quats[4*i], &s.quats[4*((i+1)%s_nNumSamples)], &s.outscalar[4*i]);
+    }
+    Samples<T>& s;
+};
+
+template <typename T>
+struct QuatMultiplySimdFn
+{
+    QuatMultiplySimdFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        simd::QuatMultiply(&s.quats[4*i], &s.quats[4*((i+1)%s_nNumSamples)], &s.outsimd[4*i]);
+    }
+    Samples<T>& s;
+};
+
+template <typename T>
+struct MatrixMultiplyScalarFn
+{
+    MatrixMultiplyScalarFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        int j = (i+1)%s_nNumSamples;
+        scalar::MatrixMultiply(&s.mats[12*i], &s.trans[4*i], &s.mats[12*j], &s.trans[4*j], &s.outscalar[12*i], &s.outtransscalar[4*i]);
+    }
+    Samples<T>& s;
+};
+
+template <typename T>
+struct MatrixMultiplySimdFn
+{
+    MatrixMultiplySimdFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        int j = (i+1)%s_nNumSamples;
+        simd::MatrixMultiply(&s.mats[12*i], &s.trans[4*i], &s.mats[12*j], &s.trans[4*j], &s.outsimd[12*i], &s.outtranssimd[4*i]);
+    }
+    Samples<T>& s;
+};
+
+template <typename T>
+struct MatrixInverseScalarFn
+{
+    MatrixInverseScalarFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        scalar::MatrixInverse(&s.mats[12*i], &s.trans[4*i], &s.outscalar[12*i], &s.outtransscalar[4*i]);
+    }
+    Samples<T>& s;
+};
+
+template <typename T>
+struct MatrixInverseSimdFn
+{
+    MatrixInverseSimdFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        simd::MatrixInverse(&s.mats[12*i], &s.trans[4*i], &s.outsimd[12*i], &s.outtranssimd[4*i]);
+    }
+    Samples<T>& s;
+};
+
+template <typename T>
+struct IsOBBinPlanesScalarFn
+{
+    IsOBBinPlanesScalarFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        s.outscalar[12*i] = scalar::IsOBBinPlanes(&s.vecs[4*i], &s.mats[12*i], &s.mats[12*i+4], &s.mats[12*i+8], &s.extents[4*i], &s.planes[0], Samples<T>::s_nNumPlanes);
+    }
+    Samples<T>& s;
+};
+
+template <typename T>
+struct IsOBBinPlanesSimdFn
+{
+    IsOBBinPlanesSimdFn(Samples<T>& s) : s(s) {
+    }
+    void operator()(int i) {
+        s.outsimd[12*i] = simd::IsOBBinPlanes(&s.vecs[4*i], &s.mats[12*i], &s.mats[12*i+4], &s.mats[12*i+8], &s.extents[4*i], &s.planes[0], Samples<T>::s_nNumPlanes);
+    }
+    Samples<T>& s;
+};
+
+/// \brief runs the scalar and simd kernel and prints the timings, returns false if the results differ
+template <typename T, typename ScalarFn, typename SimdFn>
+static bool _Compare(const char* name, Samples<T>& s, int numiterations, int numvalues, int numcompare)
+{
+    std::fill(s.outscalar.begin(), s.outscalar.end(), T(0));
+    std::fill(s.outsimd.begin(), s.outsimd.end(), T(0));
+    std::fill(s.outtransscalar.begin(), s.outtransscalar.end(), T(0));
+    std::fill(s.outtranssimd.begin(), s.outtranssimd.end(), T(0));
+    double fscalar = _Time(ScalarFn(s), numiterations);
+    double fsimd = _Time(SimdFn(s), numiterations);
+    bool bequal = true;
+    for(int i = 0; i < s_nNumSamples; ++i) {
+        if( memcmp(&s.outscalar[numvalues*i], &s.outsimd[numvalues*i], numcompare*sizeof(T)) != 0 || memcmp(&s.outtransscalar[4*i], &s.outtranssimd[4*i], 3*sizeof(T)) != 0 ) {
+            bequal = false;
+            break;
+        }
+    }
+    cout << name << "<" << (sizeof(T) == sizeof(double) ? "double" : "float") << ">: scalar=" << fscalar << "ns, simd=" << fsimd << "ns, speedup=" << (fsimd > 0 ? fscalar/fsimd : 0) << (bequal ? "" : ", RESULTS DIFFER") << endl;
+    return bequal;
+}
+
+int main(int argc, char ** argv)
+{
+    int numiterations = argc > 1 ? atoi(argv[1]) : 2000;
+#ifdef __AVX2__
+    cout << "double kernels: AVX2" << endl;
+#else
+    cout << "double kernels: SSE2" << endl;
+#endif
+    // only the kernels that geometry.h dispatches to
+    Samples<float> sfloat;
+    bool bsuccess = true;
+    bsuccess &= _Compare<float, QuatMultiplyScalarFn<float>, QuatMultiplySimdFn<float> >("QuatMultiply", sfloat, numiterations, 4, 4);
+    bsuccess &= _Compare<float, MatrixMultiplyScalarFn<float>, MatrixMultiplySimdFn<float> >("MatrixMultiply", sfloat, numiterations, 12, 12);
+    bsuccess &= _Compare<float, MatrixInverseScalarFn<float>, MatrixInverseSimdFn<float> >("MatrixInverse", sfloat, numiterations, 12, 12);
+    bsuccess &= _Compare<float, IsOBBinPlanesScalarFn<float>, IsOBBinPlanesSimdFn<float> >("IsOBBinPlanes", sfloat, numiterations, 12, 1);
+    Samples<double> sdouble;
+    bsuccess &= _Compare<double, MatrixMultiplyScalarFn<double>, MatrixMultiplySimdFn<double> >("MatrixMultiply", sdouble, numiterations, 12, 12);
+#ifdef __AVX2__
+    bsuccess &= _Compare<double, MatrixInverseScalarFn<double>, MatrixInverseSimdFn<double> >("MatrixInverse", sdouble, numiterations, 12, 12);
+#endif
+    bsuccess &= _Compare<double, IsOBBinPlanesScalarFn<double>, IsOBBinPlanesSimdFn<double> >("IsOBBinPlanes", sdouble, numiterations, 12, 1);
+    return bsuccess ? 0 : 1;
+}
+
+#endif
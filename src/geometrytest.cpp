@@ -0,0 +1,120 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2011 Rosen Diankov (rosen.diankov@gmail.com)
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/// \brief checks that IsOBBinConvexHull with the planes stored as a structure of arrays gives the same results as with a vector of planes, for random boxes and 1 to 9 planes.
+///
+/// usage: geometrytest [numboxes]
+#include <openrave/config.h>
+#include <openrave/geometry.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+using namespace OpenRAVE::geometry;
+using namespace std;
+
+template <typename T>
+static T RandomReal(T fmin, T fmax)
+{
+    return fmin + (fmax-fmin)*T(rand())/T(RAND_MAX);
+}
+
+template <typename T>
+static RaveVector<T> RandomDirection()
+{
+    RaveVector<T> v(RandomReal<T>(-1,1), RandomReal<T>(-1,1), RandomReal<T>(-1,1));
+    return v.normalize3();
+}
+
+/// \brief returns the smallest distance of the box to one of the plane boundaries used by IsOBBinConvexHull, computed in double
+template <typename T>
+static double ComputeMinMargin(const obb<T>& o, const std::vector< RaveVector<T> >& vplanes)
+{
+    double fmin = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < vplanes.size(); ++i) {
+        RaveVector<double> p(vplanes[i].x, vplanes[i].y, vplanes[i].z, vplanes[i].w), pos(o.pos.x, o.pos.y, o.pos.z), right(o.right.x, o.right.y, o.right.z), up(o.up.x, o.up.y, o.up.z), dir(o.dir.x, o.dir.y, o.dir.z);
+        double fmargin = pos.dot3(p) + p.w - (o.extents.x*fabs(p.dot3(right)) + o.extents.y*fabs(p.dot3(up)) + o.extents.z*fabs(p.dot3(dir)));
+        fmin = min(fmin, fabs(fmargin));
+    }
+    return fmin;
+}
+
+/// \brief returns false if the two overloads disagree on a box that is not within the rounding error of a plane
+template <typename T>
+static bool CheckIsOBBinConvexHull(int numboxes, const char* name)
+{
+    // FMA contraction under AVX2 may change the last bit, so the overloads may disagree when the box touches a plane
+    const double fEpsilon = 64*std::numeric_limits<T>::epsilon();
+    std::vector< RaveVector<T> > vplanes;
+    std::vector<T> vsoaplanes;
+    int numinside = 0, numoutside = 0, numtouching = 0;
+    bool bsuccess = true;
+    for(int ibox = 0; ibox < numboxes; ++ibox) {
+        size_t numplanes = 1 + ibox%9;
+        obb<T> o;
+        o.pos = RaveVector<T>(RandomReal<T>(-0.5,0.5), RandomReal<T>(-0.5,0.5), RandomReal<T>(-0.5,0.5));
+        RaveTransformMatrix<T> m = matrixFromQuat(quatFromAxisAngle(RandomDirection<T>()*RandomReal<T>(0,3)));
+        o.right = m.rotate(RaveVector<T>(1,0,0));
+        o.up = m.rotate(RaveVector<T>(0,1,0));
+        o.dir = m.rotate(RaveVector<T>(0,0,1));
+        o.extents = RaveVector<T>(RandomReal<T>(0,0.4), RandomReal<T>(0,0.4), RandomReal<T>(0,0.4));
+        // planes at distance 0.5 to 1.5 from the origin facing inside, so that the boxes fall on both sides
+        vplanes.resize(numplanes);
+        vsoaplanes.resize(4*numplanes);
+        for(size_t i = 0; i < numplanes; ++i) {
+            vplanes[i] = RandomDirection<T>();
+            vplanes[i].w = RandomReal<T>(0.5,1.5);
+            vsoaplanes[i] = vplanes[i].x;
+            vsoaplanes[numplanes+i] = vplanes[i].y;
+            vsoaplanes[2*numplanes+i] = vplanes[i].z;
+            vsoaplanes[3*numplanes+i] = vplanes[i].w;
+        }
+        bool binside = IsOBBinConvexHull(o, vplanes);
+        if( IsOBBinConvexHull(o, &vsoaplanes[0], numplanes) != binside ) {
+            if( ComputeMinMargin(o, vplanes) > fEpsilon ) {
+                cerr << name << ": box " << ibox << " with " << numplanes << " planes is " << (binside ? "inside" : "outside") << " for the vector of planes only" << endl;
+                bsuccess = false;
+            }
+            ++numtouching;
+        }
+        else if( binside ) {
+            ++numinside;
+        }
+        else {
+            ++numoutside;
+        }
+    }
+    if( numinside == 0 || numoutside == 0 ) {
+        cerr << name << ": the boxes are not distributed on both sides, " << numinside << " inside and " << numoutside << " outside" << endl;
+        bsuccess = false;
+    }
+    cout << name << ": " << numinside << " inside, " << numoutside << " outside, " << numtouching << " touching a plane" << endl;
+    return bsuccess;
+}
+
+int main(int argc, char ** argv)
+{
+    int numboxes = argc > 1 ? atoi(argv[1]) : 100000;
+    srand(0);
+    bool bsuccess = CheckIsOBBinConvexHull<float>(numboxes, "float");
+    bsuccess &= CheckIsOBBinConvexHull<double>(numboxes, "double");
+    cout << (bsuccess ? "IsOBBinConvexHull gives the same results for both plane layouts" : "IsOBBinConvexHull differs between the plane layouts") << endl;
+    return bsuccess ? 0 : 1;
+}
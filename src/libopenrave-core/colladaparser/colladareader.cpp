@@ -23,6 +23,136 @@ namespace OpenRAVE
 
 using namespace ColladaDOM150;
 
+/// \brief threads that process the pending geometries of the readers, see ColladaReader::_ProcessPendingGeometries
+///
+/// The threads are created on demand and kept between loads so that every load does not start and join its own threads. Only used while GetGlobalDAEMutex is locked, stopped by RaveDestroy.
+class ColladaGeometryWorkers
+{
+public:
+    ColladaGeometryWorkers() : _nJobId(0), _nNumJobThreads(0), _nThreadsBusy(0), _bShutdown(false) {
+    }
+    ~ColladaGeometryWorkers() {
+        Stop();
+    }
+
+    /// \brief calls fn on numthreads-1 worker threads and on the calling thread, and returns once all calls have returned
+    ///
+    /// \throw openrave_exception if any of the worker calls threw
+    void Run(const boost::function<void()>& fn, size_t numthreads)
+    {
+        while( _vthreads.size()+1 < numthreads ) {
+            _vthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&ColladaGeometryWorkers::_ThreadLoop, this, _vthreads.size(), _nJobId))));
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _fn = fn;
+            _errormessage.clear();
+            _nNumJobThreads = numthreads > 0 ? numthreads-1 : 0;
+            _nThreadsBusy = _nNumJobThreads;
+            ++_nJobId;
+            _condHasJob.notify_all();
+        }
+        std::string errormessage;
+        try {
+            fn();
+        }
+        catch(const std::exception& ex) {
+            errormessage = ex.what();
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            while(_nThreadsBusy > 0) {
+                _condJobDone.wait(lock);
+            }
+            _fn.clear();
+            if( errormessage.size() == 0 ) {
+                errormessage.swap(_errormessage);
+            }
+        }
+        if( errormessage.size() > 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("failed to process collada geometries: %s", errormessage, ORE_Failed);
+        }
+    }
+
+    void Stop()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bShutdown = true;
+            _condHasJob.notify_all();
+        }
+        FOREACH(itthread, _vthreads) {
+            (*itthread)->join();
+        }
+        _vthreads.clear();
+        _bShutdown = false;
+    }
+
+private:
+    void _ThreadLoop(size_t ithread, uint64_t lastjobid)
+    {
+        while(1) {
+            boost::function<void()> fn;
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while(!_bShutdown && (_nJobId == lastjobid || ithread >= _nNumJobThreads) ) {
+                    lastjobid = _nJobId; // skip jobs that do not need this thread
+                    _condHasJob.wait(lock);
+                }
+                if( _bShutdown ) {
+                    return;
+                }
+                lastjobid = _nJobId;
+                fn = _fn;
+            }
+
+            std::string errormessage;
+            try {
+                fn();
+            }
+            catch(const std::exception& ex) {
+                errormessage = ex.what();
+            }
+
+            boost::mutex::scoped_lock lock(_mutex);
+            if( errormessage.size() > 0 && _errormessage.size() == 0 ) {
+                _errormessage = errormessage;
+            }
+            if( --_nThreadsBusy == 0 ) {
+                _condJobDone.notify_all();
+            }
+        }
+    }
+
+    std::vector< boost::shared_ptr<boost::thread> > _vthreads;
+    boost::mutex _mutex; ///< protects the job state below
+    boost::condition _condHasJob, _condJobDone;
+    boost::function<void()> _fn; ///< job of the current Run call
+    std::string _errormessage; ///< first error of the worker threads in the current job
+    uint64_t _nJobId; ///< incremented for every job
+    size_t _nNumJobThreads; ///< the threads with an index below this take part in the current job
+    size_t _nThreadsBusy; ///< number of threads still running the current job
+    bool _bShutdown;
+};
+
+static ColladaGeometryWorkers* s_pColladaGeometryWorkers = NULL;
+
+static void _DestroyColladaGeometryWorkers()
+{
+    delete s_pColladaGeometryWorkers;
+    s_pColladaGeometryWorkers = NULL;
+}
+
+/// \brief returns the geometry workers, GetGlobalDAEMutex has to be locked
+static ColladaGeometryWorkers& _GetColladaGeometryWorkers()
+{
+    if( !s_pColladaGeometryWorkers ) {
+        s_pColladaGeometryWorkers = new ColladaGeometryWorkers();
+        RaveAddCallbackForDestroy(_DestroyColladaGeometryWorkers);
+    }
+    return *s_pColladaGeometryWorkers;
+}
+
 class ColladaReader : public daeErrorHandler
 {
 public:
@@ -326,9 +456,61 @@ public:
         return _InitPostOpen(atts);
     }
 
+    /// \brief returns the local files of the documents opened by the reader, including the external documents that were resolved while extracting
+    ///
+    /// Documents extracted from a zae are skipped since they live in a temporary directory, the zae file itself is passed by the caller.
+    void GetReferencedFiles(std::set<std::string>& setfilenames) const
+    {
+        daeDatabase* database = _dae->getDatabase();
+        daeUInt num = database->getDocumentCount();
+        for(daeUInt i = 0; i < num; ++i) {
+            daeDocument* doc = database->getDocument(i);
+            if( !doc || !doc->getDocumentURI() || doc->isZAERootDocument() || doc->getExtractedFileURI().str().size() > 0 ) {
+                continue;
+            }
+            const daeURI& docuri = *doc->getDocumentURI();
+            if( docuri.scheme() != "file" ) {
+                continue;
+            }
+            std::string filename = cdom::uriToFilePath(docuri.path());
+            if( filename.size() > 0 ) {
+                setfilenames.insert(filename);
+            }
+        }
+    }
+
+    /// \brief returns the local file that InitFromURI would open for uristr, or an empty string if the uri is not a local file
+    static std::string ResolveLocalFileFromURI(const std::string& uristr, const AttributesList& atts)
+    {
+        std::vector<std::string> vOpenRAVESchemeAliases;
+        FOREACHC(itatt,atts) {
+            if( itatt->first == "openravescheme" ) {
+                stringstream ss(itatt->second);
+                vOpenRAVESchemeAliases = std::vector<std::string>((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+            }
+        }
+        if( vOpenRAVESchemeAliases.size() == 0 ) {
+            vOpenRAVESchemeAliases.push_back("openrave");
+        }
+
+        std::string scheme, authority, path, query, fragment;
+        if( !cdom::parseUriRef(uristr, scheme, authority, path, query, fragment) || path.size() == 0 ) {
+            return std::string();
+        }
+        if( find(vOpenRAVESchemeAliases.begin(),vOpenRAVESchemeAliases.end(),scheme) != vOpenRAVESchemeAliases.end() ) {
+            // remove first slash because we need relative file
+            return RaveFindLocalFile(path.at(0) == '/' ? path.substr(1) : path, "/");
+        }
+        if( scheme.size() == 0 || scheme == "file" ) {
+            return cdom::uriToFilePath(path);
+        }
+        return std::string();
+    }
+
     bool _InitPreOpen(const AttributesList& atts)
     {
         _mapInstantiatedNodes.clear();
+        _vPendingGeometries.clear();
         RAVELOG_VERBOSE(str(boost::format("init COLLADA reader version: %s, namespace: %s\n")%COLLADA_VERSION%COLLADA_NAMESPACE));
         _dae = GetGlobalDAE();
         _bSkipGeometry = false;
@@ -359,6 +541,9 @@ public:
             }
             else if( itatt->first == "scalegeometry" ) {
             }
+            else if( itatt->first == "cache" ) {
+                // processed by RaveParseCollada*
+            }
             else {
                 //RAVELOG_WARN(str(boost::format("collada reader unprocessed attribute pair: %s:%s")%itatt->first%itatt->second));
                 if( !!_dae->getIOPlugin() ) {
@@ -812,6 +997,7 @@ public:
             }
         }
 
+        _ProcessPendingGeometries();
         if( bSuccess ) {
             if( _prefix.size() > 0 ) {
                 _AddPrefixForKinBody(probot,_prefix);
@@ -903,6 +1089,7 @@ public:
             }
         }
         if( bSuccess ) {
+            _ProcessPendingGeometries();
             return true;
         }
 
@@ -920,6 +1107,7 @@ public:
             }
         }
 
+        _ProcessPendingGeometries();
         if( bSuccess && _prefix.size() > 0 ) {
             _AddPrefixForKinBody(pbody,_prefix);
         }
@@ -2183,24 +2371,73 @@ public:
                 itgeominfo->_vGeomData.y *= vscale.z;
                 break;
             case GT_TriMesh:
-                itgeominfo->_meshcollision.ApplyTransform(TransformMatrix(tmnodegeom * toriginal).inverse() * TransformMatrix(toriginal));
                 break;
             default:
                 RAVELOG_WARN(str(boost::format("unknown geometry type: 0x%x")%itgeominfo->_type));
             }
 
             KinBody::Link::GeometryPtr pgeom(new KinBody::Link::Geometry(plink,*itgeominfo));
-            pgeom->_info.InitCollisionMesh();
             plink->_vGeometries.push_back(pgeom);
-            //  Append the collision mesh
-            TriMesh trimesh = pgeom->GetCollisionMesh();
-            trimesh.ApplyTransform(pgeom->_info._t);
-            plink->_collision.Append(trimesh);
+            // the collision meshes are transformed, triangulated, and appended to the link in _ProcessPendingGeometries
+            _vPendingGeometries.push_back(PendingGeometry());
+            _vPendingGeometries.back().pgeom = pgeom;
+            _vPendingGeometries.back().bTransformMesh = itgeominfo->_type == GT_TriMesh;
+            if( _vPendingGeometries.back().bTransformMesh ) {
+                _vPendingGeometries.back().tmesh = TransformMatrix(tmnodegeom * toriginal).inverse() * TransformMatrix(toriginal);
+            }
         }
 
         return bhasgeometry || listGeometryInfos.size() > 0;
     }
 
+    /// \brief transforms and triangulates the collision meshes of all geometries extracted by ExtractGeometries and appends them to the collision data of their links.
+    ///
+    /// The geometries are independent from each other and from the DOM, so they are processed by several threads when there are enough of them. The meshes are appended in the order the geometries were extracted.
+    void _ProcessPendingGeometries()
+    {
+        if( _vPendingGeometries.size() == 0 ) {
+            return;
+        }
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        _nNextPendingGeometry = 0;
+        int numthreads = min((int)boost::thread::hardware_concurrency(), (int)(_vPendingGeometries.size()/8));
+        if( numthreads > 1 ) {
+            _GetColladaGeometryWorkers().Run(boost::bind(&ColladaReader::_ProcessPendingGeometriesThread, this), numthreads);
+        }
+        else {
+            _ProcessPendingGeometriesThread();
+        }
+        FOREACH(itpending, _vPendingGeometries) {
+            KinBody::LinkPtr plink = itpending->pgeom->_parent.lock();
+            if( !!plink ) {
+                plink->_collision.Append(itpending->trimesh);
+            }
+        }
+        RAVELOG_VERBOSE_FORMAT("processed %d geometries with %d threads in %fs", _vPendingGeometries.size()%max(1,numthreads)%(1e-9*(utils::GetNanoPerformanceTime()-starttime)));
+        _vPendingGeometries.clear();
+    }
+
+    void _ProcessPendingGeometriesThread()
+    {
+        while(1) {
+            size_t index;
+            {
+                boost::mutex::scoped_lock lock(_mutexPendingGeometries);
+                if( _nNextPendingGeometry >= _vPendingGeometries.size() ) {
+                    break;
+                }
+                index = _nNextPendingGeometry++;
+            }
+            PendingGeometry& pending = _vPendingGeometries[index];
+            if( pending.bTransformMesh ) {
+                pending.pgeom->_info._meshcollision.ApplyTransform(pending.tmesh);
+            }
+            pending.pgeom->_info.InitCollisionMesh();
+            pending.trimesh = pending.pgeom->GetCollisionMesh();
+            pending.trimesh.ApplyTransform(pending.pgeom->_info._t);
+        }
+    }
+
     /// Paint the Geometry with the color material
     /// \param  pmat    Material info of the COLLADA's model
     /// \param  geom    Geometry properties in OpenRAVE
@@ -5057,11 +5294,157 @@ private:
     std::map<std::string,daeURI> _mapInverseResolvedURIList; ///< holds a list of inverse resolved relationships file:// -> openrave://
     std::map<domNodeRef, std::pair<domInstance_nodeRef, std::string> > _mapInstantiatedNodes; ///< holds a map of the instantiated (cloned) node and the original instance_node elements. Also contains the idsuffix used to instantiate the node.
 
+    /// \brief a geometry whose collision mesh still has to be processed by _ProcessPendingGeometries
+    struct PendingGeometry
+    {
+        PendingGeometry() : bTransformMesh(false) {
+        }
+        KinBody::Link::GeometryPtr pgeom;
+        TransformMatrix tmesh; ///< applied to the mesh of trimesh geometries
+        bool bTransformMesh;
+        TriMesh trimesh; ///< the collision mesh in the link coordinate system
+    };
+    std::vector<PendingGeometry> _vPendingGeometries; ///< geometries extracted by ExtractGeometries in order
+    size_t _nNextPendingGeometry; ///< the next geometry to be processed by _ProcessPendingGeometriesThread
+    boost::mutex _mutexPendingGeometries;
+
     bool _bOpeningZAE; ///< true if currently opening a zae
     bool _bSkipGeometry;
     bool _bBackCompatValuesInRadians; ///< if true, will assume the speed, acceleration, and dofvalues are in radians instead of degrees (for back compat)
 };
 
+/// \brief process-wide cache of the bodies extracted from COLLADA files and data, protected by GetGlobalDAEMutex
+///
+/// The entries are keyed by the MD5 hash of the COLLADA data, the loading attributes, and the unit of the environment. Loading the same data again clones the cached body into the new environment instead of parsing the DOM. The entries also store the MD5 hashes of the external documents that were opened while extracting the body, and are dropped when one of them changes. The cache can be disabled with the "cache" attribute set to "0" or "false".
+///
+/// The cached bodies are clones with their sensors that belong to a private environment, so that the cache does not keep the environments the bodies were loaded in alive.
+struct ColladaBodyCacheEntry
+{
+    KinBodyPtr pbody;
+    std::vector< std::pair<std::string, std::string> > vdependencies; ///< (filename, MD5 hash of the contents) of every document the body was extracted from
+};
+static std::map<std::string, ColladaBodyCacheEntry> s_mapColladaBodyCache;
+static std::list<std::string> s_listColladaBodyCacheKeys; ///< the keys of s_mapColladaBodyCache from oldest to newest
+static const size_t s_nMaxColladaBodyCacheSize = 32;
+static EnvironmentBasePtr s_penvColladaBodyCache; ///< owns the cached bodies, never has bodies added to it
+
+static void _ClearColladaBodyCache()
+{
+    s_mapColladaBodyCache.clear();
+    s_listColladaBodyCacheKeys.clear();
+    s_penvColladaBodyCache.reset();
+}
+
+/// \brief the cloning options of the cached bodies. Robots keep their attached sensors.
+static const int s_nColladaBodyCacheCloningOptions = Clone_Bodies|Clone_Sensors;
+
+static bool _IsColladaBodyCacheEnabled(const AttributesList& atts)
+{
+    FOREACHC(itatt, atts) {
+        if( itatt->first == "cache" ) {
+            return !(_stricmp(itatt->second.c_str(), "false") == 0 || itatt->second == "0");
+        }
+    }
+    return true;
+}
+
+static std::string _GetColladaBodyCacheKey(EnvironmentBasePtr penv, const std::string& bodytype, const std::string& data, const AttributesList& atts)
+{
+    std::stringstream ss;
+    ss << bodytype << " " << penv->GetUnit().first << " " << penv->GetUnit().second << " " << utils::GetMD5HashString(data);
+    FOREACHC(itatt, atts) {
+        ss << " " << itatt->first << "=" << itatt->second;
+    }
+    return ss.str();
+}
+
+/// \brief returns the contents of a file, or an empty string if it cannot be read
+static std::string _ReadColladaFileContents(const std::string& filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::in|std::ios::binary);
+    if( !f ) {
+        return std::string();
+    }
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+/// \brief if key is in the cache, clones the cached body into penv
+template <typename T>
+static bool _CloneFromColladaBodyCache(EnvironmentBasePtr penv, const std::string& key, boost::shared_ptr<T>& pbody)
+{
+    std::map<std::string, ColladaBodyCacheEntry>::iterator it = s_mapColladaBodyCache.find(key);
+    if( it == s_mapColladaBodyCache.end() ) {
+        return false;
+    }
+    uint64_t starttime = utils::GetNanoPerformanceTime();
+    FOREACHC(itdependency, it->second.vdependencies) {
+        if( utils::GetMD5HashString(_ReadColladaFileContents(itdependency->first)) != itdependency->second ) {
+            RAVELOG_VERBOSE_FORMAT("collada file %s changed, so removing it from the cache", itdependency->first);
+            s_listColladaBodyCacheKeys.remove(key);
+            s_mapColladaBodyCache.erase(it);
+            return false;
+        }
+    }
+    KinBodyPtr pcachedbody = it->second.pbody;
+    KinBodyPtr pnewbody;
+    if( pcachedbody->IsRobot() ) {
+        pnewbody = RaveCreateRobot(penv, pcachedbody->GetXMLId());
+    }
+    else {
+        pnewbody = RaveCreateKinBody(penv, "");
+    }
+    boost::shared_ptr<T> pnewbodyt = RaveInterfaceCast<T>(pnewbody);
+    if( !pnewbodyt ) {
+        return false;
+    }
+    pnewbody->Clone(pcachedbody, s_nColladaBodyCacheCloningOptions);
+    pbody = pnewbodyt;
+    RAVELOG_VERBOSE_FORMAT("cloned cached collada body %s in %fs", pbody->GetName()%(1e-9*(utils::GetNanoPerformanceTime()-starttime)));
+    return true;
+}
+
+/// \brief stores a copy of pbody in the cache so that later changes to pbody do not affect it
+///
+/// \param reader the reader that extracted pbody, its documents are recorded as the dependencies of the entry
+static void _AddToColladaBodyCache(const std::string& key, KinBodyPtr pbody, const ColladaReader& reader)
+{
+    if( s_mapColladaBodyCache.find(key) != s_mapColladaBodyCache.end() ) {
+        return;
+    }
+    if( !s_penvColladaBodyCache ) {
+        s_penvColladaBodyCache = RaveCreateEnvironment(0);
+    }
+    KinBodyPtr pcachedbody;
+    if( pbody->IsRobot() ) {
+        pcachedbody = RaveCreateRobot(s_penvColladaBodyCache, pbody->GetXMLId());
+    }
+    else {
+        pcachedbody = RaveCreateKinBody(s_penvColladaBodyCache, "");
+    }
+    if( !pcachedbody ) {
+        return;
+    }
+    pcachedbody->Clone(pbody, s_nColladaBodyCacheCloningOptions);
+    std::set<std::string> setfilenames;
+    reader.GetReferencedFiles(setfilenames);
+    ColladaBodyCacheEntry entry;
+    entry.pbody = pcachedbody;
+    FOREACHC(itfilename, setfilenames) {
+        entry.vdependencies.push_back(std::make_pair(*itfilename, utils::GetMD5HashString(_ReadColladaFileContents(*itfilename))));
+    }
+    if( s_mapColladaBodyCache.size() == 0 ) {
+        RaveAddCallbackForDestroy(_ClearColladaBodyCache);
+    }
+    while( s_listColladaBodyCacheKeys.size() >= s_nMaxColladaBodyCacheSize ) {
+        s_mapColladaBodyCache.erase(s_listColladaBodyCacheKeys.front());
+        s_listColladaBodyCacheKeys.pop_front();
+    }
+    s_mapColladaBodyCache[key] = entry;
+    s_listColladaBodyCacheKeys.push_back(key);
+}
+
 bool RaveParseColladaURI(EnvironmentBasePtr penv, const std::string& uri,const AttributesList& atts)
 {
     boost::mutex::scoped_lock lock(GetGlobalDAEMutex());
@@ -5075,27 +5458,53 @@ bool RaveParseColladaURI(EnvironmentBasePtr penv, const std::string& uri,const A
 bool RaveParseColladaURI(EnvironmentBasePtr penv, KinBodyPtr& pbody, const string& uri, const AttributesList& atts)
 {
     boost::mutex::scoped_lock lock(GetGlobalDAEMutex());
-    ColladaReader reader(penv);
-    if (!reader.InitFromURI(uri,atts)) {
-        return false;
-    }
     // have to extract the fragment
     std::string scheme, authority, path, query, fragment;
     cdom::parseUriRef(uri, scheme, authority, path, query, fragment);
-    return reader.Extract(pbody, fragment);
+    std::string cachekey;
+    if( !pbody && _IsColladaBodyCacheEnabled(atts) ) {
+        std::string filename = ColladaReader::ResolveLocalFileFromURI(uri, atts);
+        if( filename.size() > 0 ) {
+            cachekey = _GetColladaBodyCacheKey(penv, std::string("kinbody#") + fragment, _ReadColladaFileContents(filename), atts);
+            if( _CloneFromColladaBodyCache(penv, cachekey, pbody) ) {
+                return true;
+            }
+        }
+    }
+    ColladaReader reader(penv);
+    if( !reader.InitFromURI(uri,atts) || !reader.Extract(pbody, fragment) ) {
+        return false;
+    }
+    if( cachekey.size() > 0 ) {
+        _AddToColladaBodyCache(cachekey, pbody, reader);
+    }
+    return true;
 }
 
 bool RaveParseColladaURI(EnvironmentBasePtr penv, RobotBasePtr& probot, const string& uri, const AttributesList& atts)
 {
     boost::mutex::scoped_lock lock(GetGlobalDAEMutex());
-    ColladaReader reader(penv);
-    if (!reader.InitFromURI(uri,atts)) {
-        return false;
-    }
     // have to extract the fragment
     std::string scheme, authority, path, query, fragment;
     cdom::parseUriRef(uri, scheme, authority, path, query, fragment);
-    return reader.Extract(probot, fragment);
+    std::string cachekey;
+    if( !probot && _IsColladaBodyCacheEnabled(atts) ) {
+        std::string filename = ColladaReader::ResolveLocalFileFromURI(uri, atts);
+        if( filename.size() > 0 ) {
+            cachekey = _GetColladaBodyCacheKey(penv, std::string("robot#") + fragment, _ReadColladaFileContents(filename), atts);
+            if( _CloneFromColladaBodyCache(penv, cachekey, probot) ) {
+                return true;
+            }
+        }
+    }
+    ColladaReader reader(penv);
+    if( !reader.InitFromURI(uri,atts) || !reader.Extract(probot, fragment) ) {
+        return false;
+    }
+    if( cachekey.size() > 0 ) {
+        _AddToColladaBodyCache(cachekey, probot, reader);
+    }
+    return true;
 }
 
 bool RaveParseColladaFile(EnvironmentBasePtr penv, const string& filename, const AttributesList& atts)
@@ -5114,10 +5523,23 @@ bool RaveParseColladaFile(EnvironmentBasePtr penv, KinBodyPtr& pbody, const stri
     boost::mutex::scoped_lock lock(GetGlobalDAEMutex());
     ColladaReader reader(penv);
     string filedata = RaveFindLocalFile(filename);
-    if (filedata.size() == 0 || !reader.InitFromFile(filedata,atts)) {
+    if (filedata.size() == 0) {
+        return false;
+    }
+    std::string cachekey;
+    if( !pbody && _IsColladaBodyCacheEnabled(atts) ) {
+        cachekey = _GetColladaBodyCacheKey(penv, "kinbody", _ReadColladaFileContents(filedata), atts);
+        if( _CloneFromColladaBodyCache(penv, cachekey, pbody) ) {
+            return true;
+        }
+    }
+    if( !reader.InitFromFile(filedata,atts) || !reader.Extract(pbody) ) {
         return false;
     }
-    return reader.Extract(pbody);
+    if( cachekey.size() > 0 ) {
+        _AddToColladaBodyCache(cachekey, pbody, reader);
+    }
+    return true;
 }
 
 bool RaveParseColladaFile(EnvironmentBasePtr penv, RobotBasePtr& probot, const string& filename,const AttributesList& atts)
@@ -5125,10 +5547,23 @@ bool RaveParseColladaFile(EnvironmentBasePtr penv, RobotBasePtr& probot, const s
     boost::mutex::scoped_lock lock(GetGlobalDAEMutex());
     ColladaReader reader(penv);
     string filedata = RaveFindLocalFile(filename);
-    if (filedata.size() == 0 || !reader.InitFromFile(filedata,atts)) {
+    if (filedata.size() == 0) {
         return false;
     }
-    return reader.Extract(probot);
+    std::string cachekey;
+    if( !probot && _IsColladaBodyCacheEnabled(atts) ) {
+        cachekey = _GetColladaBodyCacheKey(penv, "robot", _ReadColladaFileContents(filedata), atts);
+        if( _CloneFromColladaBodyCache(penv, cachekey, probot) ) {
+            return true;
+        }
+    }
+    if( !reader.InitFromFile(filedata,atts) || !reader.Extract(probot) ) {
+        return false;
+    }
+    if( cachekey.size() > 0 ) {
+        _AddToColladaBodyCache(cachekey, probot, reader);
+    }
+    return true;
 }
 
 bool RaveParseColladaData(EnvironmentBasePtr penv, const string& pdata,const AttributesList& atts)
@@ -5144,6 +5579,13 @@ bool RaveParseColladaData(EnvironmentBasePtr penv, const string& pdata,const Att
 bool RaveParseColladaData(EnvironmentBasePtr penv, KinBodyPtr& pbody, const string& pdata,const AttributesList& atts)
 {
     boost::mutex::scoped_lock lock(GetGlobalDAEMutex());
+    std::string cachekey;
+    if( !pbody && _IsColladaBodyCacheEnabled(atts) ) {
+        cachekey = _GetColladaBodyCacheKey(penv, "kinbody", pdata, atts);
+        if( _CloneFromColladaBodyCache(penv, cachekey, pbody) ) {
+            return true;
+        }
+    }
     ColladaReader reader(penv);
     if (!reader.InitFromData(pdata,atts)) {
         return false;
@@ -5156,12 +5598,25 @@ bool RaveParseColladaData(EnvironmentBasePtr penv, KinBodyPtr& pbody, const stri
         }
     }
 
-    return reader.Extract(pbody, articulatedSystemId);
+    if( !reader.Extract(pbody, articulatedSystemId) ) {
+        return false;
+    }
+    if( cachekey.size() > 0 ) {
+        _AddToColladaBodyCache(cachekey, pbody, reader);
+    }
+    return true;
 }
 
 bool RaveParseColladaData(EnvironmentBasePtr penv, RobotBasePtr& probot, const string& pdata,const AttributesList& atts)
 {
     boost::mutex::scoped_lock lock(GetGlobalDAEMutex());
+    std::string cachekey;
+    if( !probot && _IsColladaBodyCacheEnabled(atts) ) {
+        cachekey = _GetColladaBodyCacheKey(penv, "robot", pdata, atts);
+        if( _CloneFromColladaBodyCache(penv, cachekey, probot) ) {
+            return true;
+        }
+    }
     ColladaReader reader(penv);
     if (!reader.InitFromData(pdata,atts)) {
         return false;
@@ -5178,7 +5633,13 @@ bool RaveParseColladaData(EnvironmentBasePtr penv, RobotBasePtr& probot, const s
         }
     }
 
-    return reader.Extract(probot, articulatedSystemId);
+    if( !reader.Extract(probot, articulatedSystemId) ) {
+        return false;
+    }
+    if( cachekey.size() > 0 ) {
+        _AddToColladaBodyCache(cachekey, probot, reader);
+    }
+    return true;
 }
 
 // register for typeof (MSVC only)
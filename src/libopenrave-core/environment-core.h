@@ -118,6 +118,7 @@ public:
 
         _nBodiesModifiedStamp = 0;
         _nEnvironmentIndex = 1;
+        _pPublishedBodies.reset(new PublishedBodies());
 
         _fDeltaSimTime = 0.01f;
         _nCurSimTime = 0;
@@ -275,7 +276,7 @@ public:
                     (*itrobot)->Destroy();
                 }
                 _vecrobots.clear();
-                _vPublishedBodies.clear();
+                _ClearPublishedBodies();
                 _nBodiesModifiedStamp++;
                 FOREACH(itsensor,_listSensors) {
                     (*itsensor)->Configure(SensorBase::CC_PowerOff);
@@ -335,7 +336,7 @@ public:
                 vcallbackbodies.insert(vcallbackbodies.end(), _vecrobots.begin(), _vecrobots.end());
             }
             _vecrobots.clear();
-            _vPublishedBodies.clear();
+            _ClearPublishedBodies();
             _nBodiesModifiedStamp++;
 
             _mapBodies.clear();
@@ -943,6 +944,7 @@ public:
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(pbody1);
         return _pCurrentChecker->CheckCollision(pbody1,report);
@@ -950,6 +952,7 @@ public:
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, KinBodyConstPtr pbody2, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(pbody1);
         CHECK_COLLISION_BODY(pbody2);
@@ -958,6 +961,7 @@ public:
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report )
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(plink->GetParent());
         return _pCurrentChecker->CheckCollision(plink,report);
@@ -965,6 +969,7 @@ public:
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(plink1->GetParent());
         CHECK_COLLISION_BODY(plink2->GetParent());
@@ -973,6 +978,7 @@ public:
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(plink->GetParent());
         CHECK_COLLISION_BODY(pbody);
@@ -981,6 +987,7 @@ public:
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(plink->GetParent());
         return _pCurrentChecker->CheckCollision(plink,vbodyexcluded,vlinkexcluded,report);
@@ -988,6 +995,7 @@ public:
 
     virtual bool CheckCollision(KinBodyConstPtr pbody, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(pbody);
         return _pCurrentChecker->CheckCollision(pbody,vbodyexcluded,vlinkexcluded,report);
@@ -995,23 +1003,27 @@ public:
 
     virtual bool CheckCollision(const RAY& ray, KinBody::LinkConstPtr plink, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollisionRay");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(plink->GetParent());
         return _pCurrentChecker->CheckCollision(ray,plink,report);
     }
     virtual bool CheckCollision(const RAY& ray, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollisionRay");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(pbody);
         return _pCurrentChecker->CheckCollision(ray,pbody,report);
     }
     virtual bool CheckCollision(const RAY& ray, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckCollisionRay");
         return _pCurrentChecker->CheckCollision(ray,report);
     }
 
     virtual bool CheckStandaloneSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report)
     {
+        OPENRAVE_PROFILING_SCOPE("Environment.CheckStandaloneSelfCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
         CHECK_COLLISION_BODY(pbody);
         return _pCurrentChecker->CheckStandaloneSelfCollision(pbody,report);
@@ -1892,101 +1904,76 @@ public:
 
     virtual void GetPublishedBodies(std::vector<KinBody::BodyState>& vbodies, uint64_t timeout)
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            vbodies = _vPublishedBodies;
-        }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-            }
-            vbodies = _vPublishedBodies;
+        PublishedBodiesConstPtr ppublished = GetPublishedBodiesSnapshot();
+        vbodies.resize(ppublished->vbodystates.size());
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            vbodies[ibody] = *ppublished->vbodystates[ibody];
         }
     }
 
-    virtual bool GetPublishedBody(const std::string &name, KinBody::BodyState& bodystate, uint64_t timeout=0)
+    virtual PublishedBodiesConstPtr GetPublishedBodiesSnapshot() const
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    bodystate = _vPublishedBodies[ibody];
-                    return true;
-                }
-            }
+        return boost::atomic_load(&_pPublishedBodies);
+    }
+
+    virtual bool GetPublishedBodiesChangedSince(uint64_t version, std::vector<KinBody::BodyStateConstPtr>& vchangedbodies, std::vector<int>& vremovedbodyids, uint64_t& newversion) const
+    {
+        PublishedBodiesConstPtr ppublished = GetPublishedBodiesSnapshot();
+        vchangedbodies.resize(0);
+        vremovedbodyids.resize(0);
+        newversion = ppublished->version;
+        if( version < ppublished->removedhistoryversion || version > ppublished->version ) {
+            vchangedbodies = ppublished->vbodystates;
+            return false;
         }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
+
+        for(size_t ibody = 0; ibody < ppublished->vbodystates.size(); ++ibody) {
+            if( ppublished->vbodyversions[ibody] > version ) {
+                vchangedbodies.push_back(ppublished->vbodystates[ibody]);
             }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    bodystate = _vPublishedBodies[ibody];
-                    return true;
-                }
+        }
+        FOREACHC(itremoved, ppublished->vremovedbodies) {
+            if( itremoved->second > version ) {
+                vremovedbodyids.push_back(itremoved->first);
             }
         }
+        return true;
+    }
 
+    virtual bool GetPublishedBody(const std::string &name, KinBody::BodyState& bodystate, uint64_t timeout=0)
+    {
+        PublishedBodiesConstPtr ppublished = GetPublishedBodiesSnapshot();
+        FOREACHC(itstate, ppublished->vbodystates) {
+            if ( (*itstate)->strname == name) {
+                bodystate = **itstate;
+                return true;
+            }
+        }
         return false;
     }
 
     virtual bool GetPublishedBodyJointValues(const std::string& name, std::vector<dReal> &jointValues, uint64_t timeout=0)
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    jointValues = _vPublishedBodies[ibody].jointvalues;
-                    return true;
-                }
-            }
-        }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-            }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    jointValues = _vPublishedBodies[ibody].jointvalues;
-                    return true;
-                }
+        PublishedBodiesConstPtr ppublished = GetPublishedBodiesSnapshot();
+        FOREACHC(itstate, ppublished->vbodystates) {
+            if ( (*itstate)->strname == name) {
+                jointValues = (*itstate)->jointvalues;
+                return true;
             }
         }
-
         return false;
     }
 
     void GetPublishedBodyTransformsMatchingPrefix(const std::string& prefix, std::vector<std::pair<std::string, Transform> >& nameTransfPairs, uint64_t timeout = 0)
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            nameTransfPairs.resize(0);
-            if( nameTransfPairs.capacity() < _vPublishedBodies.size() ) {
-                nameTransfPairs.reserve(_vPublishedBodies.size());
-            }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( strncmp(_vPublishedBodies[ibody].strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
-                    nameTransfPairs.push_back(std::make_pair(_vPublishedBodies[ibody].strname, _vPublishedBodies[ibody].vectrans.at(0)));
-                }
-            }
+        PublishedBodiesConstPtr ppublished = GetPublishedBodiesSnapshot();
+        nameTransfPairs.resize(0);
+        if( nameTransfPairs.capacity() < ppublished->vbodystates.size() ) {
+            nameTransfPairs.reserve(ppublished->vbodystates.size());
         }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-            }
-
-            nameTransfPairs.resize(0);
-            if( nameTransfPairs.capacity() < _vPublishedBodies.size() ) {
-                nameTransfPairs.reserve(_vPublishedBodies.size());
-            }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( strncmp(_vPublishedBodies[ibody].strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
-                    nameTransfPairs.push_back(std::make_pair(_vPublishedBodies[ibody].strname, _vPublishedBodies[ibody].vectrans.at(0)));
-                }
+        FOREACHC(itstate, ppublished->vbodystates) {
+            if ( strncmp((*itstate)->strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
+                nameTransfPairs.push_back(std::make_pair((*itstate)->strname, (*itstate)->vectrans.at(0)));
             }
         }
     }
@@ -2007,14 +1994,21 @@ public:
         }
     }
 
+    /// \brief publishes a new snapshot of the bodies, has to be called with _mutexInterfaces locked
+    ///
+    /// The states of the bodies whose update stamp, name, uri and active manipulator did not change are shared with the previous snapshot.
     virtual void _UpdatePublishedBodies()
     {
-        // updated the published bodies, resize dynamically in case an exception occurs
-        // when creating an item and bad data is left inside _vPublishedBodies
-        _vPublishedBodies.resize(0);
-        if( _vPublishedBodies.capacity() < _vecbodies.size() ) {
-            _vPublishedBodies.reserve(_vecbodies.size());
-        }
+        PublishedBodiesConstPtr pold = _pPublishedBodies; // only modified with _mutexInterfaces locked
+        boost::shared_ptr<PublishedBodies> pnew(new PublishedBodies());
+        pnew->version = pold->version+1;
+        pnew->vbodystates.reserve(_vecbodies.size());
+        pnew->vbodyversions.reserve(_vecbodies.size());
+
+        // bodies are usually published in the same order, so only look up the map if the next old state does not match
+        std::map<int, size_t> mapOldIndices;
+        size_t ioldnext = 0;
+        std::vector<uint8_t> vOldPublished(pold->vbodystates.size(), 0);
 
         std::vector<dReal> vdoflastsetvalues;
         FOREACH(itbody, _vecbodies) {
@@ -2023,27 +2017,96 @@ public:
                 continue;
             }
 
-            _vPublishedBodies.push_back(KinBody::BodyState());
-            KinBody::BodyState& state = _vPublishedBodies.back();
-            state.pbody = *itbody;
-            (*itbody)->GetLinkTransformations(state.vectrans, vdoflastsetvalues);
-            (*itbody)->GetDOFValues(state.jointvalues);
-            state.strname =(*itbody)->GetName();
-            state.uri = (*itbody)->GetURI();
-            state.updatestamp = (*itbody)->GetUpdateStamp();
-            state.environmentid = (*itbody)->GetEnvironmentId();
+            int environmentid = (*itbody)->GetEnvironmentId();
+            size_t iold = pold->vbodystates.size();
+            if( ioldnext < pold->vbodystates.size() && pold->vbodystates[ioldnext]->environmentid == environmentid ) {
+                iold = ioldnext;
+            }
+            else if( pold->vbodystates.size() > 0 ) {
+                if( mapOldIndices.size() == 0 ) {
+                    for(size_t i = 0; i < pold->vbodystates.size(); ++i) {
+                        mapOldIndices[pold->vbodystates[i]->environmentid] = i;
+                    }
+                }
+                std::map<int, size_t>::const_iterator itold = mapOldIndices.find(environmentid);
+                if( itold != mapOldIndices.end() ) {
+                    iold = itold->second;
+                }
+            }
+            ioldnext = iold+1;
+
+            RobotBase::ManipulatorPtr pmanip;
             if( (*itbody)->IsRobot() ) {
                 RobotBasePtr probot = RaveInterfaceCast<RobotBase>(*itbody);
                 if( !!probot ) {
-                    RobotBase::ManipulatorPtr pmanip = probot->GetActiveManipulator();
-                    if( !!pmanip ) {
-                        state.activeManipulatorName = pmanip->GetName();
-                        state.activeManipulatorTransform = pmanip->GetTransform();
+                    pmanip = probot->GetActiveManipulator();
+                }
+            }
+
+            if( iold < pold->vbodystates.size() ) {
+                vOldPublished[iold] = 1;
+                const KinBody::BodyState& oldstate = *pold->vbodystates[iold];
+                if( oldstate.pbody == *itbody && oldstate.updatestamp == (*itbody)->GetUpdateStamp() && oldstate.strname == (*itbody)->GetName() && oldstate.uri == (*itbody)->GetURI() ) {
+                    bool bsamemanip = !pmanip ? oldstate.activeManipulatorName.size() == 0 : (oldstate.activeManipulatorName == pmanip->GetName() && _IsSameTransform(oldstate.activeManipulatorTransform, pmanip->GetTransform()));
+                    if( bsamemanip ) {
+                        pnew->vbodystates.push_back(pold->vbodystates[iold]);
+                        pnew->vbodyversions.push_back(pold->vbodyversions[iold]);
+                        continue;
                     }
                 }
             }
-            _vPublishedBodies.push_back(state);
+
+            KinBody::BodyStatePtr pstate(new KinBody::BodyState());
+            pstate->pbody = *itbody;
+            (*itbody)->GetLinkTransformations(pstate->vectrans, vdoflastsetvalues);
+            (*itbody)->GetDOFValues(pstate->jointvalues);
+            pstate->strname =(*itbody)->GetName();
+            pstate->uri = (*itbody)->GetURI();
+            pstate->updatestamp = (*itbody)->GetUpdateStamp();
+            pstate->environmentid = environmentid;
+            if( !!pmanip ) {
+                pstate->activeManipulatorName = pmanip->GetName();
+                pstate->activeManipulatorTransform = pmanip->GetTransform();
+            }
+            pnew->vbodystates.push_back(pstate);
+            pnew->vbodyversions.push_back(pnew->version);
+        }
+
+        _PublishBodies(pnew, pold, vOldPublished);
+    }
+
+    static bool _IsSameTransform(const Transform& t0, const Transform& t1)
+    {
+        return (t0.trans-t1.trans).lengthsqr3() == 0 && (t0.rot-t1.rot).lengthsqr4() == 0;
+    }
+
+    /// \brief publishes an empty snapshot, has to be called with _mutexInterfaces locked
+    void _ClearPublishedBodies()
+    {
+        PublishedBodiesConstPtr pold = _pPublishedBodies;
+        boost::shared_ptr<PublishedBodies> pnew(new PublishedBodies());
+        pnew->version = pold->version+1;
+        _PublishBodies(pnew, pold, std::vector<uint8_t>(pold->vbodystates.size(), 0));
+    }
+
+    /// \brief records the old bodies that are not published anymore and makes pnew visible to the readers
+    void _PublishBodies(boost::shared_ptr<PublishedBodies> pnew, PublishedBodiesConstPtr pold, const std::vector<uint8_t>& vOldPublished)
+    {
+        // keep a bounded history of the removals, the readers that are further behind get everything
+        static const size_t s_nMaxRemovedHistory = 256;
+        pnew->removedhistoryversion = pold->removedhistoryversion;
+        pnew->vremovedbodies = pold->vremovedbodies;
+        for(size_t iold = 0; iold < vOldPublished.size(); ++iold) {
+            if( !vOldPublished[iold] ) {
+                pnew->vremovedbodies.push_back(std::make_pair(pold->vbodystates[iold]->environmentid, pnew->version));
+            }
+        }
+        if( pnew->vremovedbodies.size() > s_nMaxRemovedHistory ) {
+            size_t numerase = pnew->vremovedbodies.size() - s_nMaxRemovedHistory;
+            pnew->removedhistoryversion = max(pnew->removedhistoryversion, pnew->vremovedbodies.at(numerase-1).second);
+            pnew->vremovedbodies.erase(pnew->vremovedbodies.begin(), pnew->vremovedbodies.begin()+numerase);
         }
+        boost::atomic_store(&_pPublishedBodies, PublishedBodiesConstPtr(pnew));
     }
 
     virtual std::pair<std::string, dReal> GetUnit() const
@@ -2154,7 +2217,7 @@ protected:
                     (*itrobot)->Destroy();
                 }
                 _vecrobots.clear();
-                _vPublishedBodies.clear();
+                _ClearPublishedBodies();
             }
             // a little tricky due to a deadlocking situation
             std::map<int, KinBodyWeakPtr> mapBodies;
@@ -2776,7 +2839,7 @@ protected:
     mutable boost::timed_mutex _mutexInterfaces;     ///< lock when managing interfaces like _listOwnedInterfaces, _listModules, _mapBodies
     mutable boost::mutex _mutexInit;     ///< lock for destroying the environment
 
-    vector<KinBody::BodyState> _vPublishedBodies;
+    PublishedBodiesConstPtr _pPublishedBodies; ///< the latest published bodies, replaced with boost::atomic_store (while holding _mutexInterfaces) so that readers never lock
     string _homedirectory;
     std::pair<std::string, dReal> _unit; ///< unit name mm, cm, inches, m and the conversion for meters
 
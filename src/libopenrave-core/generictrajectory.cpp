@@ -223,12 +223,12 @@ public:
         }
         data.resize(spec.GetDOF(),0);
         if( time >= GetDuration() ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.end()-_spec.GetDOF(),_spec,1,GetEnv());
+            _GetConversionPlan(spec).Convert(data.begin(),_vtrajdata.end()-_spec.GetDOF(),1,GetEnv());
         }
         else {
             std::vector<dReal>::iterator it = std::lower_bound(_vaccumtime.begin(),_vaccumtime.end(),time);
             if( it == _vaccumtime.begin() ) {
-                ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin(),_spec,1,GetEnv());
+                _GetConversionPlan(spec).Convert(data.begin(),_vtrajdata.begin(),1,GetEnv());
             }
             else {
                 // could be faster
@@ -240,11 +240,21 @@ public:
                         _vgroupinterpolators[i](index-1,deltatime,vinternaldata);
                     }
                 }
-                ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,1,GetEnv());
+                _GetConversionPlan(spec).Convert(data.begin(),vinternaldata.begin(),1,GetEnv());
             }
         }
     }
 
+    void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times, const ConfigurationSpecification& spec) const
+    {
+        _SampleBatch(data, times.size() > 0 ? &times[0] : NULL, 0, 0, times.size(), spec);
+    }
+
+    void SampleRange(std::vector<dReal>& data, dReal starttime, dReal deltatime, size_t numsamples, const ConfigurationSpecification& spec) const
+    {
+        _SampleBatch(data, NULL, starttime, deltatime, numsamples, spec);
+    }
+
     const ConfigurationSpecification& GetConfigurationSpecification() const
     {
         return _spec;
@@ -270,7 +280,7 @@ public:
         BOOST_ASSERT(startindex<=endindex && startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
         data.resize(spec.GetDOF()*(endindex-startindex),0);
         if( startindex < endindex ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin()+startindex*_spec.GetDOF(),_spec,endindex-startindex,GetEnv());
+            _GetConversionPlan(spec).Convert(data.begin(),_vtrajdata.begin()+startindex*_spec.GetDOF(),endindex-startindex,GetEnv());
         }
     }
 
@@ -301,6 +311,11 @@ public:
 
     void serialize(std::ostream& O, int options) const
     {
+        if( options & SO_TrajectoryBinary ) {
+            // write straight from _vtrajdata
+            _SerializeBinary(O, _vtrajdata.size() > 0 ? &_vtrajdata[0] : NULL, GetNumWaypoints(), options);
+            return;
+        }
         O << "<trajectory>" << endl << _spec;
         O << "<data count=\"" << GetNumWaypoints() << "\">" << endl;
         FOREACHC(it,_vtrajdata) {
@@ -379,6 +394,262 @@ protected:
         }
     }
 
+    /// \brief polynomial of a group within the current segment, used by _SampleBatch
+    class GroupPolynomial
+    {
+public:
+        GroupPolynomial() : igroup(0), degree(0), bBlend(false) {
+        }
+        size_t igroup; ///< index into _spec._vgroups
+        int degree;
+        bool bBlend; ///< if true, the values are a linear blend of the two waypoints stored in vcoeffs, instead of a polynomial
+        std::vector<dReal> vcoeffs; ///< vcoeffs[k*dof+j] is the coefficient of t^k of the jth value
+    };
+
+    /// \brief returns the degree of the polynomial interpolating the group within a segment, or -1 if the group has to be sampled with its interpolator
+    int _GetGroupPolynomialDegree(const ConfigurationSpecification::Group& g) const
+    {
+        if( g.offset == _timeoffset || (g.name.size() >= 14 && g.name.substr(0,14) == "ikparam_values") ) {
+            return -1;
+        }
+        int derivoffset = _vderivoffsets.at(g.offset), ddoffset = _vddoffsets.at(g.offset), dddoffset = _vdddoffsets.at(g.offset);
+        if( g.interpolation == "linear" ) {
+            return 1;
+        }
+        else if( g.interpolation == "quadratic" ) {
+            return (derivoffset >= 0 || _vintegraloffsets.at(g.offset) >= 0) ? 2 : -1;
+        }
+        else if( g.interpolation == "cubic" ) {
+            return derivoffset >= 0 ? 3 : -1;
+        }
+        else if( g.interpolation == "quartic" ) {
+            return (derivoffset >= 0 && ddoffset >= 0) ? 4 : -1;
+        }
+        else if( g.interpolation == "quintic" ) {
+            return (derivoffset >= 0 && ddoffset >= 0) ? 5 : -1;
+        }
+        else if( g.interpolation == "sextic" ) {
+            return (derivoffset >= 0 && ddoffset >= 0 && dddoffset >= 0) ? 6 : -1;
+        }
+        return -1;
+    }
+
+    /// \brief computes the coefficients of the polynomial of the segment between ipoint and ipoint+1.
+    ///
+    /// The coefficients are computed with the same expressions as the _InterpolateX functions, so evaluating the polynomial gives the same values.
+    void _ComputeGroupPolynomial(GroupPolynomial& poly, size_t ipoint) const
+    {
+        const ConfigurationSpecification::Group& g = _spec._vgroups[poly.igroup];
+        const dReal* pdata0 = &_vtrajdata[ipoint*_spec.GetDOF()];
+        const dReal* pdata1 = pdata0 + _spec.GetDOF();
+        dReal* c = &poly.vcoeffs[0];
+        int n = g.dof;
+        int derivoffset = _vderivoffsets[g.offset], ddoffset = _vddoffsets[g.offset], dddoffset = _vdddoffsets[g.offset];
+        dReal ideltatime = _vdeltainvtime.at(ipoint+1);
+        dReal ideltatime2 = ideltatime*ideltatime;
+        dReal ideltatime3 = ideltatime2*ideltatime;
+        dReal ideltatime4 = ideltatime2*ideltatime2;
+        dReal ideltatime5 = ideltatime4*ideltatime;
+        for(int i = 0; i < n; ++i) {
+            c[i] = pdata0[g.offset+i];
+        }
+        switch(poly.degree) {
+        case 1:
+            for(int i = 0; i < n; ++i) {
+                c[n+i] = poly.bBlend ? pdata1[g.offset+i] : pdata1[derivoffset+i];
+            }
+            break;
+        case 2:
+            if( derivoffset >= 0 ) {
+                for(int i = 0; i < n; ++i) {
+                    dReal deriv0 = pdata0[derivoffset+i];
+                    c[n+i] = deriv0;
+                    c[2*n+i] = 0.5*ideltatime*(pdata1[derivoffset+i]-deriv0);
+                }
+            }
+            else {
+                int integraloffset = _vintegraloffsets[g.offset];
+                for(int i = 0; i < n; ++i) {
+                    dReal value0 = pdata0[g.offset+i], value1 = pdata1[g.offset+i];
+                    dReal c1TimesDelta = 6*(pdata1[integraloffset+i]-pdata0[integraloffset+i])*ideltatime - 4*value0 - 2*value1;
+                    c[n+i] = c1TimesDelta*ideltatime;
+                    c[2*n+i] = (value1 - value0 - c1TimesDelta)*ideltatime2;
+                }
+            }
+            break;
+        case 3:
+            for(int i = 0; i < n; ++i) {
+                dReal deriv0 = pdata0[derivoffset+i], deriv1 = pdata1[derivoffset+i];
+                dReal px = pdata1[g.offset+i] - pdata0[g.offset+i];
+                c[n+i] = deriv0;
+                c[2*n+i] = 3*px*ideltatime2 - (2*deriv0+deriv1)*ideltatime;
+                c[3*n+i] = (deriv1+deriv0)*ideltatime2 - 2*px*ideltatime3;
+            }
+            break;
+        case 4:
+            for(int i = 0; i < n; ++i) {
+                dReal deriv0 = pdata0[derivoffset+i], deriv1 = pdata1[derivoffset+i];
+                dReal dd0 = pdata0[ddoffset+i], dd1 = pdata1[ddoffset+i];
+                c[n+i] = deriv0;
+                c[2*n+i] = 0.5*dd0;
+                c[3*n+i] = (deriv1-deriv0)*ideltatime2 - (2*dd0+dd1)*ideltatime/3.0;
+                c[4*n+i] = -0.5*(deriv1-deriv0)*ideltatime3 + (dd0 + dd1)*ideltatime2*0.25;
+            }
+            break;
+        case 5:
+            for(int i = 0; i < n; ++i) {
+                dReal px = pdata1[g.offset+i] - pdata0[g.offset+i];
+                dReal deriv0 = pdata0[derivoffset+i], deriv1 = pdata1[derivoffset+i];
+                dReal dd0 = pdata0[ddoffset+i], dd1 = pdata1[ddoffset+i];
+                c[n+i] = deriv0;
+                c[2*n+i] = 0.5*dd0;
+                c[3*n+i] = (-1.5*dd0 + dd1*0.5)*ideltatime + (- 6*deriv0 - 4*deriv1)*ideltatime2 + px*10*ideltatime3;
+                c[4*n+i] = (1.5*dd0 - dd1)*ideltatime2 + (8*deriv0 + 7*deriv1)*ideltatime3 - px*15*ideltatime4;
+                c[5*n+i] = (-0.5*dd0 + dd1*0.5)*ideltatime3 - (3*deriv0 + 3*deriv1)*ideltatime4 + px*6*ideltatime5;
+            }
+            break;
+        case 6:
+            for(int i = 0; i < n; ++i) {
+                dReal deriv0 = pdata0[derivoffset+i], deriv1 = pdata1[derivoffset+i];
+                dReal dd0 = pdata0[ddoffset+i], dd1 = pdata1[ddoffset+i];
+                dReal ddd0 = pdata0[dddoffset+i], ddd1 = pdata1[dddoffset+i];
+                c[n+i] = deriv0;
+                c[2*n+i] = 0.5*dd0;
+                c[3*n+i] = ddd0/6.0;
+                c[4*n+i] = (-1.5*dd0 - dd1)*ideltatime2 + (- 0.375*ddd0 + ddd1*0.125)*ideltatime + (-2.5*deriv0 + 2.5*deriv1)*ideltatime3;
+                c[5*n+i] = (1.6*dd0 + 1.4*dd1)*ideltatime3 + (0.3*ddd0 - ddd1*0.2)*ideltatime2 + (3*deriv0 - 3*deriv1)*ideltatime4;
+                c[6*n+i] = (-dd0 - dd1)*0.5*ideltatime4 + (- ddd0 + ddd1)/12.0*ideltatime3 + (-deriv0 + deriv1)*ideltatime5;
+            }
+            break;
+        }
+    }
+
+    /// \brief evaluates the polynomial of the group at deltatime into pdata, which points to the start of a point
+    void _EvaluateGroupPolynomial(const GroupPolynomial& poly, dReal deltatime, size_t ipoint, dReal* pdata) const
+    {
+        const ConfigurationSpecification::Group& g = _spec._vgroups[poly.igroup];
+        const dReal* c = &poly.vcoeffs[0];
+        int n = g.dof;
+        dReal* pout = pdata + g.offset;
+        if( poly.bBlend ) {
+            dReal f = _vdeltainvtime.at(ipoint+1)*deltatime;
+            for(int i = 0; i < n; ++i) {
+                pout[i] = c[i]*(1-f) + f*c[n+i];
+            }
+        }
+        else if( poly.degree >= 2 && deltatime <= g_fEpsilon ) {
+            std::copy(c, c+n, pout);
+        }
+        else {
+            // horner's method, every dof is independent so the loop over them vectorizes
+            const dReal* ptop = c + poly.degree*n;
+            for(int i = 0; i < n; ++i) {
+                pout[i] = ptop[i];
+            }
+            for(int k = poly.degree-1; k >= 0; --k) {
+                const dReal* pk = c + k*n;
+                for(int i = 0; i < n; ++i) {
+                    pout[i] = pk[i] + deltatime*pout[i];
+                }
+            }
+        }
+    }
+
+    /// \brief samples numsamples points in the trajectory's specification and converts them to spec in one pass.
+    ///
+    /// \param ptimes if not NULL, the times to sample, otherwise samples at starttime+i*deltatime. Increasing times are found by walking the waypoints forward instead of searching.
+    void _SampleBatch(std::vector<dReal>& data, const dReal* ptimes, dReal starttime, dReal deltatime, size_t numsamples, const ConfigurationSpecification& spec) const
+    {
+        BOOST_ASSERT(_bInit);
+        OPENRAVE_ASSERT_OP(_timeoffset,>=,0);
+        _ComputeInternal();
+        OPENRAVE_ASSERT_OP_FORMAT0((int)_vtrajdata.size(),>=,_spec.GetDOF(), "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
+            _VerifySampling();
+        }
+        data.resize(0);
+        data.resize(spec.GetDOF()*numsamples,0);
+        if( numsamples == 0 ) {
+            return;
+        }
+
+        // groups that can be evaluated as polynomials per segment, the rest go through their interpolator
+        std::vector<GroupPolynomial> vpolynomials;
+        std::vector<size_t> vinterpolatedgroups;
+        for(size_t igroup = 0; igroup < _spec._vgroups.size(); ++igroup) {
+            int degree = _GetGroupPolynomialDegree(_spec._vgroups[igroup]);
+            if( degree > 0 ) {
+                vpolynomials.push_back(GroupPolynomial());
+                GroupPolynomial& poly = vpolynomials.back();
+                poly.igroup = igroup;
+                poly.degree = degree;
+                poly.bBlend = degree == 1 && _vderivoffsets[_spec._vgroups[igroup].offset] < 0;
+                poly.vcoeffs.resize((degree+1)*_spec._vgroups[igroup].dof);
+            }
+            else if( !!_vgroupinterpolators[igroup] ) {
+                vinterpolatedgroups.push_back(igroup);
+            }
+        }
+
+        int dof = _spec.GetDOF();
+        dReal duration = GetDuration();
+        std::vector<dReal> vinternaldata(dof*numsamples,0), vpointdata(dof,0);
+        size_t index = 0, polynomialindex = 0; // polynomialindex is the segment the coefficients were computed for, 0 if none
+        dReal prevtime = std::numeric_limits<dReal>::infinity(); // forces a search for the first sample
+        for(size_t isample = 0; isample < numsamples; ++isample) {
+            dReal time = !!ptimes ? ptimes[isample] : starttime+isample*deltatime;
+            OPENRAVE_ASSERT_OP(time, >=, -g_fEpsilon);
+            std::vector<dReal>::iterator itpoint = vinternaldata.begin()+isample*dof;
+            if( time >= duration ) {
+                std::copy(_vtrajdata.end()-dof,_vtrajdata.end(),itpoint);
+                continue;
+            }
+            if( time < prevtime ) {
+                index = std::lower_bound(_vaccumtime.begin(),_vaccumtime.end(),time)-_vaccumtime.begin();
+            }
+            else {
+                // same as lower_bound since the times are increasing
+                while(index < _vaccumtime.size() && _vaccumtime[index] < time) {
+                    ++index;
+                }
+            }
+            prevtime = time;
+            if( index == 0 ) {
+                std::copy(_vtrajdata.begin(),_vtrajdata.begin()+dof,itpoint);
+                continue;
+            }
+
+            dReal segmenttime = time-_vaccumtime[index-1];
+            if( polynomialindex != index ) {
+                FOREACH(itpoly, vpolynomials) {
+                    _ComputeGroupPolynomial(*itpoly, index-1);
+                }
+                polynomialindex = index;
+            }
+            FOREACHC(itpoly, vpolynomials) {
+                _EvaluateGroupPolynomial(*itpoly, segmenttime, index-1, &*itpoint);
+            }
+            if( vinterpolatedgroups.size() > 0 ) {
+                std::fill(vpointdata.begin(), vpointdata.end(), 0);
+                FOREACHC(itgroup, vinterpolatedgroups) {
+                    const ConfigurationSpecification::Group& g = _spec._vgroups[*itgroup];
+                    _vgroupinterpolators[*itgroup](index-1,segmenttime,vpointdata);
+                    std::copy(vpointdata.begin()+g.offset, vpointdata.begin()+g.offset+g.dof, itpoint+g.offset);
+                }
+            }
+        }
+        _GetConversionPlan(spec).Convert(data.begin(),vinternaldata.begin(),numsamples,GetEnv());
+    }
+
+    /// \brief returns the plan converting the internal data to spec. The plan is kept between calls, so sampling repeatedly with the same specification does not go through the global plan cache.
+    const ConfigurationSpecification::ConversionPlan& _GetConversionPlan(const ConfigurationSpecification& spec) const
+    {
+        if( !_samplingplan || !_samplingplan->IsCompiledFor(spec, _spec) ) {
+            _samplingplan = ConfigurationSpecification::GetConversionPlan(spec, _spec);
+        }
+        return *_samplingplan;
+    }
+
     void _ComputeInternal() const
     {
         if( !_bChanged ) {
@@ -1023,6 +1294,7 @@ protected:
     bool _bInit;
     mutable bool _bChanged; ///< if true, then _ComputeInternal() has to be called in order to compute _vaccumtime and _vdeltainvtime
     mutable bool _bSamplingVerified; ///< if false, then _VerifySampling() has not be called yet to verify that all points can be sampled.
+    mutable ConfigurationSpecification::ConversionPlanConstPtr _samplingplan; ///< plan of the last conversion from _spec to a sampling specification
 };
 
 TrajectoryBasePtr CreateGenericTrajectory(EnvironmentBasePtr penv, std::istream& sinput)
@@ -60,6 +60,15 @@ BOOST_STATIC_ASSERT(sizeof(xmlChar) == 1);
 #include <ivcon.h>
 #endif
 
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace OpenRAVEXMLParser
 {
 
@@ -229,7 +238,8 @@ static bool _AssimpCreateTriMesh(const aiScene* scene, aiNode* node, const Vecto
 
 #endif
 
-bool CreateTriMeshFromFile(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
+/// \brief decodes a mesh file with assimp, the ivmodelloader module, or ivcon
+static bool _DecodeTriMeshFile(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
 {
     string extension;
     if( filename.find_last_of('.') != string::npos ) {
@@ -319,6 +329,289 @@ bool CreateTriMeshFromFile(EnvironmentBasePtr penv, const std::string& filename,
     return false;
 }
 
+/// \brief the unscaled contents of a mesh file. Entries of the mesh cache are never modified, so they can be shared by all threads.
+struct TriMeshFileData
+{
+    TriMeshFileData() : ftransparency(0), bDiffuseColor(false), bAmbientColor(false), bTransparency(false) {
+    }
+    TriMesh trimesh;
+    RaveVector<float> diffuseColor, ambientColor;
+    float ftransparency;
+    bool bDiffuseColor, bAmbientColor, bTransparency; ///< true if the file specified the value
+};
+typedef boost::shared_ptr<TriMeshFileData const> TriMeshFileDataConstPtr;
+
+/// \brief a decoded mesh file and the size and modification time of the file it was decoded from
+struct TriMeshCacheEntry
+{
+    int64_t sourcesize, sourcemtime; ///< sourcemtime is in nanoseconds, see _GetFileModificationTime
+    TriMeshFileDataConstPtr pfiledata;
+};
+
+/// \brief the decoded mesh files keyed by filename, protected by s_mutexTriMeshCache
+///
+/// A file that changed on disk replaces its old entry. When the cache is full, the oldest entry is removed.
+static std::map<std::string, TriMeshCacheEntry> s_mapTriMeshCache;
+static std::list<std::string> s_listTriMeshCacheKeys; ///< the keys of s_mapTriMeshCache from oldest to newest
+static const size_t s_nMaxTriMeshCacheSize = 256;
+static boost::mutex s_mutexTriMeshCache;
+
+static void _ClearTriMeshCache()
+{
+    boost::mutex::scoped_lock lock(s_mutexTriMeshCache);
+    s_mapTriMeshCache.clear();
+    s_listTriMeshCacheKeys.clear();
+}
+
+static int _GetProcessId()
+{
+#ifdef _WIN32
+    return _getpid();
+#else
+    return getpid();
+#endif
+}
+
+/// \brief returns the modification time of a file in nanoseconds, so that a file rewritten within the same second is detected where the file system supports it
+static int64_t _GetFileModificationTime(const struct stat& filestat)
+{
+#if defined(_WIN32)
+    return (int64_t)filestat.st_mtime*1000000000;
+#elif defined(__APPLE__)
+    return (int64_t)filestat.st_mtimespec.tv_sec*1000000000 + filestat.st_mtimespec.tv_nsec;
+#else
+    return (int64_t)filestat.st_mtim.tv_sec*1000000000 + filestat.st_mtim.tv_nsec;
+#endif
+}
+
+/// \brief header of the binary sidecar file (filename + ".ortrimesh") of a mesh file
+///
+/// The header is followed by numvertices x,y,z dReal values and numindices int32 indices. The sidecar is only used if the size and modification time of the mesh file match.
+struct TriMeshSidecarHeader
+{
+    char magic[8]; ///< "ORTRIMSH"
+    uint32_t version;
+    uint32_t sizereal; ///< sizeof(dReal) of the writer
+    int64_t sourcesize, sourcemtime; ///< size and modification time in nanoseconds of the mesh file
+    uint64_t numvertices, numindices;
+    float diffuseColor[4], ambientColor[4];
+    float ftransparency;
+    uint32_t flags; ///< bit 0 diffuse, 1 ambient, 2 transparency are set
+};
+
+static const uint32_t s_nTriMeshSidecarVersion = 2; ///< version 2 stores the modification time in nanoseconds
+
+static void _InitTriMeshSidecarHeader(TriMeshSidecarHeader& header, int64_t sourcesize, int64_t sourcemtime)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "ORTRIMSH", sizeof(header.magic));
+    header.version = s_nTriMeshSidecarVersion;
+    header.sizereal = sizeof(dReal);
+    header.sourcesize = sourcesize;
+    header.sourcemtime = sourcemtime;
+}
+
+/// \brief loads the sidecar of a mesh file. On POSIX the sidecar is mapped with a single mmap call.
+static TriMeshFileDataConstPtr _LoadTriMeshSidecar(const std::string& filename, int64_t sourcesize, int64_t sourcemtime)
+{
+    std::string sidecarfilename = filename + ".ortrimesh";
+    const uint8_t* pdata = NULL;
+    size_t size = 0;
+#ifndef _WIN32
+    int fd = open(sidecarfilename.c_str(), O_RDONLY);
+    if( fd < 0 ) {
+        return TriMeshFileDataConstPtr();
+    }
+    struct stat filestat;
+    if( fstat(fd, &filestat) != 0 || filestat.st_size < (off_t)sizeof(TriMeshSidecarHeader) ) {
+        close(fd);
+        return TriMeshFileDataConstPtr();
+    }
+    void* pmapped = mmap(NULL, filestat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if( pmapped == MAP_FAILED ) {
+        return TriMeshFileDataConstPtr();
+    }
+    pdata = static_cast<const uint8_t*>(pmapped);
+    size = filestat.st_size;
+#else
+    std::vector<uint8_t> vbuffer;
+    {
+        std::ifstream f(sidecarfilename.c_str(), std::ios::in|std::ios::binary);
+        if( !f ) {
+            return TriMeshFileDataConstPtr();
+        }
+        vbuffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+    if( vbuffer.size() < sizeof(TriMeshSidecarHeader) ) {
+        return TriMeshFileDataConstPtr();
+    }
+    pdata = &vbuffer[0];
+    size = vbuffer.size();
+#endif
+
+    boost::shared_ptr<TriMeshFileData> pfiledata;
+    TriMeshSidecarHeader header, expectedheader;
+    memcpy(&header, pdata, sizeof(header));
+    _InitTriMeshSidecarHeader(expectedheader, sourcesize, sourcemtime);
+    // bound the counts by the file size before multiplying so that a corrupt header cannot overflow the expected size
+    size_t datasize = size - sizeof(header);
+    bool bvalidsize = header.numvertices <= datasize/(3*sizeof(dReal));
+    if( bvalidsize ) {
+        datasize -= header.numvertices*3*sizeof(dReal);
+        bvalidsize = header.numindices <= datasize/sizeof(int32_t) && datasize == header.numindices*sizeof(int32_t);
+    }
+    if( memcmp(header.magic, expectedheader.magic, sizeof(header.magic)) == 0 && header.version == expectedheader.version && header.sizereal == expectedheader.sizereal && header.sourcesize == sourcesize && header.sourcemtime == sourcemtime && bvalidsize ) {
+        pfiledata.reset(new TriMeshFileData());
+        const uint8_t* pvertices = pdata + sizeof(header);
+        pfiledata->trimesh.vertices.resize(header.numvertices);
+        for(size_t i = 0; i < header.numvertices; ++i) {
+            dReal v[3];
+            memcpy(v, pvertices + i*sizeof(v), sizeof(v));
+            pfiledata->trimesh.vertices[i] = Vector(v[0], v[1], v[2]);
+        }
+        pfiledata->trimesh.indices.resize(header.numindices);
+        if( header.numindices > 0 ) {
+            memcpy(&pfiledata->trimesh.indices[0], pvertices + header.numvertices*3*sizeof(dReal), header.numindices*sizeof(int32_t));
+        }
+        pfiledata->diffuseColor = RaveVector<float>(header.diffuseColor[0], header.diffuseColor[1], header.diffuseColor[2], header.diffuseColor[3]);
+        pfiledata->ambientColor = RaveVector<float>(header.ambientColor[0], header.ambientColor[1], header.ambientColor[2], header.ambientColor[3]);
+        pfiledata->ftransparency = header.ftransparency;
+        pfiledata->bDiffuseColor = !!(header.flags & 1);
+        pfiledata->bAmbientColor = !!(header.flags & 2);
+        pfiledata->bTransparency = !!(header.flags & 4);
+    }
+    else {
+        RAVELOG_DEBUG_FORMAT("ignoring out of date or invalid mesh sidecar %s", sidecarfilename);
+    }
+#ifndef _WIN32
+    munmap(const_cast<uint8_t*>(pdata), size);
+#endif
+    return pfiledata;
+}
+
+/// \brief writes the sidecar of a mesh file, see \ref TriMeshSidecarHeader
+static void _SaveTriMeshSidecar(const std::string& filename, int64_t sourcesize, int64_t sourcemtime, const TriMeshFileData& filedata)
+{
+    BOOST_STATIC_ASSERT(sizeof(int) == sizeof(int32_t));
+    std::string sidecarfilename = filename + ".ortrimesh";
+    TriMeshSidecarHeader header;
+    _InitTriMeshSidecarHeader(header, sourcesize, sourcemtime);
+    header.numvertices = filedata.trimesh.vertices.size();
+    header.numindices = filedata.trimesh.indices.size();
+    for(int i = 0; i < 4; ++i) {
+        header.diffuseColor[i] = filedata.diffuseColor[i];
+        header.ambientColor[i] = filedata.ambientColor[i];
+    }
+    header.ftransparency = filedata.ftransparency;
+    header.flags = (filedata.bDiffuseColor ? 1 : 0) | (filedata.bAmbientColor ? 2 : 0) | (filedata.bTransparency ? 4 : 0);
+
+    std::vector<dReal> vvertices(3*header.numvertices);
+    for(size_t i = 0; i < header.numvertices; ++i) {
+        vvertices[3*i+0] = filedata.trimesh.vertices[i].x;
+        vvertices[3*i+1] = filedata.trimesh.vertices[i].y;
+        vvertices[3*i+2] = filedata.trimesh.vertices[i].z;
+    }
+    // write to a temporary file first so that readers never see a partial sidecar. The name is unique per process and thread since several writers can decode the same mesh.
+    std::string tempfilename = str(boost::format("%s.%d.%s.tmp")%sidecarfilename%_GetProcessId()%boost::lexical_cast<std::string>(boost::this_thread::get_id()));
+    {
+        std::ofstream f(tempfilename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        if( !f ) {
+            RAVELOG_DEBUG_FORMAT("failed to write mesh sidecar %s", sidecarfilename);
+            return;
+        }
+        f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if( vvertices.size() > 0 ) {
+            f.write(reinterpret_cast<const char*>(&vvertices[0]), vvertices.size()*sizeof(dReal));
+        }
+        if( header.numindices > 0 ) {
+            f.write(reinterpret_cast<const char*>(&filedata.trimesh.indices[0]), header.numindices*sizeof(int32_t));
+        }
+        if( !f ) {
+            RAVELOG_DEBUG_FORMAT("failed to write mesh sidecar %s", sidecarfilename);
+            return;
+        }
+    }
+    if( rename(tempfilename.c_str(), sidecarfilename.c_str()) != 0 ) {
+        remove(tempfilename.c_str());
+    }
+}
+
+static bool _IsTriMeshColorSet(const RaveVector<float>& color)
+{
+    return color.x != -1 || color.y != -1 || color.z != -1 || color.w != -1;
+}
+
+bool CreateTriMeshFromFile(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
+{
+    struct stat filestat;
+    if( stat(filename.c_str(), &filestat) != 0 ) {
+        return _DecodeTriMeshFile(penv, filename, vscale, trimesh, diffuseColor, ambientColor, ftransparency);
+    }
+    int64_t sourcemtime = _GetFileModificationTime(filestat);
+    TriMeshFileDataConstPtr pfiledata;
+    {
+        boost::mutex::scoped_lock lock(s_mutexTriMeshCache);
+        std::map<std::string, TriMeshCacheEntry>::iterator it = s_mapTriMeshCache.find(filename);
+        if( it != s_mapTriMeshCache.end() && it->second.sourcesize == (int64_t)filestat.st_size && it->second.sourcemtime == sourcemtime ) {
+            pfiledata = it->second.pfiledata;
+        }
+    }
+    if( !pfiledata ) {
+        pfiledata = _LoadTriMeshSidecar(filename, filestat.st_size, sourcemtime);
+        if( !pfiledata ) {
+            // decode without scaling so that all scales share the entry. Values that the file does not set keep the invalid defaults.
+            boost::shared_ptr<TriMeshFileData> pnewfiledata(new TriMeshFileData());
+            pnewfiledata->diffuseColor = pnewfiledata->ambientColor = RaveVector<float>(-1,-1,-1,-1);
+            pnewfiledata->ftransparency = -1;
+            if( !_DecodeTriMeshFile(penv, filename, Vector(1,1,1), pnewfiledata->trimesh, pnewfiledata->diffuseColor, pnewfiledata->ambientColor, pnewfiledata->ftransparency) ) {
+                return false;
+            }
+            pnewfiledata->bDiffuseColor = _IsTriMeshColorSet(pnewfiledata->diffuseColor);
+            pnewfiledata->bAmbientColor = _IsTriMeshColorSet(pnewfiledata->ambientColor);
+            pnewfiledata->bTransparency = pnewfiledata->ftransparency != -1;
+            const char* psidecar = getenv("OPENRAVE_TRIMESH_SIDECAR");
+            if( !!psidecar && strcmp(psidecar, "1") == 0 ) {
+                _SaveTriMeshSidecar(filename, filestat.st_size, sourcemtime, *pnewfiledata);
+            }
+            pfiledata = pnewfiledata;
+        }
+        boost::mutex::scoped_lock lock(s_mutexTriMeshCache);
+        if( s_mapTriMeshCache.size() == 0 ) {
+            RaveAddCallbackForDestroy(_ClearTriMeshCache);
+        }
+        std::map<std::string, TriMeshCacheEntry>::iterator it = s_mapTriMeshCache.find(filename);
+        if( it == s_mapTriMeshCache.end() ) {
+            while( s_listTriMeshCacheKeys.size() >= s_nMaxTriMeshCacheSize ) {
+                s_mapTriMeshCache.erase(s_listTriMeshCacheKeys.front());
+                s_listTriMeshCacheKeys.pop_front();
+            }
+            s_listTriMeshCacheKeys.push_back(filename);
+            it = s_mapTriMeshCache.insert(std::make_pair(filename, TriMeshCacheEntry())).first;
+        }
+        it->second.sourcesize = filestat.st_size;
+        it->second.sourcemtime = sourcemtime;
+        it->second.pfiledata = pfiledata;
+    }
+
+    trimesh.indices = pfiledata->trimesh.indices;
+    trimesh.vertices.resize(pfiledata->trimesh.vertices.size());
+    for(size_t i = 0; i < trimesh.vertices.size(); ++i) {
+        const Vector& v = pfiledata->trimesh.vertices[i];
+        trimesh.vertices[i] = Vector(v.x*vscale.x, v.y*vscale.y, v.z*vscale.z);
+    }
+    if( pfiledata->bDiffuseColor ) {
+        diffuseColor = pfiledata->diffuseColor;
+    }
+    if( pfiledata->bAmbientColor ) {
+        ambientColor = pfiledata->ambientColor;
+    }
+    if( pfiledata->bTransparency ) {
+        ftransparency = pfiledata->ftransparency;
+    }
+    return true;
+}
+
 bool CreateTriMeshFromData(const std::string& data, const std::string& formathint, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
 {
 #ifdef OPENRAVE_ASSIMP
@@ -2270,7 +2563,9 @@ public:
                 _bOverwriteTransparency = true;
             }
             else if( xmlname == "jointvalues" ) {
-                _vjointvalues.reset(new std::vector<dReal>((istream_iterator<dReal>(_ss)), istream_iterator<dReal>()));
+                std::string data = _ss.str();
+                _vjointvalues.reset(new std::vector<dReal>());
+                xmlreaders::ParseNumbers(data.c_str(), data.c_str()+data.size(), *_vjointvalues);
             }
 
             if( xmlname !=_processingtag ) {
@@ -2949,7 +3244,9 @@ public:
             else if( xmlname == "controller" ) {
             }
             else if( xmlname == "jointvalues" ) {
-                _vjointvalues.reset(new std::vector<dReal>((istream_iterator<dReal>(_ss)), istream_iterator<dReal>()));
+                std::string data = _ss.str();
+                _vjointvalues.reset(new std::vector<dReal>());
+                xmlreaders::ParseNumbers(data.c_str(), data.c_str()+data.size(), *_vjointvalues);
             }
 
             if( xmlname !=_processingtag ) {
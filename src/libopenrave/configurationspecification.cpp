@@ -21,6 +21,8 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/thread/once.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 
 namespace OpenRAVE {
 
@@ -1643,30 +1645,188 @@ void ConfigurationSpecification::ConvertGroupData(std::vector<dReal>::iterator i
 
 void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification &targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification &sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
 {
-    for(size_t igroup = 0; igroup < targetspec._vgroups.size(); ++igroup) {
-        std::vector<ConfigurationSpecification::Group>::const_iterator itcompatgroup = sourcespec.FindCompatibleGroup(targetspec._vgroups[igroup]);
+    GetConversionPlan(targetspec, sourcespec)->Convert(ittargetdata, itsourcedata, numpoints, penv, filluninitialized);
+}
+
+/// \brief how to convert the data of one target group
+class ConfigurationSpecification::ConversionPlan::GroupConversion
+{
+public:
+    enum ConversionType
+    {
+        CT_Copy=0, ///< source group has the same name, copy all values
+        CT_Transfer=1, ///< copy the values given by vtransferindices
+        CT_GroupData=2, ///< conversion needs ConvertGroupData
+        CT_Fill=3, ///< no compatible source group, only fill with default values
+    };
+    enum DefaultType
+    {
+        DT_Zero=0, ///< zeros
+        DT_JointValues=1, ///< DOF values of a body
+        DT_JointVelocities=2, ///< DOF velocities of a body
+        DT_AffineTransform=3, ///< affine DOF values of the transform of a body, identity if body is not found
+    };
+
+    GroupConversion() : type(CT_Copy), defaulttype(DT_Zero), targetoffset(0), sourceoffset(0), dof(0), affinedofs(0), bUninitializedData(false), bWarnMissingBody(false) {
+    }
+
+    /// \brief computes the default values from the current state of the environment
+    void GetDefaultValues(EnvironmentBaseConstPtr penv, std::vector<dReal>& vdefaultvalues) const
+    {
+        vdefaultvalues.resize(dof);
+        std::fill(vdefaultvalues.begin(), vdefaultvalues.end(), dReal(0));
+        KinBodyPtr pbody;
+        if( !!penv ) {
+            FOREACHC(itname, vbodynames) {
+                pbody = penv->GetKinBody(*itname);
+                if( !!pbody ) {
+                    break;
+                }
+            }
+        }
+        if( !pbody ) {
+            if( bWarnMissingBody ) {
+                RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
+            }
+            if( defaulttype == DT_AffineTransform ) {
+                RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),Transform(),affinedofs);
+            }
+            return;
+        }
+        switch(defaulttype) {
+        case DT_JointValues:
+        case DT_JointVelocities: {
+            std::vector<dReal> vbodyvalues;
+            if( defaulttype == DT_JointValues ) {
+                pbody->GetDOFValues(vbodyvalues);
+            }
+            else {
+                pbody->GetDOFVelocities(vbodyvalues);
+            }
+            for(size_t i = 0; i < vdofindices.size(); ++i) {
+                vdefaultvalues.at(i) = vbodyvalues.at(vdofindices[i]);
+            }
+            break;
+        }
+        case DT_AffineTransform:
+            RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),pbody->GetTransform(),affinedofs);
+            break;
+        default:
+            break;
+        }
+    }
+
+    ConversionType type;
+    DefaultType defaulttype;
+    int targetoffset, sourceoffset, dof; ///< dof is the target group dof
+    std::vector<int> vtransferindices; ///< CT_Transfer: for every target value the index into the source group, or -1 if not present
+    std::vector<std::string> vbodynames; ///< bodies to get the default values from, the first one found is used
+    std::vector<int> vdofindices; ///< DT_JointValues and DT_JointVelocities: the body DOF indices of the target values
+    int affinedofs; ///< DT_AffineTransform: the affine DOFs of the target group
+    bool bUninitializedData; ///< CT_Transfer: true if some values in vtransferindices are -1
+    bool bWarnMissingBody; ///< if true, warn when no body in vbodynames is found
+    Group gtarget, gsource; ///< the original groups
+};
+
+ConfigurationSpecification::ConversionPlan::ConversionPlan(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec) : _vtargetgroups(targetspec._vgroups), _vsourcegroups(sourcespec._vgroups)
+{
+    _targetdof = targetspec.GetDOF();
+    _sourcedof = sourcespec.GetDOF();
+    _vgroupconversions.reserve(targetspec._vgroups.size());
+    FOREACHC(itgroup, targetspec._vgroups) {
+        const Group& gtarget = *itgroup;
+        GroupConversionPtr pconversion(new GroupConversion());
+        GroupConversion& conversion = *pconversion;
+        conversion.gtarget = gtarget;
+        conversion.targetoffset = gtarget.offset;
+        conversion.dof = gtarget.dof;
+        std::vector<Group>::const_iterator itcompatgroup = sourcespec.FindCompatibleGroup(gtarget);
         if( itcompatgroup != sourcespec._vgroups.end() ) {
-            ConfigurationSpecification::ConvertGroupData(ittargetdata+targetspec._vgroups[igroup].offset, targetspec.GetDOF(), targetspec._vgroups[igroup], itsourcedata+itcompatgroup->offset, sourcespec.GetDOF(), *itcompatgroup,numpoints,penv,filluninitialized);
+            const Group& gsource = *itcompatgroup;
+            conversion.gsource = gsource;
+            conversion.sourceoffset = gsource.offset;
+            if( gsource.name == gtarget.name ) {
+                BOOST_ASSERT(gsource.dof==gtarget.dof);
+                conversion.type = GroupConversion::CT_Copy;
+            }
+            else if( gtarget.name.size() >= 6 && gtarget.name.substr(0,6) == "joint_" ) {
+                // same as the joint conversion in ConvertGroupData
+                stringstream ss(gtarget.name);
+                std::vector<std::string> targettokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+                ss.clear();
+                ss.str(gsource.name);
+                std::vector<std::string> sourcetokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+                BOOST_ASSERT(targettokens.at(0) == sourcetokens.at(0));
+
+                std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
+                if( (int)sourcetokens.size() < gsource.dof+2 ) {
+                    RAVELOG_DEBUG(str(boost::format("source tokens '%s' do not have %d dof indices, guessing....")%gsource.name%gsource.dof));
+                    for(int i = 0; i < gsource.dof; ++i) {
+                        vsourceindices[i] = i;
+                    }
+                }
+                else {
+                    for(int i = 0; i < gsource.dof; ++i) {
+                        vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
+                    }
+                }
+                if( (int)targettokens.size() < gtarget.dof+2 ) {
+                    RAVELOG_WARN(str(boost::format("target tokens '%s' do not match dof '%d', guessing....")%gtarget.name%gtarget.dof));
+                    for(int i = 0; i < gtarget.dof; ++i) {
+                        vtargetindices[i] = i;
+                    }
+                }
+                else {
+                    for(int i = 0; i < gtarget.dof; ++i) {
+                        vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
+                    }
+                }
+
+                conversion.type = GroupConversion::CT_Transfer;
+                conversion.vtransferindices.reserve(gtarget.dof);
+                FOREACH(ittargetindex,vtargetindices) {
+                    std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
+                    if( it == vsourceindices.end() ) {
+                        conversion.bUninitializedData = true;
+                        conversion.vtransferindices.push_back(-1);
+                    }
+                    else {
+                        conversion.vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
+                    }
+                }
+                if( conversion.bUninitializedData ) {
+                    if( targettokens.size() > 1 ) {
+                        conversion.vbodynames.push_back(targettokens.at(1));
+                    }
+                    if( sourcetokens.size() > 1 ) {
+                        conversion.vbodynames.push_back(sourcetokens.at(1));
+                    }
+                    conversion.bWarnMissingBody = true;
+                    if( targettokens[0] == "joint_values" ) {
+                        conversion.defaulttype = GroupConversion::DT_JointValues;
+                    }
+                    else if( targettokens[0] == "joint_velocities" ) {
+                        conversion.defaulttype = GroupConversion::DT_JointVelocities;
+                    }
+                    conversion.vdofindices = vtargetindices;
+                }
+            }
+            else {
+                // affine, ikparam, and grab conversions are left to ConvertGroupData
+                conversion.type = GroupConversion::CT_GroupData;
+            }
         }
-        else if( filluninitialized ) {
-            vector<dReal> vdefaultvalues(targetspec._vgroups[igroup].dof,0);
-            const string& name = targetspec._vgroups[igroup].name;
+        else {
+            conversion.type = GroupConversion::CT_Fill;
+            const string& name = gtarget.name;
             if( name.size() >= 12 && name.substr(0,12) == "joint_values" ) {
                 string bodyname;
                 stringstream ss(name.substr(12));
                 ss >> bodyname;
                 if( !!ss ) {
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            vector<dReal> values;
-                            body->GetDOFValues(values);
-                            std::vector<int> indices((istream_iterator<int>(ss)), istream_iterator<int>());
-                            for(size_t i = 0; i < indices.size(); ++i) {
-                                vdefaultvalues.at(i) = values.at(indices[i]);
-                            }
-                        }
-                    }
+                    conversion.defaulttype = GroupConversion::DT_JointValues;
+                    conversion.vbodynames.push_back(bodyname);
+                    conversion.vdofindices = std::vector<int>((istream_iterator<int>(ss)), istream_iterator<int>());
                 }
             }
             else if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
@@ -1675,29 +1835,160 @@ void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittarg
                 stringstream ss(name.substr(16));
                 ss >> bodyname >> affinedofs;
                 if( !!ss ) {
-                    Transform tdefault;
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            tdefault = body->GetTransform();
-                        }
+                    BOOST_ASSERT(gtarget.dof == RaveGetAffineDOF(affinedofs));
+                    conversion.defaulttype = GroupConversion::DT_AffineTransform;
+                    conversion.vbodynames.push_back(bodyname);
+                    conversion.affinedofs = affinedofs;
+                }
+            }
+        }
+        _vgroupconversions.push_back(pconversion);
+    }
+}
+
+ConfigurationSpecification::ConversionPlan::~ConversionPlan()
+{
+}
+
+bool ConfigurationSpecification::ConversionPlan::IsCompiledFor(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec) const
+{
+    return _vtargetgroups == targetspec._vgroups && _vsourcegroups == sourcespec._vgroups;
+}
+
+void ConfigurationSpecification::ConversionPlan::Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized) const
+{
+    std::vector<dReal> vdefaultvalues;
+    FOREACHC(itconversion, _vgroupconversions) {
+        const GroupConversion& conversion = **itconversion;
+        switch(conversion.type) {
+        case GroupConversion::CT_Copy: {
+            std::vector<dReal>::const_iterator itsource = itsourcedata+conversion.sourceoffset;
+            std::vector<dReal>::iterator ittarget = ittargetdata+conversion.targetoffset;
+            for(size_t i = 0; i < numpoints; ++i) {
+                if( i != 0 ) {
+                    itsource += _sourcedof;
+                    ittarget += _targetdof;
+                }
+                std::copy(itsource,itsource+conversion.dof,ittarget);
+            }
+            break;
+        }
+        case GroupConversion::CT_Transfer: {
+            bool bfill = conversion.bUninitializedData && filluninitialized;
+            if( bfill ) {
+                conversion.GetDefaultValues(penv, vdefaultvalues);
+            }
+            const std::vector<int>& vtransferindices = conversion.vtransferindices;
+            for(size_t i = 0; i < numpoints; ++i) {
+                std::vector<dReal>::const_iterator itsource = itsourcedata+(conversion.sourceoffset+i*_sourcedof);
+                std::vector<dReal>::iterator ittarget = ittargetdata+(conversion.targetoffset+i*_targetdof);
+                for(int j = 0; j < conversion.dof; ++j) {
+                    if( vtransferindices[j] >= 0 ) {
+                        *(ittarget+j) = *(itsource+vtransferindices[j]);
+                    }
+                    else if( bfill ) {
+                        *(ittarget+j) = vdefaultvalues[j];
                     }
-                    BOOST_ASSERT((int)vdefaultvalues.size() == RaveGetAffineDOF(affinedofs));
-                    RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),tdefault,affinedofs);
                 }
             }
-            else if( name != "deltatime" ) {
-                // messages are too frequent
-                //RAVELOG_VERBOSE(str(boost::format("cannot initialize unknown group '%s'")%name));
+            break;
+        }
+        case GroupConversion::CT_GroupData:
+            ConfigurationSpecification::ConvertGroupData(ittargetdata+conversion.targetoffset, _targetdof, conversion.gtarget, itsourcedata+conversion.sourceoffset, _sourcedof, conversion.gsource, numpoints, penv, filluninitialized);
+            break;
+        case GroupConversion::CT_Fill:
+            if( filluninitialized ) {
+                conversion.GetDefaultValues(penv, vdefaultvalues);
+                for(size_t i = 0; i < numpoints; ++i) {
+                    std::copy(vdefaultvalues.begin(), vdefaultvalues.end(), ittargetdata+(conversion.targetoffset+i*_targetdof));
+                }
+            }
+            break;
+        }
+    }
+}
+
+/// \brief hashes the groups of the specifications so that the cache does not have to compare the group names of every plan
+static size_t _HashConversionSpecifications(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec)
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, targetspec._vgroups.size());
+    boost::hash_combine(seed, sourcespec._vgroups.size());
+    for(int ispec = 0; ispec < 2; ++ispec) {
+        FOREACHC(itgroup, (ispec == 0 ? targetspec : sourcespec)._vgroups) {
+            boost::hash_combine(seed, itgroup->name);
+            boost::hash_combine(seed, itgroup->offset);
+            boost::hash_combine(seed, itgroup->dof);
+            boost::hash_combine(seed, itgroup->interpolation);
+        }
+    }
+    return seed;
+}
+
+/// \brief keeps the most recently used conversion plans keyed by the hash of their specifications. Lookups only take a shared lock on the plans and a short lock on the usage order.
+class ConversionPlanCache
+{
+public:
+    ConversionPlanCache() : _nMaxPlans(32) {
+    }
+
+    ConfigurationSpecification::ConversionPlanConstPtr GetPlan(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec)
+    {
+        size_t hash = _HashConversionSpecifications(targetspec, sourcespec);
+        {
+            boost::shared_lock<boost::shared_mutex> lock(_mutex);
+            std::pair<PlanMap::const_iterator, PlanMap::const_iterator> range = _mapplans.equal_range(hash);
+            for(PlanMap::const_iterator itplan = range.first; itplan != range.second; ++itplan) {
+                if( itplan->second.first->IsCompiledFor(targetspec, sourcespec) ) {
+                    // mark as most recently used, the shared lock keeps the entry from being evicted
+                    boost::mutex::scoped_lock lockorder(_mutexorder);
+                    _listorder.splice(_listorder.end(), _listorder, itplan->second.second);
+                    return itplan->second.first;
+                }
             }
-            int offset = targetspec._vgroups[igroup].offset;
-            for(size_t i = 0; i < numpoints; ++i, offset += targetspec.GetDOF()) {
-                for(size_t j = 0; j < vdefaultvalues.size(); ++j) {
-                    *(ittargetdata+offset+j) = vdefaultvalues[j];
+        }
+        // compile outside of the lock, another thread might add the same plan in the meantime, which is harmless
+        ConfigurationSpecification::ConversionPlanConstPtr plan(new ConfigurationSpecification::ConversionPlan(targetspec, sourcespec));
+        boost::unique_lock<boost::shared_mutex> lock(_mutex);
+        boost::mutex::scoped_lock lockorder(_mutexorder);
+        _mapplans.insert(std::make_pair(hash, std::make_pair(plan, _listorder.insert(_listorder.end(), std::make_pair(hash, plan.get())))));
+        if( _listorder.size() > _nMaxPlans ) {
+            // evict the least recently used plan, callers holding it keep it alive
+            std::pair<PlanMap::iterator, PlanMap::iterator> range = _mapplans.equal_range(_listorder.front().first);
+            for(PlanMap::iterator itplan = range.first; itplan != range.second; ++itplan) {
+                if( itplan->second.first.get() == _listorder.front().second ) {
+                    _mapplans.erase(itplan);
+                    break;
                 }
             }
+            _listorder.pop_front();
         }
+        return plan;
     }
+
+private:
+    typedef std::list< std::pair<size_t, const ConfigurationSpecification::ConversionPlan*> > OrderList;
+    typedef boost::unordered_multimap<size_t, std::pair<ConfigurationSpecification::ConversionPlanConstPtr, OrderList::iterator> > PlanMap;
+    boost::shared_mutex _mutex; ///< protects _mapplans and the membership of _listorder
+    boost::mutex _mutexorder; ///< protects the order of _listorder, lookups reorder it while holding only the shared lock
+    PlanMap _mapplans;
+    OrderList _listorder; ///< hash and plan in the order they were last used, the least recently used is first
+    size_t _nMaxPlans;
+};
+
+static ConversionPlanCache* s_pConversionPlanCache = NULL;
+static boost::once_flag _onceConversionPlanCache = BOOST_ONCE_INIT;
+
+static void _CreateConversionPlanCache()
+{
+    // never destroyed so that conversions during static destruction are still valid
+    s_pConversionPlanCache = new ConversionPlanCache();
+}
+
+ConfigurationSpecification::ConversionPlanConstPtr ConfigurationSpecification::GetConversionPlan(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec)
+{
+    boost::call_once(_CreateConversionPlanCache,_onceConversionPlanCache);
+    return s_pConversionPlanCache->GetPlan(targetspec, sourcespec);
 }
 
 std::string ConfigurationSpecification::GetInterpolationDerivative(const std::string& interpolation, int deriv)
@@ -15,6 +15,7 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "libopenrave.h"
+#include "fparsermulti.h"
 #include <algorithm>
 
 // used for functions that are also used internally
@@ -60,6 +61,126 @@ protected:
 
 typedef boost::shared_ptr<ChangeCallbackData> ChangeCallbackDataPtr;
 
+/// \brief number of configurations evaluated together by KinBody::ComputeLinkTransformsBatch
+static const size_t s_nBatchFKBlockSize = 16;
+
+/// \brief a block of transforms stored as structure-of-arrays so that the loops below run across configurations and can be vectorized.
+///
+/// Each component (qw,qx,qy,qz,tx,ty,tz) is a contiguous array of s_nBatchFKBlockSize values.
+struct TransformBlockSoA
+{
+    dReal* p[7];
+
+    void Set(dReal* pdata) {
+        for(int i = 0; i < 7; ++i) {
+            p[i] = pdata + i*s_nBatchFKBlockSize;
+        }
+    }
+
+    void Broadcast(const Transform& t, size_t num) {
+        const dReal v[7] = { t.rot.x, t.rot.y, t.rot.z, t.rot.w, t.trans.x, t.trans.y, t.trans.z };
+        for(int i = 0; i < 7; ++i) {
+            std::fill(p[i], p[i]+num, v[i]);
+        }
+    }
+
+    void Get(size_t k, Transform& t) const {
+        t.rot.x = p[0][k]; t.rot.y = p[1][k]; t.rot.z = p[2][k]; t.rot.w = p[3][k];
+        t.trans.x = p[4][k]; t.trans.y = p[5][k]; t.trans.z = p[6][k];
+    }
+
+    void Put(size_t k, const Transform& t) {
+        p[0][k] = t.rot.x; p[1][k] = t.rot.y; p[2][k] = t.rot.z; p[3][k] = t.rot.w;
+        p[4][k] = t.trans.x; p[5][k] = t.trans.y; p[6][k] = t.trans.z;
+    }
+};
+
+/// \brief out = a * c for a block of transforms a and a constant transform c. out can alias a
+static void _MultiplyTransformBlockConstant(TransformBlockSoA& out, const TransformBlockSoA& a, const Transform& c, size_t num)
+{
+    const dReal cqw = c.rot.x, cqx = c.rot.y, cqy = c.rot.z, cqz = c.rot.w;
+    const dReal ctx = c.trans.x, cty = c.trans.y, ctz = c.trans.z;
+    dReal* oqw = out.p[0]; dReal* oqx = out.p[1]; dReal* oqy = out.p[2]; dReal* oqz = out.p[3];
+    dReal* otx = out.p[4]; dReal* oty = out.p[5]; dReal* otz = out.p[6];
+    const dReal* aqw = a.p[0]; const dReal* aqx = a.p[1]; const dReal* aqy = a.p[2]; const dReal* aqz = a.p[3];
+    const dReal* atx = a.p[4]; const dReal* aty = a.p[5]; const dReal* atz = a.p[6];
+    for(size_t k = 0; k < num; ++k) {
+        const dReal qw = aqw[k], qx = aqx[k], qy = aqy[k], qz = aqz[k];
+        const dReal xx = 2*qx*qx, xy = 2*qx*qy, xz = 2*qx*qz, xw = 2*qx*qw;
+        const dReal yy = 2*qy*qy, yz = 2*qy*qz, yw = 2*qy*qw, zz = 2*qz*qz, zw = 2*qz*qw;
+        otx[k] = atx[k] + (1-yy-zz)*ctx + (xy-zw)*cty + (xz+yw)*ctz;
+        oty[k] = aty[k] + (xy+zw)*ctx + (1-xx-zz)*cty + (yz-xw)*ctz;
+        otz[k] = atz[k] + (xz-yw)*ctx + (yz+xw)*cty + (1-xx-yy)*ctz;
+        oqw[k] = qw*cqw - qx*cqx - qy*cqy - qz*cqz;
+        oqx[k] = qw*cqx + qx*cqw + qy*cqz - qz*cqy;
+        oqy[k] = qw*cqy + qy*cqw + qz*cqx - qx*cqz;
+        oqz[k] = qw*cqz + qz*cqw + qx*cqy - qy*cqx;
+    }
+}
+
+/// \brief a = a * b for two blocks of transforms
+static void _MultiplyTransformBlock(TransformBlockSoA& a, const TransformBlockSoA& b, size_t num)
+{
+    dReal* aqw = a.p[0]; dReal* aqx = a.p[1]; dReal* aqy = a.p[2]; dReal* aqz = a.p[3];
+    dReal* atx = a.p[4]; dReal* aty = a.p[5]; dReal* atz = a.p[6];
+    const dReal* bqw = b.p[0]; const dReal* bqx = b.p[1]; const dReal* bqy = b.p[2]; const dReal* bqz = b.p[3];
+    const dReal* btx = b.p[4]; const dReal* bty = b.p[5]; const dReal* btz = b.p[6];
+    for(size_t k = 0; k < num; ++k) {
+        const dReal qw = aqw[k], qx = aqx[k], qy = aqy[k], qz = aqz[k];
+        const dReal xx = 2*qx*qx, xy = 2*qx*qy, xz = 2*qx*qz, xw = 2*qx*qw;
+        const dReal yy = 2*qy*qy, yz = 2*qy*qz, yw = 2*qy*qw, zz = 2*qz*qz, zw = 2*qz*qw;
+        atx[k] += (1-yy-zz)*btx[k] + (xy-zw)*bty[k] + (xz+yw)*btz[k];
+        aty[k] += (xy+zw)*btx[k] + (1-xx-zz)*bty[k] + (yz-xw)*btz[k];
+        atz[k] += (xz-yw)*btx[k] + (yz+xw)*bty[k] + (1-xx-yy)*btz[k];
+        aqw[k] = qw*bqw[k] - qx*bqx[k] - qy*bqy[k] - qz*bqz[k];
+        aqx[k] = qw*bqx[k] + qx*bqw[k] + qy*bqz[k] - qz*bqy[k];
+        aqy[k] = qw*bqy[k] + qy*bqw[k] + qz*bqx[k] - qx*bqz[k];
+        aqz[k] = qw*bqz[k] + qz*bqw[k] + qx*bqy[k] - qy*bqx[k];
+    }
+}
+
+/// \brief a = a * (rotation of angle pvalues[k] around the unit axis)
+static void _RotateTransformBlock(TransformBlockSoA& a, const Vector& unitaxis, const dReal* pvalues, size_t num)
+{
+    dReal* aqw = a.p[0]; dReal* aqx = a.p[1]; dReal* aqy = a.p[2]; dReal* aqz = a.p[3];
+    const dReal ux = unitaxis.x, uy = unitaxis.y, uz = unitaxis.z;
+    for(size_t k = 0; k < num; ++k) {
+        const dReal c = std::cos(dReal(0.5)*pvalues[k]), s = std::sin(dReal(0.5)*pvalues[k]);
+        const dReal bqx = ux*s, bqy = uy*s, bqz = uz*s;
+        const dReal qw = aqw[k], qx = aqx[k], qy = aqy[k], qz = aqz[k];
+        aqw[k] = qw*c - qx*bqx - qy*bqy - qz*bqz;
+        aqx[k] = qw*bqx + qx*c + qy*bqz - qz*bqy;
+        aqy[k] = qw*bqy + qy*c + qz*bqx - qx*bqz;
+        aqz[k] = qw*bqz + qz*c + qx*bqy - qy*bqx;
+    }
+}
+
+/// \brief a = a * (translation of pvalues[k] along the axis)
+static void _TranslateTransformBlock(TransformBlockSoA& a, const Vector& axis, const dReal* pvalues, size_t num)
+{
+    const dReal* aqw = a.p[0]; const dReal* aqx = a.p[1]; const dReal* aqy = a.p[2]; const dReal* aqz = a.p[3];
+    dReal* atx = a.p[4]; dReal* aty = a.p[5]; dReal* atz = a.p[6];
+    for(size_t k = 0; k < num; ++k) {
+        const dReal qw = aqw[k], qx = aqx[k], qy = aqy[k], qz = aqz[k];
+        const dReal xx = 2*qx*qx, xy = 2*qx*qy, xz = 2*qx*qz, xw = 2*qx*qw;
+        const dReal yy = 2*qy*qy, yz = 2*qy*qz, yw = 2*qy*qw, zz = 2*qz*qz, zw = 2*qz*qw;
+        const dReal tx = axis.x*pvalues[k], ty = axis.y*pvalues[k], tz = axis.z*pvalues[k];
+        atx[k] += (1-yy-zz)*tx + (xy-zw)*ty + (xz+yw)*tz;
+        aty[k] += (xy+zw)*tx + (1-xx-zz)*ty + (yz-xw)*tz;
+        atz[k] += (xz-yw)*tx + (yz+xw)*ty + (1-xx-yy)*tz;
+    }
+}
+
+/// \brief normalizes the quaternions of a block of transforms, see RaveTransform::operator*
+static void _NormalizeTransformBlock(TransformBlockSoA& a, size_t num)
+{
+    dReal* aqw = a.p[0]; dReal* aqx = a.p[1]; dReal* aqy = a.p[2]; dReal* aqz = a.p[3];
+    for(size_t k = 0; k < num; ++k) {
+        const dReal f = 1/std::sqrt(aqw[k]*aqw[k] + aqx[k]*aqx[k] + aqy[k]*aqy[k] + aqz[k]*aqz[k]);
+        aqw[k] *= f; aqx[k] *= f; aqy[k] *= f; aqz[k] *= f;
+    }
+}
+
 ElectricMotorActuatorInfo::ElectricMotorActuatorInfo()
 {
     gear_ratio = 0;
@@ -1453,6 +1574,7 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, const Transfo
 
 void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t checklimits, const std::vector<int>& dofindices)
 {
+    OPENRAVE_PROFILING_SCOPE("KinBody.SetDOFValues");
     CHECK_INTERNAL_COMPUTATION;
     if( vJointValues.size() == 0 || _veclinks.size() == 0) {
         return;
@@ -1782,6 +1904,242 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
     _PostprocessChangedParameters(Prop_LinkTransforms);
 }
 
+void KinBody::ComputeLinkTransformsBatch(const dReal* pconfigs, size_t numconfigs, Transform* ptransforms) const
+{
+    CHECK_INTERNAL_COMPUTATION;
+    if( numconfigs == 0 || _veclinks.size() == 0 ) {
+        return;
+    }
+    const size_t numlinks = _veclinks.size();
+    const int dof = GetDOF();
+    OPENRAVE_ASSERT_FORMAT(dof == 0 || !!pconfigs, "body %s needs configurations", GetName(), ORE_InvalidArguments);
+
+    // values of the passive joints that are not mimic, these are kept at their current values
+    std::vector< std::vector<dReal> > vPassiveJointValuesInit(_vPassiveJoints.size());
+    for(size_t i = 0; i < _vPassiveJoints.size(); ++i) {
+        if( !_vPassiveJoints[i]->IsMimic() ) {
+            _vPassiveJoints[i]->GetValues(vPassiveJointValuesInit[i]);
+            for(size_t j = 0; j < vPassiveJointValuesInit[i].size(); ++j) {
+                if( !_vPassiveJoints[i]->IsCircular(j) ) {
+                    vPassiveJointValuesInit[i][j] = max(_vPassiveJoints[i]->_info._vlowerlimit.at(j), min(_vPassiveJoints[i]->_info._vupperlimit.at(j), vPassiveJointValuesInit[i][j]));
+                }
+            }
+        }
+    }
+
+    // links that are not reached by any joint keep their current transforms
+    std::vector<uint8_t> vlinkscomputed(numlinks,0);
+    vlinkscomputed[0] = 1;
+    std::vector<uint8_t> vjointsused(_vTopologicallySortedJointsAll.size(),0);
+    for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
+        int childindex = _vTopologicallySortedJointsAll[ijoint]->GetHierarchyChildLink()->GetIndex();
+        if( !vlinkscomputed[childindex] ) {
+            vlinkscomputed[childindex] = 1;
+            vjointsused[ijoint] = 1;
+        }
+    }
+
+    std::vector<dReal> vlinkdata(numlinks*7*s_nBatchFKBlockSize), vjointdata(7*s_nBatchFKBlockSize), vjointvalues(3*s_nBatchFKBlockSize);
+    std::vector<TransformBlockSoA> vlinkblocks(numlinks);
+    for(size_t ilink = 0; ilink < numlinks; ++ilink) {
+        vlinkblocks[ilink].Set(&vlinkdata[ilink*7*s_nBatchFKBlockSize]);
+    }
+    TransformBlockSoA jointblock;
+    jointblock.Set(&vjointdata[0]);
+
+    // passive joint values per configuration of the block, stored as [axis*s_nBatchFKBlockSize+k]
+    std::vector< std::vector<dReal> > vPassiveJointValues(_vPassiveJoints.size());
+    for(size_t i = 0; i < vPassiveJointValues.size(); ++i) {
+        vPassiveJointValues[i].resize(_vPassiveJoints[i]->GetDOF()*s_nBatchFKBlockSize);
+    }
+    std::vector<dReal> vtempvalues, veval, vdata;
+    const Transform tbase = _veclinks[0]->GetTransform();
+
+    // evaluating a function parser writes to its stack, so the mimic equations are evaluated with private copies of
+    // the parsers of the joints. Copying only touches the reference count of the shared parser data.
+    // Sampling a trajectory updates its cached timing, so trajectory joints are sampled from private clones too.
+    std::vector< std::vector<OpenRAVEFunctionParserRealPtr> > vmimicparsers(_vTopologicallySortedJointsAll.size());
+    std::vector<TrajectoryBasePtr> vtrajfollow(_vTopologicallySortedJointsAll.size());
+    {
+        static boost::mutex s_mutexMimicParserCopy;
+        boost::mutex::scoped_lock lock(s_mutexMimicParserCopy);
+        for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
+            const JointPtr& pjoint = _vTopologicallySortedJointsAll[ijoint];
+            for(int iaxis = 0; iaxis < pjoint->GetDOF(); ++iaxis) {
+                if( pjoint->IsMimic(iaxis) ) {
+                    vmimicparsers[ijoint].resize(pjoint->GetDOF());
+                    vmimicparsers[ijoint][iaxis].reset(new OpenRAVEFunctionParserReal(*pjoint->_vmimic[iaxis]->_posfn));
+                    vmimicparsers[ijoint][iaxis]->ForceDeepCopy();
+                }
+            }
+            if( pjoint->GetType() == JointTrajectory && vjointsused[ijoint] && !!pjoint->_info._trajfollow ) {
+                vtrajfollow[ijoint] = RaveClone<TrajectoryBase>(pjoint->_info._trajfollow, 0);
+            }
+        }
+    }
+
+    for(size_t iblock = 0; iblock < numconfigs; iblock += s_nBatchFKBlockSize) {
+        const size_t num = min(s_nBatchFKBlockSize, numconfigs-iblock);
+        const dReal* pblockconfigs = pconfigs != NULL ? pconfigs + iblock*dof : NULL;
+
+        vlinkblocks[0].Broadcast(tbase, num);
+        for(size_t ilink = 1; ilink < numlinks; ++ilink) {
+            if( !vlinkscomputed[ilink] ) {
+                vlinkblocks[ilink].Broadcast(_veclinks[ilink]->GetTransform(), num);
+            }
+        }
+        for(size_t i = 0; i < vPassiveJointValues.size(); ++i) {
+            for(size_t j = 0; j < vPassiveJointValuesInit[i].size(); ++j) {
+                std::fill(vPassiveJointValues[i].begin()+j*s_nBatchFKBlockSize, vPassiveJointValues[i].begin()+j*s_nBatchFKBlockSize+num, vPassiveJointValuesInit[i][j]);
+            }
+        }
+
+        for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
+            const JointPtr& pjoint = _vTopologicallySortedJointsAll[ijoint];
+            const int jointindex = _vTopologicallySortedJointIndicesAll[ijoint];
+            const int dofindex = pjoint->GetDOFIndex();
+            const int jointdof = pjoint->GetDOF();
+
+            // gather the joint values of the block as [axis*s_nBatchFKBlockSize+k]
+            for(int iaxis = 0; iaxis < jointdof; ++iaxis) {
+                dReal* pvalues = &vjointvalues[iaxis*s_nBatchFKBlockSize];
+                if( pjoint->IsMimic(iaxis) ) {
+                    const std::vector<Mimic::DOFFormat>& vdofformat = pjoint->_vmimic[iaxis]->_vdofformat;
+                    for(size_t k = 0; k < num; ++k) {
+                        vtempvalues.resize(0);
+                        FOREACHC(itdof,vdofformat) {
+                            if( itdof->dofindex >= 0 ) {
+                                vtempvalues.push_back(pblockconfigs[k*dof+itdof->dofindex]);
+                            }
+                            else {
+                                vtempvalues.push_back(vPassiveJointValues.at(itdof->jointindex-_vecjoints.size()).at(itdof->axis*s_nBatchFKBlockSize+k));
+                            }
+                        }
+                        const OpenRAVEFunctionParserRealPtr& posfn = vmimicparsers[ijoint][iaxis];
+                        posfn->EvalMulti(veval, vtempvalues.empty() ? NULL : &vtempvalues[0]);
+                        int err = posfn->EvalError();
+                        dReal fvalue = 0;
+                        if( !err && veval.size() > 0 ) {
+                            // take the first value inside the limits, otherwise the first value as is (see SetDOFValues with CLA_Nothing)
+                            fvalue = veval[0];
+                            if( pjoint->GetType() != JointSpherical && !pjoint->IsCircular(iaxis) ) {
+                                FOREACHC(iteval, veval) {
+                                    if( *iteval >= pjoint->_info._vlowerlimit[iaxis]-g_fEpsilonJointLimit && *iteval <= pjoint->_info._vupperlimit[iaxis]+g_fEpsilonJointLimit ) {
+                                        fvalue = max(pjoint->_info._vlowerlimit[iaxis], min(pjoint->_info._vupperlimit[iaxis], *iteval));
+                                        break;
+                                    }
+                                }
+                            }
+                        }
+                        pvalues[k] = fvalue;
+                    }
+                    if( dofindex < 0 ) {
+                        std::copy(pvalues, pvalues+num, vPassiveJointValues.at(jointindex-(int)_vecjoints.size()).begin()+iaxis*s_nBatchFKBlockSize);
+                    }
+                }
+                else if( dofindex >= 0 ) {
+                    for(size_t k = 0; k < num; ++k) {
+                        pvalues[k] = pblockconfigs[k*dof+dofindex+iaxis];
+                    }
+                }
+                else {
+                    const std::vector<dReal>& vpassivevalues = vPassiveJointValues.at(jointindex-(int)_vecjoints.size());
+                    std::copy(vpassivevalues.begin()+iaxis*s_nBatchFKBlockSize, vpassivevalues.begin()+iaxis*s_nBatchFKBlockSize+num, pvalues);
+                }
+            }
+
+            if( !vjointsused[ijoint] ) {
+                continue;
+            }
+
+            TransformBlockSoA& childblock = vlinkblocks[pjoint->GetHierarchyChildLink()->GetIndex()];
+            const TransformBlockSoA& parentblock = !pjoint->GetHierarchyParentLink() ? vlinkblocks[0] : vlinkblocks[pjoint->GetHierarchyParentLink()->GetIndex()];
+            _MultiplyTransformBlockConstant(childblock, parentblock, pjoint->GetInternalHierarchyLeftTransform(), num);
+
+            if( pjoint->GetType() == JointRevolute ) {
+                Vector vaxis = pjoint->GetInternalHierarchyAxis(0);
+                dReal faxislen = RaveSqrt(vaxis.lengthsqr3());
+                if( faxislen > 0 ) {
+                    _RotateTransformBlock(childblock, vaxis*(1/faxislen), &vjointvalues[0], num);
+                }
+            }
+            else if( pjoint->GetType() == JointPrismatic ) {
+                _TranslateTransformBlock(childblock, pjoint->GetInternalHierarchyAxis(0), &vjointvalues[0], num);
+            }
+            else {
+                // less common joints are computed one configuration at a time, the same way as SetDOFValues
+                dReal values[3] = {0,0,0};
+                for(size_t k = 0; k < num; ++k) {
+                    for(int iaxis = 0; iaxis < jointdof; ++iaxis) {
+                        values[iaxis] = vjointvalues[iaxis*s_nBatchFKBlockSize+k];
+                    }
+                    Transform tjoint;
+                    if( pjoint->GetType() & JointSpecialBit ) {
+                        switch(pjoint->GetType()) {
+                        case JointHinge2: {
+                            Transform tfirst;
+                            tfirst.rot = quatFromAxisAngle(pjoint->GetInternalHierarchyAxis(0), values[0]);
+                            Transform tsecond;
+                            tsecond.rot = quatFromAxisAngle(tfirst.rotate(pjoint->GetInternalHierarchyAxis(1)), values[1]);
+                            tjoint = tsecond * tfirst;
+                            break;
+                        }
+                        case JointSpherical: {
+                            dReal fang = values[0]*values[0]+values[1]*values[1]+values[2]*values[2];
+                            if( fang > 0 ) {
+                                fang = RaveSqrt(fang);
+                                dReal fiang = 1/fang;
+                                tjoint.rot = quatFromAxisAngle(Vector(values[0]*fiang,values[1]*fiang,values[2]*fiang),fang);
+                            }
+                            break;
+                        }
+                        case JointTrajectory: {
+                            dReal fvalue = values[0];
+                            if( pjoint->IsCircular(0) ) {
+                                fvalue = utils::NormalizeCircularAngle(fvalue,pjoint->_vcircularlowerlimit.at(0), pjoint->_vcircularupperlimit.at(0));
+                            }
+                            vtrajfollow[ijoint]->Sample(vdata,fvalue);
+                            if( !vtrajfollow[ijoint]->GetConfigurationSpecification().ExtractTransform(tjoint,vdata.begin(),KinBodyConstPtr()) ) {
+                                RAVELOG_WARN(str(boost::format("trajectory sampling for joint %s failed")%pjoint->GetName()));
+                            }
+                            break;
+                        }
+                        default:
+                            RAVELOG_WARN(str(boost::format("forward kinematic type 0x%x not supported")%pjoint->GetType()));
+                            break;
+                        }
+                    }
+                    else {
+                        for(int iaxis = 0; iaxis < jointdof; ++iaxis) {
+                            Transform tdelta;
+                            if( pjoint->IsRevolute(iaxis) ) {
+                                tdelta.rot = quatFromAxisAngle(pjoint->GetInternalHierarchyAxis(iaxis), values[iaxis]);
+                            }
+                            else {
+                                tdelta.trans = pjoint->GetInternalHierarchyAxis(iaxis) * values[iaxis];
+                            }
+                            tjoint = tjoint * tdelta;
+                        }
+                    }
+                    jointblock.Put(k, tjoint);
+                }
+                _MultiplyTransformBlock(childblock, jointblock, num);
+            }
+
+            _MultiplyTransformBlockConstant(childblock, childblock, pjoint->GetInternalHierarchyRightTransform(), num);
+            _NormalizeTransformBlock(childblock, num);
+        }
+
+        // scatter back to configuration-major order
+        for(size_t k = 0; k < num; ++k) {
+            Transform* pout = ptransforms + (iblock+k)*numlinks;
+            for(size_t ilink = 0; ilink < numlinks; ++ilink) {
+                vlinkblocks[ilink].Get(k, pout[ilink]);
+            }
+        }
+    }
+}
+
 bool KinBody::IsDOFRevolute(int dofindex) const
 {
     int jointindex = _vDOFIndices.at(dofindex);
@@ -3283,6 +3641,7 @@ CollisionCheckerBasePtr KinBody::GetSelfCollisionChecker() const
 
 bool KinBody::CheckSelfCollision(CollisionReportPtr report, CollisionCheckerBasePtr collisionchecker) const
 {
+    OPENRAVE_PROFILING_SCOPE("KinBody.CheckSelfCollision");
     if( !collisionchecker ) {
         collisionchecker = _selfcollisionchecker;
         if( !collisionchecker ) {
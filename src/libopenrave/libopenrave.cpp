@@ -19,6 +19,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/utility.hpp>
 #include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <streambuf>
 
@@ -480,6 +481,18 @@ public:
         if( !!pOPENRAVE_DEFAULT_VIEWER && strlen(pOPENRAVE_DEFAULT_VIEWER) > 0 ) {
             _defaultviewertype = std::string(pOPENRAVE_DEFAULT_VIEWER);
         }
+
+        const char* pOPENRAVE_PROFILING = std::getenv("OPENRAVE_PROFILING");
+        if( !!pOPENRAVE_PROFILING && strlen(pOPENRAVE_PROFILING) > 0 && std::string(pOPENRAVE_PROFILING) != "0" ) {
+            RaveSetProfilingEnabled(true);
+        }
+        _profilingtracefilename.clear();
+        const char* pOPENRAVE_PROFILING_TRACE = std::getenv("OPENRAVE_PROFILING_TRACE");
+        if( !!pOPENRAVE_PROFILING_TRACE && strlen(pOPENRAVE_PROFILING_TRACE) > 0 ) {
+            _profilingtracefilename = std::string(pOPENRAVE_PROFILING_TRACE);
+            RaveSetProfilingEnabled(true);
+            RaveSetProfilingTraceEnabled(true);
+        }
         
         _UpdateDataDirs();
         return 0;
@@ -509,6 +522,14 @@ public:
         _pdefaultsampler.reset();
         _mapreaders.clear();
 
+        if( _profilingtracefilename.size() > 0 ) {
+            std::ofstream ftrace(_profilingtracefilename.c_str());
+            if( !!ftrace ) {
+                RaveWriteProfilingTrace(ftrace);
+            }
+            _profilingtracefilename.clear();
+        }
+
         // process the callbacks
         std::list<boost::function<void()> > listDestroyCallbacks;
         {
@@ -1054,6 +1075,7 @@ private:
     std::list<boost::function<void()> > _listDestroyCallbacks;
     std::string _homedirectory;
     std::string _defaultviewertype; ///< the default viewer type from the environment variable OPENRAVE_DEFAULT_VIEWER
+    std::string _profilingtracefilename; ///< if not empty, the profiling trace is written to this file on destruction, set from the environment variable OPENRAVE_PROFILING_TRACE
     std::vector<std::string> _vdbdirectories;
     int _nGlobalEnvironmentId;
     SpaceSamplerBasePtr _pdefaultsampler;
@@ -1873,6 +1895,13 @@ void RaveGetVelocityFromAffineDOFVelocities(Vector& linearvel, Vector& angularve
     }
 }
 
+CollisionReport::CollisionReport()
+{
+    OPENRAVE_PROFILING_COUNT("CollisionReport.Allocations", 1);
+    nKeepPrevious = 0;
+    Reset();
+}
+
 void CollisionReport::Reset(int coloptions)
 {
     options = coloptions;
@@ -1886,6 +1915,49 @@ void CollisionReport::Reset(int coloptions)
     }
 }
 
+/// \brief a report of the pool of a thread and the capacities it was last handed out with
+class PooledCollisionReport
+{
+public:
+    PooledCollisionReport(CollisionReportPtr report) : _report(report), _ncontactscapacity(0), _nlinkpairscapacity(0) {
+    }
+    CollisionReportPtr _report;
+    size_t _ncontactscapacity, _nlinkpairscapacity;
+};
+
+/// \brief the collision reports of a thread, a report is free when the pool holds its only reference
+static boost::thread_specific_ptr< std::vector<PooledCollisionReport> > s_pCollisionReportPool;
+static const size_t s_nMaxPooledCollisionReports = 32; ///< reports beyond this many simultaneously used ones are not pooled
+
+CollisionReportPtr RaveAcquireCollisionReport()
+{
+    std::vector<PooledCollisionReport>* ppool = s_pCollisionReportPool.get();
+    if( !ppool ) {
+        ppool = new std::vector<PooledCollisionReport>();
+        ppool->reserve(s_nMaxPooledCollisionReports);
+        s_pCollisionReportPool.reset(ppool);
+    }
+    FOREACH(itpooled, *ppool) {
+        if( itpooled->_report.unique() ) {
+            CollisionReport& report = *itpooled->_report;
+            // the contacts and link pairs grew while the report was last used
+            if( report.contacts.capacity() > itpooled->_ncontactscapacity || report.vLinkColliding.capacity() > itpooled->_nlinkpairscapacity ) {
+                OPENRAVE_PROFILING_COUNT("CollisionReport.ContactReallocations", 1);
+                itpooled->_ncontactscapacity = report.contacts.capacity();
+                itpooled->_nlinkpairscapacity = report.vLinkColliding.capacity();
+            }
+            report.nKeepPrevious = 0;
+            report.Reset();
+            return itpooled->_report;
+        }
+    }
+    CollisionReportPtr report(new CollisionReport());
+    if( ppool->size() < s_nMaxPooledCollisionReports ) {
+        ppool->push_back(PooledCollisionReport(report));
+    }
+    return report;
+}
+
 std::string CollisionReport::__str__() const
 {
     stringstream s;
@@ -1923,6 +1995,69 @@ std::string CollisionReport::__str__() const
     return s.str();
 }
 
+int CollisionCheckerBase::CheckCollisionBatch(KinBodyPtr pbody, const std::vector<dReal>& vconfigs, std::vector<uint8_t>& vresults, bool bCheckSelfCollision)
+{
+    RobotBasePtr probot;
+    if( (GetCollisionOptions() & CO_ActiveDOFs) && pbody->IsRobot() ) {
+        probot = RaveInterfaceCast<RobotBase>(pbody);
+    }
+    int dof = !!probot ? probot->GetActiveDOF() : pbody->GetDOF();
+    OPENRAVE_ASSERT_OP_FORMAT(dof, >, 0, "body %s does not have any dofs to set", pbody->GetName(), ORE_InvalidArguments);
+    OPENRAVE_ASSERT_OP_FORMAT((int)(vconfigs.size()%dof), ==, 0, "configurations are not a multiple of the dof %d", dof, ORE_InvalidArguments);
+    size_t numconfigs = vconfigs.size()/dof;
+    vresults.resize(numconfigs);
+    // same early-outs as the single queries: a body without links or enabled links cannot collide
+    if( pbody->GetLinks().size() == 0 || !pbody->IsEnabled() ) {
+        std::fill(vresults.begin(), vresults.end(), 0);
+        return 0;
+    }
+    bCheckSelfCollision &= pbody->GetLinks().size() > 1;
+
+    KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+    std::vector<dReal> vvalues(dof);
+    int ncollisions = 0;
+    for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig) {
+        std::copy(vconfigs.begin()+iconfig*dof, vconfigs.begin()+(iconfig+1)*dof, vvalues.begin());
+        if( !!probot ) {
+            probot->SetActiveDOFValues(vvalues, KinBody::CLA_Nothing);
+        }
+        else {
+            pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing);
+        }
+        bool bCollision = CheckCollision(KinBodyConstPtr(pbody));
+        if( !bCollision && bCheckSelfCollision ) {
+            bCollision = CheckStandaloneSelfCollision(KinBodyConstPtr(pbody));
+        }
+        vresults[iconfig] = bCollision;
+        if( bCollision ) {
+            ++ncollisions;
+        }
+    }
+    return ncollisions;
+}
+
+int CollisionCheckerBase::CheckCollisionRays(const std::vector<RAY>& vrays, std::vector<dReal>& vdistances, std::vector<int>& vbodyids)
+{
+    vdistances.resize(vrays.size());
+    vbodyids.resize(vrays.size());
+    CollisionOptionsStateSaver optionsaver(shared_collisionchecker(), GetCollisionOptions()|CO_Distance, false);
+    CollisionReportPtr report = RaveAcquireCollisionReport();
+    int nhits = 0;
+    for(size_t iray = 0; iray < vrays.size(); ++iray) {
+        if( CheckCollision(vrays[iray], report) ) {
+            vdistances[iray] = report->minDistance;
+            KinBody::LinkConstPtr plink = !!report->plink1 ? report->plink1 : report->plink2;
+            vbodyids[iray] = !!plink ? plink->GetParent()->GetEnvironmentId() : 0;
+            ++nhits;
+        }
+        else {
+            vdistances[iray] = -1;
+            vbodyids[iray] = 0;
+        }
+    }
+    return nhits;
+}
+
 bool PhysicsEngineBase::GetLinkForceTorque(KinBody::LinkConstPtr plink, Vector& force, Vector& torque)
 {
     force = Vector(0,0,0);
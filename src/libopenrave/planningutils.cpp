@@ -18,6 +18,7 @@
 #include <boost/lexical_cast.hpp>
 #include <openrave/planningutils.h>
 #include <openrave/plannerparameters.h>
+#include <boost/functional/hash.hpp>
 
 //#include <boost/iostreams/device/file_descriptor.hpp>
 //#include <boost/iostreams/stream.hpp>
@@ -2051,7 +2052,7 @@ void GetDHParameters(std::vector<DHParameter>& vparameters, KinBodyConstPtr pbod
     }
 }
 
-DynamicsCollisionConstraint::DynamicsCollisionConstraint(PlannerBase::PlannerParametersConstPtr parameters, const std::list<KinBodyPtr>& listCheckBodies, int filtermask) : _listCheckBodies(listCheckBodies), _filtermask(filtermask), _torquelimitmode(0), _perturbation(0.1)
+DynamicsCollisionConstraint::DynamicsCollisionConstraint(PlannerBase::PlannerParametersConstPtr parameters, const std::list<KinBodyPtr>& listCheckBodies, int filtermask) : _listCheckBodies(listCheckBodies), _filtermask(filtermask), _torquelimitmode(0), _perturbation(0.1), _checkorder(ECO_Sequential), _coarsestride(4), _bNeighStateFnProjects(false), _nBisectionRejections(0), _nMaxValidatedSegments(0), _nNextValidatedSegment(0), _bEnvironmentChanged(true), _nValidatedSegmentHits(0)
 {
     BOOST_ASSERT(listCheckBodies.size()>0);
     _report.reset(new CollisionReport());
@@ -2065,30 +2066,136 @@ DynamicsCollisionConstraint::DynamicsCollisionConstraint(PlannerBase::PlannerPar
 void DynamicsCollisionConstraint::SetPlannerParameters(PlannerBase::PlannerParametersConstPtr parameters)
 {
     _parameters = parameters;
+    _bNeighStateFnProjects = false;
     if( !!parameters ) {
         _specvel = parameters->_configurationspecification.ConvertToVelocitySpecification();
         _setvelstatefn = _specvel.GetSetFn(_listCheckBodies.front()->GetEnv());
     }
+    ClearValidatedSegments();
 }
 
 void DynamicsCollisionConstraint::SetUserCheckFunction(const boost::function<bool() >& usercheckfn, bool bCallAfterCheckCollision)
 {
     _usercheckfns[bCallAfterCheckCollision] = usercheckfn;
+    ClearValidatedSegments();
 }
 
 void DynamicsCollisionConstraint::SetFilterMask(int filtermask)
 {
     _filtermask = filtermask;
+    ClearValidatedSegments();
 }
 
 void DynamicsCollisionConstraint::SetTorqueLimitMode(int torquelimitmode)
 {
     _torquelimitmode = torquelimitmode;
+    ClearValidatedSegments();
 }
 
 void DynamicsCollisionConstraint::SetPerturbation(dReal perturbation)
 {
     _perturbation = perturbation;
+    ClearValidatedSegments();
+}
+
+void DynamicsCollisionConstraint::SetEdgeCheckOrder(EdgeCheckOrder checkorder, int coarsestride)
+{
+    OPENRAVE_ASSERT_OP(coarsestride,>=,1);
+    _checkorder = checkorder;
+    _coarsestride = coarsestride;
+}
+
+void DynamicsCollisionConstraint::SetValidatedSegmentCacheSize(int maxsegments)
+{
+    OPENRAVE_ASSERT_OP(maxsegments,>=,0);
+    _nMaxValidatedSegments = maxsegments;
+    ClearValidatedSegments();
+}
+
+void DynamicsCollisionConstraint::ClearValidatedSegments()
+{
+    _vValidatedSegments.resize(0);
+    _nNextValidatedSegment = 0;
+}
+
+void DynamicsCollisionConstraint::_InitEnvironmentCallbacks()
+{
+    if( !!_handleBodyAddRemove ) {
+        return;
+    }
+    EnvironmentBasePtr penv = _listCheckBodies.front()->GetEnv();
+    _handleBodyAddRemove = penv->RegisterBodyCallback(boost::bind(&DynamicsCollisionConstraint::_UpdateAddRemoveBodies, this, _1, _2));
+    std::vector<KinBodyPtr> vbodies;
+    penv->GetBodies(vbodies);
+    FOREACHC(itbody, vbodies) {
+        _UpdateAddRemoveBodies(*itbody, 1);
+    }
+    _bEnvironmentChanged = true;
+}
+
+void DynamicsCollisionConstraint::_UpdateAddRemoveBodies(KinBodyPtr pbody, int action)
+{
+    if( action == 1 ) {
+        if( find(_listCheckBodies.begin(), _listCheckBodies.end(), pbody) != _listCheckBodies.end() ) {
+            // changes of the checked bodies are not tracked, except for what they grab
+            _mapBodyChangeHandles[pbody.get()] = pbody->RegisterChangeCallback(KinBody::Prop_RobotGrabbed, boost::bind(&DynamicsCollisionConstraint::_UpdateChangedBody, this, KinBodyWeakPtr()));
+        }
+        else {
+            // moving is detected by the update stamps, since SetTransform does not send Prop_LinkTransforms
+            _mapBodyChangeHandles[pbody.get()] = pbody->RegisterChangeCallback(KinBody::Prop_LinkGeometry|KinBody::Prop_LinkEnable|KinBody::Prop_LinkGeometryGroup, boost::bind(&DynamicsCollisionConstraint::_UpdateChangedBody, this, KinBodyWeakPtr(pbody)));
+        }
+    }
+    else if( action == 0 ) {
+        _mapBodyChangeHandles.erase(pbody.get());
+    }
+    _bEnvironmentChanged = true;
+}
+
+void DynamicsCollisionConstraint::_UpdateChangedBody(KinBodyWeakPtr pweakbody)
+{
+    KinBodyPtr pbody = pweakbody.lock();
+    if( !!pbody ) {
+        // grabbed bodies move with the checked bodies
+        FOREACHC(itbody, _listCheckBodies) {
+            if( (*itbody)->IsRobot() && !!RaveInterfaceCast<RobotBase>(*itbody)->IsGrabbing(pbody) ) {
+                return;
+            }
+        }
+    }
+    _bEnvironmentChanged = true;
+}
+
+bool DynamicsCollisionConstraint::_HaveTrackedBodiesMoved() const
+{
+    FOREACHC(itstamp, _vTrackedBodyStamps) {
+        if( itstamp->first->GetUpdateStamp() != itstamp->second ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DynamicsCollisionConstraint::_RecordTrackedBodyStamps()
+{
+    _vTrackedBodyStamps.resize(0);
+    std::vector<KinBodyPtr> vbodies;
+    _listCheckBodies.front()->GetEnv()->GetBodies(vbodies);
+    FOREACHC(itbody, vbodies) {
+        if( find(_listCheckBodies.begin(), _listCheckBodies.end(), *itbody) != _listCheckBodies.end() ) {
+            continue;
+        }
+        // grabbed bodies move with the checked bodies
+        bool bgrabbed = false;
+        FOREACHC(itcheckbody, _listCheckBodies) {
+            if( (*itcheckbody)->IsRobot() && !!RaveInterfaceCast<RobotBase>(*itcheckbody)->IsGrabbing(*itbody) ) {
+                bgrabbed = true;
+                break;
+            }
+        }
+        if( !bgrabbed ) {
+            _vTrackedBodyStamps.push_back(std::make_pair(itbody->get(), (*itbody)->GetUpdateStamp()));
+        }
+    }
 }
 
 int DynamicsCollisionConstraint::_SetAndCheckState(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& vdofvalues, const std::vector<dReal>& vdofvelocities, const std::vector<dReal>& vdofaccels, int options, ConstraintFilterReturnPtr filterreturn)
@@ -2208,8 +2315,13 @@ int DynamicsCollisionConstraint::_CheckState(const std::vector<dReal>& vdofveloc
             }
         }
     }
+    // only pass the report when its contents are used, otherwise the checkers do not have to fill it
+    CollisionReportPtr report;
+    if( ((options & CFO_FillCollisionReport) && !!filterreturn) || IS_DEBUGLEVEL(Level_Verbose) ) {
+        report = _report;
+    }
     FOREACHC(itbody, _listCheckBodies) {
-        if( (options&CFO_CheckEnvCollisions) && (*itbody)->GetEnv()->CheckCollision(KinBodyConstPtr(*itbody),_report) ) {
+        if( (options&CFO_CheckEnvCollisions) && (*itbody)->GetEnv()->CheckCollision(KinBodyConstPtr(*itbody),report) ) {
             if( (options & CFO_FillCollisionReport) && !!filterreturn ) {
                 filterreturn->_report = *_report;
             }
@@ -2218,7 +2330,7 @@ int DynamicsCollisionConstraint::_CheckState(const std::vector<dReal>& vdofveloc
             }
             return CFO_CheckEnvCollisions;
         }
-        if( (options&CFO_CheckSelfCollisions) && (*itbody)->CheckSelfCollision(_report) ) {
+        if( (options&CFO_CheckSelfCollisions) && (*itbody)->CheckSelfCollision(report) ) {
             if( (options & CFO_FillCollisionReport) && !!filterreturn ) {
                 filterreturn->_report = *_report;
             }
@@ -2281,6 +2393,159 @@ inline std::ostream& RaveSerializeValues(std::ostream& O, const std::vector<dRea
 }
 
 int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn)
+{
+    OPENRAVE_PROFILING_SCOPE("DynamicsCollisionConstraint.Check");
+    // the cache cannot reproduce the checked configurations
+    if( _nMaxValidatedSegments <= 0 || (options & CFO_FillCheckedConfiguration) ) {
+        return _Check(q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+    }
+
+    int neededmask = 2;
+    switch (interval) {
+    case IT_Open: break;
+    case IT_OpenStart: neededmask |= 4; break;
+    case IT_OpenEnd: neededmask |= 1; break;
+    case IT_Closed: neededmask |= 5; break;
+    default:
+        BOOST_ASSERT(0);
+    }
+
+    _InitEnvironmentCallbacks();
+    if( _bEnvironmentChanged || _HaveTrackedBodiesMoved() ) {
+        ClearValidatedSegments();
+        _RecordTrackedBodyStamps();
+        _bEnvironmentChanged = false;
+    }
+
+    int maskoptions = options&_filtermask;
+    size_t hash = boost::hash_range(q0.begin(), q0.end());
+    boost::hash_range(hash, q1.begin(), q1.end());
+    boost::hash_range(hash, dq0.begin(), dq0.end());
+    boost::hash_range(hash, dq1.begin(), dq1.end());
+    boost::hash_combine(hash, timeelapsed);
+    boost::hash_combine(hash, maskoptions);
+
+    ValidatedSegment* psegment = NULL;
+    FOREACH(itsegment, _vValidatedSegments) {
+        if( itsegment->hash == hash && itsegment->options == maskoptions && itsegment->timeelapsed == timeelapsed && itsegment->vvalues.size() == q0.size()+q1.size()+dq0.size()+dq1.size() && std::equal(q0.begin(), q0.end(), itsegment->vvalues.begin()) && std::equal(q1.begin(), q1.end(), itsegment->vvalues.begin()+q0.size()) && std::equal(dq0.begin(), dq0.end(), itsegment->vvalues.begin()+q0.size()+q1.size()) && std::equal(dq1.begin(), dq1.end(), itsegment->vvalues.begin()+q0.size()+q1.size()+dq0.size()) ) {
+            psegment = &*itsegment;
+            break;
+        }
+    }
+    if( !!psegment && (psegment->validatedmask & neededmask) == neededmask ) {
+        ++_nValidatedSegmentHits;
+        if( !!filterreturn ) {
+            filterreturn->Clear();
+        }
+        return 0;
+    }
+
+    int ret = _Check(q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+    if( ret == 0 ) {
+        if( !psegment ) {
+            if( (int)_vValidatedSegments.size() < _nMaxValidatedSegments ) {
+                _vValidatedSegments.push_back(ValidatedSegment());
+                psegment = &_vValidatedSegments.back();
+            }
+            else {
+                psegment = &_vValidatedSegments.at(_nNextValidatedSegment);
+                _nNextValidatedSegment = (_nNextValidatedSegment+1)%_vValidatedSegments.size();
+            }
+            psegment->hash = hash;
+            psegment->vvalues.resize(0);
+            psegment->vvalues.insert(psegment->vvalues.end(), q0.begin(), q0.end());
+            psegment->vvalues.insert(psegment->vvalues.end(), q1.begin(), q1.end());
+            psegment->vvalues.insert(psegment->vvalues.end(), dq0.begin(), dq0.end());
+            psegment->vvalues.insert(psegment->vvalues.end(), dq1.begin(), dq1.end());
+            psegment->timeelapsed = timeelapsed;
+            psegment->options = maskoptions;
+            psegment->validatedmask = 0;
+        }
+        psegment->validatedmask |= neededmask;
+    }
+    return ret;
+}
+
+int DynamicsCollisionConstraint::_CheckBisectionSamples(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& q0, const std::vector<dReal>& dq0, dReal timeelapsed, int numSteps, int options)
+{
+    // sample indices 1..numsamples correspond to steps _coarsestride, 2*_coarsestride, ...; the end points are checked separately
+    int numsamples = (numSteps-1)/_coarsestride;
+    if( numsamples <= 0 ) {
+        return 0;
+    }
+    if( (int)_vbisectionorder.size() != numsamples ) {
+        // breadth-first midpoints of [1,numsamples], ie the van der Corput sequence for non powers of 2
+        _vbisectionorder.resize(0);
+        std::vector< std::pair<int, int> > vintervals, vnextintervals;
+        vintervals.push_back(std::make_pair(1, numsamples+1));
+        while( vintervals.size() > 0 ) {
+            vnextintervals.resize(0);
+            FOREACHC(itinterval, vintervals) {
+                if( itinterval->first < itinterval->second ) {
+                    int mid = (itinterval->first+itinterval->second)/2;
+                    _vbisectionorder.push_back(mid);
+                    vnextintervals.push_back(std::make_pair(itinterval->first, mid));
+                    vnextintervals.push_back(std::make_pair(mid+1, itinterval->second));
+                }
+            }
+            vintervals.swap(vnextintervals);
+        }
+    }
+
+    bool bQuadratic = timeelapsed > 0 && dq0.size() == q0.size() && _vtempveldelta.size() == q0.size();
+    bool bHasVelocity = dq0.size() == q0.size() && _vtempveldelta.size() == q0.size();
+    _vbisectionconfig.resize(q0.size());
+    _vbisectionvelconfig = dq0;
+    dReal fisteps = dReal(1.0)/numSteps;
+    FOREACHC(itsample, _vbisectionorder) {
+        dReal fstep = (*itsample)*_coarsestride*fisteps;
+        if( bQuadratic ) {
+            dReal t = fstep*timeelapsed;
+            for(size_t idof = 0; idof < q0.size(); ++idof) {
+                _vbisectionconfig[idof] = q0[idof] + t*(dq0[idof] + 0.5*t*_vtempaccelconfig[idof]);
+                _vbisectionvelconfig[idof] = dq0[idof] + t*_vtempaccelconfig[idof];
+            }
+        }
+        else {
+            for(size_t idof = 0; idof < q0.size(); ++idof) {
+                _vbisectionconfig[idof] = q0[idof] + fstep*dQ[idof];
+            }
+            if( bHasVelocity ) {
+                for(size_t idof = 0; idof < q0.size(); ++idof) {
+                    _vbisectionvelconfig[idof] = dq0[idof] + fstep*_vtempveldelta[idof];
+                }
+            }
+        }
+        int nstateret = _SetAndCheckState(params, _vbisectionconfig, _vbisectionvelconfig, _vtempaccelconfig, options, ConstraintFilterReturnPtr());
+        if( nstateret == (int)CFO_StateSettingError ) {
+            // the interpolated sample might not be settable (circular joints, limits), leave it to the sequential pass
+            return 0;
+        }
+        if( nstateret != 0 ) {
+            // the sequential pass only goes through the sample if _neighstatefn does not project it somewhere else
+            if( params->SetStateValues(_vbisectionconfig, 0) != 0 ) {
+                return 0;
+            }
+            _vbisectionprojected = _vbisectionconfig;
+            _vbisectionzerodelta.resize(0);
+            _vbisectionzerodelta.resize(q0.size(), 0);
+            if( !params->_neighstatefn(_vbisectionprojected, _vbisectionzerodelta, NSO_OnlyHardConstraints) ) {
+                return 0;
+            }
+            for(size_t idof = 0; idof < q0.size(); ++idof) {
+                if( RaveFabs(_vbisectionprojected[idof] - _vbisectionconfig[idof]) > g_fEpsilonLinear ) {
+                    RAVELOG_DEBUG("_neighstatefn projects the configurations, disabling the bisection check order for these parameters\n");
+                    _bNeighStateFnProjects = true;
+                    return 0;
+                }
+            }
+            return nstateret;
+        }
+    }
+    return 0;
+}
+
+int DynamicsCollisionConstraint::_Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn)
 {
     int maskoptions = options&_filtermask;
     if( !!filterreturn ) {
@@ -2491,6 +2756,15 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
         _vtempvelconfig = dq0;
     }
 
+    // the bisection samples are not necessarily the earliest invalid configuration, so only use them when the caller does not ask for one
+    if( _checkorder == ECO_Bisection && !filterreturn && !_bNeighStateFnProjects ) {
+        int nstateret = _CheckBisectionSamples(params, q0, dq0, timeelapsed, numSteps, maskoptions);
+        if( nstateret != 0 ) {
+            ++_nBisectionRejections;
+            return nstateret;
+        }
+    }
+
     if( timeelapsed > 0 && dq0.size() == _vtempconfig.size() && dq1.size() == _vtempconfig.size() ) {
         // just in case, have to set the current values to _vtempconfig since neightstatefn expects the state to be set.
         if( params->SetStateValues(_vtempconfig, 0) != 0 ) {
@@ -0,0 +1,393 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2016 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "libopenrave.h"
+
+#include <boost/atomic.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace OpenRAVE {
+
+/// \brief the statistics of one scope in one thread
+class ProfilingAccumulator
+{
+public:
+    ProfilingAccumulator() : count(0), totaltime(0), mintime(0), maxtime(0) {
+    }
+
+    inline void AddSample(uint64_t duration)
+    {
+        if( count == 0 || duration < mintime ) {
+            mintime = duration;
+        }
+        if( duration > maxtime ) {
+            maxtime = duration;
+        }
+        totaltime += duration;
+        ++count;
+    }
+
+    void Merge(const ProfilingAccumulator& r)
+    {
+        if( r.count == 0 ) {
+            return;
+        }
+        if( count == 0 || r.mintime < mintime ) {
+            mintime = r.mintime;
+        }
+        if( r.maxtime > maxtime ) {
+            maxtime = r.maxtime;
+        }
+        totaltime += r.totaltime;
+        count += r.count;
+    }
+
+    uint64_t count, totaltime, mintime, maxtime;
+};
+
+/// \brief one recorded call of a scope
+class ProfilingTraceEvent
+{
+public:
+    int scopeid;
+    int threadindex;
+    uint64_t starttime, duration;
+};
+
+/// \brief the profiling data of a single thread.
+///
+/// Only the owning thread adds to it, the mutex is only contended when the statistics are being read or reset.
+class ProfilingThreadData
+{
+public:
+    ProfilingThreadData(int threadindex) : _threadindex(threadindex), _ndroppedevents(0) {
+    }
+
+    boost::mutex _mutex;
+    std::vector<ProfilingAccumulator> _vaccumulators; ///< indexed by scope id
+    std::vector<ProfilingTraceEvent> _vevents;
+    int _threadindex;
+    uint64_t _ndroppedevents;
+};
+
+typedef boost::shared_ptr<ProfilingThreadData> ProfilingThreadDataPtr;
+
+static void _RetireProfilingThreadData(ProfilingThreadDataPtr* pthreaddata);
+
+/// \brief holds the scope names and the data of all threads. Never destroyed so that scope ids held by static variables stay valid.
+class ProfilingManager
+{
+public:
+    static const size_t s_nMaxThreadEvents = 200000; ///< maximum number of trace events every thread keeps
+
+    ProfilingManager() : _bEnabled(false), _bTraceEnabled(false), _threaddata(_RetireProfilingThreadData), _nextthreadindex(0), _retired(-1) {
+        _basetime = utils::GetNanoPerformanceTime();
+    }
+
+    inline ProfilingThreadData& GetThreadData()
+    {
+        ProfilingThreadDataPtr* pthreaddata = _threaddata.get();
+        if( !pthreaddata ) {
+            boost::mutex::scoped_lock lock(_mutex);
+            ProfilingThreadDataPtr threaddata(new ProfilingThreadData(_nextthreadindex++));
+            _listthreads.push_back(threaddata);
+            pthreaddata = new ProfilingThreadDataPtr(threaddata);
+            _threaddata.reset(pthreaddata);
+        }
+        return **pthreaddata;
+    }
+
+    int RegisterScope(const std::string& name)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        std::map<std::string, int>::iterator it = _mapscopeids.find(name);
+        if( it != _mapscopeids.end() ) {
+            return it->second;
+        }
+        int scopeid = (int)_vscopenames.size();
+        _vscopenames.push_back(name);
+        _mapscopeids[name] = scopeid;
+        return scopeid;
+    }
+
+    void AddSample(int scopeid, uint64_t starttime, uint64_t endtime)
+    {
+        ProfilingThreadData& threaddata = GetThreadData();
+        uint64_t duration = endtime > starttime ? endtime - starttime : 0;
+        boost::mutex::scoped_lock lock(threaddata._mutex);
+        if( scopeid >= (int)threaddata._vaccumulators.size() ) {
+            threaddata._vaccumulators.resize(scopeid+1);
+        }
+        threaddata._vaccumulators[scopeid].AddSample(duration);
+        if( _bTraceEnabled.load(boost::memory_order_relaxed) ) {
+            if( threaddata._vevents.size() < s_nMaxThreadEvents ) {
+                ProfilingTraceEvent event;
+                event.scopeid = scopeid;
+                event.threadindex = threaddata._threadindex;
+                event.starttime = starttime;
+                event.duration = duration;
+                threaddata._vevents.push_back(event);
+            }
+            else {
+                ++threaddata._ndroppedevents;
+            }
+        }
+    }
+
+    void AddCount(int scopeid, uint64_t count)
+    {
+        ProfilingThreadData& threaddata = GetThreadData();
+        boost::mutex::scoped_lock lock(threaddata._mutex);
+        if( scopeid >= (int)threaddata._vaccumulators.size() ) {
+            threaddata._vaccumulators.resize(scopeid+1);
+        }
+        threaddata._vaccumulators[scopeid].count += count;
+    }
+
+    void GetStats(std::vector<ProfilingStats>& vstats)
+    {
+        vstats.resize(0);
+        boost::mutex::scoped_lock lock(_mutex);
+        std::vector<ProfilingAccumulator> vaccumulators(_vscopenames.size());
+        _MergeAccumulators(_retired._vaccumulators, vaccumulators);
+        FOREACH(itthread, _listthreads) {
+            boost::mutex::scoped_lock threadlock((*itthread)->_mutex);
+            _MergeAccumulators((*itthread)->_vaccumulators, vaccumulators);
+        }
+        for(size_t i = 0; i < vaccumulators.size(); ++i) {
+            if( vaccumulators[i].count > 0 ) {
+                vstats.push_back(ProfilingStats());
+                ProfilingStats& stats = vstats.back();
+                stats.name = _vscopenames[i];
+                stats.count = vaccumulators[i].count;
+                stats.totaltime = vaccumulators[i].totaltime;
+                stats.mintime = vaccumulators[i].mintime;
+                stats.maxtime = vaccumulators[i].maxtime;
+            }
+        }
+    }
+
+    void Reset()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _retired._vaccumulators.clear();
+        _retired._vevents.clear();
+        _retired._ndroppedevents = 0;
+        FOREACH(itthread, _listthreads) {
+            boost::mutex::scoped_lock threadlock((*itthread)->_mutex);
+            (*itthread)->_vaccumulators.clear();
+            (*itthread)->_vevents.clear();
+            (*itthread)->_ndroppedevents = 0;
+        }
+        _basetime = utils::GetNanoPerformanceTime();
+    }
+
+    void WriteTrace(std::ostream& O)
+    {
+        std::vector<ProfilingTraceEvent> vevents;
+        std::vector<std::string> vscopenames;
+        std::vector<int> vthreadindices;
+        uint64_t ndroppedevents = 0, basetime = 0;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            vscopenames = _vscopenames;
+            basetime = _basetime;
+            vevents = _retired._vevents;
+            ndroppedevents = _retired._ndroppedevents;
+            FOREACH(itthread, _listthreads) {
+                boost::mutex::scoped_lock threadlock((*itthread)->_mutex);
+                vevents.insert(vevents.end(), (*itthread)->_vevents.begin(), (*itthread)->_vevents.end());
+                ndroppedevents += (*itthread)->_ndroppedevents;
+                vthreadindices.push_back((*itthread)->_threadindex);
+            }
+        }
+        if( ndroppedevents > 0 ) {
+            RAVELOG_WARN_FORMAT("profiling trace dropped %d events", ndroppedevents);
+        }
+
+        std::streamsize oldprecision = O.precision(std::numeric_limits<double>::digits10);
+        std::ios_base::fmtflags oldflags = O.flags();
+        O << std::fixed << std::setprecision(3);
+        O << "{\"traceEvents\":[";
+        bool bfirst = true;
+        FOREACHC(itevent, vevents) {
+            if( !bfirst ) {
+                O << ",";
+            }
+            bfirst = false;
+            double starttime = itevent->starttime >= basetime ? 1e-3*(double)(itevent->starttime - basetime) : 0.0;
+            O << "\n{\"name\":\"";
+            _WriteJSONString(O, vscopenames.at(itevent->scopeid));
+            O << "\",\"cat\":\"openrave\",\"ph\":\"X\",\"pid\":0,\"tid\":" << itevent->threadindex << ",\"ts\":" << starttime << ",\"dur\":" << 1e-3*(double)itevent->duration << "}";
+        }
+        FOREACHC(itthreadindex, vthreadindices) {
+            if( !bfirst ) {
+                O << ",";
+            }
+            bfirst = false;
+            O << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << *itthreadindex << ",\"args\":{\"name\":\"thread " << *itthreadindex << "\"}}";
+        }
+        O << "\n],\"displayTimeUnit\":\"ns\"}\n";
+        O.flags(oldflags);
+        O.precision(oldprecision);
+    }
+
+    /// \brief called when a thread exits, moves its data into _retired so that the list of threads does not grow
+    void RetireThreadData(ProfilingThreadDataPtr threaddata)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        {
+            boost::mutex::scoped_lock threadlock(threaddata->_mutex);
+            if( _retired._vaccumulators.size() < threaddata->_vaccumulators.size() ) {
+                _retired._vaccumulators.resize(threaddata->_vaccumulators.size());
+            }
+            _MergeAccumulators(threaddata->_vaccumulators, _retired._vaccumulators);
+            size_t numevents = std::min(threaddata->_vevents.size(), s_nMaxThreadEvents > _retired._vevents.size() ? s_nMaxThreadEvents - _retired._vevents.size() : size_t(0));
+            _retired._vevents.insert(_retired._vevents.end(), threaddata->_vevents.begin(), threaddata->_vevents.begin()+numevents);
+            _retired._ndroppedevents += threaddata->_ndroppedevents + (threaddata->_vevents.size()-numevents);
+        }
+        _listthreads.remove(threaddata);
+    }
+
+    boost::atomic<bool> _bEnabled, _bTraceEnabled; ///< read without locking by the profiled threads
+
+private:
+    static void _MergeAccumulators(const std::vector<ProfilingAccumulator>& vsource, std::vector<ProfilingAccumulator>& vtarget)
+    {
+        for(size_t i = 0; i < vsource.size() && i < vtarget.size(); ++i) {
+            vtarget[i].Merge(vsource[i]);
+        }
+    }
+
+    static void _WriteJSONString(std::ostream& O, const std::string& s)
+    {
+        FOREACHC(itc, s) {
+            switch(*itc) {
+            case '"': O << "\\\""; break;
+            case '\\': O << "\\\\"; break;
+            case '\n': O << "\\n"; break;
+            case '\t': O << "\\t"; break;
+            default:
+                if( (unsigned char)*itc < 0x20 ) {
+                    O << ' ';
+                }
+                else {
+                    O << *itc;
+                }
+            }
+        }
+    }
+
+    boost::mutex _mutex; ///< protects the scope names and the list of threads
+    std::vector<std::string> _vscopenames; ///< indexed by scope id
+    std::map<std::string, int> _mapscopeids;
+    std::list<ProfilingThreadDataPtr> _listthreads;
+    boost::thread_specific_ptr<ProfilingThreadDataPtr> _threaddata;
+    int _nextthreadindex;
+    ProfilingThreadData _retired; ///< accumulated data of the threads that have exited
+    uint64_t _basetime; ///< time of the last reset, trace events are written relative to it
+};
+
+static boost::atomic<ProfilingManager*> s_pProfilingManager(NULL); ///< published with release semantics so that threads skipping call_once see a constructed manager
+static boost::once_flag _onceProfilingManager = BOOST_ONCE_INIT;
+
+static void _CreateProfilingManager()
+{
+    s_pProfilingManager.store(new ProfilingManager(), boost::memory_order_release);
+}
+
+static inline ProfilingManager& _GetProfilingManager()
+{
+    // skip call_once on the hot path once the manager exists
+    ProfilingManager* pmanager = s_pProfilingManager.load(boost::memory_order_acquire);
+    if( !pmanager ) {
+        boost::call_once(_CreateProfilingManager,_onceProfilingManager);
+        pmanager = s_pProfilingManager.load(boost::memory_order_acquire);
+    }
+    return *pmanager;
+}
+
+static void _RetireProfilingThreadData(ProfilingThreadDataPtr* pthreaddata)
+{
+    if( !!pthreaddata ) {
+        ProfilingManager* pmanager = s_pProfilingManager.load(boost::memory_order_acquire);
+        if( !!*pthreaddata && !!pmanager ) {
+            pmanager->RetireThreadData(*pthreaddata);
+        }
+        delete pthreaddata;
+    }
+}
+
+void RaveSetProfilingEnabled(bool enabled)
+{
+    _GetProfilingManager()._bEnabled.store(enabled);
+}
+
+bool RaveIsProfilingEnabled()
+{
+    // avoid call_once in the disabled case, the manager is always created before profiling can be enabled
+    ProfilingManager* pmanager = s_pProfilingManager.load(boost::memory_order_acquire);
+    return !!pmanager && pmanager->_bEnabled.load(boost::memory_order_relaxed);
+}
+
+void RaveSetProfilingTraceEnabled(bool enabled)
+{
+    _GetProfilingManager()._bTraceEnabled.store(enabled);
+}
+
+bool RaveIsProfilingTraceEnabled()
+{
+    ProfilingManager* pmanager = s_pProfilingManager.load(boost::memory_order_acquire);
+    return !!pmanager && pmanager->_bTraceEnabled.load(boost::memory_order_relaxed);
+}
+
+int RaveRegisterProfilingScope(const std::string& name)
+{
+    return _GetProfilingManager().RegisterScope(name);
+}
+
+uint64_t RaveGetProfilingTime()
+{
+    return utils::GetNanoPerformanceTime();
+}
+
+void RaveAddProfilingSample(int scopeid, uint64_t starttime, uint64_t endtime)
+{
+    _GetProfilingManager().AddSample(scopeid, starttime, endtime);
+}
+
+void RaveAddProfilingCount(int scopeid, uint64_t count)
+{
+    _GetProfilingManager().AddCount(scopeid, count);
+}
+
+void RaveGetProfilingStats(std::vector<ProfilingStats>& vstats)
+{
+    _GetProfilingManager().GetStats(vstats);
+}
+
+void RaveResetProfilingStats()
+{
+    _GetProfilingManager().Reset();
+}
+
+void RaveWriteProfilingTrace(std::ostream& O)
+{
+    _GetProfilingManager().WriteTrace(O);
+}
+
+} // end namespace OpenRAVE
@@ -21,12 +21,140 @@
 
 namespace OpenRAVE {
 
+namespace {
+
+/// layout of the binary format, all numbers are little-endian:
+/// magic[8], uint16 version, uint16 sizeof(dReal), uint32 flags, uint64 numwaypoints, uint32 dof, uint32 metadatasize,
+/// metadata (XML of the trajectory without the data), zero padding to 8 bytes, numwaypoints*dof values
+static const char s_trajectoryBinaryMagic[8] = { '\x89', 'O', 'R', 'T', 'R', 'A', 'J', '\x1a' };
+static const uint16_t s_nTrajectoryBinaryVersion = 1;
+static const size_t s_nTrajectoryBinaryHeaderSize = 32;
+
+struct TrajectoryBinaryHeader
+{
+    uint16_t version;
+    uint16_t realsize;
+    uint32_t flags;
+    uint64_t numwaypoints;
+    uint32_t dof;
+    uint32_t metadatasize;
+
+    inline uint64_t GetDataOffset() const {
+        return ((s_nTrajectoryBinaryHeaderSize + (uint64_t)metadatasize + 7)/8)*8;
+    }
+    /// \brief number of values, ParseTrajectoryBinaryHeader guarantees that this does not overflow
+    inline uint64_t GetNumValues() const {
+        return numwaypoints*dof;
+    }
+    inline uint64_t GetDataSize() const {
+        return GetNumValues()*realsize;
+    }
+};
+
+inline bool IsLittleEndianHost()
+{
+    uint16_t test = 1;
+    return *reinterpret_cast<uint8_t*>(&test) == 1;
+}
+
+inline uint64_t ReadLittleEndian(const char* p, int numbytes)
+{
+    uint64_t value = 0;
+    for(int i = numbytes-1; i >= 0; --i) {
+        value = (value<<8)|(uint64_t)(uint8_t)p[i];
+    }
+    return value;
+}
+
+inline void WriteLittleEndian(char* p, uint64_t value, int numbytes)
+{
+    for(int i = 0; i < numbytes; ++i) {
+        p[i] = (char)(value&0xff);
+        value >>= 8;
+    }
+}
+
+/// \brief parses the fixed part of the header, throws if it is not a binary trajectory this build can read
+void ParseTrajectoryBinaryHeader(const char* p, size_t size, TrajectoryBinaryHeader& header)
+{
+    if( size < s_nTrajectoryBinaryHeaderSize || memcmp(p, s_trajectoryBinaryMagic, sizeof(s_trajectoryBinaryMagic)) != 0 ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("not a binary trajectory"), ORE_InvalidArguments);
+    }
+    header.version = (uint16_t)ReadLittleEndian(p+8, 2);
+    header.realsize = (uint16_t)ReadLittleEndian(p+10, 2);
+    header.flags = (uint32_t)ReadLittleEndian(p+12, 4);
+    header.numwaypoints = ReadLittleEndian(p+16, 8);
+    header.dof = (uint32_t)ReadLittleEndian(p+24, 4);
+    header.metadatasize = (uint32_t)ReadLittleEndian(p+28, 4);
+    if( header.version == 0 || header.version > s_nTrajectoryBinaryVersion ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("binary trajectory version %d is not supported, max is %d"), header.version%s_nTrajectoryBinaryVersion, ORE_InvalidArguments);
+    }
+    if( header.realsize != sizeof(float) && header.realsize != sizeof(double) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("binary trajectory has invalid value size %d"), header.realsize, ORE_InvalidArguments);
+    }
+    // the values have to be addressable in memory, this also rejects numwaypoints*dof*realsize overflowing
+    if( header.dof > 0 && header.numwaypoints > (uint64_t)std::numeric_limits<size_t>::max()/((uint64_t)header.dof*header.realsize) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("binary trajectory has an invalid size of %d waypoints with %d dof"), header.numwaypoints%header.dof, ORE_InvalidArguments);
+    }
+}
+
+/// \brief reads numelements from I into v, growing v in chunks so that a corrupted size fails with a truncated stream rather than a huge allocation
+template <typename T>
+bool ReadTrajectoryBinaryChunks(std::istream& I, std::vector<T>& v, size_t numelements)
+{
+    static const size_t s_nChunkSize = (1<<20)/sizeof(T);
+    v.resize(0);
+    while(v.size() < numelements) {
+        size_t offset = v.size();
+        v.resize(offset + min(numelements-offset, s_nChunkSize));
+        if( !I.read(reinterpret_cast<char*>(&v[offset]), (v.size()-offset)*sizeof(T)) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// \brief converts little-endian float or double values to dReal
+void ConvertTrajectoryBinaryValues(const char* psrc, size_t numvalues, int realsize, dReal* pdst)
+{
+    if( realsize == sizeof(float) ) {
+        for(size_t i = 0; i < numvalues; ++i, psrc += realsize) {
+            uint32_t bits = (uint32_t)ReadLittleEndian(psrc, 4);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            pdst[i] = f;
+        }
+    }
+    else {
+        for(size_t i = 0; i < numvalues; ++i, psrc += realsize) {
+            uint64_t bits = ReadLittleEndian(psrc, 8);
+            double f;
+            memcpy(&f, &bits, sizeof(f));
+            pdst[i] = f;
+        }
+    }
+}
+
+/// \brief returns true if the values written with realsize can be used in place
+inline bool CanUseTrajectoryBinaryValuesInPlace(int realsize)
+{
+    return realsize == sizeof(dReal) && IsLittleEndianHost();
+}
+
+}
+
 TrajectoryBase::TrajectoryBase(EnvironmentBasePtr penv) : InterfaceBase(PT_Trajectory,penv)
 {
 }
 
 void TrajectoryBase::serialize(std::ostream& O, int options) const
 {
+    if( options & SO_TrajectoryBinary ) {
+        std::vector<dReal> data;
+        GetWaypoints(0,GetNumWaypoints(),data);
+        _SerializeBinary(O, data.size() > 0 ? &data[0] : NULL, GetNumWaypoints(), options);
+        return;
+    }
     O << "<trajectory type=\"" << GetXMLId() << "\">" << endl << GetConfigurationSpecification();
     O << "<data count=\"" << GetNumWaypoints() << "\">" << endl;
     std::vector<dReal> data;
@@ -49,8 +177,111 @@ void TrajectoryBase::serialize(std::ostream& O, int options) const
     O << "</trajectory>" << endl;
 }
 
+void TrajectoryBase::_SerializeBinary(std::ostream& O, const dReal* pdata, size_t numwaypoints, int options) const
+{
+    std::stringstream ssmetadata;
+    ssmetadata << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+    ssmetadata << "<trajectory type=\"" << GetXMLId() << "\">" << endl << GetConfigurationSpecification();
+    if( GetDescription().size() > 0 ) {
+        ssmetadata << "<description><![CDATA[" << GetDescription() << "]]></description>" << endl;
+    }
+    if( GetReadableInterfaces().size() > 0 ) {
+        xmlreaders::StreamXMLWriterPtr writer(new xmlreaders::StreamXMLWriter("readable"));
+        FOREACHC(it, GetReadableInterfaces()) {
+            BaseXMLWriterPtr newwriter = writer->AddChild(it->first);
+            it->second->Serialize(newwriter,options);
+        }
+        writer->Serialize(ssmetadata);
+    }
+    ssmetadata << "</trajectory>" << endl;
+    std::string metadata = ssmetadata.str();
+
+    TrajectoryBinaryHeader header;
+    header.version = s_nTrajectoryBinaryVersion;
+    header.realsize = sizeof(dReal);
+    header.flags = 0;
+    header.numwaypoints = numwaypoints;
+    header.dof = GetConfigurationSpecification().GetDOF();
+    header.metadatasize = metadata.size();
+
+    std::vector<char> vheader(header.GetDataOffset(), 0);
+    memcpy(&vheader[0], s_trajectoryBinaryMagic, sizeof(s_trajectoryBinaryMagic));
+    WriteLittleEndian(&vheader[8], header.version, 2);
+    WriteLittleEndian(&vheader[10], header.realsize, 2);
+    WriteLittleEndian(&vheader[12], header.flags, 4);
+    WriteLittleEndian(&vheader[16], header.numwaypoints, 8);
+    WriteLittleEndian(&vheader[24], header.dof, 4);
+    WriteLittleEndian(&vheader[28], header.metadatasize, 4);
+    std::copy(metadata.begin(), metadata.end(), vheader.begin()+s_nTrajectoryBinaryHeaderSize);
+    O.write(&vheader[0], vheader.size());
+
+    size_t numvalues = numwaypoints*header.dof;
+    if( numvalues == 0 ) {
+        return;
+    }
+    if( IsLittleEndianHost() ) {
+        O.write(reinterpret_cast<const char*>(pdata), numvalues*sizeof(dReal));
+    }
+    else {
+        // swap in chunks so that huge trajectories do not need a second copy
+        char buffer[sizeof(dReal)*512];
+        for(size_t ivalue = 0; ivalue < numvalues; ) {
+            size_t numchunk = min(numvalues-ivalue, (size_t)512);
+            for(size_t i = 0; i < numchunk; ++i) {
+                uint64_t bits = 0;
+                memcpy(&bits, &pdata[ivalue+i], sizeof(dReal));
+                WriteLittleEndian(&buffer[i*sizeof(dReal)], bits, sizeof(dReal));
+            }
+            O.write(buffer, numchunk*sizeof(dReal));
+            ivalue += numchunk;
+        }
+    }
+}
+
 InterfaceBasePtr TrajectoryBase::deserialize(std::istream& I)
 {
+    if( I.peek() == (int)(uint8_t)s_trajectoryBinaryMagic[0] ) {
+        char headerdata[s_nTrajectoryBinaryHeaderSize];
+        if( !I.read(headerdata, s_nTrajectoryBinaryHeaderSize) ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0(_("binary trajectory header is truncated"), ORE_InvalidArguments);
+        }
+        TrajectoryBinaryHeader header;
+        ParseTrajectoryBinaryHeader(headerdata, s_nTrajectoryBinaryHeaderSize, header);
+        if( header.metadatasize == 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0(_("binary trajectory does not have a configuration"), ORE_InvalidArguments);
+        }
+        std::vector<char> vmetadata;
+        if( !ReadTrajectoryBinaryChunks(I, vmetadata, header.GetDataOffset()-s_nTrajectoryBinaryHeaderSize) ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0(_("binary trajectory metadata is truncated"), ORE_InvalidArguments);
+        }
+
+        xmlreaders::TrajectoryReader readerdata(GetEnv(),shared_trajectory());
+        LocalXML::ParseXMLData(readerdata, &vmetadata[0], header.metadatasize);
+        OPENRAVE_ASSERT_OP_FORMAT0((int)header.dof, ==, GetConfigurationSpecification().GetDOF(), "binary trajectory dof does not match its configuration", ORE_InvalidArguments);
+
+        size_t numvalues = header.GetNumValues();
+        if( numvalues > 0 ) {
+            std::vector<dReal> data;
+            bool bread;
+            if( CanUseTrajectoryBinaryValuesInPlace(header.realsize) ) {
+                bread = ReadTrajectoryBinaryChunks(I, data, numvalues);
+            }
+            else {
+                std::vector<char> vrawdata;
+                bread = ReadTrajectoryBinaryChunks(I, vrawdata, header.GetDataSize());
+                if( bread ) {
+                    data.resize(numvalues);
+                    ConvertTrajectoryBinaryValues(&vrawdata[0], numvalues, header.realsize, &data[0]);
+                }
+            }
+            if( !bread ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("binary trajectory data is truncated, expected %d values"), numvalues, ORE_InvalidArguments);
+            }
+            Insert(GetNumWaypoints(), data);
+        }
+        return shared_from_this();
+    }
+
     stringbuf buf;
     stringstream::streampos pos = I.tellg();
     I.get(buf, 0); // get all the data, yes this is inefficient, not sure if there anyway to search in streams
@@ -117,6 +348,17 @@ void TrajectoryBase::SamplePoints(std::vector<dReal>& data, const std::vector<dR
     }
 }
 
+void TrajectoryBase::SampleRange(std::vector<dReal>& data, dReal starttime, dReal deltatime, size_t numsamples, const ConfigurationSpecification& spec) const
+{
+    std::vector<dReal> tempdata;
+    data.resize(spec.GetDOF()*numsamples);
+    std::vector<dReal>::iterator itdata = data.begin();
+    for(size_t i = 0; i < numsamples; ++i, itdata += spec.GetDOF()) {
+        Sample(tempdata, starttime+i*deltatime, spec);
+        std::copy(tempdata.begin(), tempdata.end(), itdata);
+    }
+}
+
 void TrajectoryBase::GetWaypoints(size_t startindex, size_t endindex, std::vector<dReal>& data, const ConfigurationSpecification& spec) const
 {
     RAVELOG_VERBOSE(str(boost::format("TrajectoryBase::GetWaypoints: calling slow implementation %s")%GetXMLId()));
@@ -128,6 +370,53 @@ void TrajectoryBase::GetWaypoints(size_t startindex, size_t endindex, std::vecto
     }
 }
 
+TrajectoryBinaryView::TrajectoryBinaryView(const char* pbuffer, size_t size) : _numwaypoints(0), _serializedsize(0), _pdata(NULL)
+{
+    TrajectoryBinaryHeader header;
+    ParseTrajectoryBinaryHeader(pbuffer, size, header);
+    // compare the terms separately so that a corrupted header cannot wrap the sum around
+    if( header.GetDataOffset() > size || header.GetDataSize() > size - header.GetDataOffset() ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("binary trajectory needs %d bytes, buffer only has %d"), (header.GetDataOffset() + header.GetDataSize())%size, ORE_InvalidArguments);
+    }
+    _metadata.assign(pbuffer+s_nTrajectoryBinaryHeaderSize, header.metadatasize);
+    size_t configurationpos = _metadata.find("<configuration");
+    size_t configurationend = _metadata.find("</configuration>");
+    if( configurationpos == std::string::npos || configurationend == std::string::npos ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("binary trajectory does not have a configuration"), ORE_InvalidArguments);
+    }
+    ConfigurationSpecification::Reader reader(_spec);
+    LocalXML::ParseXMLData(reader, _metadata.c_str()+configurationpos, configurationend+16-configurationpos);
+    OPENRAVE_ASSERT_OP_FORMAT0((int)header.dof, ==, _spec.GetDOF(), "binary trajectory dof does not match its configuration", ORE_InvalidArguments);
+
+    _numwaypoints = header.numwaypoints;
+    _serializedsize = header.GetDataOffset() + header.GetDataSize();
+    const char* pdata = pbuffer + header.GetDataOffset();
+    size_t numvalues = header.GetNumValues();
+    if( CanUseTrajectoryBinaryValuesInPlace(header.realsize) && ((size_t)pdata % sizeof(dReal)) == 0 ) {
+        _pdata = reinterpret_cast<const dReal*>(pdata);
+    }
+    else if( numvalues > 0 ) {
+        _vconverteddata.resize(numvalues);
+        ConvertTrajectoryBinaryValues(pdata, numvalues, header.realsize, &_vconverteddata[0]);
+        _pdata = &_vconverteddata[0];
+    }
+}
+
+bool TrajectoryBinaryView::IsBinaryTrajectory(const char* pbuffer, size_t size)
+{
+    return size >= sizeof(s_trajectoryBinaryMagic) && memcmp(pbuffer, s_trajectoryBinaryMagic, sizeof(s_trajectoryBinaryMagic)) == 0;
+}
+
+void TrajectoryBinaryView::InitTrajectory(TrajectoryBasePtr traj) const
+{
+    xmlreaders::TrajectoryReader readerdata(traj->GetEnv(),traj);
+    LocalXML::ParseXMLData(readerdata, _metadata.c_str(), _metadata.size());
+    if( _numwaypoints > 0 ) {
+        std::vector<dReal> data(_pdata, _pdata+_numwaypoints*_spec.GetDOF());
+        traj->Insert(traj->GetNumWaypoints(), data);
+    }
+}
+
 // Old API
 
 bool TrajectoryBase::SampleTrajectory(dReal time, TrajectoryBase::Point& tp) const
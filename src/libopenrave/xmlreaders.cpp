@@ -22,6 +22,131 @@
 namespace OpenRAVE {
 namespace xmlreaders {
 
+static inline bool _IsNumberSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/// \brief converts the number at p if it is exact in a single multiplication or division, otherwise returns false
+///
+/// If the mantissa and the power of ten are both exactly representable, the IEEE operation gives the correctly rounded value, which is the same value the stream extraction gives.
+static bool _ParseNumberFast(const char*& p, const char* pend, dReal& value)
+{
+    // largest power of 10 and largest mantissa that are exact in dReal
+    static const int s_nMaxExactPow10 = std::numeric_limits<dReal>::digits == 53 ? 22 : 10;
+    static const uint64_t s_nMaxExactMantissa = uint64_t(1) << std::numeric_limits<dReal>::digits;
+    static const dReal s_fPow10[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* pcur = p;
+    bool bnegative = false;
+    if( pcur < pend && (*pcur == '-' || *pcur == '+') ) {
+        bnegative = *pcur == '-';
+        ++pcur;
+    }
+    uint64_t mantissa = 0;
+    int numdigits = 0, numsignificant = 0, exp10 = 0;
+    for(; pcur < pend && *pcur >= '0' && *pcur <= '9'; ++pcur, ++numdigits) {
+        if( mantissa > 0 || *pcur != '0' ) {
+            if( ++numsignificant > 19 ) {
+                return false;
+            }
+            mantissa = 10*mantissa + (*pcur-'0');
+        }
+    }
+    if( pcur < pend && *pcur == '.' ) {
+        for(++pcur; pcur < pend && *pcur >= '0' && *pcur <= '9'; ++pcur, ++numdigits) {
+            if( mantissa > 0 || *pcur != '0' ) {
+                if( ++numsignificant > 19 ) {
+                    return false;
+                }
+                mantissa = 10*mantissa + (*pcur-'0');
+            }
+            --exp10;
+        }
+    }
+    if( numdigits == 0 ) {
+        return false;
+    }
+    if( pcur < pend && (*pcur == 'e' || *pcur == 'E') ) {
+        ++pcur;
+        bool bnegativeexp = false;
+        if( pcur < pend && (*pcur == '-' || *pcur == '+') ) {
+            bnegativeexp = *pcur == '-';
+            ++pcur;
+        }
+        if( pcur >= pend || *pcur < '0' || *pcur > '9' ) {
+            return false;
+        }
+        int exponent = 0;
+        for(; pcur < pend && *pcur >= '0' && *pcur <= '9'; ++pcur) {
+            if( exponent > 10000 ) {
+                return false;
+            }
+            exponent = 10*exponent + (*pcur-'0');
+        }
+        exp10 += bnegativeexp ? -exponent : exponent;
+    }
+    if( pcur < pend && !_IsNumberSpace(*pcur) ) {
+        return false;
+    }
+    if( mantissa == 0 ) {
+        value = 0;
+    }
+    else if( mantissa > s_nMaxExactMantissa || exp10 > s_nMaxExactPow10 || exp10 < -s_nMaxExactPow10 ) {
+        return false;
+    }
+    else if( exp10 >= 0 ) {
+        value = (dReal)mantissa * s_fPow10[exp10];
+    }
+    else {
+        value = (dReal)mantissa / s_fPow10[-exp10];
+    }
+    if( bnegative ) {
+        value = -value;
+    }
+    p = pcur;
+    return true;
+}
+
+size_t ParseNumbers(const char* pbegin, const char* pend, std::vector<dReal>& values)
+{
+    size_t numinitial = values.size();
+    std::stringstream sstoken;
+    const char* p = pbegin;
+    while(1) {
+        while( p < pend && _IsNumberSpace(*p) ) {
+            ++p;
+        }
+        if( p >= pend ) {
+            break;
+        }
+        dReal value;
+        if( _ParseNumberFast(p, pend, value) ) {
+            values.push_back(value);
+            continue;
+        }
+        // convert the token with the stream
+        const char* ptokenend = p;
+        while( ptokenend < pend && !_IsNumberSpace(*ptokenend) ) {
+            ++ptokenend;
+        }
+        sstoken.clear();
+        sstoken.str(std::string(p, ptokenend));
+        if( !!(sstoken >> value) && sstoken.peek() == std::char_traits<char>::eof() ) {
+            values.push_back(value);
+            p = ptokenend;
+            continue;
+        }
+        // the token is not a single number, so let the stream convert the rest so that the results and the stopping point match stream extraction
+        std::stringstream ss(std::string(p, pend));
+        while( !!(ss >> value) ) {
+            values.push_back(value);
+        }
+        break;
+    }
+    return values.size() - numinitial;
+}
+
 StringXMLReadable::StringXMLReadable(const std::string& xmlid, const std::string& data) : XMLReadable(xmlid), _data(data)
 {
 }
@@ -142,14 +267,16 @@ bool TrajectoryReader::endElement(const std::string& name)
         }
     }
     else if( name == "data" ) {
-        _vdata.resize(_spec.GetDOF()*_datacount);
-        for(size_t i = 0; i < _vdata.size(); ++i) {
-            _ss >> _vdata[i];
-        }
-        if( !_ss ) {
-            throw OPENRAVE_EXCEPTION_FORMAT(_("failed reading %d numbers from trajectory <data> element"), _vdata.size(), ORE_Assert);
+        size_t numvalues = _spec.GetDOF()*_datacount;
+        std::string data = _ss.str();
+        _vdata.resize(0);
+        _vdata.reserve(numvalues);
+        ParseNumbers(data.c_str(), data.c_str()+data.size(), _vdata);
+        if( _vdata.size() < numvalues ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("failed reading %d numbers from trajectory <data> element"), numvalues, ORE_Assert);
         }
         else {
+            _vdata.resize(numvalues);
             _ptraj->Insert(_ptraj->GetNumWaypoints(),_vdata);
         }
     }
@@ -406,7 +533,9 @@ bool GeometryInfoReader::endElement(const std::string& xmlname)
                 }
             }
             else if( xmlname == "vertices" ) {
-                vector<dReal> values((istream_iterator<dReal>(_ss)), istream_iterator<dReal>());
+                std::string data = _ss.str();
+                vector<dReal> values;
+                ParseNumbers(data.c_str(), data.c_str()+data.size(), values);
                 if( (values.size()%9) ) {
                     RAVELOG_WARN(str(boost::format("number of points specified in the vertices field needs to be a multiple of 3 (it is %d), ignoring...\n")%values.size()));
                 }
@@ -0,0 +1,126 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2011 Rosen Diankov (rosen.diankov@gmail.com)
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/// \brief checks that xmlreaders::ParseNumbers gives bitwise the same values and stops at the same token as extracting dReal values from a std::stringstream.
+///
+/// usage: parsenumberstest [numrandom]
+#include <openrave/openrave.h>
+#include <openrave/xmlreaders.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace OpenRAVE;
+using namespace std;
+
+/// \brief returns true if ParseNumbers and the stream extraction agree on data
+static bool CheckParseNumbers(const string& data)
+{
+    vector<dReal> vexpected, vparsed;
+    stringstream ss(data);
+    dReal value;
+    while( !!(ss >> value) ) {
+        vexpected.push_back(value);
+    }
+    size_t numparsed = xmlreaders::ParseNumbers(data.c_str(), data.c_str()+data.size(), vparsed);
+
+    bool bequal = numparsed == vparsed.size() && vparsed.size() == vexpected.size();
+    for(size_t i = 0; bequal && i < vexpected.size(); ++i) {
+        // compare the bits so that -0 and 0 are distinguished
+        bequal = memcmp(&vexpected[i], &vparsed[i], sizeof(dReal)) == 0;
+    }
+    if( !bequal ) {
+        cerr << "mismatch for \"" << data << "\": stream=";
+        for(size_t i = 0; i < vexpected.size(); ++i) {
+            cerr << " " << vexpected[i];
+        }
+        cerr << ", ParseNumbers=";
+        for(size_t i = 0; i < vparsed.size(); ++i) {
+            cerr << " " << vparsed[i];
+        }
+        cerr << endl;
+    }
+    return bequal;
+}
+
+int main(int argc, char ** argv)
+{
+    int numrandom = argc > 1 ? atoi(argv[1]) : 100000;
+    static const char* s_cases[] = {
+        "",
+        "   \t\n",
+        // signs and leading zeros
+        "1 -1 +1 -0 +0 0 -0.0 +0.0 0.0 .5 -.5 5. -5.",
+        "00012 -000.5 007e2 0.000000000000000000000000000001 -0000000000000000000000000000001",
+        // more than 19 significant digits, or mantissas that are not exact
+        "1234567890123456789 12345678901234567890 -98765432109876543210e-5 0.12345678901234567890123",
+        "9007199254740992 9007199254740993 18014398509481985 1.0000000000000000001 0.1 0.2 0.3 4.35 2.675",
+        // exponents around and beyond the exact powers of ten
+        "1e22 1e23 -1e22 1e-22 1e-23 123e20 123e-25 1e+5 1E5 1e05 1e-0 1.5e-7",
+        "5e300 1.7976931348623157e308 1e308 2.2250738585072014e-308 4.9e-324 1e-320 0e999999 0e-999999",
+        "1e309 -1e309 1e-400 -2.5e-400 1e99999",
+        // special values and text
+        "inf -inf nan",
+        "1 2 inf 3",
+        "1 2 nan 3",
+        "1 2 3abc 4",
+        "1 2 3.5.6 4",
+        "1 2e 3",
+        "1 2e+ 3",
+        "1 2e- 3",
+        ". 1",
+        "- 1",
+        "+ 1",
+        "1 - 2",
+        "0x10 1",
+        "1,2 3",
+        "1\t2\n3\r4\v5\f6",
+        "  7  ",
+    };
+    bool bsuccess = true;
+    for(size_t icase = 0; icase < sizeof(s_cases)/sizeof(s_cases[0]); ++icase) {
+        bsuccess &= CheckParseNumbers(s_cases[icase]);
+    }
+
+    // random values printed in the formats that the writers use
+    static const char* s_formats[] = { "%.17g", "%.15g", "%.6g", "%.3f", "%.10e", "%g" };
+    srand(0);
+    char buf[64];
+    std::string data;
+    for(int i = 0; i < numrandom; ++i) {
+        double f = (double)rand()/RAND_MAX - 0.5;
+        int exponent = rand()%61 - 30;
+        for(int j = 0; j < abs(exponent); ++j) {
+            f = exponent > 0 ? f*10 : f/10;
+        }
+        sprintf(buf, s_formats[i%(sizeof(s_formats)/sizeof(s_formats[0]))], f);
+        data += buf;
+        data += ' ';
+        if( data.size() > 4096 ) {
+            bsuccess &= CheckParseNumbers(data);
+            data.clear();
+        }
+    }
+    bsuccess &= CheckParseNumbers(data);
+
+    cout << (bsuccess ? "ParseNumbers matches the stream extraction" : "ParseNumbers differs from the stream extraction") << endl;
+    return bsuccess ? 0 : 1;
+}
@@ -561,3 +561,69 @@ class TestCOLLADA(EnvironmentSetup):
         env2.Load('test_externalgrab.dae')
         misc.CompareEnvironments(env, env2)
         
+
+    def test_cacheduri(self):
+        self.log.info('test that cached collada bodies are reloaded when the file or an external reference changes')
+        env=self.env
+        def savebox(filename, extents):
+            env.Reset()
+            body = RaveCreateKinBody(env, '')
+            body.InitFromBoxes(array([r_[zeros(3), extents]]))
+            body.SetName('box')
+            env.Add(body)
+            env.Save(filename,Environment.SelectionOptions.Body,{'target':'box'})
+            env.Reset()
+
+        def getextents(body):
+            return body.GetLinks()[0].GetGeometries()[0].GetBoxExtents()
+
+        boxfilename = os.path.abspath('test_cacheduri_box.dae')
+        boxuri = 'file:' + boxfilename
+        savebox(boxfilename, [0.1,0.2,0.3])
+        body1 = env.ReadKinBodyURI(boxuri)
+        body2 = env.ReadKinBodyURI(boxuri)
+        assert(transdist(getextents(body1),[0.1,0.2,0.3]) <= 1e-4)
+        assert(transdist(getextents(body2),getextents(body1)) <= 1e-4)
+
+        savebox(boxfilename, [0.3,0.2,0.1])
+        body3 = env.ReadKinBodyURI(boxuri)
+        assert(transdist(getextents(body3),[0.3,0.2,0.1]) <= 1e-4)
+        body4 = env.ReadKinBodyURI(boxuri, {'cache':'0'})
+        assert(transdist(getextents(body4),getextents(body3)) <= 1e-4)
+
+        # the body is only referenced by the loaded file, so changing the referenced file has to reload it
+        env.Load(boxfilename)
+        env.Save('test_cacheduri_ref.dae',Environment.SelectionOptions.Everything,{'externalref':'*'})
+        env.Reset()
+        body5 = env.ReadKinBodyURI('test_cacheduri_ref.dae')
+        assert(transdist(getextents(body5),[0.3,0.2,0.1]) <= 1e-4)
+        savebox(boxfilename, [0.2,0.2,0.2])
+        body6 = env.ReadKinBodyURI('test_cacheduri_ref.dae')
+        assert(transdist(getextents(body6),[0.2,0.2,0.2]) <= 1e-4)
+
+    def test_cachedurisensors(self):
+        self.log.info('test that robots loaded from the collada cache keep their attached sensors and do not depend on the first environment')
+        env=self.env
+        robotfilename = 'robots/barrett-wam-sensors.zae'
+        robot1 = env.ReadRobotURI(robotfilename)
+        env.Add(robot1)
+        assert(len(robot1.GetAttachedSensors()) > 0)
+        env2 = Environment()
+        try:
+            robot2 = env2.ReadRobotURI(robotfilename)
+            env2.Add(robot2)
+            robot3 = env2.ReadRobotURI(robotfilename, {'cache':'0'})
+            assert(len(robot2.GetAttachedSensors()) == len(robot1.GetAttachedSensors()) == len(robot3.GetAttachedSensors()))
+            for attsensor1, attsensor2 in izip(robot1.GetAttachedSensors(), robot2.GetAttachedSensors()):
+                assert(attsensor2.GetSensor() is not None)
+                assert(attsensor2.GetSensor().GetEnv() == env2)
+                assert(attsensor1.GetSensor().GetXMLId() == attsensor2.GetSensor().GetXMLId())
+            misc.CompareBodies(robot2,robot3,comparegeometries=True,comparesensors=True,comparemanipulators=True,comparegrabbed=False,comparephysics=True,computeadjacent=True,epsilon=1e-10)
+
+            # the cached robot is not tied to the environment it was first loaded in
+            env.Reset()
+            robot4 = env2.ReadRobotURI(robotfilename)
+            assert(robot4.GetAttachedSensors()[0].GetSensor().GetEnv() == env2)
+            misc.CompareBodies(robot4,robot3,comparegeometries=True,comparesensors=True,comparemanipulators=True,comparegrabbed=False,comparephysics=True,computeadjacent=True,epsilon=1e-10)
+        finally:
+            env2.Destroy()
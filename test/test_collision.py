@@ -12,6 +12,9 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 from common_test_openrave import *
+import json
+import tempfile
+import threading
 
 class RunCollision(EnvironmentSetup):
     def __init__(self,collisioncheckername):
@@ -268,6 +271,207 @@ class RunCollision(EnvironmentSetup):
         manip.CheckEndEffectorCollision(report)
         assert(len(report.vLinkColliding)==4)
 
+    def test_collisionbatch(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            lower,upper = robot.GetDOFLimits()
+            configs = array([random.rand(robot.GetDOF())*(upper-lower)+lower for i in range(20)])
+            expected = []
+            with robot:
+                for config in configs:
+                    robot.SetDOFValues(config)
+                    expected.append(env.CheckCollision(robot) or robot.CheckSelfCollision())
+            results = env.GetCollisionChecker().CheckCollisionBatch(robot,configs)
+            assert(all(results == array(expected)))
+
+            # as with CheckCollision, a disabled body is never in collision
+            robot.Enable(False)
+            assert(not env.CheckCollision(robot))
+            results = env.GetCollisionChecker().CheckCollisionBatch(robot,configs)
+            assert(len(results) == len(configs) and not any(results))
+            robot.Enable(True)
+
+    def test_collisionbatchworkers(self):
+        env=self.env
+        if self.collisioncheckername != 'fcl_':
+            return
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        checker=env.GetCollisionChecker()
+        with env:
+            lower,upper = robot.GetDOFLimits()
+            configs = array([random.rand(robot.GetDOF())*(upper-lower)+lower for i in range(50)])
+            expected = checker.CheckCollisionBatch(robot,configs)
+            checker.SendCommand('SetNumWorkerContexts 4')
+            # the worker threads are kept alive between the batches
+            for i in range(3):
+                results = checker.CheckCollisionBatch(robot,configs)
+                assert(all(results == expected))
+            checker.SendCommand('SetNumWorkerContexts 0')
+
+    def test_collisionrays(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        checker=env.GetCollisionChecker()
+        with env:
+            # rays from the middle of the room in all directions, some of them are too short to hit anything
+            dirs = random.rand(100,3)-0.5
+            lengths = 0.5+4*random.rand(100)
+            dirs *= transpose(tile(lengths/sqrt(sum(dirs**2,1)),(3,1)))
+            rays = c_[tile([0,0,1.0],(100,1)),dirs]
+            distances, bodyids = checker.CheckCollisionRaysDistances(rays)
+            assert(len(distances) == len(rays) and len(bodyids) == len(rays))
+            orgoptions = checker.GetCollisionOptions()
+            checker.SetCollisionOptions(orgoptions|CollisionOptions.Distance)
+            try:
+                report = CollisionReport()
+                for ray, distance, bodyid in izip(rays,distances,bodyids):
+                    if env.CheckCollision(Ray(ray[0:3],ray[3:6]),report):
+                        assert(abs(distance-report.minDistance) <= g_epsilon)
+                        assert(bodyid == report.plink1.GetParent().GetEnvironmentId())
+                    else:
+                        assert(distance == -1 and bodyid == 0)
+            finally:
+                checker.SetCollisionOptions(orgoptions)
+            # the options of the checker are not changed by the batch
+            checker.CheckCollisionRaysDistances(rays)
+            assert(checker.GetCollisionOptions() == orgoptions)
+
+    def test_meshcache(self):
+        env=self.env
+        with env:
+            # meshes with the same triangles share their BVH, meshes that differ must not
+            def createmesh(name, extents, translation):
+                body=RaveCreateKinBody(env,'')
+                body.InitFromTrimesh(TriMesh(*misc.ComputeBoxMesh(extents)),True)
+                body.SetName(name)
+                env.Add(body)
+                body.SetTransform(matrixFromPose([1,0,0,0]+translation))
+                return body
+
+            mesh1 = createmesh('mesh1',[0.1,0.1,0.1],[0,0,0])
+            mesh2 = createmesh('mesh2',[0.1,0.1,0.1],[1,0,0])
+            mesh3 = createmesh('mesh3',[0.3,0.3,0.3],[2,0,0])
+            probe=RaveCreateKinBody(env,'')
+            probe.InitFromBoxes(array([[0,0,0,0.02,0.02,0.02]]),True)
+            probe.SetName('probe')
+            env.Add(probe)
+
+            checkernames = [self.collisioncheckername, 'pqp']
+            for checkername in checkernames:
+                env.SetCollisionChecker(RaveCreateCollisionChecker(env,checkername))
+                for clone in [True, False]:
+                    testenv = env.CloneSelf(CloningOptions.Bodies) if clone else env
+                    if clone:
+                        testenv.SetCollisionChecker(RaveCreateCollisionChecker(testenv,checkername))
+                    try:
+                        testprobe = testenv.GetKinBody('probe')
+                        testmeshes = [testenv.GetKinBody(name) for name in ['mesh1','mesh2','mesh3']]
+                        # the meshes are hollow, so the probe only collides when it touches a face. x=2.1 is inside mesh3 and would be on the face of mesh3 if it had the BVH of mesh1
+                        testprobe.SetTransform(matrixFromPose([1,0,0,0,2.1,0,0]))
+                        assert([testenv.CheckCollision(testprobe,mesh) for mesh in testmeshes] == [False,False,False])
+                        testprobe.SetTransform(matrixFromPose([1,0,0,0,2.3,0,0]))
+                        assert([testenv.CheckCollision(testprobe,mesh) for mesh in testmeshes] == [False,False,True])
+                        testprobe.SetTransform(matrixFromPose([1,0,0,0,1.1,0,0]))
+                        assert([testenv.CheckCollision(testprobe,mesh) for mesh in testmeshes] == [False,True,False])
+                        # removing a body that shares the BVH does not affect the other
+                        testenv.Remove(testmeshes[0])
+                        assert(testenv.CheckCollision(testprobe,testmeshes[1]))
+                        testprobe.SetTransform(matrixFromPose([1,0,0,0,1.2,0,0]))
+                        assert(not testenv.CheckCollision(testprobe,testmeshes[1]))
+                    finally:
+                        if clone:
+                            testenv.Destroy()
+                mesh1 = env.GetKinBody('mesh1')
+                if mesh1 is None:
+                    createmesh('mesh1',[0.1,0.1,0.1],[0,0,0])
+
+    def test_changedbodies(self):
+        env=self.env
+        with env:
+            # the checker has to follow the bodies that changed since the last check
+            bodies = []
+            for i in range(5):
+                body=RaveCreateKinBody(env,'')
+                body.InitFromBoxes(array([[0,0,0,0.1,0.1,0.1]]),True)
+                body.SetName('box%d'%i)
+                env.Add(body)
+                body.SetTransform(matrixFromPose([1,0,0,0,i,0,0]))
+                bodies.append(body)
+            probe=RaveCreateKinBody(env,'')
+            probe.InitFromBoxes(array([[0,0,0,0.1,0.1,0.1]]),True)
+            probe.SetName('probe')
+            env.Add(probe)
+            probe.SetTransform(matrixFromPose([1,0,0,0,0,5,0]))
+            assert(not env.CheckCollision(probe))
+            for i in range(5):
+                bodies[i].SetTransform(matrixFromPose([1,0,0,0,0,5,0]))
+                assert(env.CheckCollision(probe))
+                assert(env.CheckCollision(probe,bodies[i]))
+                bodies[i].SetTransform(matrixFromPose([1,0,0,0,i,0,0]))
+                assert(not env.CheckCollision(probe))
+
+            bodies[2].SetTransform(matrixFromPose([1,0,0,0,0,5,0]))
+            assert(env.CheckCollision(probe))
+            bodies[2].Enable(False)
+            assert(not env.CheckCollision(probe))
+            bodies[2].Enable(True)
+            assert(env.CheckCollision(probe))
+            env.Remove(bodies[2])
+            assert(not env.CheckCollision(probe))
+            env.Add(bodies[2])
+            assert(env.CheckCollision(probe))
+
+            # enabling a link without moving the body
+            bodies[3].SetTransform(matrixFromPose([1,0,0,0,0,5,0]))
+            bodies[3].GetLinks()[0].Enable(False)
+            assert(not env.CheckCollision(probe,bodies[3]))
+            bodies[3].GetLinks()[0].Enable(True)
+            assert(env.CheckCollision(probe,bodies[3]))
+
+    def test_profiling(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        tracefilename = tempfile.mktemp(suffix='.json')
+        RaveSetProfilingEnabled(True)
+        RaveSetProfilingTraceEnabled(True)
+        try:
+            RaveResetProfilingStats()
+            with env:
+                for i in range(10):
+                    env.CheckCollision(robot)
+            count, totaltime, mintime, maxtime = RaveGetProfilingStats()['Environment.CheckCollision']
+            assert(count == 10 and 0 <= mintime <= maxtime <= totaltime)
+
+            # the statistics of threads that exited are kept
+            def CheckCollisions():
+                with env:
+                    for i in range(5):
+                        env.CheckCollision(robot)
+            threads = [threading.Thread(target=CheckCollisions) for i in range(2)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+            assert(RaveGetProfilingStats()['Environment.CheckCollision'][0] == 20)
+
+            RaveWriteProfilingTrace(tracefilename)
+            trace = json.load(open(tracefilename,'r'))
+            events = [event for event in trace['traceEvents'] if event['name'] == 'Environment.CheckCollision']
+            assert(len(events) == 20 and all([event['ph'] == 'X' and event['dur'] >= 0 for event in events]))
+            assert(len(set([event['tid'] for event in events])) == 3)
+
+            RaveResetProfilingStats()
+            assert(not 'Environment.CheckCollision' in RaveGetProfilingStats())
+        finally:
+            RaveSetProfilingTraceEnabled(False)
+            RaveSetProfilingEnabled(False)
+            if os.path.exists(tracefilename):
+                os.remove(tracefilename)
+
 #generate_classes(RunCollision, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunCollision):
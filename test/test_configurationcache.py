@@ -15,6 +15,8 @@ from common_test_openrave import *
 from openravepy import openravepy_configurationcache
 
 import imp
+import glob
+import struct
 
 class TestConfigurationCache(EnvironmentSetup):
     def setup(self):
@@ -146,6 +148,102 @@ class TestConfigurationCache(EnvironmentSetup):
             self.log.info('writing cache to file...')
             cachechecker.SendCommand('SaveCache')
 
+    def test_saveload(self):
+        env = self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            cachechecker = RaveCreateCollisionChecker(self.env,'CacheChecker')
+            success=cachechecker.SendCommand('TrackRobotState %s'%robot.GetName())
+            assert(success is not None)
+            env.SetCollisionChecker(cachechecker)
+            robot.SetSelfCollisionChecker(cachechecker)
+            sampler = RaveCreateSpaceSampler(env, u'RobotConfiguration %s'%robot.GetName())
+            report=CollisionReport()
+
+            cachechecker.SendCommand('ResetSelfCache')
+            for iter in range(0, 200):
+                robot.SetActiveDOFValues(sampler.SampleSequence(SampleDataType.Real,1))
+                env.GetCollisionChecker().CheckSelfCollision(robot, report=report)
+            selfcachesize = int(cachechecker.SendCommand('GetSelfCacheStatistics').split()[3])
+            assert(selfcachesize > 0)
+
+            stime = time.time()
+            cachechecker.SendCommand('SaveCache')
+            cachefilenames = [filename for filename in glob.glob(os.path.join(RaveGetHomeDirectory(), 'selfcache.*')) if not filename.endswith('.tmp') and os.path.getmtime(filename) >= stime-1]
+            assert(len(cachefilenames) > 0)
+            cachefilename = max(cachefilenames, key=os.path.getmtime)
+
+            cachechecker.SendCommand('ResetSelfCache')
+            assert(int(cachechecker.SendCommand('GetSelfCacheStatistics').split()[3]) == 0)
+            cachechecker.SendCommand('LoadCache')
+            assert(int(cachechecker.SendCommand('GetSelfCacheStatistics').split()[3]) == selfcachesize)
+            assert(int(cachechecker.SendCommand('ValidateSelfCache')) == 1)
+
+            # corrupted files have to be ignored without touching memory outside of the file. the header is the first 72 bytes
+            data = open(cachefilename, 'rb').read()
+            for corrupteddata in [data[:len(data)//2], data[:72] + '\xff'*(len(data)-72)]:
+                open(cachefilename, 'wb').write(corrupteddata)
+                cachechecker.SendCommand('ResetSelfCache')
+                cachechecker.SendCommand('LoadCache')
+                assert(int(cachechecker.SendCommand('GetSelfCacheStatistics').split()[3]) == 0)
+
+            # a child that is not below its parent could make a cycle. the node records follow the header and the weights, every record starts with the level (int16), numchildren (uint32 at 20) and childoffset (uint64 at 24)
+            statedof, maxlevel = struct.unpack_from('<ii', data, 20)
+            numnodes, = struct.unpack_from('<I', data, 32)
+            noderecordsize = 32+8*statedof
+            pnoderecords = 72+8*statedof
+            pchildindices = pnoderecords+noderecordsize*numnodes
+            cyclicdata = bytearray(data)
+            for inode in range(numnodes):
+                level, = struct.unpack_from('<h', data, pnoderecords+inode*noderecordsize)
+                numchildren, childoffset = struct.unpack_from('<IQ', data, pnoderecords+inode*noderecordsize+20)
+                # below the root, so that the file is only rejected because of the child level
+                if numchildren > 0 and level < maxlevel:
+                    childindex, = struct.unpack_from('<I', data, pchildindices+4*childoffset)
+                    struct.pack_into('<h', cyclicdata, pnoderecords+childindex*noderecordsize, level)
+                    break
+            open(cachefilename, 'wb').write(cyclicdata)
+            cachechecker.SendCommand('ResetSelfCache')
+            cachechecker.SendCommand('LoadCache')
+            assert(int(cachechecker.SendCommand('GetSelfCacheStatistics').split()[3]) == 0)
+            os.remove(cachefilename)
+
+    def test_jitterthreads(self):
+        self.log.info('parallel jittering has to return the same configuration as the serial jittering')
+        env = self.env
+        with env:
+            robot = RaveCreateRobot(env,'')
+            robot.InitFromBoxes(array([[0,0,0,0.1,0.1,0.1]]),True)
+            robot.SetName('boxrobot')
+            env.Add(robot)
+            obstacle = RaveCreateKinBody(env,'')
+            obstacle.InitFromBoxes(array([[0,0,0,0.1,0.1,0.1]]),True)
+            obstacle.SetName('obstacle')
+            env.Add(obstacle)
+            obstacle.SetTransform(matrixFromPose([1,0,0,0,0.08,0.06,0]))
+            robot.SetActiveDOFs([], DOFAffine.X | DOFAffine.Y)
+            robot.SetAffineTranslationLimits([-1,-1,-1],[1,1,1])
+            assert(env.CheckCollision(robot))
+            results = []
+            for numthreads, blocksize in [(0,32), (2,1), (2,7), (4,32)]:
+                robot.SetActiveDOFValues([0,0])
+                jitterer = RaveCreateSpaceSampler(env, 'configurationjitterer boxrobot')
+                jitterer.SendCommand('SetMaxJitter 0.3')
+                jitterer.SendCommand('SetMaxLinkDistThresh 0.5')
+                jitterer.SendCommand('SetResultOnRobot 0')
+                jitterer.SendCommand('SetNumThreads %d %d'%(numthreads, blocksize))
+                jitterer.SetSeed(7)
+                values = jitterer.SampleSequence(SampleDataType.Real,1)
+                assert(len(values) == 2)
+                assert(transdist(robot.GetActiveDOFValues(), [0,0]) <= g_epsilon)
+                results.append(values)
+            for values in results[1:]:
+                assert(transdist(values, results[0]) <= g_epsilon)
+            robot.SetActiveDOFValues(results[0])
+            assert(not env.CheckCollision(robot))
+
     def test_find_insert(self):
 
         self.LoadEnv('data/lab1.env.xml')
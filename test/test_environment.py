@@ -14,6 +14,8 @@
 from common_test_openrave import *
 from subprocess import Popen, PIPE
 import shutil
+import sys
+import tempfile
 import threading
 
 class TestEnvironment(EnvironmentSetup):
@@ -233,6 +235,50 @@ class TestEnvironment(EnvironmentSetup):
             env2.Destroy()
             RaveDestroy()
             
+    def test_publishedbodies(self):
+        self.log.info('test that the published bodies report only what changed between versions')
+        env=self.env
+        with env:
+            bodies = []
+            for i in range(3):
+                body = RaveCreateKinBody(env,'')
+                body.InitFromBoxes(array([[0,0,0,0.1,0.1,0.1]]),True)
+                body.SetName('box%d'%i)
+                env.Add(body)
+                bodies.append(body)
+            env.UpdatePublishedBodies()
+            incremental, changed, removed, version = env.GetPublishedBodiesChangedSince(0)
+            assert(incremental)
+            assert(sorted([state['name'] for state in changed]) == ['box0','box1','box2'])
+            assert(len(removed) == 0)
+
+            # nothing changed, so the states are shared with the previous version
+            env.UpdatePublishedBodies()
+            incremental, changed, removed, newversion = env.GetPublishedBodiesChangedSince(version)
+            assert(incremental and len(changed) == 0 and len(removed) == 0 and newversion > version)
+            version = newversion
+
+            bodies[1].SetTransform(matrixFromPose([1,0,0,0,1,2,3]))
+            env.UpdatePublishedBodies()
+            incremental, changed, removed, newversion = env.GetPublishedBodiesChangedSince(version)
+            assert(incremental and len(removed) == 0)
+            assert([state['name'] for state in changed] == ['box1'])
+            assert(transdist(changed[0]['linktransforms'][0], bodies[1].GetTransform()) <= g_epsilon)
+            assert(transdist(env.GetPublishedBody('box1')['linktransforms'][0], bodies[1].GetTransform()) <= g_epsilon)
+            version = newversion
+
+            removedid = bodies[2].GetEnvironmentId()
+            env.Remove(bodies[2])
+            env.UpdatePublishedBodies()
+            incremental, changed, removed, newversion = env.GetPublishedBodiesChangedSince(version)
+            assert(incremental and len(changed) == 0 and removed == [removedid])
+            assert(env.GetPublishedBody('box2') is None)
+
+            # a version that was never published gives all the bodies
+            incremental, changed, removed, newversion = env.GetPublishedBodiesChangedSince(newversion+1000)
+            assert(not incremental and len(removed) == 0)
+            assert(sorted([state['name'] for state in changed]) == ['box0','box1'])
+
     def test_load_cwd(self):
         env=self.env
         oldcwd = os.getcwd()
@@ -243,7 +289,63 @@ class TestEnvironment(EnvironmentSetup):
             assert(env.Load('box0.dae'))
         finally:
             os.chdir(oldcwd)
-    
+
+    def test_trimeshcache(self):
+        env=self.env
+        tempdir = tempfile.mkdtemp()
+        meshfilename = os.path.join(tempdir,'tetrahedron.obj')
+        def WriteMesh(size, mtime):
+            # same length of file for all sizes, so that only the modification time can tell the meshes apart
+            open(meshfilename,'w').write('v 0.000 0.000 0.000\nv %.3f 0.000 0.000\nv 0.000 %.3f 0.000\nv 0.000 0.000 %.3f\nf 1 3 2\nf 1 2 4\nf 1 4 3\nf 2 3 4\n'%(size,size,size))
+            os.utime(meshfilename,(mtime,mtime))
+        def ReadMeshSize(scale=1):
+            return max(env.ReadTrimeshURI(meshfilename,{'scalegeometry':str(scale)}).vertices[:,0])
+        def ReadMeshSizeInNewProcess():
+            # a new process only has the sidecar file and not the cache of this process
+            script = 'from openravepy import *\nenv=Environment()\nprint "meshsize=%%f"%%max(env.ReadTrimeshURI(%r).vertices[:,0])\nRaveDestroy()\n'%meshfilename
+            output = Popen([sys.executable,'-c',script],stdout=PIPE,stderr=PIPE).communicate()[0]
+            for line in output.splitlines():
+                if line.startswith('meshsize='):
+                    return float(line[len('meshsize='):])
+            raise ValueError('failed to read %s in a new process: %s'%(meshfilename,output))
+
+        oldsidecar = os.environ.get('OPENRAVE_TRIMESH_SIDECAR',None)
+        os.environ['OPENRAVE_TRIMESH_SIDECAR'] = '1'
+        try:
+            sidecarfilename = meshfilename+'.ortrimesh'
+            WriteMesh(1,1000000000)
+            # both scales come from the same cached mesh
+            assert(abs(ReadMeshSize(1)-1) <= g_epsilon)
+            assert(abs(ReadMeshSize(2)-2) <= g_epsilon)
+            assert(os.path.exists(sidecarfilename))
+
+            # a mesh with the same size and modification time is read from the sidecar
+            WriteMesh(3,1000000000)
+            assert(abs(ReadMeshSizeInNewProcess()-1) <= g_epsilon)
+
+            # a change within the same second is detected by the cache and the sidecar
+            WriteMesh(3,1000000000.5)
+            assert(abs(ReadMeshSize()-3) <= g_epsilon)
+            assert(abs(ReadMeshSizeInNewProcess()-3) <= g_epsilon)
+
+            # truncated and corrupt sidecars are rejected and rewritten
+            sidecardata = open(sidecarfilename,'rb').read()
+            open(sidecarfilename,'wb').write(sidecardata[:-4])
+            WriteMesh(5,1000000000.5)
+            assert(abs(ReadMeshSizeInNewProcess()-5) <= g_epsilon)
+            sidecardata = open(sidecarfilename,'rb').read()
+            open(sidecarfilename,'wb').write('garbage!'+sidecardata[8:])
+            WriteMesh(6,1000000000.5)
+            assert(abs(ReadMeshSizeInNewProcess()-6) <= g_epsilon)
+            WriteMesh(7,1000000000.5)
+            assert(abs(ReadMeshSizeInNewProcess()-6) <= g_epsilon)
+        finally:
+            if oldsidecar is None:
+                del os.environ['OPENRAVE_TRIMESH_SIDECAR']
+            else:
+                os.environ['OPENRAVE_TRIMESH_SIDECAR'] = oldsidecar
+            shutil.rmtree(tempdir)
+
 
     def test_trylock(self):
         env=self.env
@@ -166,6 +166,37 @@ class TestIkSolver(EnvironmentSetup):
             ikreturn = solver.Solve(ikparam2,None, IkFilterOptions.CheckEnvCollisions)
             assert( ikreturn.GetAction() == expectedaction)
         
+    def test_parallelsolveall(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        ikmodel = databases.inversekinematics.InverseKinematicsModel(robot,IkParameterization.Type.Transform6D)
+        if not ikmodel.load():
+            ikmodel.autogenerate()
+
+        solver=ikmodel.manip.GetIkSolver()
+        with env:
+            # second configuration has the end effector in collision, which quits the search
+            for values in [[0.4,0.4],[pi/2,1]]:
+                robot.SetDOFValues(values,[1,3])
+                ikparam = ikmodel.manip.GetIkParameterization(IkParameterizationType.Transform6D)
+                solver.SendCommand('SetNumThreads 0')
+                sols = ikmodel.manip.FindIKSolutions(ikparam,IkFilterOptions.CheckEnvCollisions)
+                solver.SendCommand('SetNumThreads 4')
+                assert(int(solver.SendCommand('GetNumThreads'))==4)
+                parallelsols = ikmodel.manip.FindIKSolutions(ikparam,IkFilterOptions.CheckEnvCollisions)
+                assert(len(sols)==len(parallelsols))
+                assert(transdist(sols,parallelsols) == 0)
+
+            # clones do not start their own worker threads
+            clonedenv = env.CloneSelf(CloningOptions.Bodies)
+            try:
+                clonedrobot = clonedenv.GetRobot(robot.GetName())
+                assert(int(clonedrobot.GetManipulator(ikmodel.manip.GetName()).GetIkSolver().SendCommand('GetNumThreads'))==0)
+            finally:
+                clonedenv.Destroy()
+            solver.SendCommand('SetNumThreads 0')
+
     def test_customikvalues(self):
         env=self.env
         self.LoadEnv('data/lab1.env.xml')
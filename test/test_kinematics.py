@@ -875,6 +875,52 @@ class TestKinematics(EnvironmentSetup):
         assert(J0a.GetMimicDOFIndices() == [0])
         assert(J0b.GetMimicDOFIndices() == [0])
 
+    def test_linktransformsbatch(self):
+        self.log.info('check that the batch forward kinematics matches SetDOFValues and does not change the body')
+        env=self.env
+        xml="""
+<kinbody name="mimicbody">
+  <body name="L0">
+  </body>
+  <body name="L1">
+  </body>
+  <body name="L2">
+  </body>
+  <joint name="J0" type="hinge">
+    <body>L0</body>
+    <body>L1</body>
+    <axis>1 0 0</axis>
+    <limitsdeg>-90 90</limitsdeg>
+  </joint>
+  <joint name="J0a" type="hinge" mimic_pos="0.5*J0" mimic_vel="|J0 0.5" mimic_accel="|J0 0">
+    <body>L1</body>
+    <body>L2</body>
+    <axis>0 1 0</axis>
+    <anchor>0 0 0.2</anchor>
+  </joint>
+</kinbody>
+"""
+        with env:
+            env.Add(env.ReadKinBodyData(xml))
+            for robotfile in g_robotfiles:
+                self.LoadEnv(robotfile)
+            for body in env.GetBodies():
+                lowerlimit,upperlimit = body.GetDOFLimits()
+                lowerlimit = numpy.maximum(lowerlimit,-pi)
+                upperlimit = numpy.minimum(upperlimit,pi)
+                # more than one block of configurations
+                configs = array([randlimits(lowerlimit,upperlimit) for i in range(37)])
+                orgvalues = body.GetDOFValues()
+                orgtransforms = body.GetLinkTransformations()
+                batchtransforms = body.ComputeLinkTransformsBatch(configs)
+                assert(len(batchtransforms)==len(configs))
+                assert(transdist(body.GetDOFValues(),orgvalues) == 0)
+                assert(transdist(body.GetLinkTransformations(),orgtransforms) == 0)
+                with body:
+                    for config, transforms in izip(configs,batchtransforms):
+                        body.SetDOFValues(config,range(body.GetDOF()),KinBody.CheckLimitsAction.Nothing)
+                        assert(transdist(body.GetLinkTransformations(),transforms) <= g_epsilon*len(transforms))
+
     def test_specification(self):
         env=self.env
         self.LoadEnv('data/lab1.env.xml')
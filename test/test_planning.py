@@ -615,6 +615,183 @@ class RunPlanning(EnvironmentSetup):
             assert(success)
             assert(not env.CheckCollision(collisionbody))
 
+    def test_dynamicscollisionconstraint(self):
+        env=self.env
+        with env:
+            robot = RaveCreateRobot(env,'')
+            robot.InitFromBoxes(array([[0,0,0,0.05,0.05,0.05]]),True)
+            robot.SetName('box')
+            env.Add(robot)
+            obstacle = RaveCreateKinBody(env,'')
+            obstacle.InitFromBoxes(array([[0,0,0,0.05,0.05,0.05]]),True)
+            obstacle.SetName('obstacle')
+            env.Add(obstacle)
+            obstacle.SetTransform(matrixFromPose([1,0,0,0,0.5,0,0]))
+            robot.SetActiveDOFs([],DOFAffine.X|DOFAffine.Y|DOFAffine.Z)
+            parameters = Planner.PlannerParameters()
+            parameters.SetRobotActiveJoints(robot)
+            filtermask = 0xffffffff&~4 # without CFO_CheckTimeBasedConstraints
+            sequential = planningutils.DynamicsCollisionConstraint(parameters,[robot],filtermask)
+            bisection = planningutils.DynamicsCollisionConstraint(parameters,[robot],filtermask)
+            bisection.SetEdgeCheckOrder(1)
+            # the bisection order has to report the same earliest invalid time
+            q0 = [0,0,0]
+            q1 = [1,0,0]
+            ret0 = sequential.Check(q0,q1,[],[],0,Interval.Closed,0xffff,True)
+            ret1 = bisection.Check(q0,q1,[],[],0,Interval.Closed,0xffff,True)
+            assert(ret0['returncode'] != 0 and ret1['returncode'] == ret0['returncode'])
+            assert(abs(ret0['fTimeWhenInvalid']-ret1['fTimeWhenInvalid']) <= g_epsilon)
+            # the bisection pass only runs without a filterreturn, it has to reject the segment with the same code
+            assert(bisection.GetNumBisectionRejections() == 0)
+            assert(bisection.Check(q0,q1,[],[],0,Interval.Closed) == sequential.Check(q0,q1,[],[],0,Interval.Closed) != 0)
+            assert(bisection.GetNumBisectionRejections() == 1)
+            assert(bisection.Check([0,1,0],[1,1,0],[],[],0,Interval.Closed) == 0)
+            assert(bisection.GetNumBisectionRejections() == 1)
+
+            # validated segments have to be dropped when the environment changes
+            cached = planningutils.DynamicsCollisionConstraint(parameters,[robot],filtermask)
+            cached.SetValidatedSegmentCacheSize(16)
+            q0 = [0,1,0]
+            q1 = [1,1,0]
+            assert(cached.Check(q0,q1,[],[],0,Interval.Closed) == 0)
+            assert(cached.GetNumValidatedSegmentHits() == 0)
+            assert(cached.Check(q0,q1,[],[],0,Interval.Open) == 0)
+            assert(cached.Check(q0,q1,[],[],0,Interval.Closed) == 0)
+            assert(cached.GetNumValidatedSegmentHits() == 2)
+            obstacle.SetTransform(matrixFromPose([1,0,0,0,0.5,1,0]))
+            assert(cached.Check(q0,q1,[],[],0,Interval.Closed) != 0)
+            obstacle.SetTransform(matrixFromPose([1,0,0,0,0.5,0,0]))
+            assert(cached.Check(q0,q1,[],[],0,Interval.Closed) == 0)
+            assert(cached.GetNumValidatedSegmentHits() == 2)
+            obstacle2 = RaveCreateKinBody(env,'')
+            obstacle2.InitFromBoxes(array([[0.3,1,0,0.05,0.05,0.05]]),True)
+            obstacle2.SetName('obstacle2')
+            env.Add(obstacle2)
+            assert(cached.Check(q0,q1,[],[],0,Interval.Closed) != 0)
+            env.Remove(obstacle2)
+            assert(cached.Check(q0,q1,[],[],0,Interval.Closed) == 0)
+
+    def test_graspthreaded(self):
+        self.log.info('GraspThreaded returns the same grasps for any number of threads and when its workers are reused')
+        env=self.env
+        robot = self.LoadRobot('robots/barretthand.robot.xml')
+        target = env.ReadKinBodyURI('data/mug1.kinbody.xml')
+        env.Add(target,True)
+        gmodel = databases.grasping.GraspingModel(robot=robot,target=target)
+        with env:
+            manip = robot.GetActiveManipulator()
+            with target:
+                target.Enable(False)
+                taskmanip = interfaces.TaskManipulation(robot)
+                final,traj = taskmanip.ReleaseFingers(execute=False,outputfinal=True)
+            approachrays = gmodel.computeBoxApproachRays(delta=0.04,normalanglerange=0)[::4]
+            approachrays[:,3:6] = -approachrays[:,3:6]
+            robot.SetTransform(eye(4))
+            robot.SetActiveDOFs(manip.GetGripperIndices(),DOFAffine.X+DOFAffine.Y+DOFAffine.Z)
+            grasper = interfaces.Grasper(robot)
+            graspargs = dict(approachrays=approachrays, standoffs=array([0,0.025]), preshapes=array([final]), rolls=arange(0,2*pi,pi/2), manipulatordirections=array([manip.GetLocalToolDirection()]), target=target, forceclosurethreshold=0)
+            expectednextid, expectedgrasps = grasper.GraspThreaded(numthreads=1, **graspargs)
+            assert(len(expectedgrasps) > 0)
+            for numthreads in [3,3,2]:
+                nextid, grasps = grasper.GraspThreaded(numthreads=numthreads, **graspargs)
+                assert(nextid == expectednextid and len(grasps) == len(expectedgrasps))
+                for grasp, expectedgrasp in izip(grasps, expectedgrasps):
+                    # position, direction, roll, standoff are the inputs of the grasp, so the order has to match
+                    assert(transdist(grasp[0],expectedgrasp[0]) <= g_epsilon and transdist(grasp[1],expectedgrasp[1]) <= g_epsilon)
+                    assert(abs(grasp[2]-expectedgrasp[2]) <= g_epsilon and abs(grasp[3]-expectedgrasp[3]) <= g_epsilon)
+                    assert(transdist(grasp[8],expectedgrasp[8]) <= g_epsilon)
+                    assert(transdist(grasp[9],expectedgrasp[9]) <= g_epsilon)
+
+    def test_graspthreadedasync(self):
+        self.log.info('GraspThreaded streams its grasps in id order, can be stopped and resumed, and maxgrasps does not depend on the number of threads')
+        env=self.env
+        robot = self.LoadRobot('robots/barretthand.robot.xml')
+        target = env.ReadKinBodyURI('data/mug1.kinbody.xml')
+        env.Add(target,True)
+        gmodel = databases.grasping.GraspingModel(robot=robot,target=target)
+        with env:
+            manip = robot.GetActiveManipulator()
+            with target:
+                target.Enable(False)
+                taskmanip = interfaces.TaskManipulation(robot)
+                final,traj = taskmanip.ReleaseFingers(execute=False,outputfinal=True)
+            approachrays = gmodel.computeBoxApproachRays(delta=0.04,normalanglerange=0)[::4]
+            approachrays[:,3:6] = -approachrays[:,3:6]
+            robot.SetTransform(eye(4))
+            robot.SetActiveDOFs(manip.GetGripperIndices(),DOFAffine.X+DOFAffine.Y+DOFAffine.Z)
+            grasper = interfaces.Grasper(robot)
+            graspargs = dict(approachrays=approachrays, standoffs=array([0,0.025]), preshapes=array([final]), rolls=arange(0,2*pi,pi/2), manipulatordirections=array([manip.GetLocalToolDirection()]), target=target, forceclosurethreshold=0)
+            expectednextid, expectedgrasps = grasper.GraspThreaded(numthreads=1, **graspargs)
+            assert(len(expectedgrasps) > 3)
+
+        def checkgrasps(grasps, expectedgrasps):
+            assert(len(grasps) == len(expectedgrasps))
+            for grasp, expectedgrasp in izip(grasps, expectedgrasps):
+                assert(transdist(grasp[0],expectedgrasp[0]) <= g_epsilon and transdist(grasp[1],expectedgrasp[1]) <= g_epsilon)
+                assert(abs(grasp[2]-expectedgrasp[2]) <= g_epsilon and abs(grasp[3]-expectedgrasp[3]) <= g_epsilon)
+
+        # the workers use their own environments, so polling does not need to lock env
+        numgrasps = grasper.StartGraspThreaded(numthreads=3, **graspargs)
+        grasps = []
+        done = False
+        while not done:
+            done, nextid, newgrasps = grasper.GetGraspThreadedResults()
+            grasps += newgrasps
+            if not done:
+                time.sleep(0.01)
+        # results that finished after the last poll
+        done, nextid, newgrasps = grasper.GetGraspThreadedResults()
+        grasps += newgrasps
+        assert(nextid == expectednextid == numgrasps)
+        checkgrasps(grasps, expectedgrasps)
+
+        # stop in the middle and resume from the returned index
+        grasper.StartGraspThreaded(numthreads=3, **graspargs)
+        time.sleep(0.5)
+        grasper.StopGraspThreaded()
+        done, nextid, grasps = grasper.GetGraspThreadedResults()
+        assert(done and nextid <= numgrasps)
+        with env:
+            nextid, newgrasps = grasper.GraspThreaded(numthreads=2, startindex=nextid, **graspargs)
+        assert(nextid == expectednextid)
+        checkgrasps(grasps+newgrasps, expectedgrasps)
+
+        # maxgrasps returns the first successful grasps in id order
+        with env:
+            nextid1, grasps1 = grasper.GraspThreaded(numthreads=1, maxgrasps=3, **graspargs)
+            nextid3, grasps3 = grasper.GraspThreaded(numthreads=3, maxgrasps=3, **graspargs)
+        assert(nextid1 == nextid3)
+        checkgrasps(grasps1, expectedgrasps[:3])
+        checkgrasps(grasps3, expectedgrasps[:3])
+
+    def test_visibilityocclusion(self):
+        self.log.info('VisualFeedback gives the same visibility with the batched rays and with the collision callback of ignoresensorcollision')
+        env=self.env
+        robot = self.LoadRobot('robots/barrettwam.robot.xml')
+        camera = self.LoadRobot('data/camera.robot.xml')
+        with env:
+            # the camera looks down at the target from 1m
+            camera.SetTransform(matrixFromPose([0,1,0,0,1,0,2]))
+            target = RaveCreateKinBody(env,'')
+            target.InitFromBoxes(array([[0,0,0,0.05,0.05,0.05]]),True)
+            target.SetName('target')
+            env.Add(target,True)
+            target.SetTransform(matrixFromPose([1,0,0,0,1,0,1]))
+            obstacle = RaveCreateKinBody(env,'')
+            obstacle.InitFromBoxes(array([[0,0,0,0.1,0.1,0.1]]),True)
+            obstacle.SetName('obstacle')
+            env.Add(obstacle,True)
+            for ignoresensorcollision in [False,True]:
+                vf = interfaces.VisualFeedback(robot,ignoresensorcollision=ignoresensorcollision)
+                vf.SetCameraAndTarget(sensorrobot=camera,sensorname='camera',targetlink=target.GetLinks()[0],manipname='arm')
+                obstacle.SetTransform(matrixFromPose([1,0,0,0,5,5,5]))
+                assert(vf.ComputeVisibility())
+                # between the camera and the target
+                obstacle.SetTransform(matrixFromPose([1,0,0,0,1,0,1.5]))
+                assert(not vf.ComputeVisibility())
+                assert(vf.ComputeVisibility(checkocclusion=False))
+                del vf
+
 #generate_classes(RunPlanning, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunPlanning):
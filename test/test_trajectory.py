@@ -293,6 +293,36 @@ class TestTrajectory(EnvironmentSetup):
                 data2 = traj2.Sample(t)
                 assert( transdist(data1,data2) <= g_epsilon)
 
+    def test_smoothingthreaded(self):
+        env = self.env
+        self.LoadEnv('data/katanatable.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            robot.SetActiveDOFs(range(5))
+            origvalues = robot.GetActiveDOFValues()
+            smoother = RaveCreatePlanner(env,'parabolicsmoother')
+            smoother.SendCommand('SetNumThreads 4')
+            assert(int(smoother.SendCommand('GetNumThreads')) == 4)
+            traj = RaveCreateTrajectory(env,'')
+            traj.Init(robot.GetActiveConfigurationSpecification())
+            traj.Insert(0,origvalues)
+            traj.Insert(1,[ 2.299995  , -0.43290472, -1.34459131,  1.18628988,  2.14568385])
+            traj.Insert(2,origvalues)
+            traj.Insert(3,[ 2.299995  , -0.43290472, -1.34459131,  1.18628988,  2.14568385])
+            planningutils.RetimeActiveDOFTrajectory(traj,robot,False,plannername='parabolictrajectoryretimer')
+            duration = traj.GetDuration()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetExtraParameters('<_nmaxiterations>100</_nmaxiterations>')
+            # the shortcuts of the workers are committed only if they pass the constraints of the original environment
+            assert(smoother.InitPlan(robot,params))
+            assert(smoother.PlanPath(traj) == PlannerStatus.HasSolution)
+            assert(traj.GetDuration() <= duration+g_epsilon)
+            parameters = Planner.PlannerParameters()
+            parameters.SetRobotActiveJoints(robot)
+            planningutils.VerifyTrajectory(parameters,traj,samplingstep=0.002)
+            self.RunTrajectory(robot,traj)
+
     def test_multipleretiming(self):
         env=self.env
         env.Load('robots/barrettwam.robot.xml')
@@ -599,6 +629,39 @@ class TestTrajectory(EnvironmentSetup):
         assert(traj.GetWaypoint(0,g)==55)
         assert(traj.GetWaypoint(1,ConfigurationSpecification(g))==56)
 
+    def test_binaryserialization(self):
+        env=self.env
+        trajspec = ConfigurationSpecification()
+        trajspec.AddGroup('joint_values',3,'linear')
+        trajspec.AddDeltaTimeGroup()
+        traj = RaveCreateTrajectory(env,'')
+        traj.Init(trajspec)
+        traj.SetDescription('binary test')
+        orgpoints = random.rand(50*trajspec.GetDOF())
+        traj.Insert(0,orgpoints)
+        
+        trajdata = traj.serialize(SerializationOptions.TrajectoryBinary)
+        assert(trajdata.startswith('\x89ORTRAJ\x1a'))
+        traj2 = RaveCreateTrajectory(env,'').deserialize(trajdata)
+        assert(traj2.GetNumWaypoints()==traj.GetNumWaypoints())
+        assert(traj2.GetConfigurationSpecification()==trajspec)
+        assert(traj2.GetDescription()==traj.GetDescription())
+        assert(transdist(traj2.GetWaypoints(0,traj2.GetNumWaypoints()),orgpoints) == 0)
+        
+        # trajectory without waypoints
+        traj.Remove(0,traj.GetNumWaypoints())
+        traj3 = RaveCreateTrajectory(env,'').deserialize(traj.serialize(SerializationOptions.TrajectoryBinary))
+        assert(traj3.GetNumWaypoints()==0)
+        assert(traj3.GetConfigurationSpecification()==trajspec)
+        
+        # truncated data and a corrupted number of waypoints have to throw rather than allocate
+        for baddata in [trajdata[:len(trajdata)-4], trajdata[:16]+'\xff'*8+trajdata[24:]]:
+            try:
+                RaveCreateTrajectory(env,'').deserialize(baddata)
+                assert(False)
+            except openrave_exception:
+                pass
+        
     def test_robotdoortraj(self):
         env=self.env
         self.LoadEnv('data/wam_cabinet.env.xml')
@@ -678,6 +741,60 @@ class TestTrajectory(EnvironmentSetup):
             self.RunTrajectory(robot,rtraj1)
             assert( transdist(originalvalues, robot.GetConfigurationValues()) <= g_epsilon)
 
+    def test_samplespecifications(self):
+        self.log.info('sample trajectories while switching between specifications, the trajectory and the retimer keep their conversion plans')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            robot.SetActiveDOFs(range(7))
+            retimer = planningutils.ActiveDOFTrajectoryRetimer(robot, 'parabolictrajectoryretimer', '')
+            trajs = []
+            for delta in [0.3, 0.6]:
+                traj = RaveCreateTrajectory(env,'')
+                traj.Init(robot.GetActiveConfigurationSpecification())
+                traj.Insert(0,robot.GetActiveDOFValues())
+                traj.Insert(1,robot.GetActiveDOFValues()+delta*ones(robot.GetActiveDOF()))
+                assert(retimer.PlanPath(traj)==PlannerStatus.HasSolution)
+                trajs.append(traj)
+            assert(trajs[1].GetDuration() > trajs[0].GetDuration())
+            posspec = robot.GetActiveConfigurationSpecification()
+            velspec = posspec.ConvertToVelocitySpecification()
+            for traj in trajs:
+                spec = traj.GetConfigurationSpecification()
+                for t in linspace(0, traj.GetDuration(), 10):
+                    data = traj.Sample(t)
+                    values = spec.ExtractJointValues(data, robot, robot.GetActiveDOFIndices(), 0)
+                    velocities = spec.ExtractJointValues(data, robot, robot.GetActiveDOFIndices(), 1)
+                    assert(transdist(traj.Sample(t, posspec), values) <= g_epsilon)
+                    assert(transdist(traj.Sample(t, velspec), velocities) <= g_epsilon)
+                    assert(transdist(traj.Sample(t), data) <= g_epsilon)
+                    assert(transdist(traj.Sample(t, posspec), values) <= g_epsilon)
+
+    def test_samplerange(self):
+        self.log.info('SampleRange2D gives the same samples as Sample, including times past the end of the trajectory')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            robot.SetActiveDOFs(range(7))
+            posspec = robot.GetActiveConfigurationSpecification()
+            for interpolation in ['linear', 'quadratic']:
+                traj = RaveCreateTrajectory(env,'')
+                traj.Init(robot.GetActiveConfigurationSpecification())
+                for i in range(4):
+                    traj.Insert(i,robot.GetActiveDOFValues()+0.2*i*ones(robot.GetActiveDOF()))
+                plannername = 'lineartrajectoryretimer' if interpolation == 'linear' else 'parabolictrajectoryretimer'
+                assert(planningutils.RetimeActiveDOFTrajectory(traj,robot,False,1,1,plannername) == PlannerStatus.HasSolution)
+                for spec in [traj.GetConfigurationSpecification(), posspec]:
+                    numsamples = 41
+                    deltatime = 1.1*traj.GetDuration()/(numsamples-1)
+                    samples = traj.SampleRange2D(0.01, deltatime, numsamples, spec)
+                    assert(samples.shape == (numsamples, spec.GetDOF()))
+                    for i in range(numsamples):
+                        assert(transdist(samples[i], traj.Sample(0.01+i*deltatime, spec)) <= g_epsilon)
+                    assert(traj.SampleRange2D(0, deltatime, 0, spec).shape == (0, spec.GetDOF()))
+
     def test_worktraj(self):
         self.log.debug('test workspace trajerctory with ikparameterization')
         env=self.env